@@ -0,0 +1,1182 @@
+#include "AnnotationIO.h"
+
+#include <cmath>
+#include <cstring>
+#include <QFileInfo>
+#include <QThread>
+#include <QtConcurrent/QtConcurrentMap>
+#include <QDebug>
+
+namespace
+{
+const double CoordinateLimit = 1.0e9;
+
+int toCoordinate(double value)
+{
+    return qRound(qBound(-CoordinateLimit, value, CoordinateLimit));
+}
+
+bool isSpace(char c)
+{
+    return (c == ' ') || (c == '\t') || (c == '\n') || (c == '\r');
+}
+
+void skipSpace(const char *&p, const char *end)
+{
+    while ((p < end) && isSpace(*p))
+    {
+        p++;
+    }
+}
+
+bool expect(const char *&p, const char *end, char c)
+{
+    skipSpace(p, end);
+    if ((p < end) && (*p == c))
+    {
+        p++;
+        return true;
+    }
+
+    return false;
+}
+
+bool keyEquals(const char *begin, const char *end, const char *key)
+{
+    size_t length = std::strlen(key);
+    return (size_t(end - begin) == length) && (std::memcmp(begin, key, length) == 0);
+}
+
+/**
+ * @brief parseNumber 解析十进制数（可带小数和指数），失败时p不变。
+ */
+bool parseNumber(const char *&p, const char *end, double &value)
+{
+    const char *start = p;
+    bool negative = false;
+    bool hasDigits = false;
+    double result = 0.0;
+
+    if ((p < end) && ((*p == '-') || (*p == '+')))
+    {
+        negative = (*p == '-');
+        p++;
+    }
+
+    while ((p < end) && (*p >= '0') && (*p <= '9'))
+    {
+        result = result * 10.0 + (*p - '0');
+        hasDigits = true;
+        p++;
+    }
+
+    if ((p < end) && (*p == '.'))
+    {
+        double scale = 0.1;
+        p++;
+        while ((p < end) && (*p >= '0') && (*p <= '9'))
+        {
+            result += (*p - '0') * scale;
+            scale *= 0.1;
+            hasDigits = true;
+            p++;
+        }
+    }
+
+    if (hasDigits && (p < end) && ((*p == 'e') || (*p == 'E')))
+    {
+        int sign = 1;
+        int exponent = 0;
+        p++;
+        if ((p < end) && ((*p == '-') || (*p == '+')))
+        {
+            sign = (*p == '-') ? -1 : 1;
+            p++;
+        }
+        while ((p < end) && (*p >= '0') && (*p <= '9'))
+        {
+            exponent = qMin(exponent * 10 + (*p - '0'), 400);
+            p++;
+        }
+        result *= std::pow(10.0, sign * exponent);
+    }
+
+    if (!hasDigits)
+    {
+        p = start;
+        return false;
+    }
+
+    value = negative ? -result : result;
+    return true;
+}
+
+/**
+ * @brief parseString 解析JSON字符串，[begin, stop)为引号内的原始内容（不处理转义）。
+ */
+bool parseString(const char *&p, const char *end, const char *&begin, const char *&stop)
+{
+    skipSpace(p, end);
+    if ((p >= end) || (*p != '"'))
+    {
+        return false;
+    }
+
+    p++;
+    begin = p;
+    while ((p < end) && (*p != '"'))
+    {
+        if (*p == '\\')
+        {
+            p++;
+        }
+        p++;
+    }
+
+    if (p >= end)
+    {
+        return false;
+    }
+
+    stop = p;
+    p++;
+    return true;
+}
+
+/**
+ * @brief unescapeString 将parseString得到的原始内容（UTF-8）还原为文本，处理\"、\\、\n、\uXXXX等转义。
+ */
+QString unescapeString(const char *begin, const char *end)
+{
+    if (std::memchr(begin, '\\', size_t(end - begin)) == nullptr)
+    {
+        return QString::fromUtf8(begin, int(end - begin));
+    }
+
+    QString text;
+    const char *run = begin;
+    const char *p = begin;
+    while (p < end)
+    {
+        if (*p != '\\')
+        {
+            p++;
+            continue;
+        }
+
+        text += QString::fromUtf8(run, int(p - run));
+        p++;
+        if (p >= end)
+        {
+            break;
+        }
+
+        switch (*p)
+        {
+        case 'b':
+            text += QChar('\b');
+            break;
+        case 'f':
+            text += QChar('\f');
+            break;
+        case 'n':
+            text += QChar('\n');
+            break;
+        case 'r':
+            text += QChar('\r');
+            break;
+        case 't':
+            text += QChar('\t');
+            break;
+        case 'u':
+        {
+            /*
+             * 代理对由两个\uXXXX组成，逐个追加UTF-16单元即可。
+             */
+            bool ok = false;
+            const ushort code = (end - p > 4) ? QByteArray(p + 1, 4).toUShort(&ok, 16) : 0;
+            if (ok)
+            {
+                text += QChar(code);
+                p += 4;
+            }
+            break;
+        }
+        default:
+            text += QChar(*p);
+            break;
+        }
+        p++;
+        run = p;
+    }
+    text += QString::fromUtf8(run, int(end - run));
+
+    return text;
+}
+
+/**
+ * @brief appendJsonString 将文本转义后以JSON字符串（含引号）追加到buffer。
+ */
+void appendJsonString(QByteArray &buffer, const QString &text)
+{
+    const QByteArray utf8 = text.toUtf8();
+    buffer.append('"');
+    for (const char c : utf8)
+    {
+        switch (c)
+        {
+        case '"':
+            buffer.append("\\\"");
+            break;
+        case '\\':
+            buffer.append("\\\\");
+            break;
+        case '\n':
+            buffer.append("\\n");
+            break;
+        case '\r':
+            buffer.append("\\r");
+            break;
+        case '\t':
+            buffer.append("\\t");
+            break;
+        default:
+            if (uchar(c) < 0x20)
+            {
+                buffer.append("\\u00").append(QByteArray::number(uchar(c), 16).rightJustified(2, '0'));
+            }
+            else
+            {
+                buffer.append(c);
+            }
+            break;
+        }
+    }
+    buffer.append('"');
+}
+
+/**
+ * @brief skipValue 跳过任意JSON值。
+ */
+bool skipValue(const char *&p, const char *end)
+{
+    const char *begin = nullptr;
+    const char *stop = nullptr;
+
+    skipSpace(p, end);
+    if (p >= end)
+    {
+        return false;
+    }
+
+    if (*p == '"')
+    {
+        return parseString(p, end, begin, stop);
+    }
+
+    if ((*p == '{') || (*p == '['))
+    {
+        int depth = 0;
+        while (p < end)
+        {
+            if (*p == '"')
+            {
+                if (!parseString(p, end, begin, stop))
+                {
+                    return false;
+                }
+                continue;
+            }
+
+            if ((*p == '{') || (*p == '['))
+            {
+                depth++;
+            }
+            else if ((*p == '}') || (*p == ']'))
+            {
+                depth--;
+                if (depth == 0)
+                {
+                    p++;
+                    return true;
+                }
+            }
+            p++;
+        }
+
+        return false;
+    }
+
+    /*
+     * 数字、true、false、null。
+     */
+    while ((p < end) && (*p != ',') && (*p != '}') && (*p != ']') && !isSpace(*p))
+    {
+        p++;
+    }
+    return true;
+}
+
+/**
+ * @brief parsePointObject 解析 {"x":1,"y":2}。
+ */
+bool parsePointObject(const char *&p, const char *end, QPoint &point)
+{
+    const char *keyBegin = nullptr;
+    const char *keyEnd = nullptr;
+    bool hasX = false;
+    bool hasY = false;
+    double x = 0.0;
+    double y = 0.0;
+
+    if (!expect(p, end, '{'))
+    {
+        return false;
+    }
+
+    forever
+    {
+        if (!parseString(p, end, keyBegin, keyEnd) || !expect(p, end, ':'))
+        {
+            return false;
+        }
+
+        skipSpace(p, end);
+        if (keyEquals(keyBegin, keyEnd, "x"))
+        {
+            hasX = parseNumber(p, end, x);
+        }
+        else if (keyEquals(keyBegin, keyEnd, "y"))
+        {
+            hasY = parseNumber(p, end, y);
+        }
+        else if (!skipValue(p, end))
+        {
+            return false;
+        }
+
+        if (expect(p, end, ','))
+        {
+            continue;
+        }
+        if (expect(p, end, '}'))
+        {
+            break;
+        }
+        return false;
+    }
+
+    point = QPoint(toCoordinate(x), toCoordinate(y));
+    return hasX && hasY;
+}
+
+/**
+ * @brief parsePoints 解析控制点数组，元素可以是 [x,y]、{"x":x,"y":y}，或者整个数组为 x,y,x,y,...
+ */
+bool parsePoints(const char *&p, const char *end, QVector<QPoint> &points)
+{
+    bool flat = false;
+    bool hasX = false;
+    double x = 0.0;
+
+    if (!expect(p, end, '['))
+    {
+        return false;
+    }
+    if (expect(p, end, ']'))
+    {
+        return true;
+    }
+
+    forever
+    {
+        skipSpace(p, end);
+        if (p >= end)
+        {
+            return false;
+        }
+
+        if (*p == '[')
+        {
+            double y = 0.0;
+            p++;
+            skipSpace(p, end);
+            if (!parseNumber(p, end, x) || !expect(p, end, ','))
+            {
+                return false;
+            }
+            skipSpace(p, end);
+            if (!parseNumber(p, end, y) || !expect(p, end, ']'))
+            {
+                return false;
+            }
+            points.append(QPoint(toCoordinate(x), toCoordinate(y)));
+        }
+        else if (*p == '{')
+        {
+            QPoint point;
+            if (!parsePointObject(p, end, point))
+            {
+                return false;
+            }
+            points.append(point);
+        }
+        else
+        {
+            double value = 0.0;
+            if (!parseNumber(p, end, value))
+            {
+                return false;
+            }
+
+            flat = true;
+            if (hasX)
+            {
+                points.append(QPoint(toCoordinate(x), toCoordinate(value)));
+            }
+            else
+            {
+                x = value;
+            }
+            hasX = !hasX;
+        }
+
+        if (expect(p, end, ','))
+        {
+            continue;
+        }
+        if (expect(p, end, ']'))
+        {
+            break;
+        }
+        return false;
+    }
+
+    return !(flat && hasX);
+}
+
+bool parseJsonRecord(const char *begin, const char *end, AnnotationRecord &record)
+{
+    const char *p = begin;
+    const char *keyBegin = nullptr;
+    const char *keyEnd = nullptr;
+    bool hasPoints = false;
+
+    record.id = 0;
+    record.type = EPaintType::EPT_None;
+    record.points.clear();
+    record.text.clear();
+    record.textStyle = ETextStyle::ETS_Normal;
+
+    if (!expect(p, end, '{'))
+    {
+        return false;
+    }
+
+    forever
+    {
+        if (!parseString(p, end, keyBegin, keyEnd) || !expect(p, end, ':'))
+        {
+            return false;
+        }
+
+        skipSpace(p, end);
+        if (keyEquals(keyBegin, keyEnd, "id"))
+        {
+            double value = 0.0;
+            if (parseNumber(p, end, value))
+            {
+                record.id = (value > 0.0) ? quint64(value) : 0;
+            }
+            else if (!skipValue(p, end))
+            {
+                return false;
+            }
+        }
+        else if (keyEquals(keyBegin, keyEnd, "type"))
+        {
+            const char *typeBegin = nullptr;
+            const char *typeEnd = nullptr;
+            if (!parseString(p, end, typeBegin, typeEnd))
+            {
+                return false;
+            }
+            record.type = PaintTypeStrings::GetTypeEn(QString::fromLatin1(typeBegin, int(typeEnd - typeBegin)));
+        }
+        else if (keyEquals(keyBegin, keyEnd, "points"))
+        {
+            if (!parsePoints(p, end, record.points))
+            {
+                return false;
+            }
+            hasPoints = true;
+        }
+        else if (keyEquals(keyBegin, keyEnd, "text"))
+        {
+            const char *textBegin = nullptr;
+            const char *textEnd = nullptr;
+            if (!parseString(p, end, textBegin, textEnd))
+            {
+                return false;
+            }
+            record.text = unescapeString(textBegin, textEnd);
+        }
+        else if (keyEquals(keyBegin, keyEnd, "style"))
+        {
+            double value = 0.0;
+            if (parseNumber(p, end, value))
+            {
+                record.textStyle = int(value);
+            }
+            else if (!skipValue(p, end))
+            {
+                return false;
+            }
+        }
+        else if (!skipValue(p, end))
+        {
+            return false;
+        }
+
+        if (expect(p, end, ','))
+        {
+            continue;
+        }
+        if (expect(p, end, '}'))
+        {
+            break;
+        }
+        return false;
+    }
+
+    return hasPoints && (record.type != EPaintType::EPT_None);
+}
+
+bool isCsvSeparator(char c)
+{
+    return isSpace(c) || (c == '"') || (c == ';') || (c == ',');
+}
+
+/**
+ * @brief parseCsvText 解析文本列，可以用双引号括起（其中的引号写两次，可以包含逗号、换行）。
+ * 返回时p停在列之后的逗号或end处。
+ */
+bool parseCsvText(const char *&p, const char *end, QString &text)
+{
+    while ((p < end) && (*p == ' '))
+    {
+        p++;
+    }
+
+    if ((p >= end) || (*p != '"'))
+    {
+        const char *begin = p;
+        const char *comma = static_cast<const char *>(std::memchr(p, ',', size_t(end - p)));
+        p = (comma != nullptr) ? comma : end;
+        text = QString::fromUtf8(begin, int(p - begin)).trimmed();
+        return true;
+    }
+
+    QByteArray value;
+    p++;
+    forever
+    {
+        if (p >= end)
+        {
+            return false;
+        }
+        if (*p == '"')
+        {
+            if ((p + 1 < end) && (p[1] == '"'))
+            {
+                value.append('"');
+                p += 2;
+                continue;
+            }
+            p++;
+            break;
+        }
+        value.append(*p);
+        p++;
+    }
+
+    while ((p < end) && (*p == ' '))
+    {
+        p++;
+    }
+    text = QString::fromUtf8(value);
+    return true;
+}
+
+/**
+ * @brief appendCsvText 将文本用双引号括起追加到buffer，其中的引号写两次。
+ */
+void appendCsvText(QByteArray &buffer, const QString &text)
+{
+    QByteArray utf8 = text.toUtf8();
+    buffer.append('"').append(utf8.replace('"', "\"\"")).append('"');
+}
+
+/**
+ * @brief parseCsvRecord 解析一行：id,type,points，hasText时为id,type,text,style,points。
+ * points中的数以空格、分号或逗号分隔，因此每个坐标占一列（id,type,x,y,x,y,...）的文件也能读取。
+ */
+bool parseCsvRecord(const char *begin, const char *end, bool hasText, AnnotationRecord &record)
+{
+    record.id = 0;
+    record.type = EPaintType::EPT_None;
+    record.points.clear();
+    record.text.clear();
+    record.textStyle = ETextStyle::ETS_Normal;
+
+    const char *idEnd = static_cast<const char *>(std::memchr(begin, ',', size_t(end - begin)));
+    if (idEnd == nullptr)
+    {
+        return false;
+    }
+
+    const char *p = begin;
+    double value = 0.0;
+    while ((p < idEnd) && isCsvSeparator(*p))
+    {
+        p++;
+    }
+    if (parseNumber(p, idEnd, value) && (value > 0.0))
+    {
+        record.id = quint64(value);
+    }
+
+    const char *typeBegin = idEnd + 1;
+    const char *typeEnd = static_cast<const char *>(std::memchr(typeBegin, ',', size_t(end - typeBegin)));
+    if (typeEnd == nullptr)
+    {
+        return false;
+    }
+    QString typeString = QString::fromLatin1(typeBegin, int(typeEnd - typeBegin)).trimmed();
+    typeString.remove('"');
+    record.type = PaintTypeStrings::GetTypeEn(typeString);
+
+    p = typeEnd + 1;
+    if (hasText)
+    {
+        if (!parseCsvText(p, end, record.text) || (p >= end) || (*p != ','))
+        {
+            return false;
+        }
+
+        const char *styleBegin = p + 1;
+        const char *styleEnd = static_cast<const char *>(std::memchr(styleBegin, ',', size_t(end - styleBegin)));
+        if (styleEnd == nullptr)
+        {
+            return false;
+        }
+        p = styleBegin;
+        while ((p < styleEnd) && isCsvSeparator(*p))
+        {
+            p++;
+        }
+        if ((p < styleEnd) && parseNumber(p, styleEnd, value))
+        {
+            record.textStyle = int(value);
+        }
+        p = styleEnd + 1;
+    }
+
+    bool hasX = false;
+    double x = 0.0;
+    forever
+    {
+        while ((p < end) && isCsvSeparator(*p))
+        {
+            p++;
+        }
+        if (p >= end)
+        {
+            break;
+        }
+        if (!parseNumber(p, end, value))
+        {
+            return false;
+        }
+
+        if (hasX)
+        {
+            record.points.append(QPoint(toCoordinate(x), toCoordinate(value)));
+        }
+        else
+        {
+            x = value;
+        }
+        hasX = !hasX;
+    }
+
+    return !hasX && (record.type != EPaintType::EPT_None);
+}
+
+bool isBlank(const char *begin, const char *end)
+{
+    while ((begin < end) && isSpace(*begin))
+    {
+        begin++;
+    }
+    return begin >= end;
+}
+}
+
+EAnnotationFormat AnnotationFormatFromPath(const QString &path)
+{
+    if (QFileInfo(path).suffix().compare("csv", Qt::CaseInsensitive) == 0)
+    {
+        return EAnnotationFormat::EAF_Csv;
+    }
+
+    return EAnnotationFormat::EAF_Json;
+}
+
+AnnotationReader::AnnotationReader(QIODevice *device, EAnnotationFormat format) : _device(device)
+  , _format(format)
+  , _skippedCount(0)
+  , _jsonStarted(false)
+  , _jsonRecordDepth(0)
+  , _csvHeaderChecked(false)
+  , _csvHasText(false)
+{
+}
+
+bool AnnotationReader::Read(const RecordHandler &handler)
+{
+    _error.clear();
+    _skippedCount = 0;
+    _jsonStarted = false;
+    _jsonRecordDepth = 0;
+    _csvHeaderChecked = false;
+    _csvHasText = false;
+
+    if ((_device == nullptr) || !_device->isReadable())
+    {
+        _error = "device is not readable";
+        return false;
+    }
+
+    QByteArray buffer;
+    bool firstWindow = true;
+
+    forever
+    {
+        QByteArray data = _device->read(ReadWindowSize);
+        const bool atEnd = data.isEmpty();
+
+        if (firstWindow && data.startsWith("\xEF\xBB\xBF"))
+        {
+            data.remove(0, 3);
+        }
+        firstWindow = false;
+        buffer.append(data);
+
+        QVector<Span> spans;
+        bool pending = false;
+        int consumed = 0;
+        if (_format == EAnnotationFormat::EAF_Csv)
+        {
+            consumed = scanCsv(buffer, atEnd, spans);
+        }
+        else
+        {
+            consumed = scanJson(buffer, spans, pending);
+        }
+
+        if (!spans.isEmpty())
+        {
+            QVector<AnnotationRecord> records;
+            parseSpans(buffer, spans, records);
+            if (!records.isEmpty())
+            {
+                handler(records);
+            }
+        }
+
+        /*
+         * 只保留未读完的记录，和下一个窗口拼接。
+         */
+        buffer.remove(0, consumed);
+
+        if (atEnd)
+        {
+            if (pending)
+            {
+                _error = "unexpected end of file, the last record is truncated";
+                return false;
+            }
+
+            return true;
+        }
+    }
+}
+
+int AnnotationReader::scanJson(const QByteArray &data, QVector<Span> &spans, bool &pending)
+{
+    const char *d = data.constData();
+    const int size = data.size();
+    int depth = _jsonStarted ? _jsonRecordDepth : 0;
+    int recordBegin = -1;
+    int consumed = 0;
+    bool inString = false;
+    bool escape = false;
+
+    /*
+     * consumed只停在记录深度、字符串之外的位置，下次从该处以相同的状态继续扫描。
+     */
+    for (int i = 0; i < size; i++)
+    {
+        const char c = d[i];
+
+        if (inString)
+        {
+            if (escape)
+            {
+                escape = false;
+            }
+            else if (c == '\\')
+            {
+                escape = true;
+            }
+            else if (c == '"')
+            {
+                inString = false;
+            }
+            continue;
+        }
+
+        if (!_jsonStarted)
+        {
+            if (isSpace(c) || (c == ','))
+            {
+                continue;
+            }
+
+            _jsonStarted = true;
+            if (c == '[')
+            {
+                _jsonRecordDepth = 1;
+                depth = 1;
+                consumed = i + 1;
+                continue;
+            }
+
+            /*
+             * 不是数组，按JSON Lines处理，记录位于最外层。
+             */
+            _jsonRecordDepth = 0;
+            depth = 0;
+        }
+
+        switch (c)
+        {
+        case '"':
+            inString = true;
+            break;
+        case '{':
+        case '[':
+            if ((depth == _jsonRecordDepth) && (c == '{'))
+            {
+                recordBegin = i;
+            }
+            depth++;
+            break;
+        case '}':
+        case ']':
+            depth--;
+            if ((depth == _jsonRecordDepth) && (recordBegin >= 0))
+            {
+                Span span;
+                span.begin = recordBegin;
+                span.end = i + 1;
+                spans.append(span);
+                recordBegin = -1;
+                consumed = i + 1;
+            }
+            else if (depth < _jsonRecordDepth)
+            {
+                /*
+                 * 最外层数组结束，之后的内容作为新的文档。
+                 */
+                _jsonStarted = false;
+                depth = 0;
+                consumed = i + 1;
+            }
+            break;
+        default:
+            break;
+        }
+    }
+
+    pending = (recordBegin >= 0);
+    return consumed;
+}
+
+int AnnotationReader::scanCsv(const QByteArray &data, bool atEnd, QVector<Span> &spans)
+{
+    const char *d = data.constData();
+    const int size = data.size();
+    int pos = 0;
+
+    while (pos < size)
+    {
+        /*
+         * 引号内的换行属于文本列，不是记录的结束。
+         */
+        const char *newline = nullptr;
+        bool inQuote = false;
+        int search = pos;
+        forever
+        {
+            newline = static_cast<const char *>(std::memchr(d + search, '\n', size_t(size - search)));
+            const char *stop = (newline != nullptr) ? newline : d + size;
+            const char *quote = d + search;
+            while ((quote = static_cast<const char *>(std::memchr(quote, '"', size_t(stop - quote)))) != nullptr)
+            {
+                inQuote = !inQuote;
+                quote++;
+            }
+            if (!inQuote || (newline == nullptr))
+            {
+                break;
+            }
+            search = int(stop - d) + 1;
+        }
+
+        int lineEnd = 0;
+        int next = 0;
+
+        if (newline != nullptr)
+        {
+            lineEnd = int(newline - d);
+            next = lineEnd + 1;
+        }
+        else if (atEnd)
+        {
+            lineEnd = size;
+            next = size;
+        }
+        else
+        {
+            break;
+        }
+
+        if ((lineEnd > pos) && (d[lineEnd - 1] == '\r'))
+        {
+            lineEnd--;
+        }
+
+        if (!isBlank(d + pos, d + lineEnd))
+        {
+            /*
+             * 第一行的id列不是数字时，视为表头。
+             */
+            bool header = false;
+            if (!_csvHeaderChecked)
+            {
+                const char *p = d + pos;
+                double value = 0.0;
+                while ((p < d + lineEnd) && (isSpace(*p) || (*p == '"')))
+                {
+                    p++;
+                }
+                header = (p < d + lineEnd) && (*p != ',') && !parseNumber(p, d + lineEnd, value);
+                _csvHeaderChecked = true;
+
+                if (header)
+                {
+                    const QList<QByteArray> columns = QByteArray(d + pos, lineEnd - pos).toLower().split(',');
+                    QByteArray column = (columns.count() > 2) ? columns.at(2).trimmed() : QByteArray();
+                    _csvHasText = (column.replace('"', "") == "text");
+                }
+            }
+
+            if (!header)
+            {
+                Span span;
+                span.begin = pos;
+                span.end = lineEnd;
+                spans.append(span);
+            }
+        }
+
+        pos = next;
+    }
+
+    return pos;
+}
+
+void AnnotationReader::parseSpans(const QByteArray &data, const QVector<Span> &spans, QVector<AnnotationRecord> &records)
+{
+    int taskCount = 1;
+    if (spans.count() >= ParallelMinRecords)
+    {
+        taskCount = qBound(1, QThread::idealThreadCount(), spans.count() / ParallelMinRecords);
+    }
+
+    const int perTask = (spans.count() + taskCount - 1) / taskCount;
+    QVector<ParseTask> tasks(taskCount);
+    for (int i = 0; i < taskCount; i++)
+    {
+        ParseTask &task = tasks[i];
+        task.format = _format;
+        task.csvHasText = _csvHasText;
+        task.data = data.constData();
+        task.spans = spans.constData() + i * perTask;
+        task.count = qBound(0, spans.count() - i * perTask, perTask);
+        task.skipped = 0;
+    }
+
+    if (taskCount == 1)
+    {
+        parseTask(tasks[0]);
+    }
+    else
+    {
+        QtConcurrent::blockingMap(tasks, &AnnotationReader::parseTask);
+    }
+
+    records.reserve(spans.count());
+    for (const ParseTask &task : tasks)
+    {
+        records += task.records;
+        _skippedCount += task.skipped;
+    }
+}
+
+void AnnotationReader::parseTask(ParseTask &task)
+{
+    AnnotationRecord record;
+
+    task.records.reserve(task.count);
+    for (int i = 0; i < task.count; i++)
+    {
+        const char *begin = task.data + task.spans[i].begin;
+        const char *end = task.data + task.spans[i].end;
+        bool ok = false;
+
+        if (task.format == EAnnotationFormat::EAF_Csv)
+        {
+            ok = parseCsvRecord(begin, end, task.csvHasText, record);
+        }
+        else
+        {
+            ok = parseJsonRecord(begin, end, record);
+        }
+
+        if (ok)
+        {
+            task.records.append(record);
+        }
+        else
+        {
+            task.skipped++;
+        }
+    }
+}
+
+AnnotationWriter::AnnotationWriter(QIODevice *device, EAnnotationFormat format) : _device(device)
+  , _format(format)
+  , _count(0)
+  , _ok(true)
+{
+    _buffer.reserve(WriteBufferSize + 4096);
+
+    if (_format == EAnnotationFormat::EAF_Csv)
+    {
+        _buffer.append("id,type,text,style,points\n");
+    }
+    else
+    {
+        _buffer.append("[\n");
+    }
+}
+
+void AnnotationWriter::Write(const AnnotationRecord &record)
+{
+    const QByteArray type = PaintTypeStrings::GetStringEn(record.type).toLatin1();
+
+    if (_format == EAnnotationFormat::EAF_Csv)
+    {
+        _buffer.append(QByteArray::number(record.id)).append(',').append(type).append(',');
+        if (record.type == EPaintType::EPT_Text)
+        {
+            appendCsvText(_buffer, record.text);
+            _buffer.append(',').append(QByteArray::number(record.textStyle));
+        }
+        else
+        {
+            _buffer.append(',');
+        }
+        _buffer.append(',');
+        for (int i = 0; i < record.points.count(); i++)
+        {
+            if (i > 0)
+            {
+                _buffer.append(' ');
+            }
+            _buffer.append(QByteArray::number(record.points.at(i).x())).append(' ');
+            _buffer.append(QByteArray::number(record.points.at(i).y()));
+        }
+        _buffer.append('\n');
+    }
+    else
+    {
+        if (_count > 0)
+        {
+            _buffer.append(",\n");
+        }
+        _buffer.append("{\"id\":").append(QByteArray::number(record.id));
+        _buffer.append(",\"type\":\"").append(type).append("\",\"points\":[");
+        for (int i = 0; i < record.points.count(); i++)
+        {
+            if (i > 0)
+            {
+                _buffer.append(',');
+            }
+            _buffer.append('[').append(QByteArray::number(record.points.at(i).x())).append(',');
+            _buffer.append(QByteArray::number(record.points.at(i).y())).append(']');
+        }
+        _buffer.append(']');
+        if (record.type == EPaintType::EPT_Text)
+        {
+            _buffer.append(",\"text\":");
+            appendJsonString(_buffer, record.text);
+            _buffer.append(",\"style\":").append(QByteArray::number(record.textStyle));
+        }
+        _buffer.append('}');
+    }
+
+    _count++;
+    if (_buffer.size() >= WriteBufferSize)
+    {
+        flush();
+    }
+}
+
+bool AnnotationWriter::Finish()
+{
+    if (_format == EAnnotationFormat::EAF_Json)
+    {
+        _buffer.append((_count > 0) ? "\n]\n" : "]\n");
+    }
+
+    flush();
+    return _ok;
+}
+
+void AnnotationWriter::flush()
+{
+    if (_ok && !_buffer.isEmpty() && (_device->write(_buffer) != _buffer.size()))
+    {
+        qWarning() << "Warn: AnnotationWriter, failed to write!" << _device->errorString();
+        _ok = false;
+    }
+
+    /*
+     * resize(0)保留已预留的容量，避免反复分配。
+     */
+    _buffer.resize(0);
+}
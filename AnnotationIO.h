@@ -0,0 +1,155 @@
+#ifndef ANNOTATIONIO_H
+#define ANNOTATIONIO_H
+
+#include <functional>
+#include <QIODevice>
+#include <QByteArray>
+#include <QString>
+#include <QVector>
+#include <QPoint>
+
+#include "Types.h"
+
+/**
+ * @brief The EAnnotationFormat enum 标注文件的格式。
+ * - EAF_Json: 由记录组成的数组 [{"id":1,"type":"Rect","points":[[x,y],...]}, ...]，
+ *   也接受每行一条记录的JSON Lines。文本标注另有 "text":"...","style":n 两个字段。
+ * - EAF_Csv: 表头为 id,type,text,style,points，points为空格分隔的 x y x y ...；
+ *   text为双引号括起的UTF-8文本（引号写两次），非文本标注的text、style为空。
+ *   也接受没有text、style两列的旧表头 id,type,points。
+ */
+enum EAnnotationFormat
+{
+    EAF_Json = 0,
+    EAF_Csv,
+};
+
+/**
+ * @brief The AnnotationRecord struct 一条标注记录，points为图形的控制点（同GeometryShape::GetGeometry()）。
+ * 文本标注另有内容和样式（ETextStyle的组合），其他图形为空、0。
+ */
+struct AnnotationRecord
+{
+    quint64 id;
+    EPaintType type;
+    QVector<QPoint> points;
+    QString text;
+    int textStyle;
+};
+
+/**
+ * @brief AnnotationFormatFromPath 根据文件后缀判断格式，.csv为CSV，其余为JSON。
+ */
+EAnnotationFormat AnnotationFormatFromPath(const QString &path);
+
+/**
+ * @brief The AnnotationReader class 流式读取标注文件。
+ * @details
+ * - 每次读入ReadWindowSize字节，只保留未读完的最后一条记录，内存占用与文件大小无关。
+ * - 顺序扫描出窗口内每条记录的边界（只跟踪括号深度和字符串），记录的解析按块分给线程池并行完成。
+ * - 解析结果按文件中的顺序，逐窗口交给回调（类似SAX，不建立整个文件的文档树）。
+ * - 无法识别的类型、字段缺失的记录被跳过并计数；JSON中未知的字段被忽略。
+ */
+class AnnotationReader
+{
+public:
+    constexpr static int ReadWindowSize = 4 * 1024 * 1024;
+    /**
+     * @brief 一个窗口内的记录少于该值时不分块，直接在当前线程解析。
+     */
+    constexpr static int ParallelMinRecords = 256;
+
+    typedef std::function<void(const QVector<AnnotationRecord> &records)> RecordHandler;
+
+    AnnotationReader(QIODevice *device, EAnnotationFormat format);
+
+    /**
+     * @brief Read 读取到文件末尾。
+     * @param handler 每解析完一个窗口调用一次，在调用Read的线程中执行。
+     * @return false - 读取失败或文件不完整，已读出的记录仍已交给回调。
+     */
+    bool Read(const RecordHandler &handler);
+    QString GetError() const
+    {
+        return _error;
+    }
+    qint64 GetSkippedCount() const
+    {
+        return _skippedCount;
+    }
+
+private:
+    struct Span
+    {
+        int begin;
+        int end;
+    };
+
+    /**
+     * @brief The ParseTask struct 线程池中的一个解析任务，负责连续的count条记录。
+     */
+    struct ParseTask
+    {
+        EAnnotationFormat format;
+        bool csvHasText;
+        const char *data;
+        const Span *spans;
+        int count;
+        QVector<AnnotationRecord> records;
+        qint64 skipped;
+    };
+
+    QIODevice *_device;
+    EAnnotationFormat _format;
+    QString _error;
+    qint64 _skippedCount;
+
+    bool _jsonStarted;
+    int _jsonRecordDepth;
+    bool _csvHeaderChecked;
+    /**
+     * @brief 表头中是否有text、style两列。
+     */
+    bool _csvHasText;
+
+    /**
+     * @brief scanJson 找出data中完整的记录。
+     * @param[out] pending 是否有未读完的记录。
+     * @return 已处理的字节数，下次从此处继续。
+     */
+    int scanJson(const QByteArray &data, QVector<Span> &spans, bool &pending);
+    int scanCsv(const QByteArray &data, bool atEnd, QVector<Span> &spans);
+    void parseSpans(const QByteArray &data, const QVector<Span> &spans, QVector<AnnotationRecord> &records);
+    static void parseTask(ParseTask &task);
+};
+
+/**
+ * @brief The AnnotationWriter class 流式写标注文件，缓冲满WriteBufferSize字节后写入设备。
+ */
+class AnnotationWriter
+{
+public:
+    constexpr static int WriteBufferSize = 256 * 1024;
+
+    AnnotationWriter(QIODevice *device, EAnnotationFormat format);
+    AnnotationWriter(const AnnotationWriter&) = delete;
+    AnnotationWriter &operator=(const AnnotationWriter&) = delete;
+
+    void Write(const AnnotationRecord &record);
+    /**
+     * @brief Finish 写入文件尾并清空缓冲。
+     * @return false - 写入设备失败。
+     */
+    bool Finish();
+
+private:
+    QIODevice *_device;
+    EAnnotationFormat _format;
+    QByteArray _buffer;
+    qint64 _count;
+    bool _ok;
+
+    void flush();
+};
+
+#endif // ANNOTATIONIO_H
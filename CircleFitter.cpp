@@ -0,0 +1,329 @@
+#include "CircleFitter.h"
+
+#include <QtMath>
+#include <QtConcurrent>
+#include <QLineF>
+
+#include "EdgeCaliper.h"
+
+namespace
+{
+/*
+ * 克拉默法则解3x3线性方程组a * x = b，奇异时返回false。
+ */
+bool solve3(const double a[3][3], const double b[3], double x[3])
+{
+    auto det = [](const double m[3][3])
+    {
+        return m[0][0] * (m[1][1] * m[2][2] - m[1][2] * m[2][1]) -
+                m[0][1] * (m[1][0] * m[2][2] - m[1][2] * m[2][0]) +
+                m[0][2] * (m[1][0] * m[2][1] - m[1][1] * m[2][0]);
+    };
+
+    const double d = det(a);
+    if (qAbs(d) < 1e-12)
+    {
+        return false;
+    }
+
+    for (int column = 0; column < 3; column++)
+    {
+        double m[3][3];
+        for (int i = 0; i < 3; i++)
+        {
+            for (int j = 0; j < 3; j++)
+            {
+                m[i][j] = (j == column) ? b[i] : a[i][j];
+            }
+        }
+        x[column] = det(m) / d;
+    }
+    return true;
+}
+
+/*
+ * 线性同余随机数，各RANSAC假设各自持有状态。
+ */
+inline quint32 nextRandom(quint32 &state)
+{
+    state = state * 1664525u + 1013904223u;
+    return state >> 8;
+}
+}
+
+QVector<QPointF> CircleFitter::CollectEdges(const QImage &gray, const QPointF &center, qreal radius,
+                                            qreal startAngle, qreal sweepAngle)
+{
+    QVector<QPointF> points;
+    if (gray.isNull() || (radius < 1.0) || qFuzzyIsNull(sweepAngle))
+    {
+        return points;
+    }
+
+    const qreal width = qMax(qreal(MinSearchWidth), radius * SearchWidthRatio);
+    const qreal inner = qMax(0.0, radius - width);
+    const qreal outer = radius + width;
+    const bool fullCircle = (qAbs(sweepAngle) >= 360.0);
+    const qreal sweep = fullCircle ? 360.0 : sweepAngle;
+    const int minRays = 16;
+    const int maxRays = MaxRays;
+    const int rays = qBound(minRays, qCeil(qDegreesToRadians(qAbs(sweep)) * radius), maxRays);
+
+    /*
+     * 整圆时最后一条卡尺不与第一条重合。QLineF的角度方向y轴向上，场景y轴向下。
+     */
+    QVector<QLineF> lines;
+    lines.reserve(rays);
+    for (int i = 0; i < rays; i++)
+    {
+        const qreal t = fullCircle ? qreal(i) / rays : qreal(i) / (rays - 1);
+        const qreal angle = qDegreesToRadians(startAngle + sweep * t);
+        const QPointF direction(std::cos(angle), -std::sin(angle));
+        lines.append(QLineF(center + direction * inner, center + direction * outer));
+    }
+
+    EdgeCaliper caliper;
+    caliper.SetHalfWidth(1.0);
+    const QVector<CaliperResult> results = caliper.MeasureAll(gray, lines);
+
+    points.reserve(results.count());
+    for (const CaliperResult &result : results)
+    {
+        const CaliperEdge *strongest = nullptr;
+        for (const CaliperEdge &edge : result.edges)
+        {
+            if ((strongest == nullptr) || (edge.amplitude > strongest->amplitude))
+            {
+                strongest = &edge;
+            }
+        }
+        if (strongest != nullptr)
+        {
+            points.append(strongest->point);
+        }
+    }
+
+    return points;
+}
+
+bool CircleFitter::Fit(const QVector<QPointF> &points, CircleFit &fit)
+{
+    if (points.count() < MinPoints)
+    {
+        return false;
+    }
+
+    struct Hypothesis
+    {
+        quint32 seed;
+        QPointF center;
+        qreal radius;
+        int inliers;
+    };
+
+    QVector<Hypothesis> hypotheses(RansacIterations);
+    for (int i = 0; i < hypotheses.count(); i++)
+    {
+        hypotheses[i].seed = quint32(i) * 2654435761u + 1u;
+    }
+
+    QtConcurrent::blockingMap(hypotheses, [&points](Hypothesis &hypothesis)
+    {
+        hypothesis.inliers = 0;
+
+        const quint32 count = quint32(points.count());
+        quint32 state = hypothesis.seed;
+        const quint32 i1 = nextRandom(state) % count;
+        const quint32 i2 = nextRandom(state) % count;
+        const quint32 i3 = nextRandom(state) % count;
+        if ((i1 == i2) || (i2 == i3) || (i1 == i3) ||
+                !circleFromPoints(points.at(i1), points.at(i2), points.at(i3), hypothesis.center, hypothesis.radius))
+        {
+            return;
+        }
+
+        for (const QPointF &point : points)
+        {
+            const qreal distance = QLineF(hypothesis.center, point).length() - hypothesis.radius;
+            if (qAbs(distance) <= InlierTolerance)
+            {
+                hypothesis.inliers++;
+            }
+        }
+    });
+
+    const Hypothesis *best = &hypotheses.first();
+    for (const Hypothesis &hypothesis : hypotheses)
+    {
+        if (hypothesis.inliers > best->inliers)
+        {
+            best = &hypothesis;
+        }
+    }
+    if (best->inliers < MinPoints)
+    {
+        return false;
+    }
+
+    QVector<QPointF> inliers = inliersOf(points, best->center, best->radius);
+    QPointF center = best->center;
+    qreal radius = best->radius;
+    if (!fitAlgebraic(inliers, center, radius))
+    {
+        center = best->center;
+        radius = best->radius;
+    }
+
+    for (int i = 0; i < RefineIterations; i++)
+    {
+        fitGeometric(inliers, center, radius);
+        inliers = inliersOf(points, center, radius);
+        if (inliers.count() < MinPoints)
+        {
+            return false;
+        }
+    }
+
+    qreal squareSum = 0.0;
+    for (const QPointF &point : inliers)
+    {
+        const qreal distance = QLineF(center, point).length() - radius;
+        squareSum += distance * distance;
+    }
+
+    fit.center = center;
+    fit.radius = radius;
+    fit.inliers = inliers.count();
+    fit.rms = std::sqrt(squareSum / inliers.count());
+    return true;
+}
+
+bool CircleFitter::circleFromPoints(const QPointF &p1, const QPointF &p2, const QPointF &p3, QPointF &center, qreal &radius)
+{
+    /*
+     * 以p1为原点计算，减小大坐标的舍入误差。
+     */
+    const qreal bx = p2.x() - p1.x();
+    const qreal by = p2.y() - p1.y();
+    const qreal cx = p3.x() - p1.x();
+    const qreal cy = p3.y() - p1.y();
+    const qreal d = 2.0 * (bx * cy - by * cx);
+    if (qAbs(d) < 1e-9)
+    {
+        return false;
+    }
+
+    const qreal b2 = bx * bx + by * by;
+    const qreal c2 = cx * cx + cy * cy;
+    const qreal ux = (cy * b2 - by * c2) / d;
+    const qreal uy = (bx * c2 - cx * b2) / d;
+    center = QPointF(p1.x() + ux, p1.y() + uy);
+    radius = std::sqrt(ux * ux + uy * uy);
+    return true;
+}
+
+bool CircleFitter::fitAlgebraic(const QVector<QPointF> &points, QPointF &center, qreal &radius)
+{
+    if (points.count() < 3)
+    {
+        return false;
+    }
+
+    double meanX = 0.0;
+    double meanY = 0.0;
+    for (const QPointF &point : points)
+    {
+        meanX += point.x();
+        meanY += point.y();
+    }
+    meanX /= points.count();
+    meanY /= points.count();
+
+    /*
+     * 以重心为原点，解(Suu Suv; Suv Svv)(uc, vc) = (Suuu + Suvv, Svvv + Svuu) / 2。
+     */
+    double suu = 0.0, suv = 0.0, svv = 0.0;
+    double suuu = 0.0, svvv = 0.0, suvv = 0.0, svuu = 0.0;
+    for (const QPointF &point : points)
+    {
+        const double u = point.x() - meanX;
+        const double v = point.y() - meanY;
+        suu += u * u;
+        suv += u * v;
+        svv += v * v;
+        suuu += u * u * u;
+        svvv += v * v * v;
+        suvv += u * v * v;
+        svuu += v * u * u;
+    }
+
+    const double d = suu * svv - suv * suv;
+    if (qAbs(d) < 1e-12)
+    {
+        return false;
+    }
+
+    const double b1 = 0.5 * (suuu + suvv);
+    const double b2 = 0.5 * (svvv + svuu);
+    const double uc = (b1 * svv - b2 * suv) / d;
+    const double vc = (b2 * suu - b1 * suv) / d;
+
+    center = QPointF(meanX + uc, meanY + vc);
+    radius = std::sqrt(uc * uc + vc * vc + (suu + svv) / points.count());
+    return true;
+}
+
+bool CircleFitter::fitGeometric(const QVector<QPointF> &points, QPointF &center, qreal &radius)
+{
+    /*
+     * 残差d = |p - c| - r，对(cx, cy, r)的导数为(-(px - cx) / |p - c|, -(py - cy) / |p - c|, -1)，
+     * 一步高斯-牛顿：(J^T J) delta = -J^T d。
+     */
+    double jtj[3][3] = {{0.0, 0.0, 0.0}, {0.0, 0.0, 0.0}, {0.0, 0.0, 0.0}};
+    double jtd[3] = {0.0, 0.0, 0.0};
+    for (const QPointF &point : points)
+    {
+        const double dx = point.x() - center.x();
+        const double dy = point.y() - center.y();
+        const double rho = std::sqrt(dx * dx + dy * dy);
+        if (rho < 1e-9)
+        {
+            continue;
+        }
+
+        const double j[3] = {-dx / rho, -dy / rho, -1.0};
+        const double d = rho - radius;
+        for (int row = 0; row < 3; row++)
+        {
+            for (int column = 0; column < 3; column++)
+            {
+                jtj[row][column] += j[row] * j[column];
+            }
+            jtd[row] -= j[row] * d;
+        }
+    }
+
+    double delta[3];
+    if (!solve3(jtj, jtd, delta))
+    {
+        return false;
+    }
+
+    center += QPointF(delta[0], delta[1]);
+    radius += delta[2];
+    return true;
+}
+
+QVector<QPointF> CircleFitter::inliersOf(const QVector<QPointF> &points, const QPointF &center, qreal radius)
+{
+    QVector<QPointF> inliers;
+    inliers.reserve(points.count());
+    for (const QPointF &point : points)
+    {
+        if (qAbs(QLineF(center, point).length() - radius) <= InlierTolerance)
+        {
+            inliers.append(point);
+        }
+    }
+    return inliers;
+}
@@ -0,0 +1,64 @@
+#ifndef CIRCLEFITTER_H
+#define CIRCLEFITTER_H
+
+#include <QImage>
+#include <QVector>
+#include <QPointF>
+
+struct CircleFit
+{
+    QPointF center;
+    qreal radius;
+    /**
+     * @brief 参与最终拟合的内点数，以及内点到圆的距离的均方根。
+     */
+    int inliers;
+    qreal rms;
+};
+
+/**
+ * @brief The CircleFitter class 由图片中的边缘点拟合圆。
+ * @details
+ * - 坐标为场景坐标，与EdgeCaliper相同。
+ * - 收集边缘点：在粗略的圆（或圆弧的角度范围）上约每个像素取一条径向卡尺，卡尺覆盖半径两侧
+ *   SearchWidthRatio倍半径（至少MinSearchWidth像素）的圆环，每条卡尺取梯度最强的边缘，
+ *   卡尺在线程池中并行测量。
+ * - 拟合：RANSAC在线程池中并行地评估RansacIterations个三点假设，取内点最多的假设；
+ *   再对内点做代数最小二乘（Kasa）得到初值，用高斯-牛顿法最小化点到圆的几何距离，
+ *   按新的圆重新选取内点，重复RefineIterations次。
+ * - 随机采样使用固定的种子，同样的点得到同样的结果。
+ */
+class CircleFitter
+{
+public:
+    constexpr static qreal SearchWidthRatio = 0.25;
+    constexpr static qreal MinSearchWidth = 4.0;
+    constexpr static int MaxRays = 65536;
+    constexpr static int MinPoints = 8;
+    constexpr static int RansacIterations = 256;
+    constexpr static qreal InlierTolerance = 1.5;
+    constexpr static int RefineIterations = 5;
+
+    CircleFitter() = delete;
+
+    /**
+     * @brief CollectEdges 收集圆环中的边缘点。
+     * @param gray 背景图的灰度图（Grayscale8）。
+     * @param startAngle、sweepAngle 角度范围（度，逆时针为正，同QLineF::angle()），整圆为0、360。
+     */
+    static QVector<QPointF> CollectEdges(const QImage &gray, const QPointF &center, qreal radius,
+                                         qreal startAngle, qreal sweepAngle);
+    /**
+     * @brief Fit 稳健地拟合圆。
+     * @return false - 点数少于MinPoints或者没有足够内点的圆。
+     */
+    static bool Fit(const QVector<QPointF> &points, CircleFit &fit);
+
+private:
+    static bool circleFromPoints(const QPointF &p1, const QPointF &p2, const QPointF &p3, QPointF &center, qreal &radius);
+    static bool fitAlgebraic(const QVector<QPointF> &points, QPointF &center, qreal &radius);
+    static bool fitGeometric(const QVector<QPointF> &points, QPointF &center, qreal &radius);
+    static QVector<QPointF> inliersOf(const QVector<QPointF> &points, const QPointF &center, qreal radius);
+};
+
+#endif // CIRCLEFITTER_H
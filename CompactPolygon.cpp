@@ -0,0 +1,117 @@
+#include "CompactPolygon.h"
+
+CompactPolygon::CompactPolygon()
+{
+}
+
+bool CompactPolygon::CanEncode(const QPolygon &polygon)
+{
+    QRect rect = polygon.boundingRect();
+    return (rect.width() - 1 <= MaxExtent) && (rect.height() - 1 <= MaxExtent);
+}
+
+bool CompactPolygon::Encode(const QPolygon &polygon)
+{
+    if (!CanEncode(polygon))
+    {
+        return false;
+    }
+
+    _boundingRect = polygon.boundingRect();
+    _origin = _boundingRect.topLeft();
+    _offsets.resize(polygon.count() * 2);
+    _offsets.squeeze();
+
+    quint16 *offsets = _offsets.data();
+    for (int i = 0; i < polygon.count(); i++)
+    {
+        const QPoint &point = polygon.at(i);
+        offsets[2 * i] = quint16(point.x() - _origin.x());
+        offsets[2 * i + 1] = quint16(point.y() - _origin.y());
+    }
+
+    return true;
+}
+
+QPolygon CompactPolygon::Decode() const
+{
+    QPolygon polygon(this->Count());
+    const quint16 *offsets = _offsets.constData();
+    QPoint *points = polygon.data();
+
+    for (int i = 0; i < polygon.count(); i++)
+    {
+        points[i] = QPoint(_origin.x() + offsets[2 * i], _origin.y() + offsets[2 * i + 1]);
+    }
+
+    return polygon;
+}
+
+QPolygon CompactPolygon::DecodeOffsets() const
+{
+    QPolygon polygon(this->Count());
+    const quint16 *offsets = _offsets.constData();
+    QPoint *points = polygon.data();
+
+    for (int i = 0; i < polygon.count(); i++)
+    {
+        points[i] = QPoint(offsets[2 * i], offsets[2 * i + 1]);
+    }
+
+    return polygon;
+}
+
+void CompactPolygon::Clear()
+{
+    _origin = QPoint();
+    _boundingRect = QRect();
+    _offsets.clear();
+    _offsets.squeeze();
+}
+
+bool CompactPolygon::ContainsPoint(const QPoint &point, Qt::FillRule fillRule) const
+{
+    if (this->IsEmpty() || !_boundingRect.contains(point))
+    {
+        return false;
+    }
+
+    /*
+     * 在偏移坐标上统计从点向右的射线与各边的交点：奇偶规则看交点数，非零规则看带方向的交点数。
+     * 交点是否在点的右侧用叉积的符号判断，避免除法。
+     */
+    const qint64 px = point.x() - _origin.x();
+    const qint64 py = point.y() - _origin.y();
+    const quint16 *offsets = _offsets.constData();
+    const int count = this->Count();
+    int winding = 0;
+    int crossings = 0;
+
+    qint64 x0 = offsets[2 * (count - 1)];
+    qint64 y0 = offsets[2 * (count - 1) + 1];
+    for (int i = 0; i < count; i++)
+    {
+        qint64 x1 = offsets[2 * i];
+        qint64 y1 = offsets[2 * i + 1];
+
+        if ((y0 > py) != (y1 > py))
+        {
+            qint64 cross = (x1 - x0) * (py - y0) - (px - x0) * (y1 - y0);
+            if ((y1 > y0) ? (cross > 0) : (cross < 0))
+            {
+                crossings++;
+                winding += (y1 > y0) ? 1 : -1;
+            }
+        }
+
+        x0 = x1;
+        y0 = y1;
+    }
+
+    if (fillRule == Qt::FillRule::OddEvenFill)
+    {
+        return (crossings % 2) != 0;
+    }
+
+    return winding != 0;
+}
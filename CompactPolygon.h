@@ -0,0 +1,79 @@
+#ifndef COMPACTPOLYGON_H
+#define COMPACTPOLYGON_H
+
+#include <QPolygon>
+#include <QVector>
+#include <QRect>
+
+/**
+ * @brief The CompactPolygon class 紧凑存储的折线、多边形顶点。
+ * @details
+ * - 以外接矩形的左上角为原点，顶点存为相对原点的16位偏移，每个顶点4字节，QPolygon为8字节。
+ *   外接矩形的宽、高都不超过MaxExtent时才能编码。
+ * - 平移只改变原点，与顶点数无关。
+ * - DecodeOffsets()给出相对原点的顶点，绘制时平移画笔到原点即可，解码结果为临时对象，不随图形保存。
+ * - ContainsPoint()先按外接矩形排除，再在偏移坐标上做整数运算，不需要解码。
+ */
+class CompactPolygon
+{
+public:
+    constexpr static int MaxExtent = 65535;
+
+    CompactPolygon();
+
+    /**
+     * @brief CanEncode 顶点的范围是否能用16位偏移表示。
+     */
+    static bool CanEncode(const QPolygon &polygon);
+    /**
+     * @brief Encode 编码polygon，替换原有的顶点。
+     * @return false - 无法编码，原有的顶点不变。
+     */
+    bool Encode(const QPolygon &polygon);
+    QPolygon Decode() const;
+    /**
+     * @brief DecodeOffsets 解码为相对原点的顶点，与平移无关。
+     */
+    QPolygon DecodeOffsets() const;
+    void Clear();
+
+    int Count() const
+    {
+        return _offsets.count() / 2;
+    }
+    bool IsEmpty() const
+    {
+        return _offsets.isEmpty();
+    }
+    QPoint At(int i) const
+    {
+        return _origin + QPoint(_offsets.at(2 * i), _offsets.at(2 * i + 1));
+    }
+    QPoint Origin() const
+    {
+        return _origin;
+    }
+    QRect BoundingRect() const
+    {
+        return _boundingRect;
+    }
+    void Translate(const QPoint &offset)
+    {
+        _origin += offset;
+        _boundingRect.translate(offset);
+    }
+    /**
+     * @brief ContainsPoint 同QPolygon::containsPoint()，顶点首尾相连。
+     */
+    bool ContainsPoint(const QPoint &point, Qt::FillRule fillRule) const;
+
+private:
+    QPoint _origin;
+    QRect _boundingRect;
+    /**
+     * @brief 各顶点相对原点的x、y偏移，交替存放。
+     */
+    QVector<quint16> _offsets;
+};
+
+#endif // COMPACTPOLYGON_H
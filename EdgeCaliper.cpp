@@ -0,0 +1,201 @@
+#include "EdgeCaliper.h"
+
+#include <QtMath>
+#include <QtConcurrent>
+
+#include "ImageSampler.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#define EDGECALIPER_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+/*
+ * sum[i] += values[i]，NaN保持为NaN。
+ */
+void accumulate(float *sum, const float *values, int count)
+{
+    int i = 0;
+#ifdef EDGECALIPER_SSE2
+    for (; i + 4 <= count; i += 4)
+    {
+        _mm_storeu_ps(sum + i, _mm_add_ps(_mm_loadu_ps(sum + i), _mm_loadu_ps(values + i)));
+    }
+#endif
+    for (; i < count; i++)
+    {
+        sum[i] += values[i];
+    }
+}
+}
+
+EdgeCaliper::EdgeCaliper() : _halfWidth(DefaultHalfWidth)
+  , _threshold(DefaultThreshold)
+{
+}
+
+CaliperResult EdgeCaliper::Measure(const QImage &gray, const QLineF &line) const
+{
+    CaliperResult result;
+    result.line = line;
+
+    const qreal length = line.length();
+    if (gray.isNull() || (length < 1.0))
+    {
+        return result;
+    }
+
+    /*
+     * 约每个像素一个采样。场景坐标减去半个像素为以像素中心为整数点的采样坐标。
+     */
+    const int count = qBound(5, qCeil(length) + 1, int(MaxSamples));
+    const qreal step = length / (count - 1);
+    const QPointF direction = (line.p2() - line.p1()) / length;
+    const QPointF normal(-direction.y(), direction.x());
+    const QPointF start = line.p1() - QPointF(0.5, 0.5);
+    const QPointF end = line.p2() - QPointF(0.5, 0.5);
+
+    const int rows = qRound(_halfWidth);
+    QVector<float> profile(count, 0.0f);
+    QVector<float> row(count);
+    for (int k = -rows; k <= rows; k++)
+    {
+        const QPointF offset = normal * k;
+        ImageSampler::SampleLine(gray, start + offset, end + offset, count, row.data());
+        accumulate(profile.data(), row.data(), count);
+    }
+
+    const float scale = 1.0f / (2 * rows + 1);
+    for (int i = 0; i < count; i++)
+    {
+        profile[i] *= scale;
+    }
+
+    QVector<float> values(count);
+    gradient(profile.constData(), count, values.data());
+
+    for (int i = 1; i < count - 1; i++)
+    {
+        const qreal current = qAbs(values.at(i));
+        if (current / step < _threshold)
+        {
+            continue;
+        }
+
+        /*
+         * 平台（相差不超过PlateauTolerance倍、极性相同的相邻梯度）只在最左边的点处理：
+         * 向右找到平台的末端，其后的点更小时为边缘，位置取平台的中点。
+         */
+        const qreal tolerance = current * PlateauTolerance;
+        const qreal previous = qAbs(values.at(i - 1));
+        if ((previous >= current - tolerance) || (qAbs(values.at(i + 1)) > current + tolerance))
+        {
+            continue;
+        }
+
+        const int first = i;
+        while ((i + 2 < count) && (qAbs(values.at(i + 1) - values.at(first)) <= tolerance))
+        {
+            i++;
+        }
+        const qreal next = qAbs(values.at(i + 1));
+        if (next >= current - tolerance)
+        {
+            continue;
+        }
+
+        qreal offset = 0.0;
+        if (i > first)
+        {
+            offset = 0.5 * (first - i);
+        }
+        else
+        {
+            const qreal denominator = previous - 2.0 * current + next;
+            if (denominator < 0.0)
+            {
+                offset = qBound(-0.5, 0.5 * (previous - next) / denominator, 0.5);
+            }
+        }
+
+        CaliperEdge edge;
+        edge.position = (i + offset) * step;
+        edge.point = line.p1() + direction * edge.position;
+        edge.amplitude = current / step;
+        edge.polarity = (values.at(i) > 0.0f) ? EEdgePolarity::EEP_Rising : EEdgePolarity::EEP_Falling;
+        result.edges.append(edge);
+    }
+
+    for (int i = 0; i + 1 < result.edges.count(); i++)
+    {
+        const CaliperEdge &first = result.edges.at(i);
+        const CaliperEdge &second = result.edges.at(i + 1);
+        if (first.polarity != second.polarity)
+        {
+            result.pairs.append({i, i + 1, second.position - first.position});
+            i++;
+        }
+    }
+
+    return result;
+}
+
+QVector<CaliperResult> EdgeCaliper::MeasureAll(const QImage &gray, const QVector<QLineF> &lines) const
+{
+    QVector<CaliperResult> results(lines.count());
+    QVector<int> tasks(lines.count());
+    for (int i = 0; i < tasks.count(); i++)
+    {
+        tasks[i] = i;
+    }
+
+    /*
+     * 各任务写入不同的结果。
+     */
+    CaliperResult *resultBits = results.data();
+    QtConcurrent::blockingMap(tasks, [this, &gray, &lines, resultBits](const int &index)
+    {
+        resultBits[index] = this->Measure(gray, lines.at(index));
+    });
+
+    return results;
+}
+
+void EdgeCaliper::gradient(const float *profile, int count, float *values)
+{
+    const int end = count - 2;
+    for (int i = 0; i < qMin(2, count); i++)
+    {
+        values[i] = 0.0f;
+        values[count - 1 - i] = 0.0f;
+    }
+
+    int i = 2;
+#ifdef EDGECALIPER_SSE2
+    const __m128 two = _mm_set1_ps(2.0f);
+    const __m128 eighth = _mm_set1_ps(0.125f);
+    for (; i + 4 <= end; i += 4)
+    {
+        __m128 forward = _mm_add_ps(_mm_loadu_ps(profile + i + 2), _mm_mul_ps(two, _mm_loadu_ps(profile + i + 1)));
+        __m128 backward = _mm_add_ps(_mm_loadu_ps(profile + i - 2), _mm_mul_ps(two, _mm_loadu_ps(profile + i - 1)));
+        _mm_storeu_ps(values + i, _mm_mul_ps(_mm_sub_ps(forward, backward), eighth));
+    }
+#endif
+    for (; i < end; i++)
+    {
+        values[i] = (profile[i + 2] + 2.0f * profile[i + 1] - 2.0f * profile[i - 1] - profile[i - 2]) * 0.125f;
+    }
+
+    /*
+     * 图片外的采样（NaN）附近没有梯度。
+     */
+    for (i = 2; i < end; i++)
+    {
+        if (qIsNaN(values[i]))
+        {
+            values[i] = 0.0f;
+        }
+    }
+}
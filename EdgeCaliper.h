@@ -0,0 +1,104 @@
+#ifndef EDGECALIPER_H
+#define EDGECALIPER_H
+
+#include <QImage>
+#include <QVector>
+#include <QLineF>
+
+/**
+ * @brief The EEdgePolarity enum 沿卡尺方向由暗到亮为上升沿，由亮到暗为下降沿。
+ */
+enum EEdgePolarity
+{
+    EEP_Rising = 0,
+    EEP_Falling
+};
+
+struct CaliperEdge
+{
+    /**
+     * @brief 沿线段到起点的距离（原图像素），亚像素精度。
+     */
+    qreal position;
+    QPointF point;
+    /**
+     * @brief 边缘处梯度的绝对值（灰度/像素）。
+     */
+    qreal amplitude;
+    EEdgePolarity polarity;
+};
+
+/**
+ * @brief The CaliperPair struct 相邻的一对极性相反的边缘，width为两者的距离。
+ */
+struct CaliperPair
+{
+    int first;
+    int second;
+    qreal width;
+};
+
+struct CaliperResult
+{
+    QLineF line;
+    QVector<CaliperEdge> edges;
+    QVector<CaliperPair> pairs;
+};
+
+/**
+ * @brief The EdgeCaliper class 沿线段的亚像素边缘卡尺。
+ * @details
+ * - 坐标为场景坐标，像素(x, y)覆盖[x, x + 1) x [y, y + 1)。
+ * - 在线段两侧各HalfWidth像素的范围内，每隔一个像素取一条与线段平行的灰度剖面（双线性插值），
+ *   按列平均得到投影剖面，垂直于线段方向的噪声被平均掉。
+ * - 投影剖面与平滑求导核[-1, -2, 0, 2, 1] / 8卷积得到梯度，支持SSE2时一次计算4个点。
+ * - 梯度绝对值不小于Threshold的局部极大值为边缘，用相邻3点的抛物线插值求亚像素位置。
+ *   梯度相等的平台（如线性的灰度斜坡）为一个边缘，位置取平台的中点。
+ * - 相邻的一对极性相反的边缘组成一对，宽度为两者的距离，一个边缘只属于一对。
+ * - MeasureAll()每条线段一个任务，在线程池中并行测量。
+ */
+class EdgeCaliper
+{
+public:
+    constexpr static qreal DefaultHalfWidth = 5.0;
+    constexpr static qreal DefaultThreshold = 20.0;
+    constexpr static qreal PlateauTolerance = 1e-4;
+    constexpr static int MaxSamples = 8192;
+
+    EdgeCaliper();
+
+    void SetHalfWidth(qreal halfWidth)
+    {
+        _halfWidth = qMax(0.0, halfWidth);
+    }
+    qreal GetHalfWidth() const
+    {
+        return _halfWidth;
+    }
+    void SetThreshold(qreal threshold)
+    {
+        _threshold = threshold;
+    }
+    qreal GetThreshold() const
+    {
+        return _threshold;
+    }
+
+    /**
+     * @brief Measure 沿line测量边缘。
+     * @param gray 背景图的灰度图（Grayscale8）。
+     */
+    CaliperResult Measure(const QImage &gray, const QLineF &line) const;
+    QVector<CaliperResult> MeasureAll(const QImage &gray, const QVector<QLineF> &lines) const;
+
+private:
+    qreal _halfWidth;
+    qreal _threshold;
+
+    /**
+     * @brief gradient 投影剖面的梯度，两端各2个点及含NaN的点为0。
+     */
+    static void gradient(const float *profile, int count, float *values);
+};
+
+#endif // EDGECALIPER_H
@@ -0,0 +1,466 @@
+#include "FloodFill.h"
+
+#include <QThread>
+#include <QPair>
+#include <QDebug>
+#include <QtConcurrent/QtConcurrentMap>
+#include <algorithm>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#define FLOODFILL_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+/*
+ * 直接按32位像素逐字节比较的格式，其它格式先转换为ARGB32。
+ */
+bool isDirectFormat(QImage::Format format)
+{
+    return (format == QImage::Format_RGB32) || (format == QImage::Format_ARGB32) ||
+            (format == QImage::Format_ARGB32_Premultiplied);
+}
+}
+
+ScanlineFloodFill::ScanlineFloodFill() : _bits(nullptr)
+  , _bytesPerLine(0)
+  , _seedColor(0)
+  , _tolerance(0)
+  , _maxPixels(0)
+  , _truncated(false)
+  , _wordsPerLine(0)
+  , _pixelCount(0)
+{
+}
+
+bool ScanlineFloodFill::Grow(const QImage &image, const QPoint &seed, int tolerance)
+{
+    _spans.clear();
+    _region.clear();
+    _pixelCount = 0;
+    _boundingRect = QRect();
+    _truncated = false;
+    _size = image.size();
+
+    if (!QRect(QPoint(0, 0), _size).contains(seed))
+    {
+        return false;
+    }
+
+    QImage source = isDirectFormat(image.format()) ? image : image.convertToFormat(QImage::Format_ARGB32);
+    _bits = source.constBits();
+    _bytesPerLine = source.bytesPerLine();
+    _tolerance = qBound(0, tolerance, 255);
+    _seedColor = this->line(seed.y())[seed.x()];
+
+    _wordsPerLine = (_size.width() + 63) / 64;
+    _region.fill(0, _wordsPerLine * _size.height());
+
+    /*
+     * 条带按行均分，每行的位图单独对齐到字，各条带只写自己的行。
+     */
+    int bandCount = 1;
+    if (qint64(_size.width()) * _size.height() >= ParallelMinPixels)
+    {
+        bandCount = qBound(1, _size.height() / MinBandHeight, QThread::idealThreadCount() * 4);
+    }
+
+    QVector<Band> bands(bandCount);
+    for (int i = 0; i < bandCount; i++)
+    {
+        bands[i].top = int(qint64(_size.height()) * i / bandCount);
+        bands[i].bottom = int(qint64(_size.height()) * (i + 1) / bandCount) - 1;
+        bands[i].pixelCount = 0;
+        if ((seed.y() >= bands[i].top) && (seed.y() <= bands[i].bottom))
+        {
+            bands[i].pending.append({seed.y(), seed.x(), seed.x()});
+        }
+    }
+
+    QVector<Band *> active;
+    forever
+    {
+        active.clear();
+        for (Band &band : bands)
+        {
+            if (!band.pending.isEmpty())
+            {
+                active.append(&band);
+            }
+        }
+
+        if (active.isEmpty())
+        {
+            break;
+        }
+
+        if (active.count() == 1)
+        {
+            this->growBand(*active.first());
+        }
+        else
+        {
+            QtConcurrent::blockingMap(active, [this](Band *band)
+            {
+                this->growBand(*band);
+            });
+        }
+
+        for (int i = 0; i < bandCount; i++)
+        {
+            if (i > 0)
+            {
+                bands[i - 1].pending += bands[i].toUpper;
+            }
+            if (i < bandCount - 1)
+            {
+                bands[i + 1].pending += bands[i].toLower;
+            }
+            bands[i].toUpper.clear();
+            bands[i].toLower.clear();
+        }
+
+        if (_maxPixels > 0)
+        {
+            qint64 pixelCount = 0;
+            for (const Band &band : bands)
+            {
+                pixelCount += band.pixelCount;
+            }
+
+            if (pixelCount >= _maxPixels)
+            {
+                _truncated = true;
+                break;
+            }
+        }
+    }
+
+    int spanCount = 0;
+    for (const Band &band : bands)
+    {
+        spanCount += band.spans.count();
+        _pixelCount += band.pixelCount;
+    }
+
+    _spans.reserve(spanCount);
+    int left = _size.width();
+    int right = -1;
+    int top = _size.height();
+    int bottom = -1;
+    for (const Band &band : bands)
+    {
+        _spans += band.spans;
+        for (const FillSpan &span : band.spans)
+        {
+            left = qMin(left, span.left);
+            right = qMax(right, span.right);
+            top = qMin(top, span.y);
+            bottom = qMax(bottom, span.y);
+        }
+    }
+    _boundingRect = QRect(QPoint(left, top), QPoint(right, bottom));
+
+    _bits = nullptr;
+    return true;
+}
+
+bool ScanlineFloodFill::Contains(int x, int y) const
+{
+    if (_region.isEmpty() || (x < 0) || (y < 0) || (x >= _size.width()) || (y >= _size.height()))
+    {
+        return false;
+    }
+
+    return ((_region.at(y * _wordsPerLine + (x >> 6)) >> (x & 63)) & 1) != 0;
+}
+
+void ScanlineFloodFill::Fill(QImage &image, const QColor &color) const
+{
+    if (image.size() != _size)
+    {
+        qWarning() << "Warn: ScanlineFloodFill::Fill(), image size mismatch!" << image.size() << _size;
+        return;
+    }
+
+    if (_spans.isEmpty())
+    {
+        return;
+    }
+
+    if (!isDirectFormat(image.format()))
+    {
+        image = image.convertToFormat(QImage::Format_ARGB32);
+    }
+
+    quint32 value = color.rgba();
+    if (image.format() == QImage::Format_RGB32)
+    {
+        value = color.rgb();
+    }
+    else if (image.format() == QImage::Format_ARGB32_Premultiplied)
+    {
+        value = qPremultiply(color.rgba());
+    }
+
+    uchar *bits = image.bits();
+    const int bytesPerLine = image.bytesPerLine();
+    auto fillSpans = [this, bits, bytesPerLine, value](const QPair<int, int> &chunk)
+    {
+        for (int i = chunk.first; i < chunk.second; i++)
+        {
+            const FillSpan &span = _spans.at(i);
+            quint32 *row = reinterpret_cast<quint32 *>(bits + qint64(span.y) * bytesPerLine);
+            std::fill(row + span.left, row + span.right + 1, value);
+        }
+    };
+
+    /*
+     * 行段互不重叠，分组后并行写入。
+     */
+    int chunkCount = 1;
+    if (_pixelCount >= ParallelMinPixels)
+    {
+        chunkCount = qMin(_spans.count(), QThread::idealThreadCount() * 4);
+    }
+
+    QVector<QPair<int, int>> chunks;
+    for (int i = 0; i < chunkCount; i++)
+    {
+        chunks.append(qMakePair(int(qint64(_spans.count()) * i / chunkCount),
+                                int(qint64(_spans.count()) * (i + 1) / chunkCount)));
+    }
+
+    if (chunks.count() == 1)
+    {
+        fillSpans(chunks.first());
+    }
+    else
+    {
+        QtConcurrent::blockingMap(chunks, fillSpans);
+    }
+}
+
+QPolygon ScanlineFloodFill::TraceOutline() const
+{
+    QPolygon outline;
+    if (_spans.isEmpty())
+    {
+        return outline;
+    }
+
+    int startX = _size.width();
+    const int startY = _boundingRect.top();
+    for (const FillSpan &span : _spans)
+    {
+        if (span.y == startY)
+        {
+            startX = qMin(startX, span.left);
+        }
+    }
+
+    /*
+     * 方向按0～3依次为右、下、左、上（y轴向下），在角点(x, y)沿某方向前进一条像素边时，
+     * 边右侧的像素需在区域内、左侧的像素需在区域外。依次尝试右转、直行、左转。
+     */
+    const int dx[4] = {1, 0, -1, 0};
+    const int dy[4] = {0, 1, 0, -1};
+    const int rightX[4] = {0, -1, -1, 0};
+    const int rightY[4] = {0, 0, -1, -1};
+    const int leftX[4] = {0, 0, -1, -1};
+    const int leftY[4] = {-1, 0, 0, -1};
+
+    auto isBoundary = [this, &rightX, &rightY, &leftX, &leftY](int x, int y, int direction)
+    {
+        return this->Contains(x + rightX[direction], y + rightY[direction]) &&
+                !this->Contains(x + leftX[direction], y + leftY[direction]);
+    };
+
+    int x = startX;
+    int y = startY;
+    int direction = 0;
+    const qint64 maxSteps = _pixelCount * 4 + 4;
+    outline << QPoint(x, y);
+
+    for (qint64 step = 0; step < maxSteps; step++)
+    {
+        x += dx[direction];
+        y += dy[direction];
+
+        int next = direction;
+        for (int turn : {1, 0, 3})
+        {
+            next = (direction + turn) % 4;
+            if (isBoundary(x, y, next))
+            {
+                break;
+            }
+        }
+
+        if ((x == startX) && (y == startY))
+        {
+            break;
+        }
+
+        if (next != direction)
+        {
+            outline << QPoint(x, y);
+            direction = next;
+        }
+    }
+
+    return outline;
+}
+
+void ScanlineFloodFill::growBand(Band &band)
+{
+    const int width = _size.width();
+    const qint64 budget = band.pixelCount + RoundPixels;
+
+    while (!band.pending.isEmpty() && (band.pixelCount < budget))
+    {
+        const FillSpan range = band.pending.takeLast();
+        const int y = range.y;
+        const quint32 *row = this->line(y);
+        const int end = range.right + 1;
+        int x = range.left;
+
+        while (x < end)
+        {
+            x = this->findRegionBit(y, x, end, false);
+            if (x >= end)
+            {
+                break;
+            }
+
+            if (!this->matches(row[x]))
+            {
+                x = this->scanRight(row, x, end, false);
+                continue;
+            }
+
+            /*
+             * 已有的行段在生成时已向两侧延伸到不匹配的像素，与之相邻的像素不会匹配，
+             * 延伸时只需比较颜色。
+             */
+            int left = x;
+            while ((left > 0) && this->matches(row[left - 1]))
+            {
+                left--;
+            }
+            const int right = this->scanRight(row, x + 1, width, true) - 1;
+
+            this->markRegion(y, left, right);
+            band.spans.append({y, left, right});
+            band.pixelCount += right - left + 1;
+
+            /*
+             * 上下两行的同一范围作为待查行段，越过条带边界的交给相邻条带。
+             */
+            if (y > band.top)
+            {
+                band.pending.append({y - 1, left, right});
+            }
+            else if (y > 0)
+            {
+                band.toUpper.append({y - 1, left, right});
+            }
+
+            if (y < band.bottom)
+            {
+                band.pending.append({y + 1, left, right});
+            }
+            else if (y < _size.height() - 1)
+            {
+                band.toLower.append({y + 1, left, right});
+            }
+
+            x = right + 2;
+        }
+    }
+}
+
+bool ScanlineFloodFill::matches(quint32 pixel) const
+{
+    for (int shift = 0; shift < 32; shift += 8)
+    {
+        const int diff = int((pixel >> shift) & 0xff) - int((_seedColor >> shift) & 0xff);
+        if (qAbs(diff) > _tolerance)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+int ScanlineFloodFill::scanRight(const quint32 *row, int x, int end, bool matching) const
+{
+#ifdef FLOODFILL_SSE2
+    /*
+     * 一次比较4个像素：|p - seed|逐字节饱和相减得到，再减去容差，为0的通道在容差内。
+     * 像素的4个通道都在容差内时匹配，4个像素的结果相同时整组跳过。
+     */
+    const __m128i seed = _mm_set1_epi32(int(_seedColor));
+    const __m128i tolerance = _mm_set1_epi8(char(_tolerance));
+    const __m128i zero = _mm_setzero_si128();
+    const int expected = matching ? 0x1111 : 0;
+
+    while (x + 4 <= end)
+    {
+        const __m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i *>(row + x));
+        const __m128i diff = _mm_or_si128(_mm_subs_epu8(pixels, seed), _mm_subs_epu8(seed, pixels));
+        const int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_subs_epu8(diff, tolerance), zero));
+        if ((mask & (mask >> 1) & (mask >> 2) & (mask >> 3) & 0x1111) != expected)
+        {
+            break;
+        }
+        x += 4;
+    }
+#endif
+
+    while ((x < end) && (this->matches(row[x]) == matching))
+    {
+        x++;
+    }
+
+    return x;
+}
+
+int ScanlineFloodFill::findRegionBit(int y, int x, int end, bool set) const
+{
+    const quint64 *words = _region.constData() + y * _wordsPerLine;
+
+    while (x < end)
+    {
+        quint64 word = set ? words[x >> 6] : ~words[x >> 6];
+        word &= ~quint64(0) << (x & 63);
+        if (word != 0)
+        {
+            return qMin((x & ~63) + int(qCountTrailingZeroBits(word)), end);
+        }
+        x = (x & ~63) + 64;
+    }
+
+    return end;
+}
+
+void ScanlineFloodFill::markRegion(int y, int left, int right)
+{
+    quint64 *words = _region.data() + y * _wordsPerLine;
+    const int first = left >> 6;
+    const int last = right >> 6;
+    const quint64 firstMask = ~quint64(0) << (left & 63);
+    const quint64 lastMask = ~quint64(0) >> (63 - (right & 63));
+
+    if (first == last)
+    {
+        words[first] |= firstMask & lastMask;
+        return;
+    }
+
+    words[first] |= firstMask;
+    std::fill(words + first + 1, words + last, ~quint64(0));
+    words[last] |= lastMask;
+}
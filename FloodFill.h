@@ -0,0 +1,142 @@
+#ifndef FLOODFILL_H
+#define FLOODFILL_H
+
+#include <QImage>
+#include <QColor>
+#include <QVector>
+#include <QPoint>
+#include <QRect>
+#include <QPolygon>
+
+/**
+ * @brief The FillSpan struct 区域在第y行中的一段连续像素[left, right]（包含两端）。
+ */
+struct FillSpan
+{
+    int y;
+    int left;
+    int right;
+};
+
+/**
+ * @brief The ScanlineFloodFill class 扫描线种子填充：从种子像素按颜色容差生长出四连通区域。
+ * @details
+ * - 以行段为单位处理：在一行中一次向左右延伸出整段，再把上下两行的同一范围作为待查行段入栈，
+ *   不递归，也不逐像素入队。
+ * - 颜色逐通道（含alpha）比较差的绝对值，支持SSE2时一次比较4个像素。
+ * - 区域中的像素记在每行按64位对齐的位图中，跳过已填充的部分时按字查找。
+ * - 图片不少于ParallelMinPixels像素时，按行划分为条带，在线程池中并行生长。每一轮各条带最多
+ *   填充RoundPixels个像素，越过条带边界的行段在轮与轮之间交给相邻的条带，直到没有待查的行段。
+ * - 设置了像素数上限时，每一轮结束后检查，超过上限即停止生长。
+ */
+class ScanlineFloodFill
+{
+public:
+    constexpr static qint64 ParallelMinPixels = 4 * 1024 * 1024;
+    constexpr static int MinBandHeight = 128;
+    constexpr static qint64 RoundPixels = 1024 * 1024;
+
+    ScanlineFloodFill();
+
+    /**
+     * @brief SetMaxPixels 区域的像素数上限，超过后提前结束生长，不大于0时不限制。
+     */
+    void SetMaxPixels(qint64 maxPixels)
+    {
+        _maxPixels = maxPixels;
+    }
+    /**
+     * @brief IsTruncated 上一次生长是否因超过像素数上限而提前结束，此时区域不完整。
+     */
+    bool IsTruncated() const
+    {
+        return _truncated;
+    }
+
+    /**
+     * @brief Grow 从seed开始生长区域，结果替换上一次的区域。
+     * @param image 不是32位格式时先转换为ARGB32。
+     * @param tolerance 每个通道允许的最大差值，0～255。
+     * @return false - seed不在图片内。
+     */
+    bool Grow(const QImage &image, const QPoint &seed, int tolerance);
+    /**
+     * @brief GetSpans 区域的所有行段，各行段互不重叠，顺序不定。
+     */
+    const QVector<FillSpan> &GetSpans() const
+    {
+        return _spans;
+    }
+    qint64 GetPixelCount() const
+    {
+        return _pixelCount;
+    }
+    QRect GetBoundingRect() const
+    {
+        return _boundingRect;
+    }
+    QSize GetSize() const
+    {
+        return _size;
+    }
+    /**
+     * @brief Contains 像素(x, y)是否在区域内，图片范围外返回false。
+     */
+    bool Contains(int x, int y) const;
+    /**
+     * @brief Fill 将区域填充为color。
+     * @param image 与Grow()时大小相同，不是32位格式时先转换为ARGB32。
+     */
+    void Fill(QImage &image, const QColor &color) const;
+    /**
+     * @brief TraceOutline 沿像素边界跟踪区域的外轮廓，顶点为像素的角点，只保留方向改变处。
+     * @details 从最上一行最左边的像素开始，区域保持在前进方向的右侧，回到起点即结束，
+     * 只访问轮廓上的像素，与区域面积无关。区域内的孔不跟踪。
+     * @return 顺时针（y轴向下）的闭合轮廓，区域为空时返回空多边形。
+     */
+    QPolygon TraceOutline() const;
+
+private:
+    struct Band
+    {
+        int top;
+        int bottom;
+        QVector<FillSpan> pending;
+        QVector<FillSpan> toUpper;
+        QVector<FillSpan> toLower;
+        QVector<FillSpan> spans;
+        qint64 pixelCount;
+    };
+
+    const uchar *_bits;
+    int _bytesPerLine;
+    quint32 _seedColor;
+    int _tolerance;
+    qint64 _maxPixels;
+    bool _truncated;
+
+    QSize _size;
+    int _wordsPerLine;
+    QVector<quint64> _region;
+    QVector<FillSpan> _spans;
+    qint64 _pixelCount;
+    QRect _boundingRect;
+
+    void growBand(Band &band);
+    const quint32 *line(int y) const
+    {
+        return reinterpret_cast<const quint32 *>(_bits + qint64(y) * _bytesPerLine);
+    }
+    bool matches(quint32 pixel) const;
+    /**
+     * @brief scanRight 从x开始向右，第一个与种子颜色的匹配结果不等于matching的像素，没有时返回end。
+     */
+    int scanRight(const quint32 *row, int x, int end, bool matching) const;
+    /**
+     * @brief findRegionBit 第y行[x, end)中第一个在（set为true）或不在区域内的像素，没有时返回end。
+     */
+    int findRegionBit(int y, int x, int end, bool set) const;
+    void markRegion(int y, int left, int right);
+};
+
+#endif // FLOODFILL_H
@@ -1,23 +1,184 @@
 #include "GeometryShape.h"
 
 #include <complex>
+#include <QtMath>
 #include <QDebug>
 #include <QFileDialog>
+#include <QTextLayout>
 
 GeometryShape::GeometryShape() : _state(0)
   , _completed(false)
   , _selected(false)
   , _paintType(EPaintType::EPT_None)
+  , _id(0)
+  , _layerId(0)
+  , _zOrder(0.0)
   , _moveEnabled(false)
   , _dragResizeEnabled(false)
   , _valid(true)
+  , _measureObserver(nullptr)
 {
     initPen();
 }
 
+ShapeMeasure GeometryShape::Measure(EPaintType paintType, const QVector<QPoint> &points)
+{
+    ShapeMeasure measure;
+
+    switch (paintType)
+    {
+    case EPaintType::EPT_Line:
+        if (points.count() >= 2)
+        {
+            QLineF line(points.at(0), points.at(1));
+            measure.length = line.length();
+            measure.angle = line.angle();
+        }
+        break;
+    case EPaintType::EPT_Arc:
+        if (points.count() >= 3)
+        {
+            /*
+             * 与Arc::Paint()一致：半径为圆心到起点的距离，圆心角为终点方向与起点方向的夹角。
+             */
+            QLineF startLine(points.at(0), points.at(1));
+            QLineF endLine(points.at(0), points.at(2));
+            measure.radius = startLine.length();
+            measure.angle = qAbs(endLine.angle() - startLine.angle());
+            measure.length = measure.radius * qDegreesToRadians(measure.angle);
+        }
+        break;
+    case EPaintType::EPT_Circle:
+        if (points.count() >= 2)
+        {
+            measure.radius = QLineF(points.at(0), points.at(1)).length();
+            measure.perimeter = 2.0 * M_PI * measure.radius;
+            measure.area = M_PI * measure.radius * measure.radius;
+        }
+        break;
+    case EPaintType::EPT_Rect:
+    case EPaintType::EPT_Ellipse:
+        if (points.count() >= 2)
+        {
+            qreal width = qAbs(points.at(1).x() - points.at(0).x());
+            qreal height = qAbs(points.at(1).y() - points.at(0).y());
+
+            if (paintType == EPaintType::EPT_Rect)
+            {
+                measure.perimeter = 2.0 * (width + height);
+                measure.area = width * height;
+            }
+            else
+            {
+                /*
+                 * 椭圆周长使用Ramanujan近似公式。
+                 */
+                qreal a = width / 2.0;
+                qreal b = height / 2.0;
+                measure.perimeter = M_PI * (3.0 * (a + b) - qSqrt((3.0 * a + b) * (a + 3.0 * b)));
+                measure.area = M_PI * a * b;
+            }
+        }
+        break;
+    case EPaintType::EPT_Polygon:
+    case EPaintType::EPT_Polyline:
+    case EPaintType::EPT_Freehand:
+        if (points.count() >= 2)
+        {
+            qreal length = 0.0;
+            qint64 cross = 0;
+            for (int i = 1; i < points.count(); i++)
+            {
+                length += QLineF(points.at(i - 1), points.at(i)).length();
+                cross += qint64(points.at(i - 1).x()) * points.at(i).y() - qint64(points.at(i).x()) * points.at(i - 1).y();
+            }
+
+            if ((paintType == EPaintType::EPT_Polyline) || (paintType == EPaintType::EPT_Freehand))
+            {
+                measure.length = length;
+            }
+            else
+            {
+                cross += qint64(points.last().x()) * points.first().y() - qint64(points.first().x()) * points.last().y();
+                measure.perimeter = length + QLineF(points.last(), points.first()).length();
+                measure.area = qAbs(cross) / 2.0;
+            }
+        }
+        break;
+    default:
+        break;
+    }
+
+    return measure;
+}
+
+void GeometryShape::updateMeasure()
+{
+    this->setMeasure(Measure(_paintType, this->GetLiveGeometry()));
+}
+
+void GeometryShape::setMeasure(const ShapeMeasure &measure)
+{
+    ShapeMeasure oldMeasure = _measure;
+    _measure = measure;
+
+    if (_measureObserver != nullptr)
+    {
+        _measureObserver->MeasureChanged(this, oldMeasure, _measure);
+    }
+}
+
+void GeometryShape::PreparePaint(qreal scale)
+{
+    setPenWidth(_pointPen, DefaultPointPenWidth / scale);
+    setPenWidth(_linePen, DefaultLinePenWidth / scale);
+    setPenWidth(_guidePointPen, DefaultGuidePointPenWidth / scale);
+    setPenWidth(_guideLinePen, DefaultGuideLinePenWidth / scale);
+}
+
 void GeometryShape::adjustPenWidthToDefault(QPen &pen, const QPainter &painter, qreal defaultPenWidth)
 {
-    pen.setWidthF(defaultPenWidth / painter.transform().m11());
+    setPenWidth(pen, defaultPenWidth / painter.transform().m11());
+}
+
+void GeometryShape::setPenWidth(QPen &pen, qreal width)
+{
+    /*
+     * 宽度不变时不写画笔，多线程绘制同一图形时没有数据竞争。
+     */
+    if (pen.widthF() != width)
+    {
+        pen.setWidthF(width);
+    }
+}
+
+QPolygon GeometryShape::previewPolygon(const QPolygon &polygon, const QPainter &painter, bool preview)
+{
+    if (!preview || (polygon.count() <= PreviewSimplifyMinPoints))
+    {
+        return polygon;
+    }
+
+    /*
+     * 场景坐标下的最小顶点间距。
+     */
+    qreal spacing = PreviewVertexSpacing / painter.transform().m11();
+    qreal minDistance2 = spacing * spacing;
+    QPolygon simplified;
+
+    simplified.reserve(polygon.count());
+    simplified.append(polygon.first());
+    for (int i = 1; i < polygon.count() - 1; i++)
+    {
+        QPoint d = polygon.at(i) - simplified.last();
+        if ((qreal(d.x()) * d.x() + qreal(d.y()) * d.y()) >= minDistance2)
+        {
+            simplified.append(polygon.at(i));
+        }
+    }
+    simplified.append(polygon.last());
+
+    return simplified;
 }
 
 void GeometryShape::initPen()
@@ -46,14 +207,14 @@ Point::Point()
     _paintType = EPaintType::EPT_Point;
 }
 
-void Point::Paint(QPainter &painter)
+void Point::Paint(QPainter &painter, bool preview)
 {
     if (_point.isNull())
     {
         return;
     }
 
-    GeometryShape::Paint(painter);
+    GeometryShape::Paint(painter, preview);
 
     if (_selected && _moveEnabled)
     {
@@ -102,16 +263,40 @@ bool Point::Contains(QPoint point)
     return false;
 }
 
-void Point::MoveBegin(const QPoint &point)
+QRect Point::BoundingRect() const
+{
+    return QRect(_point.x() - DELTA, _point.y() - DELTA, DELTA * 2, DELTA * 2);
+}
+
+QPainterPath Point::GetPath() const
+{
+    QPainterPath path;
+    path.moveTo(_point);
+    path.lineTo(_point);
+    return path;
+}
+
+void Point::Translate(const QPoint &offset)
+{
+    _point += offset;
+}
+
+QVector<QPoint> Point::GetGeometry() const
 {
-    GeometryShape::MoveBegin(point);
-    _oldPoint = _point;
+    return QVector<QPoint>() << _point;
 }
 
-void Point::Move(QPoint point)
+void Point::SetGeometry(const QVector<QPoint> &points)
 {
-    QPoint aa = point - _moveStartCursorPoint;
-    _point = _oldPoint + aa;
+    if (points.count() < 1)
+    {
+        qWarning() << "Warn: Point::SetGeometry(), too few points!" << points.count();
+        return;
+    }
+
+    _point = points.at(0);
+    _state = 1;
+    _completed = true;
 }
 
 Line::Line() : _isNeedGuideLine(false)
@@ -119,9 +304,9 @@ Line::Line() : _isNeedGuideLine(false)
     _paintType = EPaintType::EPT_Line;
 }
 
-void Line::Paint(QPainter &painter)
+void Line::Paint(QPainter &painter, bool preview)
 {
-    GeometryShape::Paint(painter);
+    GeometryShape::Paint(painter, preview);
 
     if (_selected && _moveEnabled)
     {
@@ -185,6 +370,8 @@ void Line::UpdateState(EPaintStateType paintStateType, QPoint point)
     default:
         break;
     }
+
+    this->updateMeasure();
 }
 
 bool Line::Contains(QPoint point)
@@ -235,20 +422,63 @@ bool Line::Contains(QPoint point)
     return false;
 }
 
-void Line::MoveBegin(const QPoint &point)
+QRect Line::BoundingRect() const
+{
+    return QRect(_line.p1(), _line.p2()).normalized();
+}
+
+QPainterPath Line::GetPath() const
 {
-    GeometryShape::MoveBegin(point);
-    _oldLine = _line;
+    QPainterPath path;
+    path.moveTo(_line.p1());
+    path.lineTo(_line.p2());
+    return path;
 }
 
-void Line::Move(QPoint point)
+void Line::Translate(const QPoint &offset)
 {
-    QPoint aa = point - _moveStartCursorPoint;
+    _line.translate(offset);
+    _guideLine = _line;
+}
+
+QVector<QPoint> Line::GetGeometry() const
+{
+    return QVector<QPoint>() << _line.p1() << _line.p2();
+}
+
+QVector<QPoint> Line::GetLiveGeometry() const
+{
+    if (_isNeedGuideLine)
+    {
+        /*
+         * 光标移动前辅助线还没有终点。
+         */
+        QPoint p2 = _guideLine.p2().isNull() ? _guideLine.p1() : _guideLine.p2();
+        return QVector<QPoint>() << _guideLine.p1() << p2;
+    }
+
+    return this->GetGeometry();
+}
+
+void Line::SetGeometry(const QVector<QPoint> &points)
+{
+    if (points.count() < 2)
+    {
+        qWarning() << "Warn: Line::SetGeometry(), too few points!" << points.count();
+        return;
+    }
+
+    _line.setPoints(points.at(0), points.at(1));
+    _guideLine = _line;
+    _isNeedGuideLine = false;
+    _state = 2;
+    _completed = true;
+    this->updateMeasure();
+}
 
-    _line.setP1(_oldLine.p1() + aa);
-    _line.setP2(_oldLine.p2() + aa);
-    _guideLine.setP1(_line.p1());
-    _guideLine.setP2(_line.p2());
+bool Line::HasValidGeometry() const
+{
+    return _completed && (_line.p1() != _line.p2());
 }
 
 Arc::Arc() : _isNeedGuideArc(false)
@@ -256,9 +486,9 @@ Arc::Arc() : _isNeedGuideArc(false)
     _paintType = EPaintType::EPT_Arc;
 }
 
-void Arc::Paint(QPainter &painter)
+void Arc::Paint(QPainter &painter, bool preview)
 {
-    GeometryShape::Paint(painter);
+    GeometryShape::Paint(painter, preview);
 
     if (_selected && _moveEnabled)
     {
@@ -349,6 +579,8 @@ void Arc::UpdateState(EPaintStateType paintStateType, QPoint point)
     default:
         break;
     }
+
+    this->updateMeasure();
 }
 
 bool Arc::Contains(QPoint point)
@@ -379,24 +611,79 @@ bool Arc::Contains(QPoint point)
     return false;
 }
 
-void Arc::MoveBegin(const QPoint &point)
+QRect Arc::BoundingRect() const
+{
+    /*
+     * 取整圆的外接矩形，足够用于裁剪。
+     */
+    int radius = qCeil(QLineF(_center, _curArcP2).length());
+    return QRect(_center.x() - radius, _center.y() - radius, radius * 2, radius * 2);
+}
+
+QPainterPath Arc::GetPath() const
+{
+    QLineF lf1(_center, _curArcP2);
+    QLineF lf2(_center, _curArcP3);
+    QRectF rf(_center.x() - lf1.length(), _center.y() - lf1.length(), lf1.length() * 2, lf1.length() * 2);
+    QPainterPath path;
+    path.arcMoveTo(rf, lf1.angle());
+    path.arcTo(rf, lf1.angle(), lf2.angle() - lf1.angle());
+    return path;
+}
+
+void Arc::Translate(const QPoint &offset)
+{
+    _center += offset;
+    _curArcP2 += offset;
+    _curArcP3 += offset;
+    _guideCenter = _center;
+    _guideArcP2 = _curArcP2;
+    _guideArcP3 = _curArcP3;
+}
+
+QVector<QPoint> Arc::GetGeometry() const
 {
-    GeometryShape::MoveBegin(point);
-    _oldCenter = _center;
-    _oldCurArcP2 = _curArcP2;
-    _oldCurArcP3 = _curArcP3;
+    return QVector<QPoint>() << _center << _curArcP2 << _curArcP3;
+}
+
+QVector<QPoint> Arc::GetLiveGeometry() const
+{
+    if (_isNeedGuideArc)
+    {
+        QPoint p3 = _guideArcP3.isNull() ? _guideArcP2 : _guideArcP3;
+        return QVector<QPoint>() << _guideCenter << _guideArcP2 << p3;
+    }
+    if (!_completed)
+    {
+        return QVector<QPoint>() << _center << _center << _center;
+    }
+
+    return this->GetGeometry();
 }
 
-void Arc::Move(QPoint point)
+void Arc::SetGeometry(const QVector<QPoint> &points)
 {
-    QPoint aa = point - _moveStartCursorPoint;
+    if (points.count() < 3)
+    {
+        qWarning() << "Warn: Arc::SetGeometry(), too few points!" << points.count();
+        return;
+    }
 
-    _center = _oldCenter + aa;
-    _curArcP2 = _oldCurArcP2 + aa;
-    _curArcP3 = _oldCurArcP3 + aa;
+    _center = points.at(0);
+    _curArcP2 = points.at(1);
+    _curArcP3 = points.at(2);
     _guideCenter = _center;
     _guideArcP2 = _curArcP2;
     _guideArcP3 = _curArcP3;
+    _isNeedGuideArc = false;
+    _state = 3;
+    _completed = true;
+    this->updateMeasure();
+}
+
+bool Arc::HasValidGeometry() const
+{
+    return _completed && (_center != _curArcP2) && (_center != _curArcP3);
 }
 
 Circle::Circle() : _isNeedGuide(false)
@@ -404,9 +691,9 @@ Circle::Circle() : _isNeedGuide(false)
     _paintType = EPaintType::EPT_Circle;
 }
 
-void Circle::Paint(QPainter &painter)
+void Circle::Paint(QPainter &painter, bool preview)
 {
-    GeometryShape::Paint(painter);
+    GeometryShape::Paint(painter, preview);
 
     if (_selected && _moveEnabled)
     {
@@ -477,6 +764,8 @@ void Circle::UpdateState(EPaintStateType paintStateType, QPoint point)
     default:
         break;
     }
+
+    this->updateMeasure();
 }
 
 bool Circle::Contains(QPoint point)
@@ -500,20 +789,67 @@ bool Circle::Contains(QPoint point)
     return false;
 }
 
-void Circle::MoveBegin(const QPoint &point)
+QRect Circle::BoundingRect() const
+{
+    int radius = qCeil(QLineF(_radiusLine).length());
+    return QRect(_radiusLine.p1().x() - radius, _radiusLine.p1().y() - radius, radius * 2, radius * 2);
+}
+
+QPainterPath Circle::GetPath() const
+{
+    qreal radius = QLineF(_radiusLine).length();
+    QPainterPath path;
+    path.addEllipse(QPointF(_radiusLine.p1()), radius, radius);
+    return path;
+}
+
+void Circle::Translate(const QPoint &offset)
+{
+    _radiusLine.translate(offset);
+    _guideRadiusLine = _radiusLine;
+}
+
+QVector<QPoint> Circle::GetGeometry() const
+{
+    return QVector<QPoint>() << _radiusLine.p1() << _radiusLine.p2();
+}
+
+QVector<QPoint> Circle::GetLiveGeometry() const
 {
-    GeometryShape::MoveBegin(point);
-    _oldRadiusLine = _radiusLine;
+    if (_isNeedGuide)
+    {
+        /*
+         * 光标移动前辅助线还没有更新。
+         */
+        if (_guideRadiusLine.p1() != _radiusLine.p1())
+        {
+            return QVector<QPoint>() << _radiusLine.p1() << _radiusLine.p1();
+        }
+        return QVector<QPoint>() << _guideRadiusLine.p1() << _guideRadiusLine.p2();
+    }
+
+    return this->GetGeometry();
 }
 
-void Circle::Move(QPoint point)
+void Circle::SetGeometry(const QVector<QPoint> &points)
 {
-    QPoint aa = point - _moveStartCursorPoint;
+    if (points.count() < 2)
+    {
+        qWarning() << "Warn: Circle::SetGeometry(), too few points!" << points.count();
+        return;
+    }
+
+    _radiusLine.setPoints(points.at(0), points.at(1));
+    _guideRadiusLine = _radiusLine;
+    _isNeedGuide = false;
+    _state = 2;
+    _completed = true;
+    this->updateMeasure();
+}
 
-    _radiusLine.setP1(_oldRadiusLine.p1() + aa);
-    _radiusLine.setP2(_oldRadiusLine.p2() + aa);
-    _guideRadiusLine.setP1(_radiusLine.p1());
-    _guideRadiusLine.setP2(_radiusLine.p2());
+bool Circle::HasValidGeometry() const
+{
+    return _completed && (_radiusLine.p1() != _radiusLine.p2());
 }
 
 Rect::Rect() : _isNeedGuide(false)
@@ -527,9 +863,9 @@ Rect::~Rect()
 {
 }
 
-void Rect::Paint(QPainter &painter)
+void Rect::Paint(QPainter &painter, bool preview)
 {
-    GeometryShape::Paint(painter);
+    GeometryShape::Paint(painter, preview);
 
     if (_selected)
     {
@@ -629,6 +965,8 @@ void Rect::UpdateState(EPaintStateType paintStateType, QPoint point)
     default:
         break;
     }
+
+    this->updateMeasure();
 }
 
 bool Rect::Contains(QPoint point)
@@ -636,20 +974,63 @@ bool Rect::Contains(QPoint point)
     return _rect.contains(point);
 }
 
-void Rect::MoveBegin(const QPoint &point)
+QRect Rect::BoundingRect() const
+{
+    return _rect.normalized();
+}
+
+QPainterPath Rect::GetPath() const
+{
+    QPainterPath path;
+    path.addRect(QRectF(_rect.topLeft(), _rect.bottomRight()));
+    return path;
+}
+
+void Rect::Translate(const QPoint &offset)
+{
+    _rect.translate(offset);
+    _guideRect = _rect;
+}
+
+QVector<QPoint> Rect::GetGeometry() const
+{
+    return QVector<QPoint>() << _rect.topLeft() << _rect.bottomRight();
+}
+
+QVector<QPoint> Rect::GetLiveGeometry() const
+{
+    if (_isNeedGuide)
+    {
+        if (_guideRect.isNull())
+        {
+            return QVector<QPoint>() << _p1 << _p1;
+        }
+        return QVector<QPoint>() << _guideRect.topLeft() << _guideRect.bottomRight();
+    }
+
+    return this->GetGeometry();
+}
+
+void Rect::SetGeometry(const QVector<QPoint> &points)
 {
-    GeometryShape::MoveBegin(point);
-    _oldP1 = _rect.topLeft();
-    _oldP2 = _rect.bottomRight();
+    if (points.count() < 2)
+    {
+        qWarning() << "Warn: Rect::SetGeometry(), too few points!" << points.count();
+        return;
+    }
+
+    _p1 = points.at(0);
+    updateRect(_rect, points.at(0), points.at(1));
+    _guideRect = _rect;
+    _isNeedGuide = false;
+    _state = 2;
+    _completed = true;
+    this->updateMeasure();
 }
 
-void Rect::Move(QPoint point)
+bool Rect::HasValidGeometry() const
 {
-    QPoint aa = point - _moveStartCursorPoint;
-    QPoint p1 = _oldP1 + aa;
-    QPoint p2 = _oldP2 + aa;
-    updateRect(_rect, p1, p2);
-    updateRect(_guideRect, p1, p2);
+    return _completed && (_rect.left() != _rect.right()) && (_rect.top() != _rect.bottom());
 }
 
 Qt::CursorShape Rect::GetResizeCursorShape(QPoint point)
@@ -751,6 +1132,8 @@ void Rect::DragResize(const QPoint &point)
     default:
         break;
     }
+
+    this->updateMeasure();
 }
 
 void Rect::SetDragResizeEnabled(bool enable)
@@ -880,9 +1263,9 @@ Ellipse::Ellipse()
     _paintType = EPaintType::EPT_Ellipse;
 }
 
-void Ellipse::Paint(QPainter &painter)
+void Ellipse::Paint(QPainter &painter, bool preview)
 {
-    GeometryShape::Paint(painter);
+    GeometryShape::Paint(painter, preview);
 
     if (_selected && _moveEnabled)
     {
@@ -913,19 +1296,29 @@ void Ellipse::Paint(QPainter &painter)
     }
 }
 
-Polygon::Polygon() : _isShowGuide(false)
+QPainterPath Ellipse::GetPath() const
+{
+    QPainterPath path;
+    path.addEllipse(QRectF(_rect.topLeft(), _rect.bottomRight()));
+    return path;
+}
+
+Polygon::Polygon() : _isCompact(false)
+  , _isShowGuide(false)
+  , _chainLength(0.0)
+  , _chainCross(0)
 {
     _paintType = EPaintType::EPT_Polygon;
 }
 
-void Polygon::Paint(QPainter &painter)
+void Polygon::Paint(QPainter &painter, bool preview)
 {
-    GeometryShape::Paint(painter);
+    GeometryShape::Paint(painter, preview);
 
     if (_selected && _moveEnabled)
     {
         painter.setPen(_guideLinePen);
-        painter.drawPolygon(_guidePolygon);
+        this->drawVertices(painter, true, preview);
         return;
     }
 
@@ -938,7 +1331,7 @@ void Polygon::Paint(QPainter &painter)
     if (_completed)
     {
         painter.setPen(_linePen);
-        painter.drawPolygon(_polygon);
+        this->drawVertices(painter, true, preview);
     }
 }
 
@@ -952,6 +1345,7 @@ void Polygon::UpdateState(EPaintStateType paintStateType, QPoint point)
         _state++;
         state = _state;
 
+        this->appendChain(point);
         _polygon.putPoints(state - 1, 1, point.x(), point.y());
 
         if (state == 1)
@@ -969,69 +1363,698 @@ void Polygon::UpdateState(EPaintStateType paintStateType, QPoint point)
         _completed = true;
         break;
     case EPaintStateType::EPST_GuidePaintting:
-        _guidePolygon = _polygon;
-        _guidePolygon.push_back(point);
+        /*
+         * 顶点未变化时只替换光标所在的顶点，光标移动的开销与顶点数无关。
+         */
+        if (_guidePolygon.count() == _polygon.count() + 1)
+        {
+            _guidePolygon.last() = point;
+        }
+        else
+        {
+            _guidePolygon = _polygon;
+            _guidePolygon.push_back(point);
+        }
         break;
     default:
         break;
     }
+
+    this->updateMeasure();
 }
 
 bool Polygon::Contains(QPoint point)
 {
+    if (_isCompact)
+    {
+        return _compactPolygon.ContainsPoint(point, Qt::FillRule::OddEvenFill);
+    }
+
     return _polygon.containsPoint(point, Qt::FillRule::OddEvenFill);
 }
 
-void Polygon::MoveBegin(const QPoint &point)
+QRect Polygon::BoundingRect() const
 {
-    GeometryShape::MoveBegin(point);
-    _oldPolygon = _polygon;
+    if (_isCompact)
+    {
+        return _compactPolygon.BoundingRect();
+    }
+
+    return _polygon.boundingRect();
 }
 
-void Polygon::Move(QPoint point)
+QPainterPath Polygon::GetPath() const
 {
-    QPoint aa = point - _moveStartCursorPoint;
+    QPainterPath path = this->verticesPath();
+    path.closeSubpath();
+    return path;
+}
 
-    _polygon.clear();
-    foreach (auto item, _oldPolygon) {
-        _polygon.append(item + aa);
+void Polygon::Translate(const QPoint &offset)
+{
+    if (_isCompact)
+    {
+        _compactPolygon.Translate(offset);
+        return;
     }
-    _guidePolygon.clear();
-    _guidePolygon.append(_polygon);
+
+    _polygon.translate(offset);
+    _guidePolygon = _polygon;
 }
 
-Polyline::Polyline()
+QVector<QPoint> Polygon::GetGeometry() const
 {
-    _paintType = EPaintType::EPT_Polyline;
+    return this->vertices();
 }
 
-void Polyline::Paint(QPainter &painter)
+QVector<QPoint> Polygon::GetLiveGeometry() const
 {
-    GeometryShape::Paint(painter);
-
-    if (_selected && _moveEnabled)
+    if (_isShowGuide && (_guidePolygon.count() > _polygon.count()))
     {
-        painter.setPen(_guideLinePen);
-        painter.drawPolyline(_guidePolygon);
-        return;
+        return _guidePolygon;
     }
 
-    if (_isShowGuide)
+    return this->GetGeometry();
+}
+
+void Polygon::updateMeasure()
+{
+    /*
+     * 只在已确定顶点的累计值上补上光标所在的顶点和闭合边，与顶点数无关。
+     * 紧凑存储只用于已完成的图形，编码前已更新过测量值。
+     */
+    if (_isCompact)
     {
-        painter.setPen(_guideLinePen);
-        painter.drawPolyline(_guidePolygon);
+        return;
     }
 
-    if (_completed)
+    ShapeMeasure measure;
+
+    if (!_polygon.isEmpty())
     {
-        painter.setPen(_linePen);
-        painter.drawPolyline(_polygon);
+        const QPoint &first = _polygon.first();
+        QPoint last = _polygon.last();
+        qreal length = _chainLength;
+        qint64 cross = _chainCross;
+
+        if (_isShowGuide && (_guidePolygon.count() > _polygon.count()))
+        {
+            QPoint guide = _guidePolygon.last();
+            QPoint a = last - first;
+            QPoint b = guide - first;
+            length += QLineF(last, guide).length();
+            cross += qint64(a.x()) * b.y() - qint64(b.x()) * a.y();
+            last = guide;
+        }
+
+        if ((_paintType == EPaintType::EPT_Polyline) || (_paintType == EPaintType::EPT_Freehand))
+        {
+            measure.length = length;
+        }
+        else
+        {
+            measure.perimeter = length + QLineF(last, first).length();
+            measure.area = qAbs(cross) / 2.0;
+        }
     }
+
+    this->setMeasure(measure);
 }
 
-GeometryShape *GeometryShapeFactory::CreateGeometryShape(EPaintType paintType)
+void Polygon::appendChain(const QPoint &point)
 {
-    GeometryShape *shape = nullptr;
+    if (_polygon.isEmpty())
+    {
+        return;
+    }
+
+    QPoint a = _polygon.last() - _polygon.first();
+    QPoint b = point - _polygon.first();
+    _chainLength += QLineF(_polygon.last(), point).length();
+    _chainCross += qint64(a.x()) * b.y() - qint64(b.x()) * a.y();
+}
+
+void Polygon::resetChain()
+{
+    _chainLength = 0.0;
+    _chainCross = 0;
+
+    for (int i = 1; i < _polygon.count(); i++)
+    {
+        QPoint a = _polygon.at(i - 1) - _polygon.first();
+        QPoint b = _polygon.at(i) - _polygon.first();
+        _chainLength += QLineF(_polygon.at(i - 1), _polygon.at(i)).length();
+        _chainCross += qint64(a.x()) * b.y() - qint64(b.x()) * a.y();
+    }
+}
+
+void Polygon::SetGeometry(const QVector<QPoint> &points)
+{
+    _polygon = QPolygon(points);
+    _guidePolygon = _polygon;
+    _isShowGuide = false;
+    _state = _polygon.count() + 1;
+    _completed = true;
+    this->resetChain();
+    this->updateMeasure();
+
+    if (_isCompact)
+    {
+        _isCompact = false;
+        _compactPolygon.Clear();
+        this->SetCompact(true);
+    }
+}
+
+bool Polygon::HasValidGeometry() const
+{
+    const int count = _isCompact ? _compactPolygon.Count() : _polygon.count();
+    return _completed && (count >= 3);
+}
+
+bool Polygon::SetCompact(bool compact)
+{
+    if (compact == _isCompact)
+    {
+        return true;
+    }
+
+    if (compact)
+    {
+        if (!_completed || !_compactPolygon.Encode(_polygon))
+        {
+            return false;
+        }
+
+        _polygon = QPolygon();
+        _guidePolygon = QPolygon();
+    }
+    else
+    {
+        _polygon = _compactPolygon.Decode();
+        _guidePolygon = _polygon;
+        _compactPolygon.Clear();
+    }
+
+    _isCompact = compact;
+    return true;
+}
+
+void Polygon::drawVertices(QPainter &painter, bool closed, bool preview) const
+{
+    QPoint origin;
+    QPolygon polygon;
+    if (_isCompact)
+    {
+        /*
+         * previewPolygon()只与缩放有关，平移画笔后简化相对顶点的结果相同。
+         */
+        origin = _compactPolygon.Origin();
+        painter.translate(origin);
+        polygon = previewPolygon(_compactPolygon.DecodeOffsets(), painter, preview);
+    }
+    else
+    {
+        polygon = previewPolygon(_polygon, painter, preview);
+    }
+
+    if (closed)
+    {
+        painter.drawPolygon(polygon);
+    }
+    else
+    {
+        painter.drawPolyline(polygon);
+    }
+
+    if (_isCompact)
+    {
+        painter.translate(-origin);
+    }
+}
+
+QPainterPath Polygon::verticesPath() const
+{
+    QPainterPath path;
+    if (_isCompact)
+    {
+        path.addPolygon(_compactPolygon.DecodeOffsets());
+        path.translate(_compactPolygon.Origin());
+    }
+    else
+    {
+        path.addPolygon(_polygon);
+    }
+
+    return path;
+}
+
+Polyline::Polyline()
+{
+    _paintType = EPaintType::EPT_Polyline;
+}
+
+void Polyline::Paint(QPainter &painter, bool preview)
+{
+    GeometryShape::Paint(painter, preview);
+
+    if (_selected && _moveEnabled)
+    {
+        painter.setPen(_guideLinePen);
+        this->drawVertices(painter, false, preview);
+        return;
+    }
+
+    if (_isShowGuide)
+    {
+        painter.setPen(_guideLinePen);
+        painter.drawPolyline(_guidePolygon);
+    }
+
+    if (_completed)
+    {
+        painter.setPen(_linePen);
+        this->drawVertices(painter, false, preview);
+    }
+}
+
+QPainterPath Polyline::GetPath() const
+{
+    return this->verticesPath();
+}
+
+bool Polyline::HasValidGeometry() const
+{
+    const int count = _isCompact ? _compactPolygon.Count() : _polygon.count();
+    return _completed && (count >= 2);
+}
+
+/**
+ * @brief segmentDistance2 点p到线段[a, b]距离的平方。
+ */
+static qreal segmentDistance2(const QPoint &p, const QPoint &a, const QPoint &b)
+{
+    qreal dx = b.x() - a.x();
+    qreal dy = b.y() - a.y();
+    qreal px = p.x() - a.x();
+    qreal py = p.y() - a.y();
+    qreal length2 = dx * dx + dy * dy;
+
+    if (length2 > 0.0)
+    {
+        qreal t = qBound(0.0, (px * dx + py * dy) / length2, 1.0);
+        px -= t * dx;
+        py -= t * dy;
+    }
+
+    return px * px + py * py;
+}
+
+Freehand::Freehand()
+{
+    _paintType = EPaintType::EPT_Freehand;
+}
+
+void Freehand::Paint(QPainter &painter, bool preview)
+{
+    GeometryShape::Paint(painter, preview);
+
+    if (_selected && _moveEnabled)
+    {
+        painter.setPen(_guideLinePen);
+        painter.drawPolyline(previewPolygon(_guidePolygon, painter, preview));
+        return;
+    }
+
+    /*
+     * 只绘制与裁剪区域相交的组，相邻的组共用交界处的顶点。
+     */
+    QRectF clipRect = painter.hasClipping() ? painter.clipBoundingRect() : QRectF();
+    qreal margin = _linePen.widthF();
+
+    painter.setPen(_linePen);
+    for (int i = 0; i < _chunkRects.count(); i++)
+    {
+        if (!clipRect.isNull() &&
+                !clipRect.intersects(QRectF(_chunkRects.at(i)).adjusted(-margin, -margin, margin, margin)))
+        {
+            continue;
+        }
+
+        int first = i * ChunkSize;
+        painter.drawPolyline(_polygon.constData() + first, qMin(ChunkSize, _polygon.count() - 1 - first) + 1);
+    }
+
+    if (_isShowGuide && !_polygon.isEmpty() && (_guidePolygon.count() > _polygon.count()))
+    {
+        painter.drawLine(_polygon.last(), _guidePolygon.last());
+    }
+}
+
+void Freehand::UpdateState(EPaintStateType paintStateType, QPoint point)
+{
+    switch (paintStateType)
+    {
+    case EPaintStateType::EPST_Painting:
+        if (_state != 0)
+        {
+            break;
+        }
+
+        _state = 1;
+        _smoothed = point;
+        _pending.clear();
+        _polygon.clear();
+        _chunkRects.clear();
+        this->appendVertex(point);
+        _guidePolygon = _polygon;
+        _guidePolygon.append(point);
+        _dirtyRect = QRect(point, point);
+        _isShowGuide = true;
+        _completed = false;
+        break;
+    case EPaintStateType::EPST_GuidePaintting:
+        if (_state != 1)
+        {
+            return;
+        }
+
+        this->addSample(point);
+        break;
+    case EPaintStateType::EPST_PaintEnd:
+        if (_state != 1)
+        {
+            break;
+        }
+
+        /*
+         * 只有一个采样时重复该点，绘制为一个圆点。
+         */
+        if ((_polygon.count() == 1) || (_guidePolygon.last() != _polygon.last()))
+        {
+            this->appendVertex(_guidePolygon.last());
+        }
+
+        _state = 2;
+        _guidePolygon = _polygon;
+        _pending.clear();
+        _pending.squeeze();
+        _isShowGuide = false;
+        _completed = true;
+        break;
+    default:
+        break;
+    }
+
+    this->updateMeasure();
+}
+
+bool Freehand::Contains(QPoint point)
+{
+    qreal delta2 = qreal(DELTA) * DELTA;
+
+    for (int i = 0; i < _chunkRects.count(); i++)
+    {
+        if (!_chunkRects.at(i).adjusted(-DELTA, -DELTA, DELTA, DELTA).contains(point))
+        {
+            continue;
+        }
+
+        int first = i * ChunkSize;
+        int last = qMin(first + ChunkSize, _polygon.count() - 1);
+        for (int j = first; j < last; j++)
+        {
+            if (segmentDistance2(point, _polygon.at(j), _polygon.at(j + 1)) <= delta2)
+            {
+                return true;
+            }
+        }
+    }
+
+    return false;
+}
+
+void Freehand::Translate(const QPoint &offset)
+{
+    Polygon::Translate(offset);
+
+    for (QRect &rect : _chunkRects)
+    {
+        rect.translate(offset);
+    }
+}
+
+void Freehand::SetGeometry(const QVector<QPoint> &points)
+{
+    Polygon::SetGeometry(points);
+    _pending.clear();
+    this->resetChunks();
+}
+
+bool Freehand::SetCompact(bool compact)
+{
+    return !compact;
+}
+
+QRect Freehand::TakeDirtyRect()
+{
+    QRect rect = _dirtyRect;
+    _dirtyRect = QRect();
+    return rect;
+}
+
+void Freehand::addSample(const QPoint &point)
+{
+    _smoothed += (QPointF(point) - _smoothed) * SmoothingFactor;
+
+    QPoint sample = _smoothed.toPoint();
+    QPoint start = _polygon.last();
+    QPoint end = _guidePolygon.last();
+    if (sample == end)
+    {
+        return;
+    }
+
+    if ((_pending.count() < MaxPendingSamples) && this->fitsSegment(start, sample))
+    {
+        /*
+         * 末端移动到新的采样，重绘原来和现在的最后一段。
+         */
+        _pending.append(end);
+        _guidePolygon.last() = sample;
+        _dirtyRect |= QRect(start, end).normalized() | QRect(start, sample).normalized();
+    }
+    else
+    {
+        this->appendVertex(end);
+        _pending.clear();
+        _guidePolygon.append(sample);
+        _dirtyRect |= QRect(end, sample).normalized();
+    }
+}
+
+bool Freehand::fitsSegment(const QPoint &start, const QPoint &end) const
+{
+    qreal tolerance2 = SimplifyTolerance * SimplifyTolerance;
+
+    if (segmentDistance2(_guidePolygon.last(), start, end) > tolerance2)
+    {
+        return false;
+    }
+
+    for (const QPoint &sample : _pending)
+    {
+        if (segmentDistance2(sample, start, end) > tolerance2)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void Freehand::appendVertex(const QPoint &point)
+{
+    this->appendChain(point);
+    _polygon.append(point);
+
+    int count = _polygon.count();
+    if (count < 2)
+    {
+        return;
+    }
+
+    QRect segment = QRect(_polygon.at(count - 2), point).normalized();
+    int chunk = (count - 2) / ChunkSize;
+    if (chunk < _chunkRects.count())
+    {
+        _chunkRects[chunk] |= segment;
+    }
+    else
+    {
+        _chunkRects.append(segment);
+    }
+}
+
+void Freehand::resetChunks()
+{
+    _chunkRects.clear();
+
+    for (int i = 0; i + 1 < _polygon.count(); i++)
+    {
+        QRect segment = QRect(_polygon.at(i), _polygon.at(i + 1)).normalized();
+        if (i % ChunkSize == 0)
+        {
+            _chunkRects.append(segment);
+        }
+        else
+        {
+            _chunkRects.last() |= segment;
+        }
+    }
+}
+
+Text::Text() : _textStyle(ETextStyle::ETS_Normal)
+{
+    _paintType = EPaintType::EPT_Text;
+    this->layoutText();
+}
+
+void Text::Paint(QPainter &painter, bool preview)
+{
+    if (!_completed)
+    {
+        return;
+    }
+
+    GeometryShape::Paint(painter, preview);
+
+    const QRectF rect = _textRect.translated(_anchor);
+    const qreal scale = qSqrt(qAbs(painter.transform().determinant()));
+    if (DefaultPixelSize * scale < MinReadablePixelSize)
+    {
+        painter.fillRect(rect, _linePen.color());
+    }
+    else
+    {
+        painter.setPen(_linePen);
+        for (const QGlyphRun &glyphRun : _glyphRuns)
+        {
+            painter.drawGlyphRun(_anchor, glyphRun);
+        }
+    }
+
+    if (_selected)
+    {
+        painter.setPen(_guideLinePen);
+        painter.drawRect(rect);
+    }
+}
+
+void Text::UpdateState(EPaintStateType paintStateType, QPoint point)
+{
+    if ((paintStateType != EPST_Painting) || _completed)
+    {
+        return;
+    }
+
+    _state = 1;
+    _anchor = point;
+    _completed = true;
+}
+
+bool Text::Contains(QPoint point)
+{
+    return _textRect.translated(_anchor).contains(point);
+}
+
+QRect Text::BoundingRect() const
+{
+    return _textRect.translated(_anchor).toAlignedRect();
+}
+
+QPainterPath Text::GetPath() const
+{
+    QPainterPath path;
+    path.addRect(_textRect.translated(_anchor));
+    return path;
+}
+
+void Text::Translate(const QPoint &offset)
+{
+    _anchor += offset;
+}
+
+QVector<QPoint> Text::GetGeometry() const
+{
+    return QVector<QPoint>() << _anchor;
+}
+
+void Text::SetGeometry(const QVector<QPoint> &points)
+{
+    if (points.count() < 1)
+    {
+        qWarning() << "Warn: Text::SetGeometry(), too few points!" << points.count();
+        return;
+    }
+
+    _anchor = points.at(0);
+    _state = 1;
+    _completed = true;
+}
+
+void Text::SetText(const QString &text)
+{
+    if (text == _text)
+    {
+        return;
+    }
+
+    _text = text;
+    this->layoutText();
+}
+
+void Text::SetTextStyle(int style)
+{
+    if (style == _textStyle)
+    {
+        return;
+    }
+
+    _textStyle = style;
+    this->layoutText();
+}
+
+void Text::layoutText()
+{
+    QFont font;
+    font.setPixelSize(DefaultPixelSize);
+    font.setBold((_textStyle & ETextStyle::ETS_Bold) != 0);
+    font.setItalic((_textStyle & ETextStyle::ETS_Italic) != 0);
+    font.setUnderline((_textStyle & ETextStyle::ETS_Underline) != 0);
+
+    /*
+     * 单行排版，字形位置相对于文本框的左上角。文本为空时保留一个字高的文本框，便于选中。
+     */
+    QTextLayout layout(_text, font);
+    layout.beginLayout();
+    QTextLine line = layout.createLine();
+    layout.endLayout();
+
+    _glyphRuns = layout.glyphRuns();
+    if (line.isValid())
+    {
+        _textRect = QRectF(0.0, 0.0, qMax(line.naturalTextWidth(), 1.0), line.height());
+    }
+    else
+    {
+        _textRect = QRectF(0.0, 0.0, 1.0, QFontMetricsF(font).height());
+    }
+}
+
+GeometryShape *GeometryShapeFactory::CreateGeometryShape(EPaintType paintType)
+{
+    GeometryShape *shape = nullptr;
 
     switch (paintType)
     {
@@ -1059,6 +2082,12 @@ GeometryShape *GeometryShapeFactory::CreateGeometryShape(EPaintType paintType)
     case EPaintType::EPT_Polyline:
         shape = new Polyline();
         break;
+    case EPaintType::EPT_Text:
+        shape = new Text();
+        break;
+    case EPaintType::EPT_Freehand:
+        shape = new Freehand();
+        break;
     default:
         qCritical() << "Error: Invalid paint type!";
         break;
@@ -1066,3 +2095,24 @@ GeometryShape *GeometryShapeFactory::CreateGeometryShape(EPaintType paintType)
 
     return  shape;
 }
+
+GeometryShape *GeometryShapeFactory::CloneGeometryShape(const GeometryShape *shape)
+{
+    GeometryShape *clone = CreateGeometryShape(shape->GetPaintType());
+    if (clone == nullptr)
+    {
+        return nullptr;
+    }
+
+    clone->SetGeometry(shape->GetGeometry());
+    clone->SetId(shape->GetId());
+
+    if (shape->GetPaintType() == EPaintType::EPT_Text)
+    {
+        const Text *text = static_cast<const Text *>(shape);
+        static_cast<Text *>(clone)->SetTextStyle(text->GetTextStyle());
+        static_cast<Text *>(clone)->SetText(text->GetText());
+    }
+
+    return clone;
+}
@@ -4,8 +4,45 @@
 #include <QObject>
 #include <QPoint>
 #include <QPainter>
+#include <QPainterPath>
+#include <QGlyphRun>
+#include <QFont>
 
 #include "Types.h"
+#include "CompactPolygon.h"
+
+class GeometryShape;
+
+/**
+ * @brief The ShapeMeasure struct 图形的测量值，长度、面积的单位为场景像素，角度的单位为度，不适用的量为0。
+ * - length: Line的长度、Arc的弧长、Polyline的总长。
+ * - perimeter: Circle、Rect、Ellipse、Polygon的周长。
+ * - area: Circle、Rect、Ellipse、Polygon的面积。
+ * - radius: Arc、Circle的半径。
+ * - angle: Line与x轴正方向的夹角（逆时针），Arc的圆心角。
+ */
+struct ShapeMeasure
+{
+    qreal length;
+    qreal perimeter;
+    qreal area;
+    qreal radius;
+    qreal angle;
+
+    ShapeMeasure() : length(0.0), perimeter(0.0), area(0.0), radius(0.0), angle(0.0)
+    {
+    }
+};
+
+/**
+ * @brief The ShapeMeasureObserver class 接收图形测量值的变化，用于增量维护统计量。
+ */
+class ShapeMeasureObserver
+{
+public:
+    virtual ~ShapeMeasureObserver() {}
+    virtual void MeasureChanged(GeometryShape *shape, const ShapeMeasure &oldMeasure, const ShapeMeasure &newMeasure) = 0;
+};
 
 class GeometryShape
 {
@@ -15,6 +52,12 @@ public:
     constexpr static qreal DefaultGuidePointPenWidth = 10.0;
     constexpr static qreal DefaultLinePenWidth = 2.0;
     constexpr static qreal DefaultGuideLinePenWidth = 2.0;
+    /**
+     * @brief 预览绘制时，顶点数超过PreviewSimplifyMinPoints的折线/多边形，
+     * 去掉与前一顶点的设备距离小于PreviewVertexSpacing像素的顶点。
+     */
+    constexpr static int PreviewSimplifyMinPoints = 64;
+    constexpr static qreal PreviewVertexSpacing = 1.5;
 
     enum EPaintStateType
     {
@@ -25,27 +68,56 @@ public:
 
     GeometryShape();
     virtual ~GeometryShape() {}
-    virtual void Paint(QPainter &painter)
+    /**
+     * @brief Paint 绘制图形。
+     * @param preview 交互中的快速预览绘制（见PaintArea::ERQ_Preview），多顶点的图形按屏幕像素简化顶点。
+     */
+    virtual void Paint(QPainter &painter, bool preview)
     {
+        Q_UNUSED(preview)
         this->adjustPenWidthToDefault(_pointPen, painter, DefaultPointPenWidth);
         this->adjustPenWidthToDefault(_linePen, painter, DefaultLinePenWidth);
         this->adjustPenWidthToDefault(_guidePointPen, painter, DefaultGuidePointPenWidth);
         this->adjustPenWidthToDefault(_guideLinePen, painter, DefaultGuideLinePenWidth);
     }
+    /**
+     * @brief PreparePaint 按绘制比例预先设置画笔宽度。
+     * @details 之后以相同比例调用Paint()不再修改图形，同一图形可在多个线程中同时绘制。
+     */
+    void PreparePaint(qreal scale);
     virtual void UpdateState(EPaintStateType paintStateType, QPoint point) = 0;
     virtual bool Contains(QPoint point)
     {
         Q_UNUSED(point)
         return false;
     }
+    /**
+     * @brief BoundingRect 图形（不含画笔宽度）的外接矩形，用于重绘时的裁剪。
+     */
+    virtual QRect BoundingRect() const
+    {
+        return QRect();
+    }
+    /**
+     * @brief GetPath 图形的轮廓（场景坐标，不含画笔宽度），封闭图形为闭合路径。
+     */
+    virtual QPainterPath GetPath() const
+    {
+        return QPainterPath();
+    }
     virtual void MoveBegin(const QPoint& point)
     {
         _moveEnabled = true;
         _moveStartCursorPoint = point;
+        _moveLastCursorPoint = point;
     }
+    /**
+     * @brief Move 移动过程中按光标的增量平移图形，不保存移动前的几何副本。
+     */
     virtual void Move(QPoint point)
     {
-        Q_UNUSED(point)
+        this->Translate(point - _moveLastCursorPoint);
+        _moveLastCursorPoint = point;
     }
     virtual void MoveEnd(const QPoint& point)
     {
@@ -55,6 +127,55 @@ public:
     virtual void SaveToFile()
     {
     }
+    /**
+     * @brief Translate 平移图形（包括辅助线）。
+     */
+    virtual void Translate(const QPoint &offset) = 0;
+    /**
+     * @brief GetGeometry 图形的控制点。
+     * @details
+     * - Point: 点。
+     * - Line: 起点、终点。
+     * - Arc: 圆心、起点、终点。
+     * - Circle: 圆心、半径端点。
+     * - Rect/Ellipse: 左上角、右下角。
+     * - Polygon/Polyline: 各顶点。
+     * - Text: 文本框的左上角。
+     */
+    virtual QVector<QPoint> GetGeometry() const = 0;
+    /**
+     * @brief SetGeometry 按控制点设置图形，图形变为绘制完成状态。
+     * @param points 控制点，含义同GetGeometry()。
+     */
+    virtual void SetGeometry(const QVector<QPoint> &points) = 0;
+    /**
+     * @brief GetLiveGeometry 当前显示的控制点，含义同GetGeometry()。
+     * @details 绘制过程中为辅助线（光标所在位置）的控制点，其余时候同GetGeometry()。
+     */
+    virtual QVector<QPoint> GetLiveGeometry() const
+    {
+        return this->GetGeometry();
+    }
+    /**
+     * @brief GetMeasure 缓存的测量值，随UpdateState()、DragResize()、SetGeometry()更新，平移不改变测量值。
+     * @details 绘制过程中为GetLiveGeometry()的测量值。
+     */
+    const ShapeMeasure &GetMeasure() const
+    {
+        return _measure;
+    }
+    /**
+     * @brief SetMeasureObserver 设置测量值变化的观察者，nullptr表示不通知。
+     */
+    void SetMeasureObserver(ShapeMeasureObserver *observer)
+    {
+        _measureObserver = observer;
+    }
+    /**
+     * @brief Measure 按控制点计算测量值。
+     * @param points 控制点，含义同GetGeometry()。
+     */
+    static ShapeMeasure Measure(EPaintType paintType, const QVector<QPoint> &points);
 
     int GetState() const
     {
@@ -64,6 +185,14 @@ public:
     {
         return _completed;
     }
+    /**
+     * @brief HasValidGeometry 图形已完成且不退化，用于校验导入、恢复的数据。
+     * @details 多边形至少3个顶点，折线至少2个顶点；直线的长度、圆弧和圆的半径、矩形和椭圆的宽高不为0。
+     */
+    virtual bool HasValidGeometry() const
+    {
+        return _completed;
+    }
 
     virtual void SetSelected(bool selected)
     {
@@ -77,6 +206,53 @@ public:
     {
         return _paintType;
     }
+    /**
+     * @brief GetPointPen 点的画笔，宽度随最近一次绘制的缩放比例调整。
+     */
+    const QPen &GetPointPen() const
+    {
+        return _pointPen;
+    }
+    /**
+     * @brief GetLinePen 线的画笔，宽度随最近一次绘制的缩放比例调整。
+     */
+    const QPen &GetLinePen() const
+    {
+        return _linePen;
+    }
+    /**
+     * @brief GetId 图形在绘图区域内的唯一标识，加入绘图区域时分配，0表示未分配。
+     */
+    quint64 GetId() const
+    {
+        return _id;
+    }
+    void SetId(quint64 id)
+    {
+        _id = id;
+    }
+    /**
+     * @brief GetLayerId 图形所在图层的id，加入绘图区域时分配，移除后保留，恢复时回到原图层。
+     */
+    quint64 GetLayerId() const
+    {
+        return _layerId;
+    }
+    void SetLayerId(quint64 layerId)
+    {
+        _layerId = layerId;
+    }
+    /**
+     * @brief GetZOrder 图形在图层内的次序键，由图层维护，越大越靠上；自动保存据此恢复绘制顺序。
+     */
+    qreal GetZOrder() const
+    {
+        return _zOrder;
+    }
+    void SetZOrder(qreal zOrder)
+    {
+        _zOrder = zOrder;
+    }
 
     virtual Qt::CursorShape GetResizeCursorShape(QPoint point)
     {
@@ -105,14 +281,33 @@ protected:
     bool _completed;
     bool _selected;
     EPaintType _paintType;
+    quint64 _id;
+    quint64 _layerId;
+    qreal _zOrder;
     QPoint _moveStartCursorPoint;
+    QPoint _moveLastCursorPoint;
     bool _moveEnabled;
     bool _dragResizeEnabled;
     bool _valid;
-
+    ShapeMeasure _measure;
+    ShapeMeasureObserver *_measureObserver;
+
+    /**
+     * @brief updateMeasure 几何变化后重新计算测量值。
+     */
+    virtual void updateMeasure();
+    /**
+     * @brief setMeasure 更新缓存的测量值并通知观察者。
+     */
+    void setMeasure(const ShapeMeasure &measure);
     void adjustPenWidthToDefault(QPen &pen, const QPainter &painter, qreal defaultPenWidth);
+    /**
+     * @brief previewPolygon 预览绘制时简化顶点，非预览时原样返回。
+     */
+    static QPolygon previewPolygon(const QPolygon &polygon, const QPainter &painter, bool preview);
 private:
     void initPen();
+    static void setPenWidth(QPen &pen, qreal width);
 };
 
 class Point : public GeometryShape
@@ -121,15 +316,17 @@ public:
     constexpr static int DELTA = 10;
 
     Point();
-    void Paint(QPainter &painter) override;
+    void Paint(QPainter &painter, bool preview) override;
     void UpdateState(EPaintStateType paintStateType, QPoint point) override;
     bool Contains(QPoint point) override;
-    void MoveBegin(const QPoint &point) override;
-    void Move(QPoint point) override;
+    QRect BoundingRect() const override;
+    QPainterPath GetPath() const override;
+    void Translate(const QPoint &offset) override;
+    QVector<QPoint> GetGeometry() const override;
+    void SetGeometry(const QVector<QPoint> &points) override;
 
 private:
     QPoint _point;
-    QPoint _oldPoint;
 };
 
 class Line : public GeometryShape
@@ -138,15 +335,19 @@ public:
     constexpr static int DELTA = 5;
 
     Line();
-    void Paint(QPainter &painter) override;
+    void Paint(QPainter &painter, bool preview) override;
     void UpdateState(EPaintStateType paintStateType, QPoint point) override;
     bool Contains(QPoint point) override;
-    void MoveBegin(const QPoint &point) override;
-    void Move(QPoint point) override;
+    QRect BoundingRect() const override;
+    QPainterPath GetPath() const override;
+    void Translate(const QPoint &offset) override;
+    QVector<QPoint> GetGeometry() const override;
+    void SetGeometry(const QVector<QPoint> &points) override;
+    bool HasValidGeometry() const override;
+    QVector<QPoint> GetLiveGeometry() const override;
 
 private:
     QLine _line;
-    QLine _oldLine;
     QLine _guideLine;
     bool _isNeedGuideLine;
 };
@@ -157,19 +358,21 @@ public:
     constexpr static int DELTA = 10;
 
     Arc();
-    void Paint(QPainter &painter) override;
+    void Paint(QPainter &painter, bool preview) override;
     void UpdateState(EPaintStateType paintStateType, QPoint point) override;
     bool Contains(QPoint point) override;
-    void MoveBegin(const QPoint &point) override;
-    void Move(QPoint point) override;
+    QRect BoundingRect() const override;
+    QPainterPath GetPath() const override;
+    void Translate(const QPoint &offset) override;
+    QVector<QPoint> GetGeometry() const override;
+    void SetGeometry(const QVector<QPoint> &points) override;
+    bool HasValidGeometry() const override;
+    QVector<QPoint> GetLiveGeometry() const override;
 
 private:
     QPoint _center;
     QPoint _curArcP2;
     QPoint _curArcP3;
-    QPoint _oldCenter;
-    QPoint _oldCurArcP2;
-    QPoint _oldCurArcP3;
     QPoint _guideCenter;
     QPoint _guideArcP2;
     QPoint _guideArcP3;
@@ -180,15 +383,19 @@ class Circle : public GeometryShape
 {
 public:
     Circle();
-    void Paint(QPainter &painter) override;
+    void Paint(QPainter &painter, bool preview) override;
     void UpdateState(EPaintStateType paintStateType, QPoint point) override;
     bool Contains(QPoint point) override;
-    void MoveBegin(const QPoint &point) override;
-    void Move(QPoint point) override;
+    QRect BoundingRect() const override;
+    QPainterPath GetPath() const override;
+    void Translate(const QPoint &offset) override;
+    QVector<QPoint> GetGeometry() const override;
+    void SetGeometry(const QVector<QPoint> &points) override;
+    bool HasValidGeometry() const override;
+    QVector<QPoint> GetLiveGeometry() const override;
 
 private:
     QLine _radiusLine;
-    QLine _oldRadiusLine;
     QLine _guideRadiusLine;
     bool _isNeedGuide;
 };
@@ -200,11 +407,16 @@ public:
 
     Rect();
     ~Rect();
-    void Paint(QPainter &painter) override;
+    void Paint(QPainter &painter, bool preview) override;
     void UpdateState(EPaintStateType paintStateType, QPoint point) override;
     bool Contains(QPoint point) override;
-    void MoveBegin(const QPoint &point) override;
-    void Move(QPoint point) override;
+    QRect BoundingRect() const override;
+    QPainterPath GetPath() const override;
+    void Translate(const QPoint &offset) override;
+    QVector<QPoint> GetGeometry() const override;
+    void SetGeometry(const QVector<QPoint> &points) override;
+    bool HasValidGeometry() const override;
+    QVector<QPoint> GetLiveGeometry() const override;
     Qt::CursorShape GetResizeCursorShape(QPoint point) override;
     void DragResize(const QPoint &point) override;
     void SetDragResizeEnabled(bool enable) override;
@@ -215,8 +427,6 @@ protected:
     QRect _guideRect;
 
     QPoint _p1;
-    QPoint _oldP1;
-    QPoint _oldP2;
 
     Qt::CursorShape _cursorShape;
     Qt::CursorShape _dragCursorShape;
@@ -230,31 +440,179 @@ class Ellipse : public Rect
 {
 public:
     Ellipse();
-    void Paint(QPainter &painter) override;
+    void Paint(QPainter &painter, bool preview) override;
+    QPainterPath GetPath() const override;
 };
 
 class Polygon : public GeometryShape
 {
 public:
     Polygon();
-    void Paint(QPainter &painter) override;
+    void Paint(QPainter &painter, bool preview) override;
     void UpdateState(EPaintStateType paintStateType, QPoint point) override;
     bool Contains(QPoint point) override;
-    void MoveBegin(const QPoint &point) override;
-    void Move(QPoint point) override;
+    QRect BoundingRect() const override;
+    QPainterPath GetPath() const override;
+    void Translate(const QPoint &offset) override;
+    QVector<QPoint> GetGeometry() const override;
+    void SetGeometry(const QVector<QPoint> &points) override;
+    bool HasValidGeometry() const override;
+    QVector<QPoint> GetLiveGeometry() const override;
+    /**
+     * @brief SetCompact 已完成的图形改用紧凑存储（见CompactPolygon），false时恢复为QPolygon。
+     * @details 紧凑存储时平移与顶点数无关，SetGeometry()后仍保持紧凑存储。
+     * @return false - 图形未完成或者顶点的范围无法编码，存储方式不变。
+     */
+    virtual bool SetCompact(bool compact);
+    bool IsCompact() const
+    {
+        return _isCompact;
+    }
 
 protected:
+    /**
+     * @brief 紧凑存储时_polygon、_guidePolygon为空，顶点在_compactPolygon中。
+     */
     QPolygon _polygon;
-    QPolygon _oldPolygon;
     QPolygon _guidePolygon;
+    CompactPolygon _compactPolygon;
+    bool _isCompact;
     bool _isShowGuide;
+    /**
+     * @brief 已确定顶点组成的折线的长度，以及以第一个顶点为公共点的三角形扇的叉积和（面积的2倍，带符号）。
+     * 每添加一个顶点增量累加，绘制过程中测量不需要遍历顶点；平移不改变两者。
+     */
+    qreal _chainLength;
+    qint64 _chainCross;
+
+    void updateMeasure() override;
+    void appendChain(const QPoint &point);
+    void resetChain();
+    /**
+     * @brief vertices 当前的顶点，紧凑存储时解码。
+     */
+    QPolygon vertices() const
+    {
+        return _isCompact ? _compactPolygon.Decode() : _polygon;
+    }
+    /**
+     * @brief drawVertices 绘制顶点组成的多边形（closed）或折线。紧凑存储时把画笔平移到原点，
+     * 相对顶点解码到临时的QPolygon中，绘制后即释放，图形上只保留紧凑存储。
+     */
+    void drawVertices(QPainter &painter, bool closed, bool preview) const;
+    /**
+     * @brief verticesPath 顶点组成的折线路径，不闭合。
+     */
+    QPainterPath verticesPath() const;
 };
 
 class Polyline : public Polygon
 {
 public:
     Polyline();
-    void Paint(QPainter &painter) override;
+    void Paint(QPainter &painter, bool preview) override;
+    QPainterPath GetPath() const override;
+    bool HasValidGeometry() const override;
+};
+
+/**
+ * @brief The Freehand class 手绘笔迹，按下左键开始，按住移动时每个采样都加入笔迹，松开结束。
+ * @details
+ * - 采样先做指数平滑（SmoothingFactor），抑制手的抖动。
+ * - 在线简化：最后一个顶点到当前采样的线段与其间所有采样的距离都不超过SimplifyTolerance时，只移动笔迹的末端，
+ *   否则把末端确定为顶点。误差界与Ramer-Douglas-Peucker相同，每个采样只处理一次，待定的采样不超过MaxPendingSamples个。
+ * - 顶点每ChunkSize个一组记录外接矩形，绘制时只绘制与裁剪区域相交的组。每个采样只改变末尾的线段，
+ *   TakeDirtyRect()给出需要重绘的区域，绘制过程中只重绘这一小块，开销与笔迹的长度无关。
+ */
+class Freehand : public Polyline
+{
+public:
+    constexpr static qreal SmoothingFactor = 0.5;
+    constexpr static qreal SimplifyTolerance = 1.0;
+    constexpr static int MaxPendingSamples = 256;
+    constexpr static int ChunkSize = 64;
+    constexpr static int DELTA = 5;
+
+    Freehand();
+    void Paint(QPainter &painter, bool preview) override;
+    void UpdateState(EPaintStateType paintStateType, QPoint point) override;
+    bool Contains(QPoint point) override;
+    void Translate(const QPoint &offset) override;
+    void SetGeometry(const QVector<QPoint> &points) override;
+    /**
+     * @brief SetCompact 笔迹已按组记录外接矩形，不使用紧凑存储。
+     */
+    bool SetCompact(bool compact) override;
+    /**
+     * @brief TakeDirtyRect 上次调用以来笔迹变化的场景区域（不含画笔宽度），返回后清空。
+     */
+    QRect TakeDirtyRect();
+
+private:
+    QPointF _smoothed;
+    /**
+     * @brief 最后一个顶点之后、末端之前的采样。
+     */
+    QVector<QPoint> _pending;
+    /**
+     * @brief 第i组为起点下标在[i * ChunkSize, (i + 1) * ChunkSize)内的线段的外接矩形。
+     */
+    QVector<QRect> _chunkRects;
+    QRect _dirtyRect;
+
+    void addSample(const QPoint &point);
+    /**
+     * @brief fitsSegment 待定的采样以及末端与线段[start, end]的距离是否都不超过SimplifyTolerance。
+     */
+    bool fitsSegment(const QPoint &start, const QPoint &end) const;
+    void appendVertex(const QPoint &point);
+    void resetChunks();
+};
+
+/**
+ * @brief The Text class 文本标注，单击处为文本框的左上角，字号为场景像素，随视图缩放。
+ * @details
+ * 文本和样式变化时立即排版，缓存字形（QGlyphRun）和文本框，绘制时直接绘制字形，不再重新排版，
+ * 与视图的缩放、平移无关。字号在视口上小于MinReadablePixelSize像素时，只以色块示意。
+ */
+class Text : public GeometryShape
+{
+public:
+    constexpr static int DefaultPixelSize = 20;
+    constexpr static qreal MinReadablePixelSize = 4.0;
+
+    Text();
+    void Paint(QPainter &painter, bool preview) override;
+    void UpdateState(EPaintStateType paintStateType, QPoint point) override;
+    bool Contains(QPoint point) override;
+    QRect BoundingRect() const override;
+    QPainterPath GetPath() const override;
+    void Translate(const QPoint &offset) override;
+    QVector<QPoint> GetGeometry() const override;
+    void SetGeometry(const QVector<QPoint> &points) override;
+
+    QString GetText() const
+    {
+        return _text;
+    }
+    void SetText(const QString &text);
+    /**
+     * @brief GetTextStyle ETextStyle的组合。
+     */
+    int GetTextStyle() const
+    {
+        return _textStyle;
+    }
+    void SetTextStyle(int style);
+
+private:
+    QPoint _anchor;
+    QString _text;
+    int _textStyle;
+    QList<QGlyphRun> _glyphRuns;
+    QRectF _textRect;
+
+    void layoutText();
 };
 
 class GeometryShapeFactory
@@ -264,6 +622,10 @@ public:
     ~GeometryShapeFactory() = delete;
     GeometryShapeFactory(const GeometryShapeFactory&) = delete;
     static GeometryShape *CreateGeometryShape(EPaintType paintType);
+    /**
+     * @brief CloneGeometryShape 复制已完成的图形（类型、控制点、id，文本的内容和样式），不复制选中等交互状态。
+     */
+    static GeometryShape *CloneGeometryShape(const GeometryShape *shape);
 };
 
 #endif // GEOMETRYSHAPE_H
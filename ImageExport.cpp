@@ -0,0 +1,525 @@
+#include "ImageExport.h"
+
+#include <QtMath>
+#include <QPainter>
+#include <QSaveFile>
+#include <QDebug>
+#include <QtConcurrent/QtConcurrentMap>
+
+namespace
+{
+const char PngSignature[] = "\x89PNG\r\n\x1a\n";
+
+enum ETiffFieldType
+{
+    ETFT_Short = 3,
+    ETFT_Long = 4,
+    ETFT_Long8 = 16,
+};
+
+struct TiffEntry
+{
+    quint16 tag;
+    quint16 type;
+    quint64 count;
+    QByteArray data;
+};
+
+void appendBigEndian(QByteArray &data, quint32 value)
+{
+    data.append(char(value >> 24)).append(char(value >> 16)).append(char(value >> 8)).append(char(value));
+}
+
+void appendLittleEndian(QByteArray &data, quint64 value, int bytes)
+{
+    for (int i = 0; i < bytes; i++)
+    {
+        data.append(char(value >> (8 * i)));
+    }
+}
+
+TiffEntry tiffEntry(quint16 tag, quint16 type, const QVector<quint64> &values)
+{
+    const int bytes = (type == ETFT_Short) ? 2 : ((type == ETFT_Long) ? 4 : 8);
+    TiffEntry entry;
+    entry.tag = tag;
+    entry.type = type;
+    entry.count = quint64(values.count());
+    for (auto value : values)
+    {
+        appendLittleEndian(entry.data, value, bytes);
+    }
+    return entry;
+}
+
+/**
+ * @brief tiffEntries RGBA、不压缩、按条带存储的图片的全部标签，按编号升序排列。
+ */
+QList<TiffEntry> tiffEntries(const QSize &size, int rowsPerStrip, quint16 offsetType,
+                             const QVector<quint64> &stripOffsets, const QVector<quint64> &stripByteCounts)
+{
+    QList<TiffEntry> entries;
+    entries << tiffEntry(256, ETFT_Long, QVector<quint64>() << quint64(size.width()));
+    entries << tiffEntry(257, ETFT_Long, QVector<quint64>() << quint64(size.height()));
+    entries << tiffEntry(258, ETFT_Short, QVector<quint64>() << 8 << 8 << 8 << 8);
+    entries << tiffEntry(259, ETFT_Short, QVector<quint64>() << 1);
+    entries << tiffEntry(262, ETFT_Short, QVector<quint64>() << 2);
+    entries << tiffEntry(273, offsetType, stripOffsets);
+    entries << tiffEntry(277, ETFT_Short, QVector<quint64>() << 4);
+    entries << tiffEntry(278, ETFT_Long, QVector<quint64>() << quint64(rowsPerStrip));
+    entries << tiffEntry(279, offsetType, stripByteCounts);
+    entries << tiffEntry(284, ETFT_Short, QVector<quint64>() << 1);
+    entries << tiffEntry(338, ETFT_Short, QVector<quint64>() << 2);
+    return entries;
+}
+
+/**
+ * @brief tiffIfdSize IFD的字节数，含IFD之后放不下的值（各自按2字节对齐）。
+ */
+quint64 tiffIfdSize(const QList<TiffEntry> &entries, bool bigTiff)
+{
+    const int fieldSize = bigTiff ? 8 : 4;
+    quint64 size = (bigTiff ? 8 : 2) + quint64(entries.count()) * (bigTiff ? 20 : 12) + fieldSize;
+    for (const TiffEntry &entry : entries)
+    {
+        if (entry.data.size() > fieldSize)
+        {
+            size += quint64(entry.data.size() + entry.data.size() % 2);
+        }
+    }
+    return size;
+}
+}
+
+TiledImageRenderer::TiledImageRenderer(const QImage &background, const QList<GeometryShape *> &shapes, qreal scale) : _scale((scale > 0.0) ? scale : 1.0)
+  , _targetBits(nullptr)
+  , _targetBytesPerLine(0)
+{
+    /*
+     * 预乘格式绘制最快，只转换一次，各图块共享（只读）。
+     */
+    _background = background.convertToFormat(QImage::Format_ARGB32_Premultiplied);
+    _size = QSize(qCeil(_background.width() * _scale), qCeil(_background.height() * _scale));
+
+    const qreal margin = ShapeMargin / _scale;
+    for (auto item : shapes)
+    {
+        GeometryShape *clone = GeometryShapeFactory::CloneGeometryShape(item);
+        if (clone == nullptr)
+        {
+            continue;
+        }
+        if (!clone->GetCompleted())
+        {
+            delete clone;
+            continue;
+        }
+
+        clone->PreparePaint(_scale);
+        _shapes.append(clone);
+        _shapeRects.append(QRectF(clone->BoundingRect()).adjusted(-margin, -margin, margin, margin));
+    }
+
+    const int tileSize = TileSize;
+    for (int y = 0; y < _size.height(); y += tileSize)
+    {
+        for (int x = 0; x < _size.width(); x += tileSize)
+        {
+            _tiles.append(QRect(x, y, qMin(tileSize, _size.width() - x), qMin(tileSize, _size.height() - y)));
+        }
+    }
+}
+
+TiledImageRenderer::~TiledImageRenderer()
+{
+    qDeleteAll(_shapes);
+}
+
+QFuture<void> TiledImageRenderer::Start(QImage &target)
+{
+    Q_ASSERT((target.size() == _size) && (target.format() == QImage::Format_ARGB32_Premultiplied));
+
+    /*
+     * bits()会分离共享的数据，需在启动前于调用线程中完成。
+     */
+    _targetBits = target.bits();
+    _targetBytesPerLine = target.bytesPerLine();
+    _targetOrigin = QPoint(0, 0);
+
+    return QtConcurrent::map(_tiles, [this](const QRect &tile)
+    {
+        this->renderTile(tile);
+    });
+}
+
+void TiledImageRenderer::RenderBand(QImage &band, int top, int rows)
+{
+    Q_ASSERT((band.width() == _size.width()) && (rows <= band.height()) &&
+             (band.format() == QImage::Format_ARGB32_Premultiplied));
+
+    _targetBits = band.bits();
+    _targetBytesPerLine = band.bytesPerLine();
+    _targetOrigin = QPoint(0, top);
+
+    const int tileSize = TileSize;
+    QVector<QRect> tiles;
+    for (int x = 0; x < _size.width(); x += tileSize)
+    {
+        tiles.append(QRect(x, top, qMin(tileSize, _size.width() - x), rows));
+    }
+
+    QtConcurrent::blockingMap(tiles, [this](const QRect &tile)
+    {
+        this->renderTile(tile);
+    });
+}
+
+void TiledImageRenderer::RenderRect(QPainter &painter, const QRect &rect) const
+{
+    const QRectF sceneRect(rect.x() / _scale, rect.y() / _scale, rect.width() / _scale, rect.height() / _scale);
+
+    QTransform transform;
+    transform.translate(-rect.x(), -rect.y());
+    transform.scale(_scale, _scale);
+
+    painter.setRenderHint(QPainter::Antialiasing, true);
+    painter.setRenderHint(QPainter::SmoothPixmapTransform, true);
+    painter.setTransform(transform);
+
+    /*
+     * 源区域向外扩展2像素，平滑缩放在区域边缘的采样与相邻区域一致，拼接处没有接缝。
+     */
+    QRect sourceRect = sceneRect.adjusted(-2.0, -2.0, 2.0, 2.0).toAlignedRect() & _background.rect();
+    if (!sourceRect.isEmpty())
+    {
+        painter.drawImage(QRectF(sourceRect), _background, QRectF(sourceRect));
+    }
+
+    for (int i = 0; i < _shapes.count(); i++)
+    {
+        if (_shapeRects.at(i).intersects(sceneRect))
+        {
+            _shapes.at(i)->Paint(painter, false);
+        }
+    }
+}
+
+void TiledImageRenderer::renderTile(const QRect &tile) const
+{
+    uchar *bits = _targetBits + (tile.y() - _targetOrigin.y()) * _targetBytesPerLine + (tile.x() - _targetOrigin.x()) * 4;
+    QImage view(bits, tile.width(), tile.height(), _targetBytesPerLine, QImage::Format_ARGB32_Premultiplied);
+    view.fill(Qt::transparent);
+
+    QPainter painter(&view);
+    this->RenderRect(painter, tile);
+}
+
+BandImageWriter::BandImageWriter(QIODevice *device, EImageFileFormat format, const QSize &size, int bandRows) : _device(device)
+  , _format(format)
+  , _size(size)
+  , _writtenRows(0)
+  , _bigTiff(false)
+  , _rowsPerStrip(qBound(1, bandRows, qMax(1, size.height())))
+  , _stream()
+  , _deflating(false)
+{
+}
+
+BandImageWriter::~BandImageWriter()
+{
+    if (_deflating)
+    {
+        deflateEnd(&_stream);
+    }
+}
+
+bool BandImageWriter::Begin()
+{
+    if (_format == EImageFileFormat::EIFF_Png)
+    {
+        /*
+         * 每行前有一个滤波类型字节，0表示不滤波。
+         */
+        _row = QByteArray(1 + _size.width() * 4, '\0');
+        _idat = QByteArray(IdatSize, '\0');
+        if (deflateInit(&_stream, Z_BEST_SPEED) != Z_OK)
+        {
+            qWarning() << "Warn: BandImageWriter::Begin(), failed to init deflate!";
+            return false;
+        }
+        _deflating = true;
+        _stream.next_out = reinterpret_cast<Bytef *>(_idat.data());
+        _stream.avail_out = uInt(_idat.size());
+
+        QByteArray header;
+        appendBigEndian(header, quint32(_size.width()));
+        appendBigEndian(header, quint32(_size.height()));
+        header.append(char(8)).append(char(6)).append(char(0)).append(char(0)).append(char(0));
+
+        return write(QByteArray(PngSignature, 8)) && writePngChunk("IHDR", header);
+    }
+
+    /*
+     * 经典TIFF的偏移为32位：文件头、像素数据、IFD前的对齐字节和IFD（含条带表等放不下的值）
+     * 都在4GB以内时才使用经典TIFF。
+     */
+    const int strips = (_size.height() + _rowsPerStrip - 1) / _rowsPerStrip;
+    const QList<TiffEntry> entries = tiffEntries(_size, _rowsPerStrip, ETFT_Long,
+                                                 QVector<quint64>(strips), QVector<quint64>(strips));
+    const quint64 classicSize = 8 + quint64(_size.width()) * quint64(_size.height()) * 4 + 1 + tiffIfdSize(entries, false);
+    _row = QByteArray(_size.width() * 4, '\0');
+    _bigTiff = classicSize > quint64(0xFFFFFFFFu);
+
+    QByteArray header("II", 2);
+    if (_bigTiff)
+    {
+        appendLittleEndian(header, 43, 2);
+        appendLittleEndian(header, 8, 2);
+        appendLittleEndian(header, 0, 2);
+        appendLittleEndian(header, 0, 8);
+    }
+    else
+    {
+        appendLittleEndian(header, 42, 2);
+        appendLittleEndian(header, 0, 4);
+    }
+
+    return write(header);
+}
+
+bool BandImageWriter::WriteBand(const QImage &band, int rows)
+{
+    const int offset = (_format == EImageFileFormat::EIFF_Png) ? 1 : 0;
+
+    if (_format == EImageFileFormat::EIFF_Tiff)
+    {
+        _stripOffsets.append(quint64(_device->pos()));
+        _stripByteCounts.append(quint64(rows) * _size.width() * 4);
+    }
+
+    for (int y = 0; y < rows; y++)
+    {
+        /*
+         * 两种格式都保存非预乘的RGBA。
+         */
+        const QRgb *src = reinterpret_cast<const QRgb *>(band.constScanLine(y));
+        uchar *dst = reinterpret_cast<uchar *>(_row.data()) + offset;
+        for (int x = 0; x < _size.width(); x++)
+        {
+            const QRgb color = qUnpremultiply(src[x]);
+            dst[0] = uchar(qRed(color));
+            dst[1] = uchar(qGreen(color));
+            dst[2] = uchar(qBlue(color));
+            dst[3] = uchar(qAlpha(color));
+            dst += 4;
+        }
+
+        if (_format == EImageFileFormat::EIFF_Tiff)
+        {
+            if (!write(_row))
+            {
+                return false;
+            }
+            continue;
+        }
+
+        if (!deflateData(_row.constData(), _row.size(), Z_NO_FLUSH))
+        {
+            return false;
+        }
+    }
+
+    _writtenRows += rows;
+    return true;
+}
+
+bool BandImageWriter::Finish()
+{
+    if (_writtenRows != _size.height())
+    {
+        qWarning() << "Warn: BandImageWriter::Finish(), incomplete image!" << _writtenRows << _size.height();
+        return false;
+    }
+
+    if (_format == EImageFileFormat::EIFF_Tiff)
+    {
+        return finishTiff();
+    }
+
+    if (!deflateData(nullptr, 0, Z_FINISH))
+    {
+        return false;
+    }
+    deflateEnd(&_stream);
+    _deflating = false;
+
+    return writePngChunk("IEND", QByteArray());
+}
+
+bool BandImageWriter::write(const QByteArray &data)
+{
+    return _device->write(data) == data.size();
+}
+
+bool BandImageWriter::writePngChunk(const char *type, const QByteArray &data)
+{
+    QByteArray chunk;
+    chunk.reserve(data.size() + 12);
+    appendBigEndian(chunk, quint32(data.size()));
+    chunk.append(type, 4);
+    chunk.append(data);
+    appendBigEndian(chunk, quint32(crc32(0, reinterpret_cast<const Bytef *>(chunk.constData() + 4), uInt(data.size() + 4))));
+    return write(chunk);
+}
+
+bool BandImageWriter::deflateData(const char *data, int length, int flush)
+{
+    _stream.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(data));
+    _stream.avail_in = uInt(length);
+
+    int result = Z_OK;
+    do
+    {
+        result = deflate(&_stream, flush);
+        if (result == Z_STREAM_ERROR)
+        {
+            qWarning() << "Warn: BandImageWriter::deflateData(), failed to deflate!";
+            return false;
+        }
+
+        /*
+         * 输出缓冲满或数据流结束时写一个IDAT块，之后从缓冲开头继续输出。
+         */
+        if ((_stream.avail_out == 0) || (result == Z_STREAM_END))
+        {
+            if (!writePngChunk("IDAT", _idat.left(_idat.size() - int(_stream.avail_out))))
+            {
+                return false;
+            }
+            _stream.next_out = reinterpret_cast<Bytef *>(_idat.data());
+            _stream.avail_out = uInt(_idat.size());
+        }
+    } while ((_stream.avail_in > 0) || ((flush == Z_FINISH) && (result != Z_STREAM_END)));
+
+    return true;
+}
+
+bool BandImageWriter::finishTiff()
+{
+    const quint16 offsetType = _bigTiff ? ETFT_Long8 : ETFT_Long;
+    const int fieldSize = _bigTiff ? 8 : 4;
+
+    const QList<TiffEntry> entries = tiffEntries(_size, _rowsPerStrip, offsetType, _stripOffsets, _stripByteCounts);
+
+    QByteArray padding((_device->pos() % 2 == 0) ? 0 : 1, '\0');
+    if (!write(padding))
+    {
+        return false;
+    }
+
+    const quint64 ifdOffset = quint64(_device->pos());
+    const quint64 ifdSize = (_bigTiff ? 8 : 2) + quint64(entries.count()) * (_bigTiff ? 20 : 12) + (_bigTiff ? 8 : 4);
+    QByteArray ifd;
+    QByteArray extra;
+
+    appendLittleEndian(ifd, quint64(entries.count()), _bigTiff ? 8 : 2);
+    for (const TiffEntry &entry : entries)
+    {
+        appendLittleEndian(ifd, entry.tag, 2);
+        appendLittleEndian(ifd, entry.type, 2);
+        appendLittleEndian(ifd, entry.count, fieldSize);
+
+        if (entry.data.size() <= fieldSize)
+        {
+            ifd.append(entry.data);
+            ifd.append(QByteArray(fieldSize - entry.data.size(), '\0'));
+        }
+        else
+        {
+            /*
+             * 放不下的值写在IFD之后，字段中保存偏移。
+             */
+            appendLittleEndian(ifd, ifdOffset + ifdSize + quint64(extra.size()), fieldSize);
+            extra.append(entry.data);
+            if (extra.size() % 2 != 0)
+            {
+                extra.append('\0');
+            }
+        }
+    }
+    appendLittleEndian(ifd, 0, fieldSize);
+
+    QByteArray headerOffset;
+    appendLittleEndian(headerOffset, ifdOffset, fieldSize);
+
+    return write(ifd) && write(extra) && _device->seek(_bigTiff ? 8 : 4) && write(headerOffset);
+}
+
+BandImageExporter::BandImageExporter(TiledImageRenderer *renderer, const QString &path, EImageFileFormat format, QObject *parent) : QObject(parent)
+  , _renderer(renderer)
+  , _path(path)
+  , _format(format)
+  , _cancelRequested(0)
+{
+    const int maxBandHeight = TiledImageRenderer::TileSize;
+    const qint64 bytesPerLine = qint64(qMax(1, _renderer->GetSize().width())) * 4;
+    _bandHeight = qBound(1, int(qMin(qint64(maxBandHeight), BandBytes / bytesPerLine)), maxBandHeight);
+}
+
+int BandImageExporter::GetBandCount() const
+{
+    return (_renderer->GetSize().height() + _bandHeight - 1) / _bandHeight;
+}
+
+bool BandImageExporter::Run()
+{
+    const QSize size = _renderer->GetSize();
+    QSaveFile file(_path);
+    if (!file.open(QIODevice::WriteOnly))
+    {
+        qWarning() << "Warn: BandImageExporter::Run(), failed to open!" << _path << file.errorString();
+        return false;
+    }
+
+    BandImageWriter writer(&file, _format, size, _bandHeight);
+    QImage band(size.width(), _bandHeight, QImage::Format_ARGB32_Premultiplied);
+    if (band.isNull() || !writer.Begin())
+    {
+        file.cancelWriting();
+        return false;
+    }
+
+    int count = 0;
+    for (int top = 0; top < size.height(); top += _bandHeight)
+    {
+        if (_cancelRequested.loadAcquire() != 0)
+        {
+            file.cancelWriting();
+            return false;
+        }
+
+        const int rows = qMin(_bandHeight, size.height() - top);
+        _renderer->RenderBand(band, top, rows);
+        if (!writer.WriteBand(band, rows))
+        {
+            qWarning() << "Warn: BandImageExporter::Run(), failed to write!" << _path << file.errorString();
+            file.cancelWriting();
+            return false;
+        }
+
+        emit bandFinished(++count);
+    }
+
+    if (!writer.Finish() || !file.commit())
+    {
+        qWarning() << "Warn: BandImageExporter::Run(), failed to finish!" << _path << file.errorString();
+        return false;
+    }
+
+    return true;
+}
+
+void BandImageExporter::Cancel()
+{
+    _cancelRequested.storeRelease(1);
+}
@@ -0,0 +1,181 @@
+#ifndef IMAGEEXPORT_H
+#define IMAGEEXPORT_H
+
+#include <QImage>
+#include <QList>
+#include <QVector>
+#include <QRect>
+#include <QRectF>
+#include <QFuture>
+#include <QObject>
+#include <QIODevice>
+#include <QAtomicInt>
+#include <zlib.h>
+
+#include "GeometryShape.h"
+
+/**
+ * @brief The TiledImageRenderer class 导出图片：将背景图和图形按比例渲染到目标图片。
+ * @details
+ * - 目标图片划分为TileSize x TileSize的图块，在线程池中并行渲染，每个图块使用各自的QPainter。
+ * - 图块直接绘制在目标图片对应区域的内存上（不复制像素），渲染完成即拼接完成。
+ * - 构造时在调用线程复制图形，渲染期间绘图区域中的图形可以继续编辑。
+ * - 每个图块只绘制外接矩形与之相交的图形。
+ */
+class TiledImageRenderer
+{
+public:
+    constexpr static int TileSize = 512;
+    /**
+     * @brief 图形的画笔宽度、端点等超出外接矩形的范围（目标图片的像素）。
+     */
+    constexpr static int ShapeMargin = 8;
+
+    /**
+     * @param background 背景图，位于场景坐标原点，导出范围即背景图的范围。
+     * @param shapes 需要导出的图形（场景坐标）。
+     * @param scale 导出比例，目标图片大小为背景图大小乘以scale。
+     */
+    TiledImageRenderer(const QImage &background, const QList<GeometryShape *> &shapes, qreal scale);
+    ~TiledImageRenderer();
+    TiledImageRenderer(const TiledImageRenderer&) = delete;
+    TiledImageRenderer &operator=(const TiledImageRenderer&) = delete;
+
+    QSize GetSize() const
+    {
+        return _size;
+    }
+    int GetTileCount() const
+    {
+        return _tiles.count();
+    }
+    /**
+     * @brief Start 开始并行渲染。
+     * @param target 目标图片，大小为GetSize()，格式为ARGB32_Premultiplied。渲染结束前对象和target需保持有效。
+     * @return 可用于等待、取消，进度为已完成的图块数。
+     */
+    QFuture<void> Start(QImage &target);
+    /**
+     * @brief RenderBand 渲染目标图片中从top开始的rows行，行带内仍按图块并行，完成后返回。
+     * @param band 宽度为GetSize().width()、格式为ARGB32_Premultiplied的图片，结果写在前rows行。
+     */
+    void RenderBand(QImage &band, int top, int rows);
+    /**
+     * @brief RenderRect 在调用线程中渲染目标图片的一个区域。
+     * @param painter 绘制到区域左上角为原点的设备上。
+     * @param rect 目标图片坐标下的区域。
+     */
+    void RenderRect(QPainter &painter, const QRect &rect) const;
+
+private:
+    QImage _background;
+    QList<GeometryShape *> _shapes;
+    QVector<QRectF> _shapeRects;
+    qreal _scale;
+    QSize _size;
+    QVector<QRect> _tiles;
+
+    uchar *_targetBits;
+    int _targetBytesPerLine;
+    QPoint _targetOrigin;
+
+    void renderTile(const QRect &tile) const;
+};
+
+/**
+ * @brief The EImageFileFormat enum 流式导出支持的格式。
+ * - EIFF_Png: RGBA，按行带用zlib压缩（最快级别），压缩状态跨行带保持，整张图片为一个zlib数据流。
+ * - EIFF_Tiff: RGBA，不压缩，每个行带一个条带（strip），文件（含IFD和条带表）超过4GB时使用BigTIFF。
+ */
+enum EImageFileFormat
+{
+    EIFF_Png = 0,
+    EIFF_Tiff,
+};
+
+/**
+ * @brief The BandImageWriter class 按行带顺序写入图片文件，只缓存一行像素（PNG另有一个IDAT块的压缩输出）。
+ */
+class BandImageWriter
+{
+public:
+    /**
+     * @brief 一个IDAT块的最大长度。
+     */
+    constexpr static int IdatSize = 64 * 1024;
+
+    /**
+     * @param device 输出设备，TIFF需要可以回写文件头。
+     * @param bandRows 每个行带的行数，最后一个行带可以更少。
+     */
+    BandImageWriter(QIODevice *device, EImageFileFormat format, const QSize &size, int bandRows);
+    ~BandImageWriter();
+    BandImageWriter(const BandImageWriter&) = delete;
+    BandImageWriter &operator=(const BandImageWriter&) = delete;
+
+    bool Begin();
+    /**
+     * @brief WriteBand 写入band的前rows行（ARGB32_Premultiplied），各行带按从上到下的顺序写入。
+     */
+    bool WriteBand(const QImage &band, int rows);
+    bool Finish();
+
+private:
+    QIODevice *_device;
+    EImageFileFormat _format;
+    QSize _size;
+    QByteArray _row;
+    int _writtenRows;
+
+    bool _bigTiff;
+    QVector<quint64> _stripOffsets;
+    QVector<quint64> _stripByteCounts;
+    int _rowsPerStrip;
+
+    z_stream _stream;
+    bool _deflating;
+    QByteArray _idat;
+
+    bool write(const QByteArray &data);
+    bool writePngChunk(const char *type, const QByteArray &data);
+    /**
+     * @brief deflateData 压缩data，输出缓冲满时写一个IDAT块；flush为Z_FINISH时结束数据流并写出剩余数据。
+     */
+    bool deflateData(const char *data, int length, int flush);
+    bool finishTiff();
+};
+
+/**
+ * @brief The BandImageExporter class 按行带流式导出图片，内存占用由行带大小决定，与导出分辨率无关。
+ * @details Run()在后台线程中执行，逐行带渲染并写入文件；取消或失败时不留下不完整的文件。
+ */
+class BandImageExporter : public QObject
+{
+    Q_OBJECT
+public:
+    /**
+     * @brief 一个行带的最大字节数。
+     */
+    constexpr static qint64 BandBytes = 64 * 1024 * 1024;
+
+    BandImageExporter(TiledImageRenderer *renderer, const QString &path, EImageFileFormat format, QObject *parent = nullptr);
+
+    int GetBandCount() const;
+    bool Run();
+    /**
+     * @brief Cancel 请求取消，可在任意线程调用，当前行带写完后停止。
+     */
+    void Cancel();
+
+signals:
+    void bandFinished(int count);
+
+private:
+    TiledImageRenderer *_renderer;
+    QString _path;
+    EImageFileFormat _format;
+    int _bandHeight;
+    QAtomicInt _cancelRequested;
+};
+
+#endif // IMAGEEXPORT_H
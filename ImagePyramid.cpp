@@ -0,0 +1,94 @@
+#include "ImagePyramid.h"
+
+#include <QtMath>
+#include <QtConcurrent>
+
+ImagePyramid::ImagePyramid()
+{
+}
+
+void ImagePyramid::Build(const QImage &image)
+{
+    _levels.clear();
+    if (image.isNull())
+    {
+        return;
+    }
+
+    _levels.append(ToGray(image));
+    while ((_levels.last().width() > MinLevelSize) || (_levels.last().height() > MinLevelSize))
+    {
+        _levels.append(downsample(_levels.last()));
+    }
+}
+
+void ImagePyramid::Clear()
+{
+    _levels.clear();
+}
+
+int ImagePyramid::LevelForScale(qreal scale) const
+{
+    if (_levels.isEmpty() || (scale >= 1.0) || (scale <= 0.0))
+    {
+        return 0;
+    }
+
+    int level = qFloor(std::log2(1.0 / scale));
+    return qBound(0, level, _levels.count() - 1);
+}
+
+QPointF ImagePyramid::ToLevel(const QPointF &point, int level)
+{
+    qreal factor = qreal(1 << level);
+    return QPointF((point.x() + 0.5) / factor - 0.5, (point.y() + 0.5) / factor - 0.5);
+}
+
+QImage ImagePyramid::ToGray(const QImage &image)
+{
+    if (image.format() == QImage::Format_Grayscale8)
+    {
+        return image;
+    }
+
+    return image.convertToFormat(QImage::Format_Grayscale8);
+}
+
+QImage ImagePyramid::downsample(const QImage &source)
+{
+    QImage target((source.width() + 1) / 2, (source.height() + 1) / 2, QImage::Format_Grayscale8);
+
+    QVector<int> tasks;
+    for (int y = 0; y < target.height(); y += RowsPerTask)
+    {
+        tasks.append(y);
+    }
+
+    /*
+     * 奇数宽、高时最后一列、一行与自身平均。各任务写入不同的行。
+     */
+    uchar *targetBits = target.bits();
+    const int targetBytesPerLine = target.bytesPerLine();
+    QtConcurrent::blockingMap(tasks, [&source, &target, targetBits, targetBytesPerLine](const int &top)
+    {
+        const int bottom = qMin(top + int(RowsPerTask), target.height());
+        const int lastX = source.width() - 1;
+        const int lastY = source.height() - 1;
+
+        for (int y = top; y < bottom; y++)
+        {
+            const uchar *row0 = source.constScanLine(2 * y);
+            const uchar *row1 = source.constScanLine(qMin(2 * y + 1, lastY));
+            uchar *out = targetBits + qint64(y) * targetBytesPerLine;
+
+            for (int x = 0; x < target.width(); x++)
+            {
+                int x0 = 2 * x;
+                int x1 = qMin(x0 + 1, lastX);
+                out[x] = uchar((row0[x0] + row0[x1] + row1[x0] + row1[x1] + 2) >> 2);
+            }
+        }
+    });
+
+    return target;
+}
@@ -0,0 +1,59 @@
+#ifndef IMAGEPYRAMID_H
+#define IMAGEPYRAMID_H
+
+#include <QImage>
+#include <QVector>
+
+/**
+ * @brief The ImagePyramid class 背景图的灰度金字塔，用于测量、分析。
+ * @details
+ * - 第0层为原图的灰度图（Grayscale8），之后每层宽、高减半，像素为上一层2x2像素的平均值，
+ *   直到宽、高都不大于MinLevelSize。
+ * - 各层按行分块在线程池中并行生成。
+ * - 第L层的像素(x, y)的中心对应原图的((x + 0.5) * 2^L - 0.5, (y + 0.5) * 2^L - 0.5)。
+ */
+class ImagePyramid
+{
+public:
+    constexpr static int MinLevelSize = 64;
+    constexpr static int RowsPerTask = 64;
+
+    ImagePyramid();
+
+    /**
+     * @brief Build 由image重新生成金字塔，image为空时清空。
+     */
+    void Build(const QImage &image);
+    void Clear();
+    bool IsEmpty() const
+    {
+        return _levels.isEmpty();
+    }
+    int GetLevelCount() const
+    {
+        return _levels.count();
+    }
+    const QImage &GetLevel(int level) const
+    {
+        return _levels.at(level);
+    }
+    /**
+     * @brief LevelForScale 视图缩放比例为scale时，每个屏幕像素不少于一个像素的最粗的层。
+     */
+    int LevelForScale(qreal scale) const;
+    /**
+     * @brief ToLevel 原图坐标转换为第level层的坐标。
+     */
+    static QPointF ToLevel(const QPointF &point, int level);
+    /**
+     * @brief ToGray 转换为Grayscale8，已是该格式时不复制。
+     */
+    static QImage ToGray(const QImage &image);
+
+private:
+    QVector<QImage> _levels;
+
+    static QImage downsample(const QImage &source);
+};
+
+#endif // IMAGEPYRAMID_H
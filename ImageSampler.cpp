@@ -0,0 +1,126 @@
+#include "ImageSampler.h"
+
+#include <limits>
+#include <QtMath>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#define IMAGESAMPLER_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+/*
+ * 取(x, y)、(x + 1, y)、(x, y + 1)、(x + 1, y + 1)四个像素，越过右、下边界时取边界像素。
+ */
+inline void fetchQuad(const QImage &gray, int x, int y, float &a, float &b, float &c, float &d)
+{
+    const int x1 = qMin(x + 1, gray.width() - 1);
+    const int y1 = qMin(y + 1, gray.height() - 1);
+    const uchar *row0 = gray.constScanLine(y);
+    const uchar *row1 = gray.constScanLine(y1);
+    a = row0[x];
+    b = row0[x1];
+    c = row1[x];
+    d = row1[x1];
+}
+}
+
+float ImageSampler::Sample(const QImage &gray, qreal x, qreal y)
+{
+    if ((x < -0.5) || (y < -0.5) || (x > gray.width() - 0.5) || (y > gray.height() - 0.5))
+    {
+        return std::numeric_limits<float>::quiet_NaN();
+    }
+
+    /*
+     * 边缘外的半个像素按边缘像素取值。
+     */
+    x = qBound(0.0, x, qreal(gray.width() - 1));
+    y = qBound(0.0, y, qreal(gray.height() - 1));
+    const int ix = int(x);
+    const int iy = int(y);
+    const float fx = float(x - ix);
+    const float fy = float(y - iy);
+
+    float a, b, c, d;
+    fetchQuad(gray, ix, iy, a, b, c, d);
+    const float top = a + (b - a) * fx;
+    const float bottom = c + (d - c) * fx;
+    return top + (bottom - top) * fy;
+}
+
+void ImageSampler::SampleLine(const QImage &gray, const QPointF &p1, const QPointF &p2, int count, float *values)
+{
+    if (count <= 0)
+    {
+        return;
+    }
+    if (count == 1)
+    {
+        values[0] = Sample(gray, p1.x(), p1.y());
+        return;
+    }
+
+    const qreal dx = (p2.x() - p1.x()) / (count - 1);
+    const qreal dy = (p2.y() - p1.y()) / (count - 1);
+    int i = 0;
+
+#ifdef IMAGESAMPLER_SSE2
+    /*
+     * 4个采样点一组：坐标、范围判断、截断取整、插值用SSE2计算，只有取像素逐个进行。
+     */
+    const __m128 index = _mm_set_ps(3.0f, 2.0f, 1.0f, 0.0f);
+    const __m128 stepX = _mm_set1_ps(float(dx));
+    const __m128 stepY = _mm_set1_ps(float(dy));
+    const __m128 minXY = _mm_set1_ps(-0.5f);
+    const __m128 maxX = _mm_set1_ps(float(gray.width()) - 0.5f);
+    const __m128 maxY = _mm_set1_ps(float(gray.height()) - 0.5f);
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 lastX = _mm_set1_ps(float(gray.width() - 1));
+    const __m128 lastY = _mm_set1_ps(float(gray.height() - 1));
+    const __m128 nan = _mm_set1_ps(std::numeric_limits<float>::quiet_NaN());
+
+    alignas(16) int ix[4];
+    alignas(16) int iy[4];
+    alignas(16) float a[4];
+    alignas(16) float b[4];
+    alignas(16) float c[4];
+    alignas(16) float d[4];
+
+    for (; i + 4 <= count; i += 4)
+    {
+        const __m128 n = _mm_add_ps(index, _mm_set1_ps(float(i)));
+        const __m128 x = _mm_add_ps(_mm_set1_ps(float(p1.x())), _mm_mul_ps(n, stepX));
+        const __m128 y = _mm_add_ps(_mm_set1_ps(float(p1.y())), _mm_mul_ps(n, stepY));
+        const __m128 inside = _mm_and_ps(_mm_and_ps(_mm_cmpge_ps(x, minXY), _mm_cmple_ps(x, maxX)),
+                                         _mm_and_ps(_mm_cmpge_ps(y, minXY), _mm_cmple_ps(y, maxY)));
+
+        const __m128 cx = _mm_min_ps(_mm_max_ps(x, zero), lastX);
+        const __m128 cy = _mm_min_ps(_mm_max_ps(y, zero), lastY);
+        const __m128i ixs = _mm_cvttps_epi32(cx);
+        const __m128i iys = _mm_cvttps_epi32(cy);
+        const __m128 fx = _mm_sub_ps(cx, _mm_cvtepi32_ps(ixs));
+        const __m128 fy = _mm_sub_ps(cy, _mm_cvtepi32_ps(iys));
+        _mm_store_si128(reinterpret_cast<__m128i *>(ix), ixs);
+        _mm_store_si128(reinterpret_cast<__m128i *>(iy), iys);
+
+        for (int k = 0; k < 4; k++)
+        {
+            fetchQuad(gray, ix[k], iy[k], a[k], b[k], c[k], d[k]);
+        }
+
+        const __m128 va = _mm_load_ps(a);
+        const __m128 vc = _mm_load_ps(c);
+        const __m128 top = _mm_add_ps(va, _mm_mul_ps(_mm_sub_ps(_mm_load_ps(b), va), fx));
+        const __m128 bottom = _mm_add_ps(vc, _mm_mul_ps(_mm_sub_ps(_mm_load_ps(d), vc), fx));
+        const __m128 value = _mm_add_ps(top, _mm_mul_ps(_mm_sub_ps(bottom, top), fy));
+        _mm_storeu_ps(values + i, _mm_or_ps(_mm_and_ps(inside, value), _mm_andnot_ps(inside, nan)));
+    }
+#endif
+
+    for (; i < count; i++)
+    {
+        values[i] = Sample(gray, p1.x() + dx * i, p1.y() + dy * i);
+    }
+}
@@ -0,0 +1,24 @@
+#ifndef IMAGESAMPLER_H
+#define IMAGESAMPLER_H
+
+#include <QImage>
+#include <QPointF>
+
+/**
+ * @brief The ImageSampler class 灰度图（Grayscale8）的双线性采样。
+ * @details 坐标以像素中心为整数点；图片范围（各边向外半个像素）外的采样为NaN。
+ */
+class ImageSampler
+{
+public:
+    ImageSampler() = delete;
+
+    /**
+     * @brief SampleLine 沿线段[p1, p2]等间距采样count个点（含两端），写入values。
+     * @details 支持SSE2时一次插值4个采样点。
+     */
+    static void SampleLine(const QImage &gray, const QPointF &p1, const QPointF &p2, int count, float *values);
+    static float Sample(const QImage &gray, qreal x, qreal y);
+};
+
+#endif // IMAGESAMPLER_H
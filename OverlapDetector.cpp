@@ -0,0 +1,296 @@
+#include "OverlapDetector.h"
+
+#include <algorithm>
+#include <QtConcurrent>
+
+OverlapDetector::OverlapDetector(const QList<GeometryShape *> &shapes)
+{
+    /*
+     * 展开轮廓只读取图形，调用线程阻塞等待，期间图形不会被修改。
+     */
+    QVector<const GeometryShape *> items;
+    items.reserve(shapes.count());
+    for (auto item : shapes)
+    {
+        items.append(item);
+    }
+
+    _outlines = QtConcurrent::blockingMapped<QVector<Outline>>(items, &OverlapDetector::makeOutline);
+    std::sort(_outlines.begin(), _outlines.end(), [](const Outline &a, const Outline &b)
+    {
+        return a.bounds.left() < b.bounds.left();
+    });
+}
+
+QVector<OverlapPair> OverlapDetector::Detect() const
+{
+    const int count = _outlines.count();
+    QVector<int> chunks;
+    for (int begin = 0; begin < count; begin += SweepChunkSize)
+    {
+        chunks.append(begin);
+    }
+
+    /*
+     * 每一组扫描以组内图形为左端的图形对，结果写入各自的列表，最后合并。
+     */
+    QVector<QVector<OverlapPair>> results(chunks.count());
+    auto sweepChunk = [this, count, &results](const int &begin)
+    {
+        QVector<OverlapPair> &pairs = results[begin / SweepChunkSize];
+        int end = qMin(begin + int(SweepChunkSize), count);
+
+        for (int i = begin; i < end; i++)
+        {
+            const Outline &a = _outlines.at(i);
+            for (int j = i + 1; (j < count) && (_outlines.at(j).bounds.left() <= a.bounds.right()); j++)
+            {
+                const Outline &b = _outlines.at(j);
+                EOverlapKind kind = EOverlapKind::EOK_Intersect;
+                if (!rangesOverlap(a.bounds, b.bounds) || !overlaps(a, b, kind))
+                {
+                    continue;
+                }
+
+                OverlapPair pair;
+                const Outline &first = (a.id < b.id) ? a : b;
+                const Outline &second = (a.id < b.id) ? b : a;
+                pair.firstId = first.id;
+                pair.firstType = first.type;
+                pair.secondId = second.id;
+                pair.secondType = second.type;
+                pair.kind = kind;
+                pairs.append(pair);
+            }
+        }
+    };
+    QtConcurrent::blockingMap(chunks, sweepChunk);
+
+    QVector<OverlapPair> pairs;
+    for (const QVector<OverlapPair> &result : results)
+    {
+        pairs += result;
+    }
+    std::sort(pairs.begin(), pairs.end(), [](const OverlapPair &a, const OverlapPair &b)
+    {
+        return (a.firstId < b.firstId) || ((a.firstId == b.firstId) && (a.secondId < b.secondId));
+    });
+
+    return pairs;
+}
+
+bool OverlapDetector::WriteReport(QIODevice *device, const QVector<OverlapPair> &pairs)
+{
+    QByteArray buffer("id1,type1,id2,type2,kind\n");
+    buffer.reserve(buffer.size() + pairs.count() * 40);
+
+    for (const OverlapPair &pair : pairs)
+    {
+        buffer.append(QByteArray::number(pair.firstId)).append(',');
+        buffer.append(PaintTypeStrings::GetStringEn(pair.firstType).toLatin1()).append(',');
+        buffer.append(QByteArray::number(pair.secondId)).append(',');
+        buffer.append(PaintTypeStrings::GetStringEn(pair.secondType).toLatin1()).append(',');
+        buffer.append((pair.kind == EOverlapKind::EOK_Contain) ? "contain" : "intersect").append('\n');
+    }
+
+    return device->write(buffer) == buffer.size();
+}
+
+OverlapDetector::Outline OverlapDetector::makeOutline(const GeometryShape *shape)
+{
+    Outline outline;
+    outline.id = shape->GetId();
+    outline.type = shape->GetPaintType();
+
+    switch (outline.type)
+    {
+    case EPaintType::EPT_Circle:
+    case EPaintType::EPT_Rect:
+    case EPaintType::EPT_Ellipse:
+    case EPaintType::EPT_Polygon:
+    case EPaintType::EPT_Text:
+        outline.closed = true;
+        break;
+    default:
+        outline.closed = false;
+        break;
+    }
+
+    for (const QPolygonF &ring : shape->GetPath().toSubpathPolygons())
+    {
+        if (!ring.isEmpty())
+        {
+            outline.rings.append(ring);
+            outline.bounds = outline.bounds.isNull() ? ring.boundingRect() : (outline.bounds | ring.boundingRect());
+        }
+    }
+
+    return outline;
+}
+
+bool OverlapDetector::overlaps(const Outline &a, const Outline &b, EOverlapKind &kind)
+{
+    if (a.rings.isEmpty() || b.rings.isEmpty())
+    {
+        return false;
+    }
+
+    if (outlinesCross(a, b))
+    {
+        kind = EOverlapKind::EOK_Intersect;
+        return true;
+    }
+
+    /*
+     * 轮廓不相交时，一个图形要么整个在另一个内部，要么完全在外部，只需判断一个顶点。
+     */
+    if ((a.closed && containsPoint(a, b.rings.first().first())) ||
+            (b.closed && containsPoint(b, a.rings.first().first())))
+    {
+        kind = EOverlapKind::EOK_Contain;
+        return true;
+    }
+
+    return false;
+}
+
+void OverlapDetector::collectSegments(const Outline &outline, const QRectF &area, bool fromFirst, QVector<Segment> &segments)
+{
+    for (const QPolygonF &ring : outline.rings)
+    {
+        int count = ring.count();
+        int segmentCount = (outline.closed && (ring.first() != ring.last())) ? count : count - 1;
+
+        /*
+         * 只有一个顶点（点）时作为长度为0的线段。
+         */
+        if (count == 1)
+        {
+            segmentCount = 1;
+        }
+
+        for (int i = 0; i < segmentCount; i++)
+        {
+            Segment segment;
+            segment.p1 = ring.at(i);
+            segment.p2 = ring.at((i + 1) % count);
+            segment.minX = qMin(segment.p1.x(), segment.p2.x());
+            segment.maxX = qMax(segment.p1.x(), segment.p2.x());
+            segment.minY = qMin(segment.p1.y(), segment.p2.y());
+            segment.maxY = qMax(segment.p1.y(), segment.p2.y());
+            segment.fromFirst = fromFirst;
+
+            if ((segment.minX <= area.right()) && (area.left() <= segment.maxX) &&
+                    (segment.minY <= area.bottom()) && (area.top() <= segment.maxY))
+            {
+                segments.append(segment);
+            }
+        }
+    }
+}
+
+bool OverlapDetector::outlinesCross(const Outline &a, const Outline &b)
+{
+    QRectF area(QPointF(qMax(a.bounds.left(), b.bounds.left()), qMax(a.bounds.top(), b.bounds.top())),
+                QPointF(qMin(a.bounds.right(), b.bounds.right()), qMin(a.bounds.bottom(), b.bounds.bottom())));
+
+    QVector<Segment> segments;
+    collectSegments(a, area, true, segments);
+    int firstCount = segments.count();
+    collectSegments(b, area, false, segments);
+    if ((firstCount == 0) || (firstCount == segments.count()))
+    {
+        return false;
+    }
+
+    std::sort(segments.begin(), segments.end(), [](const Segment &s, const Segment &t)
+    {
+        return s.minX < t.minX;
+    });
+
+    /*
+     * 按左端扫描，每条线段只与另一个轮廓中仍然活动（右端不在其左边）的线段比较，
+     * 已经结束的线段在比较时移出。
+     */
+    QVector<const Segment *> active[2];
+    for (const Segment &segment : segments)
+    {
+        QVector<const Segment *> &others = active[segment.fromFirst ? 1 : 0];
+        for (int i = 0; i < others.count(); )
+        {
+            const Segment *other = others.at(i);
+            if (other->maxX < segment.minX)
+            {
+                others[i] = others.last();
+                others.removeLast();
+                continue;
+            }
+
+            if ((other->minY <= segment.maxY) && (segment.minY <= other->maxY) && segmentsIntersect(*other, segment))
+            {
+                return true;
+            }
+            i++;
+        }
+
+        active[segment.fromFirst ? 0 : 1].append(&segment);
+    }
+
+    return false;
+}
+
+bool OverlapDetector::segmentsIntersect(const Segment &s, const Segment &t)
+{
+    auto orientation = [](const QPointF &p, const QPointF &q, const QPointF &r)
+    {
+        qreal value = (q.x() - p.x()) * (r.y() - p.y()) - (q.y() - p.y()) * (r.x() - p.x());
+        return (value > 0.0) ? 1 : ((value < 0.0) ? -1 : 0);
+    };
+    auto onSegment = [](const Segment &segment, const QPointF &point)
+    {
+        return (point.x() >= segment.minX) && (point.x() <= segment.maxX) &&
+                (point.y() >= segment.minY) && (point.y() <= segment.maxY);
+    };
+
+    int o1 = orientation(s.p1, s.p2, t.p1);
+    int o2 = orientation(s.p1, s.p2, t.p2);
+    int o3 = orientation(t.p1, t.p2, s.p1);
+    int o4 = orientation(t.p1, t.p2, s.p2);
+
+    if ((o1 != o2) && (o3 != o4))
+    {
+        return true;
+    }
+
+    /*
+     * 共线或端点在另一条线段上。
+     */
+    return ((o1 == 0) && onSegment(s, t.p1)) || ((o2 == 0) && onSegment(s, t.p2)) ||
+            ((o3 == 0) && onSegment(t, s.p1)) || ((o4 == 0) && onSegment(t, s.p2));
+}
+
+bool OverlapDetector::containsPoint(const Outline &outline, const QPointF &point)
+{
+    if (!outline.bounds.contains(point))
+    {
+        return false;
+    }
+
+    bool inside = false;
+    for (const QPolygonF &ring : outline.rings)
+    {
+        int count = ring.count();
+        for (int i = 0, j = count - 1; i < count; j = i++)
+        {
+            const QPointF &p = ring.at(i);
+            const QPointF &q = ring.at(j);
+            if (((p.y() > point.y()) != (q.y() > point.y())) &&
+                    (point.x() < (q.x() - p.x()) * (point.y() - p.y()) / (q.y() - p.y()) + p.x()))
+            {
+                inside = !inside;
+            }
+        }
+    }
+
+    return inside;
+}
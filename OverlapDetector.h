@@ -0,0 +1,105 @@
+#ifndef OVERLAPDETECTOR_H
+#define OVERLAPDETECTOR_H
+
+#include <QList>
+#include <QVector>
+#include <QPolygonF>
+#include <QRectF>
+#include <QIODevice>
+
+#include "GeometryShape.h"
+
+/**
+ * @brief The EOverlapKind enum 两个图形的重叠方式。
+ * - EOK_Intersect: 轮廓相交（含接触）。
+ * - EOK_Contain: 轮廓不相交，一个图形在另一个封闭图形内部。
+ */
+enum EOverlapKind
+{
+    EOK_Intersect = 0,
+    EOK_Contain,
+};
+
+/**
+ * @brief The OverlapPair struct 一对重叠的图形，firstId小于secondId。
+ */
+struct OverlapPair
+{
+    quint64 firstId;
+    EPaintType firstType;
+    quint64 secondId;
+    EPaintType secondType;
+    EOverlapKind kind;
+};
+
+/**
+ * @brief The OverlapDetector class 查找一组图形中所有重叠、相交的图形对。
+ * @details
+ * - 构造时在线程池中并行将各图形的轮廓展开为折线，计算外接矩形，之后与原图形无关。
+ * - 粗检测：按外接矩形的左边排序后扫描（sweep and prune），只比较x范围重叠的图形，再比较y范围。
+ * - 精检测：在两个外接矩形的重叠范围内取出两个轮廓的线段，同样按x扫描求是否有线段相交；
+ *   不相交时再判断一个图形是否在另一个封闭图形内部。
+ * - 排序后的图形按SweepChunkSize个一组，在线程池中并行扫描。
+ */
+class OverlapDetector
+{
+public:
+    constexpr static int SweepChunkSize = 256;
+
+    explicit OverlapDetector(const QList<GeometryShape *> &shapes);
+
+    /**
+     * @brief Detect 所有重叠的图形对，按firstId、secondId排序。
+     */
+    QVector<OverlapPair> Detect() const;
+    /**
+     * @brief WriteReport 将重叠的图形对写为CSV：id1,type1,id2,type2,kind。
+     */
+    static bool WriteReport(QIODevice *device, const QVector<OverlapPair> &pairs);
+
+private:
+    struct Outline
+    {
+        quint64 id;
+        EPaintType type;
+        bool closed;
+        QRectF bounds;
+        QVector<QPolygonF> rings;
+    };
+
+    struct Segment
+    {
+        QPointF p1;
+        QPointF p2;
+        qreal minX;
+        qreal maxX;
+        qreal minY;
+        qreal maxY;
+        bool fromFirst;
+    };
+
+    QVector<Outline> _outlines;
+
+    static Outline makeOutline(const GeometryShape *shape);
+    static bool rangesOverlap(const QRectF &a, const QRectF &b)
+    {
+        return (a.left() <= b.right()) && (b.left() <= a.right()) &&
+                (a.top() <= b.bottom()) && (b.top() <= a.bottom());
+    }
+    /**
+     * @brief overlaps 精检测，外接矩形已重叠。
+     */
+    static bool overlaps(const Outline &a, const Outline &b, EOverlapKind &kind);
+    /**
+     * @brief collectSegments 轮廓中与area相交的线段，封闭图形包括首尾相连的一段。
+     */
+    static void collectSegments(const Outline &outline, const QRectF &area, bool fromFirst, QVector<Segment> &segments);
+    static bool outlinesCross(const Outline &a, const Outline &b);
+    static bool segmentsIntersect(const Segment &s, const Segment &t);
+    /**
+     * @brief containsPoint 点是否在封闭图形内（奇偶规则）。
+     */
+    static bool containsPoint(const Outline &outline, const QPointF &point);
+};
+
+#endif // OVERLAPDETECTOR_H
@@ -1,6 +1,8 @@
 #include "PaintArea.h"
 
 #include <algorithm>
+#include <cmath>
+#include <functional>
 #include <QPainter>
 #include <QMouseEvent>
 #include <QDebug>
@@ -15,9 +17,130 @@
 #include <QDrag>
 #include <QGraphicsView>
 #include <QGraphicsScene>
+#include <QScrollBar>
+#include <QPaintEvent>
+#include <QMessageBox>
+#include <QFile>
+#include <QSaveFile>
+#include <QFileInfo>
+#include <QtConcurrent>
+#include <QInputDialog>
+#include <QtMath>
+
+#include "AnnotationIO.h"
+#include "FloodFill.h"
+#include "PolygonSimplifier.h"
+
+namespace
+{
+/*
+ * 包含边界的包含判断，QRectF::contains()对宽高都为0的矩形（点）总是返回false。
+ */
+bool rectContains(const QRectF &outer, const QRectF &inner)
+{
+    return (inner.left() >= outer.left()) && (inner.right() <= outer.right()) &&
+            (inner.top() >= outer.top()) && (inner.bottom() <= outer.bottom());
+}
+
+/*
+ * 线段[p1, p2]与[q1, q2]是否相交（包括端点接触）。
+ */
+bool segmentsIntersect(const QPointF &p1, const QPointF &p2, const QPointF &q1, const QPointF &q2)
+{
+    auto cross = [](const QPointF &o, const QPointF &a, const QPointF &b)
+    {
+        return (a.x() - o.x()) * (b.y() - o.y()) - (a.y() - o.y()) * (b.x() - o.x());
+    };
+    auto onSegment = [](const QPointF &a, const QPointF &b, const QPointF &p)
+    {
+        return (qMin(a.x(), b.x()) <= p.x()) && (p.x() <= qMax(a.x(), b.x())) &&
+                (qMin(a.y(), b.y()) <= p.y()) && (p.y() <= qMax(a.y(), b.y()));
+    };
+
+    const qreal d1 = cross(q1, q2, p1);
+    const qreal d2 = cross(q1, q2, p2);
+    const qreal d3 = cross(p1, p2, q1);
+    const qreal d4 = cross(p1, p2, q2);
+    if ((((d1 > 0.0) && (d2 < 0.0)) || ((d1 < 0.0) && (d2 > 0.0))) &&
+            (((d3 > 0.0) && (d4 < 0.0)) || ((d3 < 0.0) && (d4 > 0.0))))
+    {
+        return true;
+    }
+
+    return (qFuzzyIsNull(d1) && onSegment(q1, q2, p1)) || (qFuzzyIsNull(d2) && onSegment(q1, q2, p2)) ||
+            (qFuzzyIsNull(d3) && onSegment(p1, p2, q1)) || (qFuzzyIsNull(d4) && onSegment(p1, p2, q2));
+}
+
+/*
+ * 路径（曲线展开为折线）是否完全在闭合多边形lasso内：顶点都在lasso内，且没有边与lasso的边相交。
+ * 只判断顶点对凹的套索不够，两个顶点都在内部的边仍可能穿出套索。
+ */
+bool pathInside(const QPolygonF &lasso, const QPainterPath &path)
+{
+    const QList<QPolygonF> polygons = path.toSubpathPolygons();
+    for (const QPolygonF &polygon : polygons)
+    {
+        for (const QPointF &point : polygon)
+        {
+            if (!lasso.containsPoint(point, Qt::FillRule::OddEvenFill))
+            {
+                return false;
+            }
+        }
+    }
+
+    const int count = lasso.count();
+    for (const QPolygonF &polygon : polygons)
+    {
+        for (int i = 1; i < polygon.count(); i++)
+        {
+            const QRectF edgeBounds = QRectF(polygon.at(i - 1), polygon.at(i)).normalized();
+            for (int j = 0; j < count; j++)
+            {
+                const QPointF &q1 = lasso.at(j);
+                const QPointF &q2 = lasso.at((j + 1) % count);
+                if ((qMax(q1.x(), q2.x()) < edgeBounds.left()) || (qMin(q1.x(), q2.x()) > edgeBounds.right()) ||
+                        (qMax(q1.y(), q2.y()) < edgeBounds.top()) || (qMin(q1.y(), q2.y()) > edgeBounds.bottom()))
+                {
+                    continue;
+                }
+                if (segmentsIntersect(polygon.at(i - 1), polygon.at(i), q1, q2))
+                {
+                    return false;
+                }
+            }
+        }
+    }
+
+    return true;
+}
+
+/*
+ * Neumaier补偿求和：sum + compensation近似为精确的和，反复加减同一个值不会累积舍入误差。
+ */
+void compensatedAdd(qreal &sum, qreal &compensation, qreal value)
+{
+    const qreal total = sum + value;
+    if (qAbs(sum) >= qAbs(value))
+    {
+        compensation += (sum - total) + value;
+    }
+    else
+    {
+        compensation += (value - total) + sum;
+    }
+    sum = total;
+}
+}
 
 PaintArea::PaintArea(QGraphicsScene *scene, QWidget *parent) : QGraphicsView(scene, parent)
   , _paintType(EPaintType::EPT_None)
+  , _toolType(EToolType::ETT_Paint)
+  , _fillColor(Qt::red)
+  , _textStyle(ETextStyle::ETS_Normal)
+  , _importSimplifyTolerance(0.0)
+  , _compactStorage(false)
+  , _overlapHighlight(false)
   , _lastPaintShape(nullptr)
   , _lastSelectedShape(nullptr)
   , _mouseButtonPressEnabled(true)
@@ -25,6 +148,20 @@ PaintArea::PaintArea(QGraphicsScene *scene, QWidget *parent) : QGraphicsView(sce
   , _mouseMoveEnabled(true)
   , _moveEnabled(false)
   , _dragResizeEnabled(false)
+  , _panOriginInitialized(false)
+  , _zoomTargetScale(1.0)
+  , _zoomPreviewEnabled(false)
+  , _renderQuality(ERenderQuality::ERQ_High)
+  , _refineBandTop(0)
+  , _lastShapeId(0)
+  , _autosave(nullptr)
+  , _measureStatistics()
+  , _measureSum()
+  , _measureCompensation()
+  , _snapMarkerVisible(false)
+  , _regionSelectMode(ERegionSelectMode::ERSM_None)
+  , _currentLayer(0)
+  , _lastLayerId(0)
 {
     for (int i = EPaintType::EPT_Point; i < EPaintType::EPT_End; i++)
     {
@@ -32,6 +169,7 @@ PaintArea::PaintArea(QGraphicsScene *scene, QWidget *parent) : QGraphicsView(sce
     }
 
     _selectedList.clear();
+    _layers.append(new PaintLayer(++_lastLayerId, QString("图层 %1").arg(_lastLayerId)));
 
     // 开启追踪鼠标，可触发mouseMoveEvent事件
     setMouseTracking(true);
@@ -47,10 +185,66 @@ PaintArea::PaintArea(QGraphicsScene *scene, QWidget *parent) : QGraphicsView(sce
     this->setVerticalScrollBarPolicy(Qt::ScrollBarPolicy::ScrollBarAlwaysOff);
     this->setTransformationAnchor(QGraphicsView::AnchorUnderMouse);
     this->setResizeAnchor(QGraphicsView::AnchorUnderMouse);
+
+    /*
+     * 平移时由QGraphicsView滚动视口（位块搬移），只重绘新露出的条带。
+     * 场景足够大，滚动条才有可滚动的范围；背景缓存后，露出区域的重绘只需拷贝背景。
+     */
+    this->setSceneRect(-SceneExtent, -SceneExtent, SceneExtent * 2, SceneExtent * 2);
+    this->setAlignment(Qt::AlignLeft | Qt::AlignTop);
+    this->setCacheMode(QGraphicsView::CacheBackground);
+    this->setViewportUpdateMode(QGraphicsView::MinimalViewportUpdate);
+
+    _zoomAnimation = new QVariantAnimation(this);
+    _zoomAnimation->setDuration(ZoomAnimationDuration);
+    _zoomAnimation->setEasingCurve(QEasingCurve::OutCubic);
+    connect(_zoomAnimation, &QVariantAnimation::valueChanged, this, [this](const QVariant &value)
+    {
+        this->applyZoomScale(value.toReal());
+    });
+    connect(_zoomAnimation, &QVariantAnimation::finished, this, [this]()
+    {
+        /*
+         * 动画结束，丢弃占位图，完整重绘一次。
+         */
+        _zoomPreviewEnabled = false;
+        _zoomPreviewFrame = QPixmap();
+        this->viewport()->update();
+
+        /*
+         * 依赖缩放比例的测量显示（如灰度剖面的金字塔层）在缩放结束后刷新。
+         */
+        this->scheduleMeasureUpdate();
+    });
+
+    _refineIdleTimer = new QTimer(this);
+    _refineIdleTimer->setSingleShot(true);
+    _refineIdleTimer->setInterval(RefineIdleDelay);
+    connect(_refineIdleTimer, &QTimer::timeout, this, &PaintArea::refineIdleHandler);
+
+    _refineBandTimer = new QTimer(this);
+    _refineBandTimer->setInterval(0);
+    connect(_refineBandTimer, &QTimer::timeout, this, &PaintArea::refineBandHandler);
+
+    /*
+     * 一次事件中可能有大量图形的测量值变化（导入、撤销），合并为一次通知。
+     */
+    _measureTimer = new QTimer(this);
+    _measureTimer->setSingleShot(true);
+    _measureTimer->setInterval(0);
+    connect(_measureTimer, &QTimer::timeout, this, &PaintArea::measureChanged);
 }
 
 PaintArea::~PaintArea()
 {
+    /*
+     * 正常退出，不需要恢复。
+     */
+    if (_autosave != nullptr)
+    {
+        _autosave->Stop(true);
+    }
+
     for (auto list : _coreMap.values())
     {
         for (auto item : *list)
@@ -63,6 +257,8 @@ PaintArea::~PaintArea()
 
         delete list;
     }
+
+    qDeleteAll(_layers);
 }
 
 bool PaintArea::eventFilter(QObject *object, QEvent *event)
@@ -85,7 +281,8 @@ bool PaintArea::eventFilter(QObject *object, QEvent *event)
     {
         QKeyEvent *keyEvent = reinterpret_cast<QKeyEvent *>(event);
         if (((keyEvent->key() == Qt::Key_A) && ((keyEvent->modifiers() & Qt::ControlModifier) == Qt::ControlModifier)) ||
-                (keyEvent->key() == Qt::Key_Delete))
+                (keyEvent->key() == Qt::Key_Delete) ||
+                keyEvent->matches(QKeySequence::Undo) || keyEvent->matches(QKeySequence::Redo))
         {
             ret = false;
         }
@@ -116,11 +313,105 @@ void PaintArea::SetPaintType(EPaintType type)
     qDebug() << "type" << type;
 }
 
+void PaintArea::SetToolType(EToolType type)
+{
+    if ((type < EToolType::ETT_Paint) || (type >= EToolType::ETT_End))
+    {
+        qCritical() << "Error: SetToolType(), Invalid tool type! " << type;
+        return;
+    }
+
+    _toolType = type;
+}
+
+void PaintArea::SetFillColor(const QColor &color)
+{
+    _fillColor = color;
+}
+
+void PaintArea::SetTextStyle(int style)
+{
+    _textStyle = style;
+
+    /*
+     * 选中的已完成文本的样式变化记为一条历史记录，并提交自动保存。
+     */
+    QList<Text *> texts;
+    QVector<int> oldStyles;
+    for (auto item : _selectedList)
+    {
+        if ((item->GetPaintType() == EPaintType::EPT_Text) && item->GetCompleted())
+        {
+            Text *text = static_cast<Text *>(item);
+            if (text->GetTextStyle() != style)
+            {
+                texts.append(text);
+                oldStyles.append(text->GetTextStyle());
+            }
+        }
+    }
+    if (texts.isEmpty())
+    {
+        return;
+    }
+
+    TextStyleCommand *command = new TextStyleCommand(texts, oldStyles, style);
+    command->Redo(this);
+    this->pushCommand(command);
+    this->viewport()->update();
+}
+
+void PaintArea::SetImportSimplifyTolerance(qreal tolerance)
+{
+    _importSimplifyTolerance = tolerance;
+}
+
+void PaintArea::SetCompactStorage(bool enabled)
+{
+    _compactStorage = enabled;
+
+    for (EPaintType paintType : {EPaintType::EPT_Polygon, EPaintType::EPT_Polyline})
+    {
+        for (auto item : *_coreMap[paintType])
+        {
+            if (item->GetCompleted())
+            {
+                static_cast<Polygon *>(item)->SetCompact(enabled);
+            }
+        }
+    }
+}
+
 void PaintArea::paintEvent(QPaintEvent *event)
 {
+    if (_zoomPreviewEnabled)
+    {
+        paintZoomPreview(event);
+        return;
+    }
+
     QGraphicsView::paintEvent(event);
-//    QPainter painter(this);
-//    paintAllShapes(painter);
+    QPainter painter(this->viewport());
+    paintAllShapes(painter, event->region());
+    paintOverlapHighlight(painter);
+    this->paintOverlay(painter);
+    paintSnapMarker(painter);
+    paintRegionSelect(painter);
+}
+
+void PaintArea::showEvent(QShowEvent *event)
+{
+    QGraphicsView::showEvent(event);
+
+    /*
+     * 首次显示时，将场景原点放在视口左上角。
+     */
+    if (!_panOriginInitialized)
+    {
+        _panOriginInitialized = true;
+        this->horizontalScrollBar()->setValue(0);
+        this->verticalScrollBar()->setValue(0);
+    }
 }
 
 void PaintArea::mousePressEvent(QMouseEvent *event)
@@ -128,6 +419,10 @@ void PaintArea::mousePressEvent(QMouseEvent *event)
     EPaintType paintType = _paintType;
     GeometryShape *shape = nullptr;
     QPoint eventPos = this->AdjustedPos(event->pos());
+    QPoint scenePos = this->mapToScene(event->pos()).toPoint();
+
+    this->cancelRefine();
+    this->scheduleMeasureUpdate();
 
     if ((event->button() == Qt::MouseButton::LeftButton) &&
             ((QApplication::keyboardModifiers() == Qt::AltModifier)))
@@ -135,11 +430,27 @@ void PaintArea::mousePressEvent(QMouseEvent *event)
         if ((_lastPaintShape == nullptr) || (_lastPaintShape->GetCompleted()))
         {
             this->setCursor(Qt::CursorShape::SizeAllCursor);
-            _moveStartCursorPos = eventPos;
+            _panLastCursorPos = event->pos();
             return;
         }
     }
 
+    if ((_toolType != EToolType::ETT_Paint) && ((_lastPaintShape == nullptr) || _lastPaintShape->GetCompleted()))
+    {
+        if (event->button() == Qt::MouseButton::LeftButton)
+        {
+            if (_toolType == EToolType::ETT_FloodFill)
+            {
+                this->floodFill(scenePos);
+            }
+            else if (_toolType == EToolType::ETT_MagicWand)
+            {
+                this->magicWand(scenePos);
+            }
+        }
+        return;
+    }
+
     if (!_coreMap.contains(paintType))
     {
         qCritical() << "Error: mousePressEvent(), invalid paint type!";
@@ -153,14 +464,28 @@ void PaintArea::mousePressEvent(QMouseEvent *event)
 
         if ((_lastPaintShape == nullptr) || (_lastPaintShape->GetCompleted()))
         {
+            /*
+             * Shift + 拖拽框选，Ctrl + Shift + 拖拽套索选择。
+             */
+            if (QApplication::keyboardModifiers() == Qt::ShiftModifier)
+            {
+                this->regionSelectBegin(ERegionSelectMode::ERSM_Rect, scenePos);
+                break;
+            }
+            if (QApplication::keyboardModifiers() == (Qt::ControlModifier | Qt::ShiftModifier))
+            {
+                this->regionSelectBegin(ERegionSelectMode::ERSM_Lasso, scenePos);
+                break;
+            }
+
             if (QApplication::keyboardModifiers() == Qt::ControlModifier)
             {
                 qDebug() << "Key: Ctrl + LeftButton, press";
-                this->multiSelectHandler(eventPos);
+                this->multiSelectHandler(scenePos);
                 break;
             }
 
-            this->singleSelectPressHandler(eventPos);
+            this->singleSelectPressHandler(scenePos);
             if (_selectedList.count() > 0)
             {
                 break;
@@ -169,8 +494,15 @@ void PaintArea::mousePressEvent(QMouseEvent *event)
 
         if (_coreMap[paintType]->isEmpty() || _coreMap[paintType]->last()->GetCompleted())
         {
+            PaintLayer *layer = _layers.at(_currentLayer);
+            if (!layer->GetVisible() || layer->GetLocked())
+            {
+                qWarning() << "Warn: mousePressEvent(), current layer is hidden or locked!" << layer->GetName();
+                break;
+            }
+
             shape = GeometryShapeFactory::CreateGeometryShape(paintType);
-            _coreMap[paintType]->append(shape);
+            this->InsertShape(shape);
         }
 
         _lastPaintShape = _coreMap[paintType]->last();
@@ -178,6 +510,14 @@ void PaintArea::mousePressEvent(QMouseEvent *event)
 
         if (_lastPaintShape->GetCompleted())
         {
+            if ((paintType == EPaintType::EPT_Text) && !this->inputText(_lastPaintShape))
+            {
+                this->viewport()->update();
+                break;
+            }
+
+            this->ShapeChanged(_lastPaintShape);
+            this->pushCommand(new CreateShapesCommand(QList<GeometryShape *>() << _lastPaintShape));
             this->viewport()->update();
         }
 
@@ -186,7 +526,12 @@ void PaintArea::mousePressEvent(QMouseEvent *event)
         switch (paintType) {
         case EPaintType::EPT_Polygon:
         case EPaintType::EPT_Polyline:
-            _lastPaintShape->UpdateState(GeometryShape::EPaintStateType::EPST_PaintEnd, QPoint());
+            if ((_lastPaintShape != nullptr) && !_lastPaintShape->GetCompleted())
+            {
+                _lastPaintShape->UpdateState(GeometryShape::EPaintStateType::EPST_PaintEnd, QPoint());
+                this->ShapeChanged(_lastPaintShape);
+                this->pushCommand(new CreateShapesCommand(QList<GeometryShape *>() << _lastPaintShape));
+            }
             _lastPaintShape = nullptr;
             this->viewport()->update();
             break;
@@ -203,6 +548,9 @@ void PaintArea::mouseReleaseEvent(QMouseEvent *event)
 {
     EPaintType paintType = _paintType;
     QPoint eventPos = this->AdjustedPos(event->pos());
+    QPoint scenePos = this->mapToScene(event->pos()).toPoint();
+
+    this->scheduleMeasureUpdate();
 
     if ((event->button() == Qt::MouseButton::LeftButton) &&
             ((QApplication::keyboardModifiers() == Qt::AltModifier)))
@@ -214,12 +562,24 @@ void PaintArea::mouseReleaseEvent(QMouseEvent *event)
         }
     }
 
+    if ((_toolType != EToolType::ETT_Paint) && ((_lastPaintShape == nullptr) || _lastPaintShape->GetCompleted()))
+    {
+        return;
+    }
+
     if (!_coreMap.contains(paintType))
     {
         //qCritical() << "Error: mouseReleaseEvent(), Invalid paint type!";
         return;
     }
 
+    if ((event->button() == Qt::MouseButton::LeftButton) && (_regionSelectMode != ERegionSelectMode::ERSM_None))
+    {
+        this->regionSelectUpdate(scenePos);
+        this->regionSelectEnd();
+        return;
+    }
+
     switch (event->button()) {
     case Qt::MouseButton::LeftButton:
         qDebug() << this->objectName() << ": Left button release.";
@@ -235,8 +595,17 @@ void PaintArea::mouseReleaseEvent(QMouseEvent *event)
          */
         if (_dragResizeEnabled)
         {
+            GeometryShape *shape = _selectedList.last();
             _dragResizeEnabled = false;
-            _selectedList.last()->SetDragResizeEnabled(false);
+            shape->SetDragResizeEnabled(false);
+
+            QVector<QPoint> geometry = shape->GetGeometry();
+            if (geometry != _dragResizeStartGeometry)
+            {
+                this->ShapeChanged(shape);
+                this->pushCommand(new ReshapeCommand(shape, _dragResizeStartGeometry, geometry));
+            }
+
             this->viewport()->update();
             break;
         }
@@ -251,6 +620,19 @@ void PaintArea::mouseReleaseEvent(QMouseEvent *event)
                 item->MoveEnd(eventPos);
             }
 
+            /*
+             * 所有选中图形的移动，记为一条历史记录。
+             */
+            QPoint offset = eventPos - _moveStartCursorPos;
+            if (!offset.isNull())
+            {
+                for (auto item : _selectedList)
+                {
+                    this->ShapeChanged(item);
+                }
+                this->pushCommand(new MoveShapesCommand(_selectedList, offset));
+            }
+
             _moveEnabled = false;
             this->viewport()->update();
             break;
@@ -258,7 +640,7 @@ void PaintArea::mouseReleaseEvent(QMouseEvent *event)
 
         if ((_lastPaintShape == nullptr) || (_lastPaintShape->GetCompleted()))
         {
-            if (singleSelectReleaseHandler(eventPos))
+            if (singleSelectReleaseHandler(scenePos))
             {
                 break;
             }
@@ -270,17 +652,34 @@ void PaintArea::mouseReleaseEvent(QMouseEvent *event)
         case EPaintType::EPT_Circle:
         case EPaintType::EPT_Rect:
         case EPaintType::EPT_Ellipse:
-            _lastPaintShape->UpdateState(GeometryShape::EPaintStateType::EPST_PaintEnd, eventPos);
-            if (_lastPaintShape->GetCompleted() && !_lastPaintShape->IsValid())
+        case EPaintType::EPT_Freehand:
+        {
+            GeometryShape *shape = _lastPaintShape;
+            if (shape == nullptr)
+            {
+                break;
+            }
+
+            shape->UpdateState(GeometryShape::EPaintStateType::EPST_PaintEnd, eventPos);
+            if (shape->GetCompleted())
             {
-                qWarning() << "Warn: Invalid shape! " << paintType;
-                _coreMap[paintType]->removeOne(_lastPaintShape);
-                delete _lastPaintShape;
+                if (!shape->IsValid())
+                {
+                    qWarning() << "Warn: Invalid shape! " << paintType;
+                    this->RemoveShape(shape);
+                    delete shape;
+                }
+                else
+                {
+                    this->ShapeChanged(shape);
+                    this->pushCommand(new CreateShapesCommand(QList<GeometryShape *>() << shape));
+                }
             }
 
             _lastPaintShape = nullptr;
             this->viewport()->update();
             break;
+        }
         default:
             break;
         }
@@ -297,6 +696,16 @@ void PaintArea::mouseMoveEvent(QMouseEvent *e)
 {
     EPaintType paintType = _paintType;
     QPoint eventPos = this->AdjustedPos(e->pos());
+    QPoint scenePos = this->mapToScene(e->pos()).toPoint();
+
+    this->cancelRefine();
+    this->updateSnapMarker(scenePos);
+
+    if (_regionSelectMode != ERegionSelectMode::ERSM_None)
+    {
+        this->regionSelectUpdate(scenePos);
+        return;
+    }
 
     if ((_lastPaintShape == nullptr) || _lastPaintShape->GetCompleted())
     {
@@ -304,7 +713,9 @@ void PaintArea::mouseMoveEvent(QMouseEvent *e)
                 (QApplication::keyboardModifiers() == Qt::AltModifier))
         {
             this->setCursor(Qt::CursorShape::SizeAllCursor);
-            this->move(this->pos() + (eventPos - _moveStartCursorPos));
+            this->interactionUpdate();
+            this->panBy(e->pos() - _panLastCursorPos);
+            _panLastCursorPos = e->pos();
             return;
         }
     }
@@ -315,7 +726,7 @@ void PaintArea::mouseMoveEvent(QMouseEvent *e)
         return;
     }
 
-    cursorShapeHandler(eventPos);
+    cursorShapeHandler(scenePos);
 
     /*
      * Ctrl + 鼠标移动，忽略...
@@ -330,6 +741,7 @@ void PaintArea::mouseMoveEvent(QMouseEvent *e)
      */
     if (_dragResizeEnabled)
     {
+        this->interactionUpdate();
         _selectedList.last()->DragResize(eventPos);
         this->viewport()->update();
         return;
@@ -340,6 +752,7 @@ void PaintArea::mouseMoveEvent(QMouseEvent *e)
      */
     if (_moveEnabled)
     {
+        this->interactionUpdate();
         for (auto item : _selectedList)
         {
             item->Move(eventPos);
@@ -360,10 +773,29 @@ void PaintArea::mouseMoveEvent(QMouseEvent *e)
     case EPaintType::EPT_Polyline:
         if ((_lastPaintShape != nullptr) && !_lastPaintShape->GetCompleted())
         {
+            this->interactionUpdate();
             _lastPaintShape->UpdateState(GeometryShape::EPaintStateType::EPST_GuidePaintting, eventPos);
             this->viewport()->update();
         }
         break;
+    case EPaintType::EPT_Freehand:
+        /*
+         * 手绘只重绘笔迹末尾变化的一小块，不切换到预览绘制，图层缓存保持有效。
+         */
+        if ((_lastPaintShape != nullptr) && !_lastPaintShape->GetCompleted())
+        {
+            Freehand *freehand = static_cast<Freehand *>(_lastPaintShape);
+            freehand->UpdateState(GeometryShape::EPaintStateType::EPST_GuidePaintting, eventPos);
+
+            QRect dirtyRect = freehand->TakeDirtyRect();
+            if (!dirtyRect.isNull())
+            {
+                int margin = qCeil(GeometryShape::DefaultGuidePointPenWidth) + 1;
+                this->viewport()->update(this->mapFromScene(QRectF(dirtyRect)).boundingRect()
+                                         .adjusted(-margin, -margin, margin, margin));
+            }
+        }
+        break;
     default:
         break;
     }
@@ -371,6 +803,9 @@ void PaintArea::mouseMoveEvent(QMouseEvent *e)
 
 void PaintArea::keyPressEvent(QKeyEvent *event)
 {
+    this->cancelRefine();
+    this->scheduleMeasureUpdate();
+
     if ((event->modifiers() == Qt::ControlModifier) && (event->key() == Qt::Key_A))
     {
         //qDebug() << "Key: Ctrl + A";
@@ -381,11 +816,20 @@ void PaintArea::keyPressEvent(QKeyEvent *event)
         //qDebug() << "Key: Del";
         deleteSelectedShapes();
     }
+    if (event->matches(QKeySequence::Undo))
+    {
+        this->Undo();
+    }
+    else if (event->matches(QKeySequence::Redo))
+    {
+        this->Redo();
+    }
 }
 
 void PaintArea::wheelEvent(QWheelEvent *event)
 {
     QWidget::wheelEvent(event);
+    this->cancelRefine();
 
     /*
      * Ctrl + 鼠标滚轮，进行绘图区域的缩放。
@@ -403,103 +847,307 @@ void PaintArea::wheelEvent(QWheelEvent *event)
         }
 
         event->accept();
+
+        if (step != 0)
+        {
+            this->zoomAt(std::pow(ZoomStepFactor, step / 120.0), event->pos());
+        }
     }
 }
 
-void PaintArea::paintAllShapes(QPainter& painter)
+void PaintArea::paintAllShapes(QPainter& painter, const QRegion &exposedRegion)
 {
-    painter.save();
-    //painter.rotate(60);
-    painter.scale(this->transform().m11(), this->transform().m22());
+    QVector<QRectF> exposedRects;
 
-    for (auto list : _coreMap.values())
+    /*
+     * 将重绘区域转换到场景坐标，并按选中点画笔的宽度向外扩展，避免裁掉图形的边缘。
+     */
+    qreal margin = GeometryShape::DefaultGuidePointPenWidth / this->transform().m11();
+    for (const QRect &rect : exposedRegion)
     {
-        if (!list->isEmpty())
+        exposedRects.append(this->mapToScene(rect).boundingRect().adjusted(-margin, -margin, margin, margin));
+    }
+
+    /*
+     * 按图层从下到上合成。每个图层先绘制缓存，再在其上绘制该图层中绘制中、选中的图形；
+     * 交互过程中缓存失效时直接绘制图层中的图形，空闲后再重建缓存。
+     */
+    for (auto layer : _layers)
+    {
+        if (!layer->GetVisible())
         {
-            for (auto item : *list)
+            continue;
+        }
+
+        bool cached = this->updateLayerCache(layer);
+
+        painter.save();
+        painter.setOpacity(layer->GetOpacity());
+
+        if (cached)
+        {
+            const QPixmap &cache = layer->GetCache();
+            qreal ratio = cache.devicePixelRatio();
+            if (exposedRegion.isEmpty())
             {
-                if (item != nullptr)
-                {
-                    item->Paint(painter);
-                }
+                painter.drawPixmap(0, 0, cache);
+            }
+            for (const QRect &rect : exposedRegion)
+            {
+                painter.drawPixmap(rect, cache, QRect(rect.topLeft() * ratio, rect.size() * ratio));
             }
         }
-    }
 
-    painter.restore();
-}
+        /*
+         * 设置裁剪区域，图形（如手绘笔迹）可按clipBoundingRect()只绘制重绘区域内的部分。
+         */
+        if (!exposedRegion.isEmpty())
+        {
+            painter.setClipRegion(exposedRegion);
+        }
 
-void PaintArea::paintCursorLine()
-{
-    // 绘制鼠标，效果太差，拖动有阴影。
-//    QPainter painter(this);
-//    painter.setPen(_guideLinePen);
-//    painter.drawLine(_curCursorPoint.x() - 20, _curCursorPoint.y(), _curCursorPoint.x() + 20, _curCursorPoint.y());
-    //    painter.drawLine(_curCursorPoint.x(), _curCursorPoint.y() - 20, _curCursorPoint.x(), _curCursorPoint.y() + 20);
+        //painter.rotate(60);
+        painter.setTransform(this->viewportTransform());
+        painter.setRenderHint(QPainter::Antialiasing, _renderQuality == ERenderQuality::ERQ_High);
+
+        for (auto item : layer->GetShapes())
+        {
+            if ((!cached || isActiveShape(item)) && isShapeExposed(item, exposedRects))
+            {
+                item->Paint(painter, _renderQuality == ERenderQuality::ERQ_Preview);
+            }
+        }
+
+        painter.restore();
+    }
 }
 
-int PaintArea::edgeCheck(bool stateCache, bool state)
+bool PaintArea::updateLayerCache(PaintLayer *layer)
 {
-    if (!stateCache && state)
+    QSize size = this->viewport()->size();
+    QTransform transform = this->viewportTransform();
+
+    if (layer->IsCacheValid(transform, size))
     {
-        return 1;
+        return true;
     }
-    else if (stateCache && !state)
+    if (_renderQuality != ERenderQuality::ERQ_High)
     {
-        return -1;
+        return false;
     }
 
-    return 0;
-}
+    qreal ratio = this->viewport()->devicePixelRatioF();
+    QPixmap cache(size * ratio);
+    cache.setDevicePixelRatio(ratio);
+    cache.fill(Qt::transparent);
 
-void PaintArea::multiSelectHandler(const QPoint &point)
-{
-    for (auto list : _coreMap.values())
+    qreal margin = GeometryShape::DefaultGuidePointPenWidth / this->transform().m11();
+    QVector<QRectF> viewRects;
+    viewRects.append(this->mapToScene(this->viewport()->rect()).boundingRect().adjusted(-margin, -margin, margin, margin));
+
+    QPainter painter(&cache);
+    painter.setTransform(transform);
+    painter.setRenderHint(QPainter::Antialiasing, true);
+    for (auto item : layer->GetShapes())
     {
-        if (!list->isEmpty())
+        if (!isActiveShape(item) && isShapeExposed(item, viewRects))
         {
-            auto it = std::find_if(list->begin(), list->end(), [=](GeometryShape *rect){
-                return rect->Contains(point);
-            });
+            item->Paint(painter, false);
+        }
+    }
+    painter.end();
 
-            if (it != list->end())
-            {
-                if (_selectedList.contains(*it))
-                {
-                    (*it)->SetSelected(false);
-                    _selectedList.removeOne(*it);
-                }
-                else
-                {
-                    (*it)->SetSelected(true);
-                    _selectedList.append(*it);
-                }
+    layer->SetCache(cache, transform);
+    return true;
+}
 
-                break;
-            }
+bool PaintArea::isShapeExposed(GeometryShape *shape, const QVector<QRectF> &exposedRects) const
+{
+    /*
+     * 绘制中、选中的图形还会绘制辅助线，不做裁剪。
+     */
+    if (exposedRects.isEmpty() || !shape->GetCompleted() || shape->GetSelected())
+    {
+        return true;
+    }
+
+    QRectF boundingRect = QRectF(shape->BoundingRect()).adjusted(-1, -1, 1, 1);
+    for (const QRectF &rect : exposedRects)
+    {
+        if (rect.intersects(boundingRect))
+        {
+            return true;
         }
     }
+
+    return false;
 }
 
-void PaintArea::singleSelectPressHandler(const QPoint &point)
+void PaintArea::zoomAt(qreal factor, const QPoint &viewPos)
 {
-    GeometryShape *shape = nullptr;
+    qreal minScale = MinZoomScale;
+    qreal maxScale = MaxZoomScale;
+    qreal curScale = this->transform().m11();
+    bool running = (_zoomAnimation->state() == QAbstractAnimation::Running);
 
-    for (auto list : _coreMap.values())
+    /*
+     * 动画过程中连续滚动，在上一次的目标比例上继续累积。
+     */
+    qreal targetScale = qBound(minScale, (running ? _zoomTargetScale : curScale) * factor, maxScale);
+    if (!running && qFuzzyCompare(targetScale, curScale))
     {
-        if ((list != nullptr) && !list->isEmpty())
-        {
-            auto it = std::find_if(list->begin(), list->end(), [=](GeometryShape *rect){
-                return rect->Contains(point);
-            });
+        return;
+    }
 
-            if (it != list->end())
-            {
-                shape = *it;
-                break;
-            }
+    this->interactionUpdate();
+    _zoomTargetScale = targetScale;
+    _zoomAnchorViewPos = viewPos;
+    _zoomAnchorScenePos = this->mapToScene(viewPos);
+
+    if (!_zoomPreviewEnabled)
+    {
+        _zoomPreviewFrame = this->viewport()->grab();
+        _zoomPreviewTransform = this->viewportTransform();
+        _zoomPreviewEnabled = true;
+    }
+
+    _zoomAnimation->stop();
+    _zoomAnimation->setStartValue(curScale);
+    _zoomAnimation->setEndValue(targetScale);
+    _zoomAnimation->start();
+}
+
+void PaintArea::applyZoomScale(qreal scale)
+{
+    ViewportAnchor anchor = this->transformationAnchor();
+    this->setTransformationAnchor(QGraphicsView::NoAnchor);
+    this->setTransform(QTransform::fromScale(scale, scale));
+    this->setTransformationAnchor(anchor);
+
+    /*
+     * 滚动视图，使锚点下的场景坐标保持不变。
+     */
+    QPointF delta = this->viewportTransform().map(_zoomAnchorScenePos) - QPointF(_zoomAnchorViewPos);
+    this->horizontalScrollBar()->setValue(this->horizontalScrollBar()->value() + qRound(delta.x()));
+    this->verticalScrollBar()->setValue(this->verticalScrollBar()->value() + qRound(delta.y()));
+}
+
+void PaintArea::paintZoomPreview(QPaintEvent *event)
+{
+    QPainter painter(this->viewport());
+    painter.setClipRegion(event->region());
+
+    painter.save();
+    painter.setTransform(this->viewportTransform());
+    this->drawBackground(&painter, this->mapToScene(this->viewport()->rect()).boundingRect());
+    painter.restore();
+
+    /*
+     * 占位图按“截图时的视口 -> 场景 -> 当前视口”的变换绘制。
+     */
+    painter.setTransform(_zoomPreviewTransform.inverted() * this->viewportTransform());
+    painter.drawPixmap(0, 0, _zoomPreviewFrame);
+}
+
+void PaintArea::interactionUpdate()
+{
+    _refineBandTimer->stop();
+    _refineBandTop = 0;
+    _renderQuality = ERenderQuality::ERQ_Preview;
+    _refineIdleTimer->start();
+}
+
+void PaintArea::cancelRefine()
+{
+    if (_refineBandTimer->isActive())
+    {
+        _refineBandTimer->stop();
+        _refineIdleTimer->start();
+    }
+}
+
+void PaintArea::refineIdleHandler()
+{
+    if (_renderQuality != ERenderQuality::ERQ_High)
+    {
+        _renderQuality = ERenderQuality::ERQ_High;
+        _refineBandTop = 0;
+    }
+
+    _refineBandTimer->start();
+}
+
+void PaintArea::refineBandHandler()
+{
+    /*
+     * 每次只同步重绘一个条带，然后回到事件循环，新的输入可以随时打断。
+     */
+    if (_refineBandTop >= this->viewport()->height())
+    {
+        _refineBandTimer->stop();
+        return;
+    }
+
+    this->viewport()->repaint(0, _refineBandTop, this->viewport()->width(), RefineBandHeight);
+    _refineBandTop += RefineBandHeight;
+}
+
+void PaintArea::panBy(const QPoint &delta)
+{
+    if (delta.isNull())
+    {
+        return;
+    }
+
+    this->horizontalScrollBar()->setValue(this->horizontalScrollBar()->value() - delta.x());
+    this->verticalScrollBar()->setValue(this->verticalScrollBar()->value() - delta.y());
+}
+
+void PaintArea::paintCursorLine()
+{
+    // 绘制鼠标，效果太差，拖动有阴影。
+//    QPainter painter(this);
+//    painter.setPen(_guideLinePen);
+//    painter.drawLine(_curCursorPoint.x() - 20, _curCursorPoint.y(), _curCursorPoint.x() + 20, _curCursorPoint.y());
+    //    painter.drawLine(_curCursorPoint.x(), _curCursorPoint.y() - 20, _curCursorPoint.x(), _curCursorPoint.y() + 20);
+}
+
+int PaintArea::edgeCheck(bool stateCache, bool state)
+{
+    if (!stateCache && state)
+    {
+        return 1;
+    }
+    else if (stateCache && !state)
+    {
+        return -1;
+    }
+
+    return 0;
+}
+
+void PaintArea::multiSelectHandler(const QPoint &point)
+{
+    GeometryShape *shape = this->shapeAt(point);
+
+    if (shape != nullptr)
+    {
+        if (_selectedList.contains(shape))
+        {
+            this->setShapeSelected(shape, false);
+            _selectedList.removeOne(shape);
+        }
+        else
+        {
+            this->setShapeSelected(shape, true);
+            _selectedList.append(shape);
         }
     }
+}
+
+void PaintArea::singleSelectPressHandler(const QPoint &point)
+{
+    GeometryShape *shape = this->shapeAt(point);
 
     if (shape != nullptr)
     {
@@ -514,19 +1162,21 @@ void PaintArea::singleSelectPressHandler(const QPoint &point)
                 item->MoveBegin(point);
             }
             _moveEnabled = true;
+            _selectedList.removeOne(shape);
         }
         else
         {
             for (auto item : _selectedList)
             {
-                item->SetSelected(false);
+                this->setShapeSelected(item, false);
             }
 
             _selectedList.clear();
         }
 
         _moveEnabled = true;
-        shape->SetSelected(true);
+        _moveStartCursorPos = point;
+        this->setShapeSelected(shape, true);
         shape->MoveBegin(point);
         _selectedList.append(shape);
     }
@@ -536,12 +1186,13 @@ void PaintArea::singleSelectPressHandler(const QPoint &point)
         {
             if(_selectedList.last()->GetResizeCursorShape(point) != Qt::CursorShape::CrossCursor)
             {
+                _dragResizeStartGeometry = _selectedList.last()->GetGeometry();
                 _dragResizeEnabled = true;
                 _selectedList.last()->SetDragResizeEnabled(true);
             }
             else
             {
-                _selectedList.last()->SetSelected(false);
+                this->setShapeSelected(_selectedList.last(), false);
                 _selectedList.clear();
             }
         }
@@ -549,7 +1200,7 @@ void PaintArea::singleSelectPressHandler(const QPoint &point)
         {
             for (auto item : _selectedList)
             {
-                item->SetSelected(false);
+                this->setShapeSelected(item, false);
             }
             _selectedList.clear();
         }
@@ -559,23 +1210,7 @@ void PaintArea::singleSelectPressHandler(const QPoint &point)
 bool PaintArea::singleSelectReleaseHandler(const QPoint &point)
 {
     bool ret = false;
-    GeometryShape *shape = nullptr;
-
-    for (auto list : _coreMap.values())
-    {
-        if ((list != nullptr) && !list->isEmpty())
-        {
-            auto it = std::find_if(list->begin(), list->end(), [=](GeometryShape *rect){
-                return rect->Contains(point);
-            });
-
-            if (it != list->end())
-            {
-                shape = *it;
-                break;
-            }
-        }
-    }
+    GeometryShape *shape = this->shapeAt(point);
 
     if (shape != nullptr)
     {
@@ -587,11 +1222,11 @@ bool PaintArea::singleSelectReleaseHandler(const QPoint &point)
         {
             for (auto item : _selectedList)
             {
-                item->SetSelected(false);
+                this->setShapeSelected(item, false);
             }
 
             _selectedList.clear();
-            shape->SetSelected(true);
+            this->setShapeSelected(shape, true);
             _selectedList.append(shape);
         }
 
@@ -619,6 +1254,11 @@ void PaintArea::cursorShapeHandler(const QPoint &point)
             {
                 for (auto item : *list)
                 {
+                    if (!this->isShapeEditable(item))
+                    {
+                        continue;
+                    }
+
                     if (item->Contains(point))
                     {
                         cursorShape = Qt::SizeAllCursor;
@@ -646,46 +1286,1456 @@ void PaintArea::cursorShapeHandler(const QPoint &point)
 }
 
 void PaintArea::selectAllShapes()
+{
+    clearSelection();
+
+    for (auto list : _coreMap.values())
+    {
+        if (!list->isEmpty())
+        {
+            for (auto item : *list)
+            {
+                if (this->isShapeEditable(item))
+                {
+                    _selectedList.append(item);
+                    this->setShapeSelected(item, true);
+                }
+            }
+        }
+    }
+}
+
+void PaintArea::clearSelection()
 {
     for (auto item : _selectedList)
     {
-        item->SetSelected(false);
+        this->setShapeSelected(item, false);
     }
     _selectedList.clear();
+}
 
-    for (auto list : _coreMap.values())
+void PaintArea::regionSelectBegin(ERegionSelectMode mode, const QPoint &scenePos)
+{
+    this->clearSelection();
+    _regionSelectMode = mode;
+    _regionSelectStart = scenePos;
+    _regionSelectEnd = scenePos;
+    _regionSelectLasso.clear();
+    _regionSelectLasso.append(scenePos);
+    this->viewport()->update();
+}
+
+void PaintArea::regionSelectUpdate(const QPoint &scenePos)
+{
+    if (_regionSelectMode == ERegionSelectMode::ERSM_Lasso)
     {
-        if (!list->isEmpty())
+        if (scenePos == _regionSelectLasso.last())
         {
-            for (auto item : *list)
+            return;
+        }
+        _regionSelectLasso.append(scenePos);
+    }
+
+    _regionSelectEnd = scenePos;
+    this->interactionUpdate();
+    this->viewport()->update();
+}
+
+void PaintArea::regionSelectEnd()
+{
+    ERegionSelectMode mode = _regionSelectMode;
+    _regionSelectMode = ERegionSelectMode::ERSM_None;
+
+    /*
+     * 先按外接矩形从网格中取出候选图形，再判断图形的轮廓是否完全在区域内。
+     */
+    std::function<bool(GeometryShape *)> inRegion;
+    QRect bounds;
+    if (mode == ERegionSelectMode::ERSM_Rect)
+    {
+        bounds = QRect(_regionSelectStart, _regionSelectEnd).normalized();
+        QRectF band(bounds);
+        inRegion = [band](GeometryShape *shape)
+        {
+            return rectContains(band, shape->GetPath().boundingRect());
+        };
+    }
+    else
+    {
+        bounds = _regionSelectLasso.boundingRect();
+        QPolygonF lasso(_regionSelectLasso);
+        QRectF lassoBounds(bounds);
+        inRegion = [lasso, lassoBounds](GeometryShape *shape)
+        {
+            QPainterPath path = shape->GetPath();
+            if (!rectContains(lassoBounds, path.boundingRect()))
+            {
+                return false;
+            }
+            return pathInside(lasso, path);
+        };
+    }
+    _regionSelectLasso.clear();
+
+    QVector<GeometryShape *> candidates = _shapeGrid.Query(bounds);
+    candidates.erase(std::remove_if(candidates.begin(), candidates.end(), [this](GeometryShape *shape)
+    {
+        return !this->isShapeEditable(shape);
+    }), candidates.end());
+    QVector<GeometryShape *> shapes;
+    if (candidates.count() >= ParallelSelectMinShapes)
+    {
+        shapes = QtConcurrent::blockingFiltered(candidates, inRegion);
+    }
+    else
+    {
+        for (auto item : candidates)
+        {
+            if (inRegion(item))
             {
-                _selectedList.append(item);
-                item->SetSelected(true);
+                shapes.append(item);
             }
         }
     }
+
+    for (auto item : shapes)
+    {
+        this->setShapeSelected(item, true);
+        _selectedList.append(item);
+    }
+
+    this->viewport()->update();
 }
 
-void PaintArea::deleteSelectedShapes()
+void PaintArea::paintRegionSelect(QPainter &painter)
 {
-    if (!_selectedList.isEmpty())
+    if (_regionSelectMode == ERegionSelectMode::ERSM_None)
     {
-        for (auto item : _selectedList)
+        return;
+    }
+
+    QPen pen(QColor("#7cfc00"));
+    pen.setStyle(Qt::PenStyle::DashLine);
+    painter.save();
+    painter.setTransform(this->viewportTransform());
+    pen.setWidthF(GeometryShape::DefaultGuideLinePenWidth / this->transform().m11());
+    painter.setPen(pen);
+    painter.setBrush(Qt::NoBrush);
+
+    if (_regionSelectMode == ERegionSelectMode::ERSM_Rect)
+    {
+        painter.drawRect(QRect(_regionSelectStart, _regionSelectEnd).normalized());
+    }
+    else
+    {
+        painter.drawPolygon(_regionSelectLasso);
+    }
+
+    painter.restore();
+}
+
+void PaintArea::paintOverlapHighlight(QPainter &painter)
+{
+    if (!_overlapHighlight || _overlapShapes.isEmpty())
+    {
+        return;
+    }
+
+    QPen pen(QColor(255, 140, 0, 160));
+    pen.setCapStyle(Qt::PenCapStyle::RoundCap);
+    pen.setJoinStyle(Qt::PenJoinStyle::RoundJoin);
+    painter.save();
+    painter.setTransform(this->viewportTransform());
+    painter.setRenderHint(QPainter::Antialiasing, _renderQuality == ERenderQuality::ERQ_High);
+    pen.setWidthF(OverlapHighlightWidth / this->transform().m11());
+    painter.setPen(pen);
+    painter.setBrush(Qt::NoBrush);
+
+    QRectF viewRect = this->mapToScene(this->viewport()->rect()).boundingRect();
+    for (auto item : _overlapShapes)
+    {
+        PaintLayer *layer = this->findLayer(item->GetLayerId());
+        if ((layer != nullptr) && layer->GetVisible() &&
+                viewRect.intersects(QRectF(item->BoundingRect()).adjusted(-1, -1, 1, 1)))
         {
-            item->SetSelected(false);
-            _coreMap[item->GetPaintType()]->removeOne(item);
-            delete item;
+            painter.drawPath(item->GetPath());
         }
+    }
 
-        _selectedList.clear();
-        this->viewport()->update();
+    painter.restore();
+}
+
+const PaintLayer *PaintArea::GetLayer(int index) const
+{
+    if ((index < 0) || (index >= _layers.count()))
+    {
+        return nullptr;
     }
+
+    return _layers.at(index);
 }
 
-QPoint PaintArea::AdjustedPos(const QPoint &point) const
+void PaintArea::SetCurrentLayer(int index)
+{
+    if ((index < 0) || (index >= _layers.count()) || (index == _currentLayer))
+    {
+        return;
+    }
+
+    _currentLayer = index;
+    emit layersChanged();
+}
+
+int PaintArea::AddLayer(const QString &name)
+{
+    quint64 id = ++_lastLayerId;
+    _currentLayer++;
+    _layers.insert(_currentLayer, new PaintLayer(id, name.isEmpty() ? QString("图层 %1").arg(id) : name));
+
+    emit layersChanged();
+    return _currentLayer;
+}
+
+void PaintArea::SetLayerVisible(int index, bool visible)
+{
+    if ((index < 0) || (index >= _layers.count()) || (_layers.at(index)->GetVisible() == visible))
+    {
+        return;
+    }
+
+    _layers.at(index)->SetVisible(visible);
+    this->deselectLayer(_layers.at(index));
+    this->viewport()->update();
+    emit layersChanged();
+}
+
+void PaintArea::SetLayerLocked(int index, bool locked)
+{
+    if ((index < 0) || (index >= _layers.count()) || (_layers.at(index)->GetLocked() == locked))
+    {
+        return;
+    }
+
+    _layers.at(index)->SetLocked(locked);
+    this->deselectLayer(_layers.at(index));
+    this->viewport()->update();
+    emit layersChanged();
+}
+
+void PaintArea::SetLayerOpacity(int index, qreal opacity)
 {
-    QPointF newPos(point);
-    newPos.setX(newPos.x() / this->matrix().m11());
-    newPos.setY(newPos.y() / this->matrix().m22());
-    return newPos.toPoint();
+    if ((index < 0) || (index >= _layers.count()))
+    {
+        return;
+    }
+
+    /*
+     * 只改变合成时的不透明度，不需要重建缓存。
+     */
+    _layers.at(index)->SetOpacity(opacity);
+    this->viewport()->update();
+    emit layersChanged();
+}
+
+void PaintArea::MoveLayer(int index, int offset)
+{
+    int target = index + offset;
+    if ((index < 0) || (index >= _layers.count()) || (target < 0) || (target >= _layers.count()) || (offset == 0))
+    {
+        return;
+    }
+
+    PaintLayer *current = _layers.at(_currentLayer);
+    _layers.move(index, target);
+    _currentLayer = _layers.indexOf(current);
+
+    this->viewport()->update();
+    emit layersChanged();
+}
+
+void PaintArea::BringSelectedToFront()
+{
+    /*
+     * 按原来的顺序依次移到最上面，选中图形之间的相对顺序不变。
+     */
+    QList<GeometryShape *> shapes = this->selectedShapesInOrder();
+    QVector<ShapePlacement> oldPlacements = this->shapePlacements(shapes);
+    bool changed = false;
+    for (auto item : shapes)
+    {
+        PaintLayer *layer = this->findLayer(item->GetLayerId());
+        if ((layer != nullptr) && layer->BringToFront(item))
+        {
+            changed = true;
+        }
+    }
+
+    if (changed)
+    {
+        this->arrangeCommit(shapes, oldPlacements);
+    }
+}
+
+void PaintArea::SendSelectedToBack()
+{
+    QList<GeometryShape *> shapes = this->selectedShapesInOrder();
+    QVector<ShapePlacement> oldPlacements = this->shapePlacements(shapes);
+    bool changed = false;
+    for (int i = shapes.count() - 1; i >= 0; i--)
+    {
+        PaintLayer *layer = this->findLayer(shapes.at(i)->GetLayerId());
+        if ((layer != nullptr) && layer->SendToBack(shapes.at(i)))
+        {
+            changed = true;
+        }
+    }
+
+    if (changed)
+    {
+        this->arrangeCommit(shapes, oldPlacements);
+    }
+}
+
+bool PaintArea::MoveSelectedToLayer(int index)
+{
+    if ((index < 0) || (index >= _layers.count()))
+    {
+        return false;
+    }
+
+    PaintLayer *target = _layers.at(index);
+    if (target->GetLocked())
+    {
+        qWarning() << "Warn: PaintArea::MoveSelectedToLayer(), layer is locked!" << target->GetName();
+        return false;
+    }
+
+    QList<GeometryShape *> shapes;
+    for (auto item : this->selectedShapesInOrder())
+    {
+        if (item->GetLayerId() != target->GetId())
+        {
+            shapes.append(item);
+        }
+    }
+    if (shapes.isEmpty())
+    {
+        return false;
+    }
+
+    QVector<ShapePlacement> oldPlacements = this->shapePlacements(shapes);
+    for (auto item : shapes)
+    {
+        PaintLayer *layer = this->findLayer(item->GetLayerId());
+        if (layer != nullptr)
+        {
+            layer->RemoveShape(item);
+        }
+        item->SetLayerId(target->GetId());
+        target->AppendShape(item);
+    }
+
+    if (!target->GetVisible())
+    {
+        this->deselectLayer(target);
+    }
+    this->arrangeCommit(shapes, oldPlacements);
+    return true;
+}
+
+void PaintArea::ArrangeShapes(const QList<GeometryShape *> &shapes, const QVector<ShapePlacement> &placements)
+{
+    for (auto item : shapes)
+    {
+        PaintLayer *layer = this->findLayer(item->GetLayerId());
+        if (layer != nullptr)
+        {
+            layer->RemoveShape(item);
+        }
+    }
+
+    QVector<int> order(shapes.count());
+    for (int i = 0; i < order.count(); i++)
+    {
+        order[i] = i;
+    }
+    std::stable_sort(order.begin(), order.end(), [&placements](int i1, int i2)
+    {
+        return placements.at(i1).index < placements.at(i2).index;
+    });
+
+    for (int i : order)
+    {
+        GeometryShape *shape = shapes.at(i);
+        PaintLayer *layer = this->findLayer(placements.at(i).layerId);
+        if (layer == nullptr)
+        {
+            layer = _layers.at(_currentLayer);
+        }
+
+        shape->SetLayerId(layer->GetId());
+        if (layer->InsertShape(shape, placements.at(i).index))
+        {
+            for (auto item : layer->GetShapes())
+            {
+                _autosaveDirtySet.insert(item);
+            }
+        }
+        _autosaveDirtySet.insert(shape);
+    }
+}
+
+QList<GeometryShape *> PaintArea::selectedShapesInOrder() const
+{
+    QList<GeometryShape *> shapes;
+    for (auto layer : _layers)
+    {
+        for (auto item : layer->GetShapes())
+        {
+            if (item->GetSelected())
+            {
+                shapes.append(item);
+            }
+        }
+    }
+
+    return shapes;
+}
+
+QVector<ShapePlacement> PaintArea::shapePlacements(const QList<GeometryShape *> &shapes) const
+{
+    /*
+     * 每个图层只遍历一次，不逐个图形查找序号。
+     */
+    QHash<GeometryShape *, int> positions;
+    positions.reserve(shapes.count());
+    for (int i = 0; i < shapes.count(); i++)
+    {
+        positions.insert(shapes.at(i), i);
+    }
+
+    QVector<ShapePlacement> placements(shapes.count(), {0, -1});
+    for (auto layer : _layers)
+    {
+        const QList<GeometryShape *> &layerShapes = layer->GetShapes();
+        for (int i = 0; i < layerShapes.count(); i++)
+        {
+            auto it = positions.constFind(layerShapes.at(i));
+            if (it != positions.constEnd())
+            {
+                placements[it.value()] = {layer->GetId(), i};
+            }
+        }
+    }
+
+    return placements;
+}
+
+void PaintArea::arrangeCommit(const QList<GeometryShape *> &shapes, const QVector<ShapePlacement> &oldPlacements)
+{
+    for (auto item : shapes)
+    {
+        _autosaveDirtySet.insert(item);
+    }
+
+    this->pushCommand(new ArrangeShapesCommand(shapes, oldPlacements, this->shapePlacements(shapes)));
+    this->viewport()->update();
+}
+
+PaintLayer *PaintArea::findLayer(quint64 id) const
+{
+    for (auto layer : _layers)
+    {
+        if (layer->GetId() == id)
+        {
+            return layer;
+        }
+    }
+
+    return nullptr;
+}
+
+void PaintArea::invalidateShapeLayer(GeometryShape *shape)
+{
+    PaintLayer *layer = this->findLayer(shape->GetLayerId());
+    if (layer != nullptr)
+    {
+        layer->InvalidateCache();
+    }
+}
+
+void PaintArea::compactShape(GeometryShape *shape)
+{
+    if (!_compactStorage || !shape->GetCompleted())
+    {
+        return;
+    }
+
+    EPaintType paintType = shape->GetPaintType();
+    if ((paintType == EPaintType::EPT_Polygon) || (paintType == EPaintType::EPT_Polyline))
+    {
+        static_cast<Polygon *>(shape)->SetCompact(true);
+    }
+}
+
+bool PaintArea::isShapeEditable(GeometryShape *shape) const
+{
+    PaintLayer *layer = this->findLayer(shape->GetLayerId());
+    return (layer != nullptr) && layer->GetVisible() && !layer->GetLocked();
+}
+
+GeometryShape *PaintArea::shapeAt(const QPoint &point) const
+{
+    /*
+     * 从最上层开始查找，点击重叠的图形时选中看到的那个。
+     */
+    for (int i = _layers.count() - 1; i >= 0; i--)
+    {
+        PaintLayer *layer = _layers.at(i);
+        if (!layer->GetVisible() || layer->GetLocked())
+        {
+            continue;
+        }
+
+        const QList<GeometryShape *> &shapes = layer->GetShapes();
+        for (int j = shapes.count() - 1; j >= 0; j--)
+        {
+            if (shapes.at(j)->Contains(point))
+            {
+                return shapes.at(j);
+            }
+        }
+    }
+
+    return nullptr;
+}
+
+void PaintArea::setShapeSelected(GeometryShape *shape, bool selected)
+{
+    /*
+     * 选中的图形不在图层缓存中，选中状态变化时缓存失效。
+     */
+    if (shape->GetSelected() != selected)
+    {
+        shape->SetSelected(selected);
+        this->invalidateShapeLayer(shape);
+    }
+}
+
+void PaintArea::deselectLayer(PaintLayer *layer)
+{
+    for (auto item : layer->GetShapes())
+    {
+        if (item->GetSelected())
+        {
+            this->setShapeSelected(item, false);
+            _selectedList.removeOne(item);
+        }
+    }
+}
+
+void PaintArea::deleteSelectedShapes()
+{
+    if (!_selectedList.isEmpty())
+    {
+        /*
+         * 图形交给历史记录持有，撤销时恢复。
+         */
+        QList<GeometryShape *> shapes = _selectedList;
+        for (auto item : shapes)
+        {
+            this->RemoveShape(item);
+        }
+
+        this->pushCommand(new DeleteShapesCommand(shapes));
+        this->viewport()->update();
+    }
+}
+
+void PaintArea::InsertShape(GeometryShape *shape)
+{
+    if ((shape == nullptr) || !_coreMap.contains(shape->GetPaintType()))
+    {
+        qCritical() << "Error: InsertShape(), invalid shape!";
+        return;
+    }
+
+    if (shape->GetId() == 0)
+    {
+        shape->SetId(++_lastShapeId);
+    }
+
+    /*
+     * 新图形加入当前图层；撤销删除等恢复的图形回到原来的图层（图层内位于最上面）。
+     */
+    PaintLayer *layer = this->findLayer(shape->GetLayerId());
+    if (layer == nullptr)
+    {
+        layer = _layers.at(_currentLayer);
+        shape->SetLayerId(layer->GetId());
+    }
+    layer->AppendShape(shape);
+
+    _coreMap[shape->GetPaintType()]->append(shape);
+    _autosaveDirtySet.insert(shape);
+
+    this->compactShape(shape);
+    _snapIndex.InsertShape(shape);
+    _shapeGrid.InsertShape(shape);
+    shape->SetMeasureObserver(this);
+    this->accumulateMeasure(shape->GetMeasure(), 1);
+    _measureStatistics.count++;
+    this->scheduleMeasureUpdate();
+}
+
+void PaintArea::RemoveShape(GeometryShape *shape)
+{
+    if (shape == nullptr)
+    {
+        return;
+    }
+
+    if (_selectedList.removeOne(shape))
+    {
+        this->setShapeSelected(shape, false);
+    }
+    if (_lastPaintShape == shape)
+    {
+        _lastPaintShape = nullptr;
+    }
+    if (_lastSelectedShape == shape)
+    {
+        _lastSelectedShape = nullptr;
+    }
+    if (_coreMap.contains(shape->GetPaintType()) && _coreMap[shape->GetPaintType()]->removeOne(shape))
+    {
+        PaintLayer *layer = this->findLayer(shape->GetLayerId());
+        if (layer != nullptr)
+        {
+            layer->RemoveShape(shape);
+        }
+        _snapIndex.RemoveShape(shape);
+        _shapeGrid.RemoveShape(shape);
+        shape->SetMeasureObserver(nullptr);
+        this->accumulateMeasure(shape->GetMeasure(), -1);
+        _measureStatistics.count--;
+        if (_measureStatistics.count == 0)
+        {
+            /*
+             * 图形全部删除后清零合计，丢弃累积的舍入误差。
+             */
+            _measureStatistics = MeasureStatistics();
+            _measureSum = ShapeMeasure();
+            _measureCompensation = ShapeMeasure();
+        }
+        this->scheduleMeasureUpdate();
+    }
+
+    _autosaveDirtySet.remove(shape);
+    _autosaveRemovedIds.append(shape->GetId());
+    _overlapShapes.remove(shape);
+}
+
+void PaintArea::ShapeChanged(GeometryShape *shape)
+{
+    _autosaveDirtySet.insert(shape);
+    this->compactShape(shape);
+    _snapIndex.UpdateShape(shape);
+    _shapeGrid.UpdateShape(shape);
+    this->invalidateShapeLayer(shape);
+}
+
+void PaintArea::MeasureChanged(GeometryShape *shape, const ShapeMeasure &oldMeasure, const ShapeMeasure &newMeasure)
+{
+    Q_UNUSED(shape)
+    this->accumulateMeasure(oldMeasure, -1);
+    this->accumulateMeasure(newMeasure, 1);
+    this->scheduleMeasureUpdate();
+}
+
+GeometryShape *PaintArea::GetMeasuredShape() const
+{
+    if ((_lastPaintShape != nullptr) && !_lastPaintShape->GetCompleted())
+    {
+        return _lastPaintShape;
+    }
+    if (_selectedList.count() == 1)
+    {
+        return _selectedList.first();
+    }
+
+    return nullptr;
+}
+
+void PaintArea::accumulateMeasure(const ShapeMeasure &measure, int sign)
+{
+    compensatedAdd(_measureSum.length, _measureCompensation.length, sign * measure.length);
+    compensatedAdd(_measureSum.perimeter, _measureCompensation.perimeter, sign * measure.perimeter);
+    compensatedAdd(_measureSum.area, _measureCompensation.area, sign * measure.area);
+
+    _measureStatistics.totalLength = _measureSum.length + _measureCompensation.length;
+    _measureStatistics.totalPerimeter = _measureSum.perimeter + _measureCompensation.perimeter;
+    _measureStatistics.totalArea = _measureSum.area + _measureCompensation.area;
+}
+
+void PaintArea::scheduleMeasureUpdate()
+{
+    if (!_measureTimer->isActive())
+    {
+        _measureTimer->start();
+    }
+}
+
+void PaintArea::Undo()
+{
+    /*
+     * 绘制、移动、改变大小的过程中不能撤销。
+     */
+    if (_moveEnabled || _dragResizeEnabled ||
+            ((_lastPaintShape != nullptr) && !_lastPaintShape->GetCompleted()))
+    {
+        return;
+    }
+
+    clearSelection();
+    if (_history.Undo(this))
+    {
+        this->clearOverlaps();
+        this->autosaveCommit();
+        this->viewport()->update();
+    }
+}
+
+void PaintArea::Redo()
+{
+    if (_moveEnabled || _dragResizeEnabled ||
+            ((_lastPaintShape != nullptr) && !_lastPaintShape->GetCompleted()))
+    {
+        return;
+    }
+
+    clearSelection();
+    if (_history.Redo(this))
+    {
+        this->clearOverlaps();
+        this->autosaveCommit();
+        this->viewport()->update();
+    }
+}
+
+void PaintArea::SetHistoryMemoryLimit(qint64 bytes)
+{
+    _history.SetMemoryLimit(bytes);
+}
+
+void PaintArea::EnableAutosave(const QString &dirPath, const QString &name)
+{
+    if (_autosave != nullptr)
+    {
+        return;
+    }
+
+    _autosave = new PaintAutosave(dirPath, name, this);
+
+    if (_autosave->HasRecoveryData())
+    {
+        if (QMessageBox::question(this, "自动保存", "上次未正常退出，是否恢复自动保存的图形？") == QMessageBox::Yes)
+        {
+            /*
+             * 按次序键依次加入原来的图层，不存在的图层按id重新建立。
+             */
+            QList<PaintAutosave::Record> records = _autosave->Recover();
+            std::stable_sort(records.begin(), records.end(), [](const PaintAutosave::Record &r1,
+                             const PaintAutosave::Record &r2)
+            {
+                return r1.zOrder < r2.zOrder;
+            });
+
+            QList<quint64> layerIds;
+            for (const PaintAutosave::Record &record : records)
+            {
+                if ((record.layerId != 0) && (this->findLayer(record.layerId) == nullptr) &&
+                        !layerIds.contains(record.layerId))
+                {
+                    layerIds.append(record.layerId);
+                }
+            }
+            std::sort(layerIds.begin(), layerIds.end());
+            for (quint64 layerId : layerIds)
+            {
+                _layers.append(new PaintLayer(layerId, QString("图层 %1").arg(layerId)));
+                _lastLayerId = qMax(_lastLayerId, layerId);
+            }
+
+            for (const PaintAutosave::Record &record : records)
+            {
+                GeometryShape *shape = GeometryShapeFactory::CreateGeometryShape(record.type);
+                if (shape == nullptr)
+                {
+                    continue;
+                }
+
+                shape->SetGeometry(record.points);
+                if (!shape->HasValidGeometry())
+                {
+                    qWarning() << "Warn: PaintArea::EnableAutosave(), invalid record!" << record.id
+                               << PaintTypeStrings::GetStringEn(record.type) << record.points.count();
+                    delete shape;
+                    continue;
+                }
+                if (record.type == EPaintType::EPT_Text)
+                {
+                    Text *text = static_cast<Text *>(shape);
+                    text->SetTextStyle(record.textStyle);
+                    text->SetText(record.text);
+                }
+                shape->SetId(record.id);
+                shape->SetLayerId(record.layerId);
+                _lastShapeId = qMax(_lastShapeId, record.id);
+                this->InsertShape(shape);
+            }
+
+            emit layersChanged();
+
+            this->viewport()->update();
+        }
+        else
+        {
+            _autosave->Discard();
+        }
+    }
+
+    /*
+     * 以当前的图形作为起始快照，日志从空开始。
+     */
+    _autosaveDirtySet.clear();
+    _autosaveRemovedIds.clear();
+    _autosave->start();
+    _autosave->WriteSnapshot(completedShapes());
+}
+
+bool PaintArea::ImportAnnotations(const QString &path)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly))
+    {
+        qWarning() << "Warn: PaintArea::ImportAnnotations(), failed to open!" << path << file.errorString();
+        return false;
+    }
+
+    QList<GeometryShape *> shapes;
+    qint64 invalidCount = 0;
+    AnnotationReader reader(&file, AnnotationFormatFromPath(path));
+    bool ok = reader.Read([this, &shapes, &invalidCount](const QVector<AnnotationRecord> &batch)
+    {
+        /*
+         * 每一批记录中的多边形、折线在线程池中并行简化。
+         */
+        QVector<AnnotationRecord> records = batch;
+        qreal tolerance = _importSimplifyTolerance;
+        if (tolerance > 0.0)
+        {
+            QtConcurrent::blockingMap(records, [tolerance](AnnotationRecord &record)
+            {
+                switch (record.type)
+                {
+                case EPaintType::EPT_Polygon:
+                case EPaintType::EPT_Polyline:
+                case EPaintType::EPT_Freehand:
+                {
+                    bool closed = (record.type == EPaintType::EPT_Polygon);
+                    QPolygon simplified = PolygonSimplifier::Simplify(QPolygon(record.points), tolerance, closed);
+                    if (simplified.count() >= (closed ? 3 : 2))
+                    {
+                        record.points = simplified;
+                    }
+                    break;
+                }
+                default:
+                    break;
+                }
+            });
+        }
+
+        for (const AnnotationRecord &record : records)
+        {
+            GeometryShape *shape = GeometryShapeFactory::CreateGeometryShape(record.type);
+            if (shape == nullptr)
+            {
+                invalidCount++;
+                continue;
+            }
+
+            /*
+             * 点数不足或者退化（多边形少于3个顶点、宽高为0的矩形等）的记录跳过。
+             */
+            shape->SetGeometry(record.points);
+            if (!shape->HasValidGeometry())
+            {
+                qWarning() << "Warn: PaintArea::ImportAnnotations(), invalid record!" << record.id
+                           << PaintTypeStrings::GetStringEn(record.type) << record.points.count();
+                invalidCount++;
+                delete shape;
+                continue;
+            }
+            if (record.type == EPaintType::EPT_Text)
+            {
+                Text *text = static_cast<Text *>(shape);
+                text->SetTextStyle(record.textStyle);
+                text->SetText(record.text);
+            }
+
+            this->InsertShape(shape);
+            shapes.append(shape);
+        }
+    });
+
+    if (!ok)
+    {
+        qWarning() << "Warn: PaintArea::ImportAnnotations()," << reader.GetError() << path;
+    }
+    if ((reader.GetSkippedCount() + invalidCount) > 0)
+    {
+        qWarning() << "Warn: PaintArea::ImportAnnotations(), skipped invalid records:"
+                   << (reader.GetSkippedCount() + invalidCount);
+    }
+
+    if (!shapes.isEmpty())
+    {
+        this->pushCommand(new CreateShapesCommand(shapes));
+        this->viewport()->update();
+    }
+
+    return ok;
+}
+
+bool PaintArea::ExportAnnotations(const QString &path)
+{
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly))
+    {
+        qWarning() << "Warn: PaintArea::ExportAnnotations(), failed to open!" << path << file.errorString();
+        return false;
+    }
+
+    QList<GeometryShape *> shapes = completedShapes();
+    std::sort(shapes.begin(), shapes.end(), [](GeometryShape *a, GeometryShape *b)
+    {
+        return a->GetId() < b->GetId();
+    });
+
+    AnnotationWriter writer(&file, AnnotationFormatFromPath(path));
+    for (auto item : shapes)
+    {
+        AnnotationRecord record;
+        record.id = item->GetId();
+        record.type = item->GetPaintType();
+        record.points = item->GetGeometry();
+        record.textStyle = ETextStyle::ETS_Normal;
+        if (item->GetPaintType() == EPaintType::EPT_Text)
+        {
+            const Text *text = static_cast<const Text *>(item);
+            record.text = text->GetText();
+            record.textStyle = text->GetTextStyle();
+        }
+        writer.Write(record);
+    }
+
+    if (!writer.Finish() || !file.commit())
+    {
+        qWarning() << "Warn: PaintArea::ExportAnnotations(), failed to write!" << path << file.errorString();
+        return false;
+    }
+
+    return true;
+}
+
+bool PaintArea::SimplifySelectedShapes(qreal tolerance)
+{
+    struct SimplifyTask
+    {
+        GeometryShape *shape;
+        bool closed;
+        QVector<QPoint> oldGeometry;
+        QVector<QPoint> newGeometry;
+    };
+
+    QVector<SimplifyTask> tasks;
+    for (auto item : _selectedList)
+    {
+        EPaintType paintType = item->GetPaintType();
+        if ((paintType == EPaintType::EPT_Polygon) || (paintType == EPaintType::EPT_Polyline) ||
+                (paintType == EPaintType::EPT_Freehand))
+        {
+            SimplifyTask task;
+            task.shape = item;
+            task.closed = (paintType == EPaintType::EPT_Polygon);
+            task.oldGeometry = item->GetGeometry();
+            tasks.append(task);
+        }
+    }
+
+    if (tasks.isEmpty())
+    {
+        qWarning() << "Warn: PaintArea::SimplifySelectedShapes(), no polygon or polyline selected!";
+        return false;
+    }
+
+    QtConcurrent::blockingMap(tasks, [tolerance](SimplifyTask &task)
+    {
+        task.newGeometry = PolygonSimplifier::Simplify(QPolygon(task.oldGeometry), tolerance, task.closed);
+    });
+
+    /*
+     * 顶点数不变、或者简化后退化（多边形少于3个顶点）的图形保持不变。
+     */
+    QList<GeometryShape *> shapes;
+    QVector<QVector<QPoint>> newGeometries;
+    for (const SimplifyTask &task : tasks)
+    {
+        int minCount = task.closed ? 3 : 2;
+        if ((task.newGeometry.count() >= task.oldGeometry.count()) || (task.newGeometry.count() < minCount))
+        {
+            continue;
+        }
+
+        shapes.append(task.shape);
+        newGeometries.append(task.newGeometry);
+    }
+
+    this->reshapeShapes(shapes, newGeometries);
+    return true;
+}
+
+void PaintArea::reshapeShapes(const QList<GeometryShape *> &shapes, const QVector<QVector<QPoint>> &newGeometries)
+{
+    if (shapes.isEmpty() || (shapes.count() != newGeometries.count()))
+    {
+        return;
+    }
+
+    QVector<QVector<QPoint>> oldGeometries;
+    for (int i = 0; i < shapes.count(); i++)
+    {
+        oldGeometries.append(shapes.at(i)->GetGeometry());
+        shapes.at(i)->SetGeometry(newGeometries.at(i));
+        this->ShapeChanged(shapes.at(i));
+    }
+
+    this->pushCommand(new ReshapeShapesCommand(shapes, oldGeometries, newGeometries));
+    this->viewport()->update();
+}
+
+void PaintArea::insertShapes(const QList<GeometryShape *> &shapes)
+{
+    if (shapes.isEmpty())
+    {
+        return;
+    }
+
+    for (GeometryShape *shape : shapes)
+    {
+        this->InsertShape(shape);
+    }
+
+    this->pushCommand(new CreateShapesCommand(shapes));
+    this->viewport()->update();
+}
+
+bool PaintArea::CombineSelectedShapes(EBooleanOp op)
+{
+    QList<GeometryShape *> operands;
+    QVector<QPainterPath> paths;
+    for (auto item : _selectedList)
+    {
+        if (ShapeBoolean::IsSupported(item))
+        {
+            operands.append(item);
+            paths.append(ShapeBoolean::ToPath(item));
+        }
+    }
+
+    if (operands.count() < 2)
+    {
+        qWarning() << "Warn: PaintArea::CombineSelectedShapes(), select at least 2 polygons, rects, ellipses or circles!";
+        return false;
+    }
+
+    QList<QPolygon> polygons = ShapeBoolean::Combine(paths, op);
+    if (polygons.isEmpty())
+    {
+        qWarning() << "Warn: PaintArea::CombineSelectedShapes(), empty result!" << op;
+        return false;
+    }
+
+    quint64 layerId = operands.first()->GetLayerId();
+    for (auto item : operands)
+    {
+        this->RemoveShape(item);
+    }
+
+    QList<GeometryShape *> shapes;
+    for (const QPolygon &polygon : polygons)
+    {
+        GeometryShape *shape = GeometryShapeFactory::CreateGeometryShape(EPaintType::EPT_Polygon);
+        shape->SetGeometry(polygon);
+        shape->SetLayerId(layerId);
+        this->InsertShape(shape);
+        shapes.append(shape);
+    }
+
+    this->pushCommand(new ReplaceShapesCommand(operands, shapes));
+    this->viewport()->update();
+    return true;
+}
+
+int PaintArea::CheckOverlaps()
+{
+    QList<GeometryShape *> shapes = this->completedShapes(true);
+    OverlapDetector detector(shapes);
+    _overlapPairs = detector.Detect();
+
+    /*
+     * 按id找回图形，用于高亮。
+     */
+    QHash<quint64, GeometryShape *> shapeById;
+    shapeById.reserve(shapes.count());
+    for (auto item : shapes)
+    {
+        shapeById.insert(item->GetId(), item);
+    }
+
+    _overlapShapes.clear();
+    for (const OverlapPair &pair : _overlapPairs)
+    {
+        _overlapShapes.insert(shapeById.value(pair.firstId));
+        _overlapShapes.insert(shapeById.value(pair.secondId));
+    }
+
+    this->SetOverlapHighlight(true);
+    return _overlapPairs.count();
+}
+
+bool PaintArea::ExportOverlapReport(const QString &path)
+{
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly))
+    {
+        qWarning() << "Warn: PaintArea::ExportOverlapReport(), failed to open!" << path << file.errorString();
+        return false;
+    }
+
+    if (!OverlapDetector::WriteReport(&file, _overlapPairs) || !file.commit())
+    {
+        qWarning() << "Warn: PaintArea::ExportOverlapReport(), failed to write!" << path << file.errorString();
+        return false;
+    }
+
+    return true;
+}
+
+void PaintArea::SetOverlapHighlight(bool enabled)
+{
+    _overlapHighlight = enabled;
+    this->viewport()->update();
+}
+
+void PaintArea::clearOverlaps()
+{
+    /*
+     * 图形被修改、撤销或重做后，上一次的检查结果不再可靠，需重新检查。
+     */
+    _overlapPairs.clear();
+    _overlapShapes.clear();
+}
+
+bool PaintArea::ExportVector(const QString &path, EVectorBackground background)
+{
+    VectorExporter exporter(completedShapes(true));
+    QImage image;
+    QString imagePath;
+    if (this->exportBackground(image, imagePath))
+    {
+        exporter.SetBackground(image, imagePath, background);
+
+        QImage overlay;
+        if (this->exportFillOverlay(overlay))
+        {
+            exporter.SetFillOverlay(overlay);
+        }
+    }
+
+    if (QFileInfo(path).suffix().compare("pdf", Qt::CaseInsensitive) == 0)
+    {
+        return exporter.WritePdf(path);
+    }
+
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly))
+    {
+        qWarning() << "Warn: PaintArea::ExportVector(), failed to open!" << path << file.errorString();
+        return false;
+    }
+
+    if (!exporter.WriteSvg(&file) || !file.commit())
+    {
+        qWarning() << "Warn: PaintArea::ExportVector(), failed to write!" << path << file.errorString();
+        return false;
+    }
+
+    return true;
+}
+
+bool PaintArea::exportBackground(QImage &image, QString &filePath) const
+{
+    Q_UNUSED(image)
+    Q_UNUSED(filePath)
+    return false;
+}
+
+bool PaintArea::exportFillOverlay(QImage &overlay) const
+{
+    Q_UNUSED(overlay)
+    return false;
+}
+
+bool PaintArea::floodFill(const QPoint &scenePos)
+{
+    Q_UNUSED(scenePos)
+    return false;
+}
+
+void PaintArea::BackgroundChanged(const QRect &rect)
+{
+    Q_UNUSED(rect)
+    this->viewport()->update();
+}
+
+void PaintArea::fillBackground(const QSharedPointer<QImage> &overlay, const QVector<FillSpan> &spans,
+                               const QColor &color)
+{
+    if (overlay.isNull() || spans.isEmpty())
+    {
+        return;
+    }
+
+    FillCommand *command = new FillCommand(overlay, spans, color.rgba());
+    command->Redo(this);
+    this->pushCommand(command);
+}
+
+void PaintArea::paintOverlay(QPainter &painter)
+{
+    Q_UNUSED(painter)
+}
+
+bool PaintArea::inputText(GeometryShape *shape)
+{
+    bool ok = false;
+    QString text = QInputDialog::getText(this, "文本", "内容：", QLineEdit::Normal, QString(), &ok);
+    if (!ok || text.isEmpty())
+    {
+        this->RemoveShape(shape);
+        delete shape;
+        return false;
+    }
+
+    Text *textShape = static_cast<Text *>(shape);
+    textShape->SetTextStyle(_textStyle);
+    textShape->SetText(text);
+    return true;
+}
+
+bool PaintArea::magicWand(const QPoint &scenePos)
+{
+    QImage image;
+    QString filePath;
+    if (!this->exportBackground(image, filePath))
+    {
+        return false;
+    }
+
+    PaintLayer *layer = _layers.at(_currentLayer);
+    if (!layer->GetVisible() || layer->GetLocked())
+    {
+        qWarning() << "Warn: PaintArea::magicWand(), current layer is hidden or locked!" << layer->GetName();
+        return false;
+    }
+
+    /*
+     * 背景图位于场景坐标原点，像素坐标即场景坐标。
+     */
+    ScanlineFloodFill region;
+    region.SetMaxPixels(MagicWandMaxPixels);
+    if (!region.Grow(image, scenePos, FillTolerance))
+    {
+        return false;
+    }
+    if (region.IsTruncated())
+    {
+        qWarning() << "Warn: PaintArea::magicWand(), region too large!" << scenePos;
+        return false;
+    }
+
+    const qreal tolerance = MagicWandSimplifyTolerance;
+    QPolygon outline = PolygonSimplifier::Simplify(region.TraceOutline(), tolerance, true);
+    if (outline.count() < 3)
+    {
+        qWarning() << "Warn: PaintArea::magicWand(), invalid outline!" << outline.count();
+        return false;
+    }
+
+    GeometryShape *shape = GeometryShapeFactory::CreateGeometryShape(EPaintType::EPT_Polygon);
+    shape->SetGeometry(outline);
+
+    this->InsertShape(shape);
+    this->pushCommand(new CreateShapesCommand(QList<GeometryShape *>() << shape));
+    this->viewport()->update();
+    return true;
+}
+
+void PaintArea::pushCommand(PaintCommand *command)
+{
+    _history.Push(command);
+    this->clearOverlaps();
+    this->autosaveCommit();
+}
+
+void PaintArea::autosaveCommit()
+{
+    if (_autosave == nullptr)
+    {
+        _autosaveDirtySet.clear();
+        _autosaveRemovedIds.clear();
+        return;
+    }
+
+    _autosave->AppendRemove(_autosaveRemovedIds);
+    _autosaveRemovedIds.clear();
+
+    /*
+     * 绘制中的图形留到完成后再提交。
+     */
+    QList<GeometryShape *> shapes;
+    for (auto it = _autosaveDirtySet.begin(); it != _autosaveDirtySet.end();)
+    {
+        if ((*it)->GetCompleted())
+        {
+            shapes.append(*it);
+            it = _autosaveDirtySet.erase(it);
+        }
+        else
+        {
+            ++it;
+        }
+    }
+    _autosave->AppendUpsert(shapes);
+
+    if (_autosave->NeedsSnapshot())
+    {
+        _autosave->WriteSnapshot(completedShapes());
+    }
+}
+
+QList<GeometryShape *> PaintArea::completedShapes(bool visibleOnly) const
+{
+    QList<GeometryShape *> shapes;
+
+    for (auto layer : _layers)
+    {
+        if (visibleOnly && !layer->GetVisible())
+        {
+            continue;
+        }
+
+        for (auto item : layer->GetShapes())
+        {
+            if (item->GetCompleted())
+            {
+                shapes.append(item);
+            }
+        }
+    }
+
+    return shapes;
+}
+
+QPoint PaintArea::AdjustedPos(const QPoint &point) const
+{
+    QPoint pos = this->mapToScene(point).toPoint();
+    QPoint target;
+
+    if (this->findSnapTarget(pos, target))
+    {
+        return target;
+    }
+
+    return pos;
+}
+
+bool PaintArea::findSnapTarget(const QPoint &scenePos, QPoint &target) const
+{
+    /*
+     * 只在绘制线段、折线、多边形时吸附；移动、改变大小以及按下修饰键时不吸附。
+     */
+    switch (_paintType)
+    {
+    case EPaintType::EPT_Line:
+    case EPaintType::EPT_Polyline:
+    case EPaintType::EPT_Polygon:
+        break;
+    default:
+        return false;
+    }
+
+    if (_moveEnabled || _dragResizeEnabled || (QApplication::keyboardModifiers() != Qt::NoModifier))
+    {
+        return false;
+    }
+
+    return _snapIndex.Nearest(scenePos, SnapTolerance / this->transform().m11(), target);
+}
+
+void PaintArea::updateSnapMarker(const QPoint &scenePos)
+{
+    QPoint target;
+    bool visible = this->findSnapTarget(scenePos, target);
+
+    if ((visible == _snapMarkerVisible) && (!visible || (target == _snapMarker)))
+    {
+        return;
+    }
+
+    if (_snapMarkerVisible)
+    {
+        this->viewport()->update(this->snapMarkerRect());
+    }
+
+    _snapMarkerVisible = visible;
+    _snapMarker = target;
+
+    if (_snapMarkerVisible)
+    {
+        this->viewport()->update(this->snapMarkerRect());
+    }
+}
+
+QRect PaintArea::snapMarkerRect() const
+{
+    QPoint center = this->mapFromScene(_snapMarker);
+    return QRect(center.x() - SnapMarkerSize, center.y() - SnapMarkerSize, SnapMarkerSize * 2 + 1, SnapMarkerSize * 2 + 1);
+}
+
+void PaintArea::paintSnapMarker(QPainter &painter)
+{
+    if (!_snapMarkerVisible)
+    {
+        return;
+    }
+
+    QPen pen(QColor("#7cfc00"));
+    pen.setWidth(2);
+    painter.setPen(pen);
+    painter.setBrush(Qt::NoBrush);
+    painter.drawRect(this->snapMarkerRect().adjusted(1, 1, -1, -1));
 }
@@ -4,16 +4,110 @@
 #include <QWidget>
 #include <QPen>
 #include <QMap>
+#include <QSet>
 #include <QGraphicsView>
+#include <QPixmap>
+#include <QVariantAnimation>
+#include <QTimer>
 
 #include "Types.h"
 #include "GeometryShape.h"
+#include "PaintHistory.h"
+#include "PaintAutosave.h"
+#include "VectorExport.h"
+#include "SnapIndex.h"
+#include "ShapeGrid.h"
+#include "PaintLayer.h"
+#include "ShapeBoolean.h"
+#include "OverlapDetector.h"
 
-class PaintArea : public QGraphicsView
+class PaintArea : public QGraphicsView, public PaintShapeStore, public ShapeMeasureObserver
 {
     Q_OBJECT
 public:
     constexpr static Qt::CursorShape DefaultCursorShape = Qt::CursorShape::CrossCursor;
+    /**
+     * @brief 场景的半边长。平移通过滚动条实现，场景需要足够大才有滚动范围。
+     */
+    constexpr static qreal SceneExtent = 100000.0;
+    /**
+     * @brief 滚轮每转过一格（120）的缩放倍数，以及缩放的范围和动画时长（ms）。
+     */
+    constexpr static qreal ZoomStepFactor = 1.25;
+    constexpr static qreal MinZoomScale = 1.0 / 64;
+    constexpr static qreal MaxZoomScale = 64.0;
+    constexpr static int ZoomAnimationDuration = 150;
+    /**
+     * @brief 交互停止后，延时RefineIdleDelay（ms）开始高质量重绘，每次重绘RefineBandHeight像素高的条带。
+     */
+    constexpr static int RefineIdleDelay = 200;
+    constexpr static int RefineBandHeight = 64;
+    /**
+     * @brief 绘制线段、折线、多边形时，光标吸附到SnapTolerance屏幕像素内最近的顶点、端点、圆心或矩形角点。
+     * 吸附目标以边长为SnapMarkerSize * 2的方框标记。
+     */
+    constexpr static qreal SnapTolerance = 8.0;
+    constexpr static int SnapMarkerSize = 6;
+    /**
+     * @brief 框选、套索选择的候选图形不少于ParallelSelectMinShapes个时，在线程池中并行判断。
+     */
+    constexpr static int ParallelSelectMinShapes = 512;
+    /**
+     * @brief 油漆桶、魔棒每个颜色通道允许的最大差值。
+     */
+    constexpr static int FillTolerance = 32;
+    /**
+     * @brief 魔棒区域超过MagicWandMaxPixels像素时放弃，轮廓按MagicWandSimplifyTolerance（场景坐标）简化。
+     */
+    constexpr static qint64 MagicWandMaxPixels = 32LL * 1024 * 1024;
+    constexpr static qreal MagicWandSimplifyTolerance = 1.0;
+    /**
+     * @brief 简化折线、多边形时默认允许的最大距离（场景坐标）。
+     */
+    constexpr static qreal DefaultSimplifyTolerance = 1.0;
+    /**
+     * @brief 重叠图形高亮轮廓的宽度（屏幕像素）。
+     */
+    constexpr static qreal OverlapHighlightWidth = 4.0;
+
+    /**
+     * @brief The ERenderQuality enum
+     * - ERQ_Preview: 交互中，不抗锯齿、简化几何、图片最近邻缩放。
+     * - ERQ_High: 空闲时，高质量绘制。
+     */
+    enum ERenderQuality
+    {
+        ERQ_Preview = 0,
+        ERQ_High,
+    };
+
+    /**
+     * @brief The ERegionSelectMode enum
+     * - ERSM_Rect: Shift + 拖拽框选，选中轮廓完全在矩形内的图形。
+     * - ERSM_Lasso: Ctrl + Shift + 拖拽套索选择，选中轮廓完全在套索内的图形。
+     */
+    enum ERegionSelectMode
+    {
+        ERSM_None = 0,
+        ERSM_Rect,
+        ERSM_Lasso,
+    };
+
+    /**
+     * @brief The MeasureStatistics struct 绘图区域内所有图形（含绘制中的图形）的测量值合计。
+     * @details 图形加入、移除、测量值变化时以补偿求和增量更新，不需要遍历图形；撤销、重做后按图形重新计算。
+     */
+    struct MeasureStatistics
+    {
+        int count;
+        qreal totalLength;
+        qreal totalPerimeter;
+        qreal totalArea;
+
+        MeasureStatistics() : count(0), totalLength(0.0), totalPerimeter(0.0), totalArea(0.0)
+        {
+        }
+    };
 
 //    explicit PaintArea(QWidget *parent = nullptr);
     PaintArea(QGraphicsScene *scene, QWidget *parent = nullptr);
@@ -21,12 +115,193 @@ public:
 
     bool eventFilter(QObject *object, QEvent *event) override;
     virtual void SetPaintType(EPaintType type);
+    /**
+     * @brief SetToolType 切换工具，绘制中的图形需先完成才能使用其它工具。
+     */
+    virtual void SetToolType(EToolType type);
+    EToolType GetToolType() const
+    {
+        return _toolType;
+    }
+    virtual void SetFillColor(const QColor &color);
+    /**
+     * @brief SetTextStyle 设置新建文本的样式（ETextStyle的组合），同时应用于选中的文本。
+     */
+    virtual void SetTextStyle(int style);
+    int GetTextStyle() const
+    {
+        return _textStyle;
+    }
+    QColor GetFillColor() const
+    {
+        return _fillColor;
+    }
+    /**
+     * @brief AdjustedPos 视口坐标转换为场景坐标，绘制线段、折线、多边形时吸附到附近的吸附目标。
+     */
     QPoint AdjustedPos(const QPoint &point) const;
+    ERenderQuality GetRenderQuality() const
+    {
+        return _renderQuality;
+    }
+
+    void InsertShape(GeometryShape *shape) override;
+    void RemoveShape(GeometryShape *shape) override;
+    void ShapeChanged(GeometryShape *shape) override;
+    void ArrangeShapes(const QList<GeometryShape *> &shapes, const QVector<ShapePlacement> &placements) override;
+    void BackgroundChanged(const QRect &rect) override;
+    void MeasureChanged(GeometryShape *shape, const ShapeMeasure &oldMeasure, const ShapeMeasure &newMeasure) override;
+    const MeasureStatistics &GetMeasureStatistics() const
+    {
+        return _measureStatistics;
+    }
+    /**
+     * @brief GetMeasuredShape 需要显示测量值的图形：绘制中的图形，否则为唯一选中的图形，没有时返回nullptr。
+     */
+    GeometryShape *GetMeasuredShape() const;
+    /**
+     * @brief 图层从下到上编号，新图形加入当前图层。
+     */
+    int GetLayerCount() const
+    {
+        return _layers.count();
+    }
+    const PaintLayer *GetLayer(int index) const;
+    int GetCurrentLayer() const
+    {
+        return _currentLayer;
+    }
+    void SetCurrentLayer(int index);
+    /**
+     * @brief AddLayer 在当前图层之上新建图层，并设为当前图层。
+     * @param name 为空时按编号命名。
+     * @return 新图层的编号。
+     */
+    int AddLayer(const QString &name = QString());
+    /**
+     * @brief SetLayerVisible 显示、隐藏图层，隐藏后图层中的图形取消选中。
+     */
+    void SetLayerVisible(int index, bool visible);
+    /**
+     * @brief SetLayerLocked 锁定、解锁图层，锁定后图层中的图形取消选中。
+     */
+    void SetLayerLocked(int index, bool locked);
+    void SetLayerOpacity(int index, qreal opacity);
+    /**
+     * @brief MoveLayer 调整图层顺序，offset为正时上移。
+     */
+    void MoveLayer(int index, int offset);
+    /**
+     * @brief BringSelectedToFront 将选中的图形移到各自图层的最上面。
+     */
+    void BringSelectedToFront();
+    /**
+     * @brief SendSelectedToBack 将选中的图形移到各自图层的最下面。
+     */
+    void SendSelectedToBack();
+    /**
+     * @brief MoveSelectedToLayer 将选中的图形移到第index个图层的最上面，图形之间的相对顺序不变。
+     * @return false - 图层不存在、已锁定或者没有需要移动的图形。
+     */
+    bool MoveSelectedToLayer(int index);
+    /**
+     * @brief Undo 撤销上一次编辑。
+     */
+    void Undo();
+    /**
+     * @brief Redo 重做上一次撤销的编辑。
+     */
+    void Redo();
+    /**
+     * @brief SetHistoryMemoryLimit 设置撤销历史的内存上限（字节）。
+     */
+    void SetHistoryMemoryLimit(qint64 bytes);
+    /**
+     * @brief EnableAutosave 开启自动保存，上次未正常退出时询问是否恢复。
+     * @param dirPath 自动保存的目录。
+     * @param name 文件名（不含后缀），同一目录下的绘图区域各不相同。
+     */
+    void EnableAutosave(const QString &dirPath, const QString &name);
+    /**
+     * @brief ImportAnnotations 从JSON/CSV文件导入标注，作为一次编辑记入撤销历史。
+     * @details 文件中的id不沿用，导入的图形重新分配id。
+     * @return false - 打开或读取失败，已读出的图形仍被导入。
+     */
+    bool ImportAnnotations(const QString &path);
+    /**
+     * @brief ExportAnnotations 将已完成的图形按id顺序导出为JSON/CSV文件，格式由后缀决定。
+     */
+    bool ExportAnnotations(const QString &path);
+    /**
+     * @brief ExportVector 将已完成的图形导出为SVG/PDF矢量图，格式由后缀决定。
+     * @param background 有背景图时（见exportBackground()）背景图的处理方式。
+     */
+    bool ExportVector(const QString &path, EVectorBackground background);
+    /**
+     * @brief SimplifySelectedShapes 简化选中的多边形、折线、手绘笔迹的顶点，各图形在线程池中并行简化，
+     * 作为一次编辑记入撤销历史。
+     * @param tolerance 简化后与原图形的最大距离（场景坐标）。
+     * @return false - 没有选中可简化的图形。
+     */
+    bool SimplifySelectedShapes(qreal tolerance = DefaultSimplifyTolerance);
+    /**
+     * @brief CombineSelectedShapes 对选中的多边形、矩形、椭圆、圆做布尔运算（见ShapeBoolean），
+     * 结果的各个环作为多边形加入第一个选中图形所在的图层，替换参与运算的图形，作为一次编辑记入撤销历史。
+     * @details 差集为第一个选中的图形减去其余选中的图形；其它类型的选中图形不参与运算，保持不变。
+     * @return false - 可运算的图形少于2个，或者结果为空。
+     */
+    bool CombineSelectedShapes(EBooleanOp op);
+    /**
+     * @brief CheckOverlaps 查找显示的图层中所有重叠、相交的图形对（见OverlapDetector），并高亮涉及的图形。
+     * @return 重叠的图形对数。
+     */
+    int CheckOverlaps();
+    const QVector<OverlapPair> &GetOverlapPairs() const
+    {
+        return _overlapPairs;
+    }
+    /**
+     * @brief ExportOverlapReport 将上一次CheckOverlaps()的结果写为CSV报告。
+     */
+    bool ExportOverlapReport(const QString &path);
+    /**
+     * @brief SetOverlapHighlight 是否高亮上一次CheckOverlaps()找到的重叠图形，之后的编辑、撤销、重做会清除检查结果。
+     */
+    void SetOverlapHighlight(bool enabled);
+    bool GetOverlapHighlight() const
+    {
+        return _overlapHighlight;
+    }
+    /**
+     * @brief SetImportSimplifyTolerance 导入标注时按tolerance简化多边形、折线，不大于0时不简化（默认）。
+     */
+    virtual void SetImportSimplifyTolerance(qreal tolerance);
+    qreal GetImportSimplifyTolerance() const
+    {
+        return _importSimplifyTolerance;
+    }
+    /**
+     * @brief SetCompactStorage 已完成的多边形、折线是否使用紧凑存储（见CompactPolygon），默认不使用。
+     */
+    virtual void SetCompactStorage(bool enabled);
+    bool GetCompactStorage() const
+    {
+        return _compactStorage;
+    }
 
 signals:
+    /**
+     * @brief measureChanged 测量值、统计量或选中的图形发生了变化。
+     */
+    void measureChanged();
+    /**
+     * @brief layersChanged 图层的增加、顺序、属性或者当前图层发生了变化。
+     */
+    void layersChanged();
 
 protected:
     void paintEvent(QPaintEvent *event) override;
+    void showEvent(QShowEvent *event) override;
     void mousePressEvent(QMouseEvent *event) override;
     void mouseReleaseEvent(QMouseEvent *event) override;
     void mouseMoveEvent(QMouseEvent *e) override;
@@ -37,10 +312,81 @@ protected:
 //    void dropEvent(QDropEvent *event) override;
 //    void startDrag(Qt::DropActions supportedActions) override;
 
-    void paintAllShapes(QPainter& painter);
+    /**
+     * @brief paintAllShapes 在视口上绘制所有图形。
+     * @param painter 视口的画笔。
+     * @param exposedRegion 需要重绘的视口区域，为空时绘制全部图形。
+     */
+    void paintAllShapes(QPainter& painter, const QRegion &exposedRegion = QRegion());
+    /**
+     * @brief panBy 平移视图。
+     * @param delta 视口坐标下的平移量。
+     * @details 通过滚动条滚动视图，已绘制的像素直接搬移，仅重绘新露出的区域。
+     */
+    void panBy(const QPoint &delta);
+    /**
+     * @brief zoomAt 以视口中的某一点为锚点，平滑缩放视图。
+     * @param factor 相对于当前目标比例的缩放倍数。
+     * @param viewPos 视口坐标下的锚点，缩放过程中该点下的场景内容保持不动。
+     * @details 动画过程中只绘制缩放前一帧的缩放图作为占位，动画结束后再完整重绘一次。
+     */
+    void zoomAt(qreal factor, const QPoint &viewPos);
+    /**
+     * @brief interactionUpdate 拖拽、缩放、平移等交互进行中，切换到预览质量，并重新计时空闲。
+     */
+    void interactionUpdate();
+    /**
+     * @brief cancelRefine 有新的输入，暂停高质量重绘，空闲后从暂停处继续。
+     */
+    void cancelRefine();
+    /**
+     * @brief completedShapes 已绘制完成的图形（不含绘制中的图形），按图层从下到上的顺序。
+     * @param visibleOnly 只包含显示的图层中的图形。
+     */
+    QList<GeometryShape *> completedShapes(bool visibleOnly = false) const;
+    /**
+     * @brief exportBackground 导出时使用的背景图及其文件路径。
+     * @return false - 没有背景图。
+     */
+    virtual bool exportBackground(QImage &image, QString &filePath) const;
+    /**
+     * @brief exportFillOverlay 油漆桶的填充覆盖层（与背景图大小相同），背景图文件中不含这些填充。
+     * @return false - 没有填充。
+     */
+    virtual bool exportFillOverlay(QImage &overlay) const;
+    /**
+     * @brief floodFill 油漆桶：以scenePos处的像素为种子填充背景图，可撤销。
+     * @return false - 没有背景图或者位置在背景图外。
+     */
+    virtual bool floodFill(const QPoint &scenePos);
+    /**
+     * @brief paintOverlay 在图形和重叠标记之上、吸附标记之下绘制附加的标记，painter为视口坐标。
+     * @details 缩放动画的占位帧不调用。
+     */
+    virtual void paintOverlay(QPainter &painter);
+    /**
+     * @brief reshapeShapes 将shapes的控制点改为newGeometries，记为一条可撤销的历史记录。
+     */
+    void reshapeShapes(const QList<GeometryShape *> &shapes, const QVector<QVector<QPoint>> &newGeometries);
+    /**
+     * @brief insertShapes 将已完成的图形加入当前图层，记为一条可撤销的历史记录。
+     */
+    void insertShapes(const QList<GeometryShape *> &shapes);
+    /**
+     * @brief fillBackground 将行段填充到背景的填充覆盖层overlay中，记为一条可撤销的历史记录（见FillCommand）。
+     */
+    void fillBackground(const QSharedPointer<QImage> &overlay, const QVector<FillSpan> &spans, const QColor &color);
 
 private:
     EPaintType _paintType;
+    EToolType _toolType;
+    QColor _fillColor;
+    int _textStyle;
+    qreal _importSimplifyTolerance;
+    bool _compactStorage;
+    bool _overlapHighlight;
+    QVector<OverlapPair> _overlapPairs;
+    QSet<GeometryShape *> _overlapShapes;
     GeometryShape *_lastPaintShape;
     GeometryShape *_lastSelectedShape;
 
@@ -52,10 +398,122 @@ private:
     bool _mouseMoveEnabled;
     bool _moveEnabled;
     bool _dragResizeEnabled;
+    bool _panOriginInitialized;
 
+    QPoint _panLastCursorPos;
     QPoint _moveStartCursorPos;
+    QVector<QPoint> _dragResizeStartGeometry;
+
+    PaintHistory _history;
+    quint64 _lastShapeId;
+
+    PaintAutosave *_autosave;
+    QSet<GeometryShape *> _autosaveDirtySet;
+    QVector<quint64> _autosaveRemovedIds;
+
+    QVariantAnimation *_zoomAnimation;
+    qreal _zoomTargetScale;
+    QPoint _zoomAnchorViewPos;
+    QPointF _zoomAnchorScenePos;
+    bool _zoomPreviewEnabled;
+    QPixmap _zoomPreviewFrame;
+    QTransform _zoomPreviewTransform;
+
+    ERenderQuality _renderQuality;
+    QTimer *_refineIdleTimer;
+    QTimer *_refineBandTimer;
+    int _refineBandTop;
+
+    MeasureStatistics _measureStatistics;
+    /**
+     * @brief 合计的累加值和Neumaier补偿量（只用length、perimeter、area），两者之和为_measureStatistics中的合计。
+     */
+    ShapeMeasure _measureSum;
+    ShapeMeasure _measureCompensation;
+    QTimer *_measureTimer;
+
+    SnapIndex _snapIndex;
+    QPoint _snapMarker;
+    bool _snapMarkerVisible;
+
+    ShapeGrid _shapeGrid;
+    ERegionSelectMode _regionSelectMode;
+    QPoint _regionSelectStart;
+    QPoint _regionSelectEnd;
+    QPolygon _regionSelectLasso;
+
+    QList<PaintLayer *> _layers;
+    int _currentLayer;
+    quint64 _lastLayerId;
 
     void paintCursorLine();
+    bool isShapeExposed(GeometryShape *shape, const QVector<QRectF> &exposedRects) const;
+    /**
+     * @brief updateLayerCache 图层缓存失效时，在高质量绘制时按当前视图重建。
+     * @return false - 缓存不可用（交互中），需要直接绘制图层中的图形。
+     */
+    bool updateLayerCache(PaintLayer *layer);
+    /**
+     * @brief isActiveShape 绘制中、选中的图形不进入图层缓存，每次重绘时直接绘制。
+     */
+    static bool isActiveShape(const GeometryShape *shape)
+    {
+        return !shape->GetCompleted() || shape->GetSelected();
+    }
+    void applyZoomScale(qreal scale);
+    void paintZoomPreview(QPaintEvent *event);
+    void refineIdleHandler();
+    void refineBandHandler();
+    void accumulateMeasure(const ShapeMeasure &measure, int sign);
+    void scheduleMeasureUpdate();
+    bool findSnapTarget(const QPoint &scenePos, QPoint &target) const;
+    void updateSnapMarker(const QPoint &scenePos);
+    QRect snapMarkerRect() const;
+    void paintSnapMarker(QPainter &painter);
+    void regionSelectBegin(ERegionSelectMode mode, const QPoint &scenePos);
+    void regionSelectUpdate(const QPoint &scenePos);
+    /**
+     * @brief regionSelectEnd 结束框选、套索选择，选中区域内的图形。
+     */
+    void regionSelectEnd();
+    void paintRegionSelect(QPainter &painter);
+    void paintOverlapHighlight(QPainter &painter);
+    void clearOverlaps();
+    PaintLayer *findLayer(quint64 id) const;
+    void invalidateShapeLayer(GeometryShape *shape);
+    /**
+     * @brief compactShape 开启紧凑存储时，已完成的多边形、折线改用紧凑存储。
+     */
+    void compactShape(GeometryShape *shape);
+    /**
+     * @brief isShapeEditable 图形所在图层显示且未锁定时，图形可以选中、移动。
+     */
+    bool isShapeEditable(GeometryShape *shape) const;
+    /**
+     * @brief shapeAt 包含point的最上层可编辑图形，没有时返回nullptr。
+     */
+    GeometryShape *shapeAt(const QPoint &point) const;
+    void setShapeSelected(GeometryShape *shape, bool selected);
+    void deselectLayer(PaintLayer *layer);
+    /**
+     * @brief selectedShapesInOrder 选中的图形，按绘制顺序（图层从下到上，图层内从下到上）。
+     */
+    QList<GeometryShape *> selectedShapesInOrder() const;
+    QVector<ShapePlacement> shapePlacements(const QList<GeometryShape *> &shapes) const;
+    /**
+     * @brief arrangeCommit 调整顺序后记录历史，并将次序键变化的图形交给自动保存。
+     */
+    void arrangeCommit(const QList<GeometryShape *> &shapes, const QVector<ShapePlacement> &oldPlacements);
+    /**
+     * @brief magicWand 魔棒：在背景图中从scenePos生长区域，将其外轮廓作为多边形加入当前图层。
+     * @return false - 没有背景图、位置在背景图外、区域过大或者当前图层不可绘制。
+     */
+    bool magicWand(const QPoint &scenePos);
+    /**
+     * @brief inputText 输入新建文本的内容，取消或者内容为空时移除并删除图形。
+     * @return false - 图形已删除。
+     */
+    bool inputText(GeometryShape *shape);
     /**
      * @brief Pulse edge check.
      * @param[in] stateCache Old state.
@@ -95,6 +553,15 @@ private:
     bool moveReleaseHandler(const QPoint &point);
     void cursorShapeHandler(const QPoint &point);
     void selectAllShapes();
+    void clearSelection();
+    /**
+     * @brief pushCommand 记录一条已执行的编辑，并提交到自动保存。
+     */
+    void pushCommand(PaintCommand *command);
+    /**
+     * @brief autosaveCommit 将上次提交以来变化的图形写入自动保存的日志。
+     */
+    void autosaveCommit();
     void deleteSelectedShapes();
 };
 
@@ -7,9 +7,14 @@
 #include <QFileDialog>
 #include <QImage>
 #include <QGraphicsPixmapItem>
+#include <QMessageBox>
+#include <QPushButton>
+#include <QFileInfo>
 
 PaintAreaMain::PaintAreaMain(QGraphicsScene *scene, QWidget *parent) : PaintArea(scene, parent)
   ,_paintImage(nullptr)
+  ,_caliperEnabled(false)
+  ,_circleFitEnabled(false)
 {
     this->setBackgroundBrush(QPixmap(":/images/background1.png"));
 
@@ -33,6 +38,13 @@ PaintAreaMain::PaintAreaMain(QGraphicsScene *scene, QWidget *parent) : PaintArea
 //    p.setColor(QPalette::ColorRole::Background, Qt::transparent);
 //    p.setColor(QPalette::ColorRole::WindowText, Qt::red);
 //    _curPosLabel->setPalette(p);
+
+    _measureLabel = new QLabel(this);
+    _measureLabel->move(20, this->height() - 120);
+    _measureLabel->setFont(font);
+    _measureLabel->setStyleSheet("background-color:transparent;color:red;");
+    this->updateMeasureText();
+    connect(this, &PaintArea::measureChanged, this, &PaintAreaMain::updateMeasureText);
 }
 
 void PaintAreaMain::SetPaintType(EPaintType type)
@@ -44,26 +56,109 @@ void PaintAreaMain::SetPaintType(EPaintType type)
     }
 }
 
+void PaintAreaMain::SetToolType(EToolType type)
+{
+    PaintArea::SetToolType(type);
+    if (_paintImage != nullptr)
+    {
+        _paintImage->SetToolType(type);
+    }
+}
+
+void PaintAreaMain::SetFillColor(const QColor &color)
+{
+    PaintArea::SetFillColor(color);
+    if (_paintImage != nullptr)
+    {
+        _paintImage->SetFillColor(color);
+    }
+}
+
+void PaintAreaMain::SetTextStyle(int style)
+{
+    PaintArea::SetTextStyle(style);
+    if (_paintImage != nullptr)
+    {
+        _paintImage->SetTextStyle(style);
+    }
+}
+
+void PaintAreaMain::SetImportSimplifyTolerance(qreal tolerance)
+{
+    PaintArea::SetImportSimplifyTolerance(tolerance);
+    if (_paintImage != nullptr)
+    {
+        _paintImage->SetImportSimplifyTolerance(tolerance);
+    }
+}
+
+void PaintAreaMain::SetCompactStorage(bool enabled)
+{
+    PaintArea::SetCompactStorage(enabled);
+    if (_paintImage != nullptr)
+    {
+        _paintImage->SetCompactStorage(enabled);
+    }
+}
+
 void PaintAreaMain::ImageOptChangedHandler(int optMode)
 {
-    if (_paintImage == nullptr)
+    if (optMode == 1)
     {
         QString path = QFileDialog::getOpenFileName(nullptr, "选择图片", "", "Images (*.png *.xpm *.jpg);;All Files (*)");
-//        _paintImage = new PaintImage(this);
-//        _paintImage->setObjectName("PaintImage");
-        QGraphicsScene *scene = new QGraphicsScene(this);
-        QGraphicsPixmapItem *aa = scene->addPixmap(QPixmap(path));
-        _paintImage = new PaintImage(scene, this);
-        _paintImage->setObjectName("PaintImage");
-        _paintImage->move(100, 100);
+        if (path.isEmpty())
+        {
+            return;
+        }
+
+        if (_paintImage == nullptr)
+        {
+            QGraphicsScene *scene = new QGraphicsScene(this);
+            _paintImage = new PaintImage(scene, this);
+            _paintImage->setObjectName("PaintImage");
+            _paintImage->move(100, 100);
+            _paintImage->SetToolType(this->GetToolType());
+            _paintImage->SetFillColor(this->GetFillColor());
+            _paintImage->SetTextStyle(this->GetTextStyle());
+            _paintImage->SetImportSimplifyTolerance(this->GetImportSimplifyTolerance());
+            _paintImage->SetCompactStorage(this->GetCompactStorage());
+            _paintImage->SetCaliperEnabled(_caliperEnabled);
+            _paintImage->SetCircleFitEnabled(_circleFitEnabled);
+        }
+
+        if (_paintImage->LoadImage(path))
+        {
+            _paintImage->show();
+        }
+        return;
     }
 
-    if (optMode == 1)
+    if ((optMode == 4) || (optMode == 5))
     {
-        _paintImage->show();
-        _paintImage->LoadImage();
+        _caliperEnabled = (optMode == 4);
+        if (_paintImage != nullptr)
+        {
+            _paintImage->SetCaliperEnabled(_caliperEnabled);
+        }
+        return;
     }
-    else if (optMode == 2)
+
+    if ((optMode == 6) || (optMode == 7))
+    {
+        _circleFitEnabled = (optMode == 6);
+        if (_paintImage != nullptr)
+        {
+            _paintImage->SetCircleFitEnabled(_circleFitEnabled);
+        }
+        return;
+    }
+
+    if (_paintImage == nullptr)
+    {
+        return;
+    }
+
+    if (optMode == 2)
     {
         _paintImage->SaveImage();
     }
@@ -71,51 +166,119 @@ void PaintAreaMain::ImageOptChangedHandler(int optMode)
     {
         _paintImage->ClearImage();
     }
+    else if (optMode == 8)
+    {
+        _paintImage->MatchSelectedRect();
+    }
 }
 
-void PaintAreaMain::paintEvent(QPaintEvent *event)
+void PaintAreaMain::AnnotationOptChangedHandler(int optMode)
 {
-    PaintArea::paintEvent(event);
-    QPainter painter(this->viewport());
-    paintAllShapes(painter);
-}
+    PaintArea *area = this;
+    if ((_paintImage != nullptr) && _paintImage->isVisible())
+    {
+        area = _paintImage;
+    }
 
-void PaintAreaMain::wheelEvent(QWheelEvent *event)
-{
-    PaintArea::wheelEvent(event);
+    const QString filter = "JSON (*.json *.jsonl);;CSV (*.csv);;All Files (*)";
 
-    /*
-     * Ctrl + 鼠标滚轮，进行绘图区域的缩放。
-     */
-    if (QApplication::keyboardModifiers() == Qt::ControlModifier)
+    if (optMode == 1)
     {
-        QPoint numDegrees = event->angleDelta();
-        int step = 0;
-        qreal g = 0;
-
-        if (!numDegrees.isNull())
+        QString path = QFileDialog::getOpenFileName(this, "导入标注", "", filter);
+        if (!path.isEmpty() && !area->ImportAnnotations(path))
+        {
+            QMessageBox::warning(this, "导入标注", "读取标注文件失败，已导入读出的部分。");
+        }
+    }
+    else if (optMode == 2)
+    {
+        QString path = QFileDialog::getSaveFileName(this, "导出标注", "", filter);
+        if (!path.isEmpty() && !area->ExportAnnotations(path))
         {
-            step = numDegrees.y();
+            QMessageBox::warning(this, "导出标注", "写入标注文件失败。");
+        }
+    }
+    else if (optMode == 3)
+    {
+        QString path = QFileDialog::getSaveFileName(this, "导出矢量图", "", "SVG (*.svg);;PDF (*.pdf)");
+        if (path.isEmpty())
+        {
+            return;
         }
 
-        event->accept();
+        /*
+         * 只有图片窗口有背景图；PDF不能引用外部文件，只能嵌入。
+         */
+        EVectorBackground background = EVectorBackground::EVB_None;
+        if (area == _paintImage)
+        {
+            QMessageBox box(QMessageBox::Question, "导出矢量图", "是否包含背景图？", QMessageBox::NoButton, this);
+            QPushButton *embedButton = box.addButton("嵌入", QMessageBox::AcceptRole);
+            QPushButton *linkButton = nullptr;
+            if (QFileInfo(path).suffix().compare("svg", Qt::CaseInsensitive) == 0)
+            {
+                linkButton = box.addButton("链接", QMessageBox::AcceptRole);
+            }
+            box.addButton("不包含", QMessageBox::RejectRole);
+            box.exec();
 
-        qDebug() << step;
+            if (box.clickedButton() == embedButton)
+            {
+                background = EVectorBackground::EVB_Embedded;
+            }
+            else if ((linkButton != nullptr) && (box.clickedButton() == linkButton))
+            {
+                background = EVectorBackground::EVB_Linked;
+            }
+        }
 
-        if (step > 0)
+        if (!area->ExportVector(path, background))
         {
-            g = 2;
-            qDebug() << "Zoom out: " << g;
+            QMessageBox::warning(this, "导出矢量图", "写入矢量图文件失败。");
         }
-        else
+    }
+    else if (optMode == 4)
+    {
+        if (!area->SimplifySelectedShapes())
         {
-            g = 0.5;
-            qDebug() << "Zoom in: " << g;
+            QMessageBox::information(this, "简化图形", "请先选中多边形、多段线或手绘笔迹。");
         }
+    }
+    else if ((optMode >= 5) && (optMode <= 7))
+    {
+        EBooleanOp op = static_cast<EBooleanOp>(optMode - 5);
+        if (!area->CombineSelectedShapes(op))
+        {
+            QMessageBox::information(this, "布尔运算", "请选中至少2个多边形、矩形、椭圆或圆，且运算结果不为空。");
+        }
+    }
+    else if (optMode == 8)
+    {
+        int count = area->CheckOverlaps();
+        if (count == 0)
+        {
+            QMessageBox::information(this, "重叠检查", "没有重叠或相交的图形。");
+            return;
+        }
+
+        QMessageBox box(QMessageBox::Information, "重叠检查", QString("发现%0对重叠或相交的图形，已高亮显示。").arg(count),
+                        QMessageBox::NoButton, this);
+        QPushButton *saveButton = box.addButton("保存报告", QMessageBox::AcceptRole);
+        box.addButton(QMessageBox::Close);
+        box.exec();
 
-        qDebug() << this->matrix().m11();
-        this->scale(g, g);
-        qDebug() << this->matrix().m11();
+        if (box.clickedButton() == saveButton)
+        {
+            QString path = QFileDialog::getSaveFileName(this, "保存报告", "", "CSV (*.csv)");
+            if (!path.isEmpty() && !area->ExportOverlapReport(path))
+            {
+                QMessageBox::warning(this, "保存报告", "写入报告文件失败。");
+            }
+        }
+    }
+    else if (optMode == 9)
+    {
+        area->SetOverlapHighlight(false);
     }
 }
 
@@ -123,6 +286,7 @@ void PaintAreaMain::resizeEvent(QResizeEvent *event)
 {
     PaintArea::resizeEvent(event);
     _curPosLabel->move(20, this->height() - 80);
+    _measureLabel->move(20, this->height() - 120);
 }
 
 void PaintAreaMain::mouseMoveEvent(QMouseEvent *e)
@@ -133,12 +297,62 @@ void PaintAreaMain::mouseMoveEvent(QMouseEvent *e)
 
 void PaintAreaMain::updateXYCoordinateText()
 {
-    QPoint pos = this->AdjustedPos(this->mapFromGlobal(this->cursor().pos()));
+    QPoint pos = this->AdjustedPos(this->viewport()->mapFromGlobal(QCursor::pos()));
     QString xy = QString("X:%0 Y:%1").arg(QString::number(pos.x())).arg(QString::number(pos.y()));
     _curPosLabel->setText(xy);
     _curPosLabel->adjustSize();
 }
 
+void PaintAreaMain::updateMeasureText()
+{
+    GeometryShape *shape = this->GetMeasuredShape();
+    QString text;
+
+    if (shape == nullptr)
+    {
+        const MeasureStatistics &statistics = this->GetMeasureStatistics();
+        text = QString("图形:%0 总长度:%1 总周长:%2 总面积:%3").arg(statistics.count)
+                .arg(QString::number(statistics.totalLength, 'f', 1))
+                .arg(QString::number(statistics.totalPerimeter, 'f', 1))
+                .arg(QString::number(statistics.totalArea, 'f', 1));
+    }
+    else
+    {
+        const ShapeMeasure &measure = shape->GetMeasure();
+
+        switch (shape->GetPaintType())
+        {
+        case EPaintType::EPT_Line:
+            text = QString("长度:%0 角度:%1°").arg(QString::number(measure.length, 'f', 1))
+                    .arg(QString::number(measure.angle, 'f', 1));
+            break;
+        case EPaintType::EPT_Arc:
+            text = QString("半径:%0 弧长:%1 圆心角:%2°").arg(QString::number(measure.radius, 'f', 1))
+                    .arg(QString::number(measure.length, 'f', 1)).arg(QString::number(measure.angle, 'f', 1));
+            break;
+        case EPaintType::EPT_Circle:
+            text = QString("半径:%0 周长:%1 面积:%2").arg(QString::number(measure.radius, 'f', 1))
+                    .arg(QString::number(measure.perimeter, 'f', 1)).arg(QString::number(measure.area, 'f', 1));
+            break;
+        case EPaintType::EPT_Rect:
+        case EPaintType::EPT_Ellipse:
+        case EPaintType::EPT_Polygon:
+            text = QString("周长:%0 面积:%1").arg(QString::number(measure.perimeter, 'f', 1))
+                    .arg(QString::number(measure.area, 'f', 1));
+            break;
+        case EPaintType::EPT_Polyline:
+        case EPaintType::EPT_Freehand:
+            text = QString("长度:%0").arg(QString::number(measure.length, 'f', 1));
+            break;
+        default:
+            break;
+        }
+    }
+
+    _measureLabel->setText(text);
+    _measureLabel->adjustSize();
+}
+
 PaintAreaMainWrapper::PaintAreaMainWrapper(QWidget *parent) : QWidget(parent)
   ,_openToResizeChild(false)
 {
@@ -13,20 +13,41 @@ public:
 //    explicit PaintAreaMain(QWidget *parent = nullptr);
     PaintAreaMain(QGraphicsScene *scene, QWidget *parent = nullptr);
     void SetPaintType(EPaintType type) override;
+    void SetToolType(EToolType type) override;
+    void SetFillColor(const QColor &color) override;
+    void SetTextStyle(int style) override;
+    void SetImportSimplifyTolerance(qreal tolerance) override;
+    void SetCompactStorage(bool enabled) override;
 
 public slots:
+    /**
+     * @brief ImageOptChangedHandler 加载(1)/保存(2)/清除(3)图片，开启(4)/关闭(5)卡尺测量，开启(6)/关闭(7)圆拟合、模板匹配(8)。
+     */
     void ImageOptChangedHandler(int optMode);
+    /**
+     * @brief AnnotationOptChangedHandler 导入(1)/导出(2)标注、导出矢量图(3)、简化选中的图形(4)、
+     * 选中图形的并集(5)/交集(6)/差集(7)、重叠检查(8)/清除重叠标记(9)，图片窗口显示时作用于图片窗口。
+     */
+    void AnnotationOptChangedHandler(int optMode);
 
 protected:
-    void paintEvent(QPaintEvent *event) override;
-    void wheelEvent(QWheelEvent *event) override;
     void resizeEvent(QResizeEvent *event) override;
     void mouseMoveEvent(QMouseEvent *e) override;
 
 private:
     PaintImage *_paintImage;
+    /**
+     * @brief 图片窗口的卡尺测量、圆拟合开关，图片窗口创建时设置。
+     */
+    bool _caliperEnabled;
+    bool _circleFitEnabled;
     QLabel *_curPosLabel;
+    QLabel *_measureLabel;
     void updateXYCoordinateText();
+    /**
+     * @brief updateMeasureText 显示绘制中或选中图形的测量值，没有时显示所有图形的统计量。
+     */
+    void updateMeasureText();
 };
 
 class PaintAreaMainWrapper : public QWidget
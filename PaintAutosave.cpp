@@ -0,0 +1,473 @@
+#include "PaintAutosave.h"
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QDataStream>
+#include <QMutexLocker>
+#include <QDebug>
+
+#if defined(Q_OS_WIN)
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace
+{
+const quint32 SnapshotMagic = 0x5045534E;
+const quint32 JournalMagic = 0x5045534A;
+const int SnapshotHeaderSize = 12;
+const int JournalHeaderSize = 8;
+
+/**
+ * @brief syncFile 将文件的内容写入磁盘。
+ */
+bool syncFile(QFileDevice &file)
+{
+    if (!file.flush())
+    {
+        return false;
+    }
+
+#if defined(Q_OS_WIN)
+    return ::_commit(file.handle()) == 0;
+#else
+    return ::fsync(file.handle()) == 0;
+#endif
+}
+
+void writeShape(QDataStream &stream, const PaintAutosave::Record &record)
+{
+    stream << quint64(record.id) << qint32(record.type) << record.points << quint64(record.layerId)
+           << double(record.zOrder) << record.text << qint32(record.textStyle);
+}
+
+bool readShape(QDataStream &stream, PaintAutosave::Record &record)
+{
+    quint64 id = 0;
+    qint32 type = 0;
+    QVector<QPoint> points;
+    quint64 layerId = 0;
+    double zOrder = 0.0;
+    QString text;
+    qint32 textStyle = 0;
+
+    stream >> id >> type >> points >> layerId >> zOrder >> text >> textStyle;
+    if (stream.status() != QDataStream::Ok)
+    {
+        return false;
+    }
+
+    record.id = id;
+    record.type = static_cast<EPaintType>(type);
+    record.points = points;
+    record.layerId = layerId;
+    record.zOrder = zOrder;
+    record.text = text;
+    record.textStyle = textStyle;
+    return true;
+}
+}
+
+PaintAutosave::PaintAutosave(const QString &dirPath, const QString &name, QObject *parent) : QThread(parent)
+  , _stopRequested(false)
+  , _journalBytes(0)
+{
+    QDir().mkpath(dirPath);
+    _journalPath = QDir(dirPath).filePath(name + ".journal");
+    _snapshotPath = QDir(dirPath).filePath(name + ".snapshot");
+}
+
+PaintAutosave::~PaintAutosave()
+{
+    if (this->isRunning())
+    {
+        Stop(false);
+    }
+}
+
+bool PaintAutosave::HasRecoveryData() const
+{
+    return (QFileInfo(_journalPath).size() > JournalHeaderSize) || (QFileInfo(_snapshotPath).size() > SnapshotHeaderSize);
+}
+
+QList<PaintAutosave::Record> PaintAutosave::Recover() const
+{
+    QMap<quint64, Record> records;
+
+    readSnapshot(_snapshotPath, records);
+    replayJournal(_journalPath, records);
+
+    return records.values();
+}
+
+void PaintAutosave::Discard()
+{
+    QFile::remove(_journalPath);
+    QFile::remove(_snapshotPath);
+}
+
+void PaintAutosave::AppendUpsert(const QList<GeometryShape *> &shapes)
+{
+    if (shapes.isEmpty())
+    {
+        return;
+    }
+
+    Request request;
+    request.type = ERQT_Upsert;
+    request.records = makeRecords(shapes);
+    enqueue(request);
+}
+
+void PaintAutosave::AppendRemove(const QVector<quint64> &ids)
+{
+    if (ids.isEmpty())
+    {
+        return;
+    }
+
+    Request request;
+    request.type = ERQT_Remove;
+    request.ids = ids;
+    enqueue(request);
+}
+
+void PaintAutosave::WriteSnapshot(const QList<GeometryShape *> &shapes)
+{
+    Request request;
+    request.type = ERQT_Snapshot;
+    request.records = makeRecords(shapes);
+    enqueue(request);
+}
+
+void PaintAutosave::Stop(bool discardFiles)
+{
+    _mutex.lock();
+    _stopRequested = true;
+    _queueCondition.wakeAll();
+    _stopCondition.wakeAll();
+    _mutex.unlock();
+
+    this->wait();
+
+    if (discardFiles)
+    {
+        Discard();
+    }
+}
+
+void PaintAutosave::run()
+{
+    QFile journal(_journalPath);
+    if (!journal.open(QIODevice::ReadWrite | QIODevice::Append))
+    {
+        qCritical() << "Error: PaintAutosave, failed to open journal!" << _journalPath;
+        return;
+    }
+
+    /*
+     * 恢复已在start()之前完成，没有文件头或者版本不同的旧日志直接清空。
+     */
+    journal.seek(0);
+    if (!readJournalHeader(journal))
+    {
+        journal.resize(0);
+        writeJournalHeader(journal);
+    }
+    journal.seek(journal.size());
+
+    forever
+    {
+        QList<Request> batch;
+        bool stop = false;
+
+        _mutex.lock();
+        while (_queue.isEmpty() && !_stopRequested)
+        {
+            _queueCondition.wait(&_mutex);
+        }
+        batch.swap(_queue);
+        stop = _stopRequested;
+        _mutex.unlock();
+
+        if (stop && batch.isEmpty())
+        {
+            break;
+        }
+
+        for (const Request &request : batch)
+        {
+            const QByteArray data = serialize(request);
+            if (request.type != ERQT_Snapshot)
+            {
+                journal.write(data);
+                continue;
+            }
+
+            /*
+             * 快照原子替换成功后才清空日志。即使清空前崩溃，重复回放日志的结果也不变。
+             */
+            QSaveFile snapshot(_snapshotPath);
+            if (snapshot.open(QIODevice::WriteOnly) &&
+                    (snapshot.write(data) == data.size()) &&
+                    syncFile(snapshot) && snapshot.commit())
+            {
+                syncFile(journal);
+                journal.resize(0);
+                writeJournalHeader(journal);
+            }
+            else
+            {
+                qWarning() << "Warn: PaintAutosave, failed to write snapshot!" << _snapshotPath;
+            }
+        }
+
+        if (!syncFile(journal))
+        {
+            qWarning() << "Warn: PaintAutosave, failed to sync journal!" << _journalPath;
+        }
+
+        /*
+         * 落盘后等待一段时间，期间到达的记录合并为一次落盘。
+         */
+        _mutex.lock();
+        if (!_stopRequested)
+        {
+            _stopCondition.wait(&_mutex, SyncInterval);
+        }
+        _mutex.unlock();
+    }
+}
+
+void PaintAutosave::enqueue(const Request &request)
+{
+    if (request.type == ERQT_Snapshot)
+    {
+        _journalBytes = 0;
+    }
+    else
+    {
+        _journalBytes += estimateSize(request);
+    }
+
+    QMutexLocker locker(&_mutex);
+    _queue.append(request);
+    _queueCondition.wakeOne();
+}
+
+QList<PaintAutosave::Record> PaintAutosave::makeRecords(const QList<GeometryShape *> &shapes)
+{
+    QList<Record> records;
+    records.reserve(shapes.count());
+    for (auto item : shapes)
+    {
+        Record record;
+        record.id = item->GetId();
+        record.type = item->GetPaintType();
+        record.points = item->GetGeometry();
+        record.layerId = item->GetLayerId();
+        record.zOrder = item->GetZOrder();
+        record.textStyle = 0;
+        if (item->GetPaintType() == EPaintType::EPT_Text)
+        {
+            const Text *text = static_cast<const Text *>(item);
+            record.text = text->GetText();
+            record.textStyle = text->GetTextStyle();
+        }
+        records.append(record);
+    }
+
+    return records;
+}
+
+qint64 PaintAutosave::estimateSize(const Request &request)
+{
+    /*
+     * 帧头6字节，记录类型与个数5字节；每个图形id、类型、点数、图层、次序键、文本长度、样式共40字节，
+     * 每个点8字节，文本每个字符2字节。
+     */
+    qint64 size = 6 + 5 + qint64(request.ids.count()) * sizeof(quint64);
+    for (const Record &record : request.records)
+    {
+        size += 40 + qint64(record.points.count()) * 8 + qint64(record.text.size()) * 2;
+    }
+
+    return size;
+}
+
+QByteArray PaintAutosave::serialize(const Request &request)
+{
+    QByteArray data;
+    QDataStream stream(&data, QIODevice::WriteOnly);
+    stream.setVersion(QDataStream::Qt_5_0);
+
+    switch (request.type)
+    {
+    case ERQT_Upsert:
+        stream << quint8(ERT_Upsert) << quint32(request.records.count());
+        for (const Record &record : request.records)
+        {
+            writeShape(stream, record);
+        }
+        return frame(data);
+    case ERQT_Remove:
+        stream << quint8(ERT_Remove) << request.ids;
+        return frame(data);
+    case ERQT_Snapshot:
+        stream << SnapshotMagic << FormatVersion << quint32(request.records.count());
+        for (const Record &record : request.records)
+        {
+            writeShape(stream, record);
+        }
+        return data;
+    }
+
+    return data;
+}
+
+QByteArray PaintAutosave::frame(const QByteArray &payload)
+{
+    QByteArray data;
+    QDataStream stream(&data, QIODevice::WriteOnly);
+    stream.setVersion(QDataStream::Qt_5_0);
+    stream << quint32(payload.size()) << quint16(qChecksum(payload.constData(), uint(payload.size())));
+    stream.writeRawData(payload.constData(), payload.size());
+    return data;
+}
+
+bool PaintAutosave::writeJournalHeader(QIODevice &device)
+{
+    QDataStream stream(&device);
+    stream.setVersion(QDataStream::Qt_5_0);
+    stream << JournalMagic << FormatVersion;
+    return stream.status() == QDataStream::Ok;
+}
+
+bool PaintAutosave::readJournalHeader(QIODevice &device)
+{
+    QDataStream stream(&device);
+    stream.setVersion(QDataStream::Qt_5_0);
+
+    quint32 magic = 0;
+    quint32 version = 0;
+    stream >> magic >> version;
+    return (stream.status() == QDataStream::Ok) && (magic == JournalMagic) && (version == FormatVersion);
+}
+
+void PaintAutosave::readSnapshot(const QString &path, QMap<quint64, Record> &records)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly))
+    {
+        return;
+    }
+
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_5_0);
+
+    quint32 magic = 0;
+    quint32 version = 0;
+    quint32 count = 0;
+    stream >> magic >> version >> count;
+    if ((stream.status() != QDataStream::Ok) || (magic != SnapshotMagic))
+    {
+        qWarning() << "Warn: PaintAutosave, invalid snapshot!" << path;
+        return;
+    }
+    if (version != FormatVersion)
+    {
+        qWarning() << "Warn: PaintAutosave, unsupported snapshot version!" << path << version;
+        return;
+    }
+
+    for (quint32 i = 0; i < count; i++)
+    {
+        Record record;
+        if (!readShape(stream, record))
+        {
+            break;
+        }
+        records.insert(record.id, record);
+    }
+}
+
+void PaintAutosave::replayJournal(const QString &path, QMap<quint64, Record> &records)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly))
+    {
+        return;
+    }
+
+    if (!readJournalHeader(file))
+    {
+        if (file.size() > 0)
+        {
+            qWarning() << "Warn: PaintAutosave, unsupported journal version!" << path;
+        }
+        return;
+    }
+
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_5_0);
+
+    /*
+     * 崩溃时最后一条记录可能只写了一部分，遇到不完整或校验错误的记录即停止。
+     */
+    while (!stream.atEnd())
+    {
+        quint32 size = 0;
+        quint16 checksum = 0;
+        stream >> size >> checksum;
+        if ((stream.status() != QDataStream::Ok) || (qint64(size) > (file.size() - file.pos())))
+        {
+            break;
+        }
+
+        QByteArray payload(int(size), Qt::Uninitialized);
+        if ((stream.readRawData(payload.data(), int(size)) != int(size)) ||
+                (qChecksum(payload.constData(), size) != checksum))
+        {
+            qWarning() << "Warn: PaintAutosave, truncated journal record!" << path;
+            break;
+        }
+
+        applyRecord(payload, records);
+    }
+}
+
+void PaintAutosave::applyRecord(const QByteArray &payload, QMap<quint64, Record> &records)
+{
+    QDataStream stream(payload);
+    stream.setVersion(QDataStream::Qt_5_0);
+
+    quint8 type = 0;
+    stream >> type;
+
+    if (type == ERT_Upsert)
+    {
+        quint32 count = 0;
+        stream >> count;
+        for (quint32 i = 0; i < count; i++)
+        {
+            Record record;
+            if (!readShape(stream, record))
+            {
+                break;
+            }
+            records.insert(record.id, record);
+        }
+    }
+    else if (type == ERT_Remove)
+    {
+        QVector<quint64> ids;
+        stream >> ids;
+        for (auto id : ids)
+        {
+            records.remove(id);
+        }
+    }
+}
@@ -0,0 +1,148 @@
+#ifndef PAINTAUTOSAVE_H
+#define PAINTAUTOSAVE_H
+
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QByteArray>
+#include <QList>
+#include <QMap>
+#include <QVector>
+#include <QPoint>
+#include <QString>
+
+#include "Types.h"
+#include "GeometryShape.h"
+
+/**
+ * @brief The PaintAutosave class 自动保存：后台线程追加写日志，崩溃后可恢复。
+ * @details
+ * - 日志以文件头（魔数、格式版本）开始，之后为记录，每条记录为：长度(quint32) + 校验(quint16) + 内容。
+ *   内容为“图形id现在的几何”或“图形id已删除”，重复回放结果不变。
+ * - GUI线程只复制图形的id、类型、控制点、图层、次序键和文本（隐式共享），序列化、写文件、落盘（fsync）在后台线程，
+ *   每SyncInterval毫秒最多落盘一次。
+ * - 日志（按记录估算的大小）超过CompactThreshold字节后，写一次全量快照（原子替换），并清空日志。
+ * - 恢复：读取快照，再回放日志；日志末尾不完整、校验错误的记录被忽略。
+ *   快照、日志的格式版本与FormatVersion不同时（旧版本写的文件）整个忽略。
+ */
+class PaintAutosave : public QThread
+{
+    Q_OBJECT
+public:
+    constexpr static int SyncInterval = 200;
+    constexpr static qint64 CompactThreshold = 8 * 1024 * 1024;
+    constexpr static quint32 FormatVersion = 3;
+
+    /**
+     * @brief The Record struct 一个图形的记录：控制点以及所在图层的id和图层内的次序键（GeometryShape::GetZOrder()）。
+     * 文本标注另记录内容和样式（ETextStyle的组合），其他图形为空、0。
+     */
+    struct Record
+    {
+        quint64 id;
+        EPaintType type;
+        QVector<QPoint> points;
+        quint64 layerId;
+        qreal zOrder;
+        QString text;
+        int textStyle;
+    };
+
+    PaintAutosave(const QString &dirPath, const QString &name, QObject *parent = nullptr);
+    ~PaintAutosave();
+
+    /**
+     * @brief HasRecoveryData 上次是否未正常退出，留下了可恢复的数据。
+     */
+    bool HasRecoveryData() const;
+    /**
+     * @brief Recover 读取快照并回放日志，需在start()之前调用。
+     * @return 恢复出的图形，按id排序；按次序键排序后依次加入图层即为原来的绘制顺序。
+     */
+    QList<Record> Recover() const;
+    /**
+     * @brief Discard 删除快照和日志，需在start()之前调用。
+     */
+    void Discard();
+
+    /**
+     * @brief AppendUpsert 记录图形当前的几何（新建或修改），一批图形为一条记录。
+     */
+    void AppendUpsert(const QList<GeometryShape *> &shapes);
+    /**
+     * @brief AppendRemove 记录图形已删除。
+     */
+    void AppendRemove(const QVector<quint64> &ids);
+    /**
+     * @brief WriteSnapshot 写全量快照，之后清空日志。
+     */
+    void WriteSnapshot(const QList<GeometryShape *> &shapes);
+    /**
+     * @brief NeedsSnapshot 自上次快照以来，日志是否已超过CompactThreshold字节。
+     */
+    bool NeedsSnapshot() const
+    {
+        return _journalBytes > CompactThreshold;
+    }
+    /**
+     * @brief Stop 写完队列中的数据后停止后台线程。
+     * @param discardFiles 是否删除快照和日志（正常退出时不需要恢复）。
+     */
+    void Stop(bool discardFiles);
+
+protected:
+    void run() override;
+
+private:
+    enum ERecordType
+    {
+        ERT_Upsert = 1,
+        ERT_Remove,
+    };
+
+    enum ERequestType
+    {
+        ERQT_Upsert,
+        ERQT_Remove,
+        ERQT_Snapshot,
+    };
+
+    /**
+     * @brief The Request struct 待写入的一条记录，由后台线程序列化。
+     */
+    struct Request
+    {
+        ERequestType type;
+        QList<Record> records;
+        QVector<quint64> ids;
+    };
+
+    QString _journalPath;
+    QString _snapshotPath;
+
+    QMutex _mutex;
+    QWaitCondition _queueCondition;
+    QWaitCondition _stopCondition;
+    QList<Request> _queue;
+    bool _stopRequested;
+    qint64 _journalBytes;
+
+    void enqueue(const Request &request);
+    static QList<Record> makeRecords(const QList<GeometryShape *> &shapes);
+    /**
+     * @brief estimateSize 记录序列化后的大致字节数，用于在GUI线程判断是否需要快照。
+     */
+    static qint64 estimateSize(const Request &request);
+    static QByteArray serialize(const Request &request);
+    static QByteArray frame(const QByteArray &payload);
+    /**
+     * @brief writeJournalHeader、readJournalHeader 日志的文件头，版本不同时read返回false。
+     */
+    static bool writeJournalHeader(QIODevice &device);
+    static bool readJournalHeader(QIODevice &device);
+    static void readSnapshot(const QString &path, QMap<quint64, Record> &records);
+    static void replayJournal(const QString &path, QMap<quint64, Record> &records);
+    static void applyRecord(const QByteArray &payload, QMap<quint64, Record> &records);
+};
+
+#endif // PAINTAUTOSAVE_H
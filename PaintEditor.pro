@@ -1,6 +1,6 @@
 QT       += core gui
 
-greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
+greaterThan(QT_MAJOR_VERSION, 4): QT += widgets concurrent
 
 CONFIG += c++11
 
@@ -16,27 +16,74 @@ DEFINES += QT_DEPRECATED_WARNINGS
 #DEFINES += QT_DISABLE_DEPRECATED_BEFORE=0x060000    # disables all the APIs deprecated before Qt 6.0.0
 
 SOURCES += \
+    AnnotationIO.cpp \
+    CircleFitter.cpp \
+    CompactPolygon.cpp \
+    EdgeCaliper.cpp \
+    FloodFill.cpp \
     GeometryShape.cpp \
+    ImageExport.cpp \
+    ImagePyramid.cpp \
+    ImageSampler.cpp \
+    OverlapDetector.cpp \
     PaintArea.cpp \
     PaintAreaMain.cpp \
+    PaintAutosave.cpp \
+    PaintHistory.cpp \
     PaintImage.cpp \
+    PaintLayer.cpp \
+    PaintLayerPanel.cpp \
     PaintPanel.cpp \
     PaintToolbar.cpp \
+    PolygonSimplifier.cpp \
+    ProfilePlot.cpp \
+    RoiStatistics.cpp \
+    ShapeBoolean.cpp \
+    ShapeGrid.cpp \
+    SnapIndex.cpp \
+    TemplateMatcher.cpp \
+    VectorExport.cpp \
     main.cpp \
     mainwindow.cpp
 
 HEADERS += \
+    AnnotationIO.h \
+    CircleFitter.h \
+    CompactPolygon.h \
+    EdgeCaliper.h \
+    FloodFill.h \
     GeometryShape.h \
+    ImageExport.h \
+    ImagePyramid.h \
+    ImageSampler.h \
+    OverlapDetector.h \
     PaintArea.h \
     PaintAreaMain.h \
+    PaintAutosave.h \
+    PaintHistory.h \
     PaintImage.h \
+    PaintLayer.h \
+    PaintLayerPanel.h \
     PaintPanel.h \
     PaintToolbar.h \
+    PolygonSimplifier.h \
+    ProfilePlot.h \
+    RoiStatistics.h \
+    ShapeBoolean.h \
+    ShapeGrid.h \
+    SnapIndex.h \
+    TemplateMatcher.h \
     Types.h \
+    VectorExport.h \
     mainwindow.h
 
 FORMS +=
 
+# PNG export uses zlib: the copy bundled with (and exported by) QtCore on Windows,
+# the system zlib elsewhere.
+win32: INCLUDEPATH += $$[QT_INSTALL_HEADERS]/QtZlib
+else: LIBS += -lz
+
 msvc{
     QMAKE_CFLAGS += /utf-8
     QMAKE_CXXFLAGS += /utf-8
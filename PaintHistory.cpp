@@ -0,0 +1,425 @@
+#include "PaintHistory.h"
+
+#include <algorithm>
+
+CreateShapesCommand::CreateShapesCommand(const QList<GeometryShape *> &shapes) : _shapes(shapes)
+{
+}
+
+void CreateShapesCommand::Undo(PaintShapeStore *store)
+{
+    for (auto item : _shapes)
+    {
+        store->RemoveShape(item);
+    }
+}
+
+void CreateShapesCommand::Redo(PaintShapeStore *store)
+{
+    for (auto item : _shapes)
+    {
+        store->InsertShape(item);
+    }
+}
+
+qint64 CreateShapesCommand::Cost() const
+{
+    return sizeof(*this) + _shapes.count() * sizeof(GeometryShape *);
+}
+
+void CreateShapesCommand::Release(bool applied)
+{
+    if (!applied)
+    {
+        qDeleteAll(_shapes);
+    }
+
+    _shapes.clear();
+}
+
+DeleteShapesCommand::DeleteShapesCommand(const QList<GeometryShape *> &shapes) : _shapes(shapes)
+{
+}
+
+void DeleteShapesCommand::Undo(PaintShapeStore *store)
+{
+    for (auto item : _shapes)
+    {
+        store->InsertShape(item);
+    }
+}
+
+void DeleteShapesCommand::Redo(PaintShapeStore *store)
+{
+    for (auto item : _shapes)
+    {
+        store->RemoveShape(item);
+    }
+}
+
+qint64 DeleteShapesCommand::Cost() const
+{
+    return sizeof(*this) + _shapes.count() * sizeof(GeometryShape *);
+}
+
+void DeleteShapesCommand::Release(bool applied)
+{
+    if (applied)
+    {
+        qDeleteAll(_shapes);
+    }
+
+    _shapes.clear();
+}
+
+ReplaceShapesCommand::ReplaceShapesCommand(const QList<GeometryShape *> &removedShapes,
+                                           const QList<GeometryShape *> &createdShapes) : _removedShapes(removedShapes)
+  , _createdShapes(createdShapes)
+{
+}
+
+void ReplaceShapesCommand::Undo(PaintShapeStore *store)
+{
+    for (auto item : _createdShapes)
+    {
+        store->RemoveShape(item);
+    }
+    for (auto item : _removedShapes)
+    {
+        store->InsertShape(item);
+    }
+}
+
+void ReplaceShapesCommand::Redo(PaintShapeStore *store)
+{
+    for (auto item : _removedShapes)
+    {
+        store->RemoveShape(item);
+    }
+    for (auto item : _createdShapes)
+    {
+        store->InsertShape(item);
+    }
+}
+
+qint64 ReplaceShapesCommand::Cost() const
+{
+    return sizeof(*this) + (_removedShapes.count() + _createdShapes.count()) * sizeof(GeometryShape *);
+}
+
+void ReplaceShapesCommand::Release(bool applied)
+{
+    if (applied)
+    {
+        qDeleteAll(_removedShapes);
+    }
+    else
+    {
+        qDeleteAll(_createdShapes);
+    }
+
+    _removedShapes.clear();
+    _createdShapes.clear();
+}
+
+MoveShapesCommand::MoveShapesCommand(const QList<GeometryShape *> &shapes, const QPoint &offset) : _shapes(shapes)
+  , _offset(offset)
+{
+}
+
+void MoveShapesCommand::Undo(PaintShapeStore *store)
+{
+    for (auto item : _shapes)
+    {
+        item->Translate(-_offset);
+        store->ShapeChanged(item);
+    }
+}
+
+void MoveShapesCommand::Redo(PaintShapeStore *store)
+{
+    for (auto item : _shapes)
+    {
+        item->Translate(_offset);
+        store->ShapeChanged(item);
+    }
+}
+
+qint64 MoveShapesCommand::Cost() const
+{
+    return sizeof(*this) + _shapes.count() * sizeof(GeometryShape *);
+}
+
+ReshapeCommand::ReshapeCommand(GeometryShape *shape, const QVector<QPoint> &oldGeometry, const QVector<QPoint> &newGeometry) : _shape(shape)
+  , _oldGeometry(oldGeometry)
+  , _newGeometry(newGeometry)
+{
+}
+
+void ReshapeCommand::Undo(PaintShapeStore *store)
+{
+    _shape->SetGeometry(_oldGeometry);
+    store->ShapeChanged(_shape);
+}
+
+void ReshapeCommand::Redo(PaintShapeStore *store)
+{
+    _shape->SetGeometry(_newGeometry);
+    store->ShapeChanged(_shape);
+}
+
+qint64 ReshapeCommand::Cost() const
+{
+    return sizeof(*this) + (_oldGeometry.count() + _newGeometry.count()) * sizeof(QPoint);
+}
+
+ReshapeShapesCommand::ReshapeShapesCommand(const QList<GeometryShape *> &shapes, const QVector<QVector<QPoint>> &oldGeometries,
+                                           const QVector<QVector<QPoint>> &newGeometries) : _shapes(shapes)
+  , _oldGeometries(oldGeometries)
+  , _newGeometries(newGeometries)
+{
+}
+
+void ReshapeShapesCommand::Undo(PaintShapeStore *store)
+{
+    for (int i = 0; i < _shapes.count(); i++)
+    {
+        _shapes.at(i)->SetGeometry(_oldGeometries.at(i));
+        store->ShapeChanged(_shapes.at(i));
+    }
+}
+
+void ReshapeShapesCommand::Redo(PaintShapeStore *store)
+{
+    for (int i = 0; i < _shapes.count(); i++)
+    {
+        _shapes.at(i)->SetGeometry(_newGeometries.at(i));
+        store->ShapeChanged(_shapes.at(i));
+    }
+}
+
+qint64 ReshapeShapesCommand::Cost() const
+{
+    qint64 cost = sizeof(*this) + _shapes.count() * sizeof(GeometryShape *);
+    for (int i = 0; i < _shapes.count(); i++)
+    {
+        cost += (_oldGeometries.at(i).count() + _newGeometries.at(i).count()) * sizeof(QPoint);
+    }
+
+    return cost;
+}
+
+TextStyleCommand::TextStyleCommand(const QList<Text *> &texts, const QVector<int> &oldStyles, int newStyle) : _texts(texts)
+  , _oldStyles(oldStyles)
+  , _newStyle(newStyle)
+{
+}
+
+void TextStyleCommand::Undo(PaintShapeStore *store)
+{
+    for (int i = 0; i < _texts.count(); i++)
+    {
+        _texts.at(i)->SetTextStyle(_oldStyles.at(i));
+        store->ShapeChanged(_texts.at(i));
+    }
+}
+
+void TextStyleCommand::Redo(PaintShapeStore *store)
+{
+    for (auto text : _texts)
+    {
+        text->SetTextStyle(_newStyle);
+        store->ShapeChanged(text);
+    }
+}
+
+qint64 TextStyleCommand::Cost() const
+{
+    return sizeof(*this) + _texts.count() * (sizeof(Text *) + sizeof(int));
+}
+
+ArrangeShapesCommand::ArrangeShapesCommand(const QList<GeometryShape *> &shapes,
+                                           const QVector<ShapePlacement> &oldPlacements,
+                                           const QVector<ShapePlacement> &newPlacements) : _shapes(shapes)
+  , _oldPlacements(oldPlacements)
+  , _newPlacements(newPlacements)
+{
+}
+
+void ArrangeShapesCommand::Undo(PaintShapeStore *store)
+{
+    store->ArrangeShapes(_shapes, _oldPlacements);
+}
+
+void ArrangeShapesCommand::Redo(PaintShapeStore *store)
+{
+    store->ArrangeShapes(_shapes, _newPlacements);
+}
+
+qint64 ArrangeShapesCommand::Cost() const
+{
+    return sizeof(*this) + _shapes.count() * (sizeof(GeometryShape *) + 2 * sizeof(ShapePlacement));
+}
+
+FillCommand::FillCommand(const QSharedPointer<QImage> &overlay, const QVector<FillSpan> &spans, QRgb color) : _overlay(overlay)
+  , _spans(spans)
+  , _color(color)
+{
+    for (const FillSpan &span : _spans)
+    {
+        _boundingRect |= QRect(span.left, span.y, span.right - span.left + 1, 1);
+
+        const QRgb *row = reinterpret_cast<const QRgb *>(_overlay->constScanLine(span.y));
+        for (int x = span.left; x <= span.right; x++)
+        {
+            if (!_runColors.isEmpty() && (_runColors.last() == row[x]))
+            {
+                _runLengths.last()++;
+            }
+            else
+            {
+                _runColors.append(row[x]);
+                _runLengths.append(1);
+            }
+        }
+    }
+}
+
+void FillCommand::Undo(PaintShapeStore *store)
+{
+    int run = 0;
+    int remaining = _runLengths.isEmpty() ? 0 : _runLengths.first();
+    for (const FillSpan &span : _spans)
+    {
+        QRgb *row = reinterpret_cast<QRgb *>(_overlay->scanLine(span.y));
+        for (int x = span.left; x <= span.right; x++)
+        {
+            if (remaining == 0)
+            {
+                run++;
+                remaining = _runLengths.at(run);
+            }
+            row[x] = _runColors.at(run);
+            remaining--;
+        }
+    }
+
+    store->BackgroundChanged(_boundingRect);
+}
+
+void FillCommand::Redo(PaintShapeStore *store)
+{
+    for (const FillSpan &span : _spans)
+    {
+        QRgb *row = reinterpret_cast<QRgb *>(_overlay->scanLine(span.y));
+        std::fill(row + span.left, row + span.right + 1, _color);
+    }
+
+    store->BackgroundChanged(_boundingRect);
+}
+
+qint64 FillCommand::Cost() const
+{
+    return sizeof(*this) + _spans.count() * sizeof(FillSpan) + _runColors.count() * (sizeof(QRgb) + sizeof(int));
+}
+
+PaintHistory::PaintHistory() : _index(0)
+  , _cost(0)
+  , _memoryLimit(DefaultMemoryLimit)
+{
+}
+
+PaintHistory::~PaintHistory()
+{
+    Clear();
+}
+
+void PaintHistory::Push(PaintCommand *command)
+{
+    /*
+     * 丢弃可重做的命令。
+     */
+    while (_commands.count() > _index)
+    {
+        PaintCommand *item = _commands.takeLast();
+        _cost -= item->Cost();
+        item->Release(false);
+        delete item;
+    }
+
+    _commands.append(command);
+    _cost += command->Cost();
+    _index = _commands.count();
+
+    trim();
+}
+
+bool PaintHistory::Undo(PaintShapeStore *store)
+{
+    if (!CanUndo())
+    {
+        return false;
+    }
+
+    _index--;
+    _commands.at(_index)->Undo(store);
+    return true;
+}
+
+bool PaintHistory::Redo(PaintShapeStore *store)
+{
+    if (!CanRedo())
+    {
+        return false;
+    }
+
+    _commands.at(_index)->Redo(store);
+    _index++;
+    return true;
+}
+
+void PaintHistory::Clear()
+{
+    for (int i = 0; i < _commands.count(); i++)
+    {
+        _commands.at(i)->Release(i < _index);
+        delete _commands.at(i);
+    }
+
+    _commands.clear();
+    _index = 0;
+    _cost = 0;
+}
+
+void PaintHistory::SetMemoryLimit(qint64 bytes)
+{
+    _memoryLimit = bytes;
+    trim();
+}
+
+void PaintHistory::trim()
+{
+    /*
+     * 先从末尾丢弃可重做的命令：后面的命令依赖前面命令的结果，丢弃末尾的命令不会使其它命令失效，
+     * 从头部丢弃未执行的命令则会释放可重做命令仍要用到的图形。
+     */
+    while ((_cost > _memoryLimit) && (_commands.count() > _index))
+    {
+        PaintCommand *item = _commands.takeLast();
+        _cost -= item->Cost();
+        item->Release(false);
+        delete item;
+    }
+
+    /*
+     * 再从最早的已执行命令开始丢弃，至少保留最近的一条命令。
+     */
+    while ((_cost > _memoryLimit) && (_index > 1))
+    {
+        PaintCommand *item = _commands.takeFirst();
+        _cost -= item->Cost();
+        item->Release(true);
+        delete item;
+        _index--;
+    }
+}
@@ -0,0 +1,282 @@
+#ifndef PAINTHISTORY_H
+#define PAINTHISTORY_H
+
+#include <QList>
+#include <QVector>
+#include <QPoint>
+#include <QImage>
+#include <QSharedPointer>
+
+#include "GeometryShape.h"
+#include "FloodFill.h"
+
+/**
+ * @brief The ShapePlacement struct 图形在绘图区域中的位置：所在图层的id及其在图层内的序号（从下往上）。
+ */
+struct ShapePlacement
+{
+    quint64 layerId;
+    int index;
+};
+
+/**
+ * @brief The PaintShapeStore class 图形的容器，由绘图区域实现。
+ * @details 撤销/重做通过它增删、修改图形，绘图区域借此维护选中列表等状态。
+ */
+class PaintShapeStore
+{
+public:
+    virtual ~PaintShapeStore() {}
+    virtual void InsertShape(GeometryShape *shape) = 0;
+    virtual void RemoveShape(GeometryShape *shape) = 0;
+    /**
+     * @brief ShapeChanged 图形的几何发生了变化（移动、改变大小等）。
+     */
+    virtual void ShapeChanged(GeometryShape *shape) = 0;
+    /**
+     * @brief ArrangeShapes 把图形移到指定的图层和序号（调整绘制顺序、移到其它图层）。
+     * @details 先从原图层取出所有图形，再按序号从小到大插入，其它图形的相对顺序不变。
+     */
+    virtual void ArrangeShapes(const QList<GeometryShape *> &shapes, const QVector<ShapePlacement> &placements) = 0;
+    /**
+     * @brief BackgroundChanged 背景的填充覆盖层在rect（像素坐标）内发生了变化。
+     */
+    virtual void BackgroundChanged(const QRect &rect) = 0;
+};
+
+/**
+ * @brief The PaintCommand class 一条已执行的编辑操作。
+ * @details 命令只记录增量（图形指针、平移量、改变前后的控制点），不复制图形。
+ */
+class PaintCommand
+{
+public:
+    virtual ~PaintCommand() {}
+    virtual void Undo(PaintShapeStore *store) = 0;
+    virtual void Redo(PaintShapeStore *store) = 0;
+    /**
+     * @brief Cost 命令自身占用的内存（字节），用于限制历史记录的大小。
+     */
+    virtual qint64 Cost() const = 0;
+    /**
+     * @brief Release 命令被丢弃前调用，释放只被命令持有的图形。
+     * @param applied 命令当前是否处于已执行状态。
+     */
+    virtual void Release(bool applied)
+    {
+        Q_UNUSED(applied)
+    }
+};
+
+/**
+ * @brief The CreateShapesCommand class 新建图形。未执行（被撤销）时，图形由命令持有。
+ */
+class CreateShapesCommand : public PaintCommand
+{
+public:
+    explicit CreateShapesCommand(const QList<GeometryShape *> &shapes);
+    void Undo(PaintShapeStore *store) override;
+    void Redo(PaintShapeStore *store) override;
+    qint64 Cost() const override;
+    void Release(bool applied) override;
+
+private:
+    QList<GeometryShape *> _shapes;
+};
+
+/**
+ * @brief The DeleteShapesCommand class 删除图形。已执行时，图形由命令持有。
+ */
+class DeleteShapesCommand : public PaintCommand
+{
+public:
+    explicit DeleteShapesCommand(const QList<GeometryShape *> &shapes);
+    void Undo(PaintShapeStore *store) override;
+    void Redo(PaintShapeStore *store) override;
+    qint64 Cost() const override;
+    void Release(bool applied) override;
+
+private:
+    QList<GeometryShape *> _shapes;
+};
+
+/**
+ * @brief The ReplaceShapesCommand class 用新图形替换原图形（布尔运算等）。
+ * 已执行时原图形由命令持有，未执行时新图形由命令持有。
+ */
+class ReplaceShapesCommand : public PaintCommand
+{
+public:
+    ReplaceShapesCommand(const QList<GeometryShape *> &removedShapes, const QList<GeometryShape *> &createdShapes);
+    void Undo(PaintShapeStore *store) override;
+    void Redo(PaintShapeStore *store) override;
+    qint64 Cost() const override;
+    void Release(bool applied) override;
+
+private:
+    QList<GeometryShape *> _removedShapes;
+    QList<GeometryShape *> _createdShapes;
+};
+
+/**
+ * @brief The MoveShapesCommand class 平移图形，所有图形共用一个平移量。
+ */
+class MoveShapesCommand : public PaintCommand
+{
+public:
+    MoveShapesCommand(const QList<GeometryShape *> &shapes, const QPoint &offset);
+    void Undo(PaintShapeStore *store) override;
+    void Redo(PaintShapeStore *store) override;
+    qint64 Cost() const override;
+
+private:
+    QList<GeometryShape *> _shapes;
+    QPoint _offset;
+};
+
+/**
+ * @brief The ReshapeCommand class 改变单个图形的控制点（拖拽改变大小等）。
+ */
+class ReshapeCommand : public PaintCommand
+{
+public:
+    ReshapeCommand(GeometryShape *shape, const QVector<QPoint> &oldGeometry, const QVector<QPoint> &newGeometry);
+    void Undo(PaintShapeStore *store) override;
+    void Redo(PaintShapeStore *store) override;
+    qint64 Cost() const override;
+
+private:
+    GeometryShape *_shape;
+    QVector<QPoint> _oldGeometry;
+    QVector<QPoint> _newGeometry;
+};
+
+/**
+ * @brief The ReshapeShapesCommand class 同时改变多个图形的控制点（简化顶点等），记为一条历史记录。
+ */
+class ReshapeShapesCommand : public PaintCommand
+{
+public:
+    ReshapeShapesCommand(const QList<GeometryShape *> &shapes, const QVector<QVector<QPoint>> &oldGeometries,
+                         const QVector<QVector<QPoint>> &newGeometries);
+    void Undo(PaintShapeStore *store) override;
+    void Redo(PaintShapeStore *store) override;
+    qint64 Cost() const override;
+
+private:
+    QList<GeometryShape *> _shapes;
+    QVector<QVector<QPoint>> _oldGeometries;
+    QVector<QVector<QPoint>> _newGeometries;
+};
+
+/**
+ * @brief The TextStyleCommand class 改变文本的样式（ETextStyle的组合），记录每个文本前后的样式。
+ */
+class TextStyleCommand : public PaintCommand
+{
+public:
+    TextStyleCommand(const QList<Text *> &texts, const QVector<int> &oldStyles, int newStyle);
+    void Undo(PaintShapeStore *store) override;
+    void Redo(PaintShapeStore *store) override;
+    qint64 Cost() const override;
+
+private:
+    QList<Text *> _texts;
+    QVector<int> _oldStyles;
+    int _newStyle;
+};
+
+/**
+ * @brief The ArrangeShapesCommand class 调整图形的绘制顺序或者移到其它图层，记录前后的位置。
+ */
+class ArrangeShapesCommand : public PaintCommand
+{
+public:
+    ArrangeShapesCommand(const QList<GeometryShape *> &shapes, const QVector<ShapePlacement> &oldPlacements,
+                         const QVector<ShapePlacement> &newPlacements);
+    void Undo(PaintShapeStore *store) override;
+    void Redo(PaintShapeStore *store) override;
+    qint64 Cost() const override;
+
+private:
+    QList<GeometryShape *> _shapes;
+    QVector<ShapePlacement> _oldPlacements;
+    QVector<ShapePlacement> _newPlacements;
+};
+
+/**
+ * @brief The FillCommand class 油漆桶：把填充覆盖层（ARGB32）中的行段填充为同一颜色。
+ * @details
+ * - 构造时按行段顺序以游程编码记录原来的像素（多为透明或者少数几种颜色），不保存整块图片。
+ * - 命令共享覆盖层；更换背景图后覆盖层随之更换，旧的命令只修改已不显示的覆盖层。
+ */
+class FillCommand : public PaintCommand
+{
+public:
+    FillCommand(const QSharedPointer<QImage> &overlay, const QVector<FillSpan> &spans, QRgb color);
+    void Undo(PaintShapeStore *store) override;
+    void Redo(PaintShapeStore *store) override;
+    qint64 Cost() const override;
+
+private:
+    QSharedPointer<QImage> _overlay;
+    QVector<FillSpan> _spans;
+    QRgb _color;
+    QVector<QRgb> _runColors;
+    QVector<int> _runLengths;
+    QRect _boundingRect;
+};
+
+/**
+ * @brief The PaintHistory class 撤销/重做的历史记录。
+ * @details
+ * - 命令按执行顺序保存，_index之前的命令处于已执行状态。
+ * - 新命令加入时丢弃可重做的命令。
+ * - 命令的总大小超过内存上限时，先从末尾丢弃可重做的命令，再从最早的已执行命令开始丢弃。
+ */
+class PaintHistory
+{
+public:
+    constexpr static qint64 DefaultMemoryLimit = 16 * 1024 * 1024;
+
+    PaintHistory();
+    ~PaintHistory();
+    PaintHistory(const PaintHistory&) = delete;
+    PaintHistory &operator=(const PaintHistory&) = delete;
+
+    /**
+     * @brief Push 记录一条已执行的命令，历史记录接管命令。
+     */
+    void Push(PaintCommand *command);
+    bool Undo(PaintShapeStore *store);
+    bool Redo(PaintShapeStore *store);
+    void Clear();
+
+    bool CanUndo() const
+    {
+        return _index > 0;
+    }
+    bool CanRedo() const
+    {
+        return _index < _commands.count();
+    }
+    void SetMemoryLimit(qint64 bytes);
+    qint64 GetMemoryLimit() const
+    {
+        return _memoryLimit;
+    }
+    qint64 GetCost() const
+    {
+        return _cost;
+    }
+
+private:
+    QList<PaintCommand *> _commands;
+    int _index;
+    qint64 _cost;
+    qint64 _memoryLimit;
+
+    void trim();
+};
+
+#endif // PAINTHISTORY_H
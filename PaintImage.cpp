@@ -4,31 +4,233 @@
 #include <QApplication>
 #include <QWheelEvent>
 #include <QDebug>
+#include <QMessageBox>
+#include <QProgressDialog>
+#include <QFutureWatcher>
+#include <QFileInfo>
+#include <QResizeEvent>
+#include <QPainter>
+#include <QtMath>
+#include <QInputDialog>
+#include <QtConcurrent/QtConcurrentRun>
 
-PaintImage::PaintImage(QGraphicsScene *scene, QWidget *parent) : PaintArea(scene, parent), _saveEnabled(false)
+
+PaintImageItem::PaintImageItem(const QPixmap &pixmap, QGraphicsItem *parent) : QGraphicsPixmapItem(pixmap, parent)
+{
+}
+
+void PaintImageItem::paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget *widget)
+{
+    Q_UNUSED(option)
+    bool smooth = true;
+
+    /*
+     * widget为视图的视口。
+     */
+    PaintArea *view = (widget != nullptr) ? qobject_cast<PaintArea *>(widget->parentWidget()) : nullptr;
+    if (view != nullptr)
+    {
+        smooth = (view->GetRenderQuality() == PaintArea::ERenderQuality::ERQ_High);
+    }
+
+    painter->setRenderHint(QPainter::SmoothPixmapTransform, smooth);
+    painter->drawPixmap(this->offset(), this->pixmap());
+}
+
+PaintImage::PaintImage(QGraphicsScene *scene, QWidget *parent) : PaintArea(scene, parent)
+  , _imageItem(nullptr)
+  , _fillItem(nullptr)
+  , _profileLevel(0)
+  , _roiType(EPaintType::EPT_None)
+  , _caliperEnabled(false)
+  , _caliperIndex(-1)
+  , _circleFitEnabled(false)
+  , _fitPendingId(0)
 {
-    _image = new QImage();
+    _profilePlot = new ProfilePlot(this);
+    _profilePlot->resize(ProfilePlotWidth, ProfilePlotHeight);
+    _profilePlot->hide();
+
+    _roiLabel = new QLabel(this);
+    _roiLabel->move(10, 10);
+    _roiLabel->setStyleSheet("background-color:rgba(255,255,255,200);color:black;padding:4px;");
+    _roiLabel->setAttribute(Qt::WA_TransparentForMouseEvents);
+    _roiLabel->hide();
+
+    /*
+     * 绘制、拖拽改变大小、选中、撤销等都会触发measureChanged；移动不改变测量值，在mouseMoveEvent()中更新。
+     */
+    connect(this, &PaintArea::measureChanged, this, &PaintImage::updateImageMeasure);
+
+    _fitWatcher = new QFutureWatcher<CircleFitJob>(this);
+    connect(_fitWatcher, &QFutureWatcher<CircleFitJob>::finished, this, &PaintImage::finishCircleFit);
 }
 
 PaintImage::~PaintImage()
 {
-    delete _image;
 }
 
-void PaintImage::LoadImage()
+bool PaintImage::LoadImage(const QString &path)
 {
-//    QString path = QFileDialog::getOpenFileName(nullptr, "选择图片", "", "Images (*.png *.xpm *.jpg);;All Files (*)");
-//    _image->load(path);
-//    this->resize(_image->width(), _image->height());
+    QImage image;
+    if (!image.load(path))
+    {
+        qWarning() << "Warn: PaintImage::LoadImage(), failed to load!" << path;
+        return false;
+    }
+
+    _image = image;
+    _imagePath = path;
+    _fillOverlay.reset();
+    _fillComposite = QImage();
+    this->clearImageMeasure();
+    if (_imageItem == nullptr)
+    {
+        _imageItem = new PaintImageItem(QPixmap::fromImage(_image));
+        _fillItem = new PaintImageItem(QPixmap(), _imageItem);
+        this->scene()->addItem(_imageItem);
+    }
+    else
+    {
+        _imageItem->setPixmap(QPixmap::fromImage(_image));
+        _fillItem->setPixmap(QPixmap());
+    }
+
     this->viewport()->update();
+    return true;
 }
 
 void PaintImage::SaveImage()
 {
-    _saveEnabled = true;
-    this->viewport()->update();
-    QString path = QFileDialog::getSaveFileName(nullptr, "保存图片", "", "Images (*.png *.xpm *.jpg);;All Files (*)");
-    _image->save(path);
+    if (_image.isNull())
+    {
+        return;
+    }
+
+    bool ok = false;
+    const double scale = QInputDialog::getDouble(this, "保存图片", "导出比例：", 1.0, MinExportScale, MaxExportScale, 2, &ok);
+    if (!ok)
+    {
+        return;
+    }
+
+    QString path = QFileDialog::getSaveFileName(nullptr, "保存图片", "", "Images (*.png *.tif *.tiff *.xpm *.jpg);;All Files (*)");
+    if (path.isEmpty())
+    {
+        return;
+    }
+
+    QImage background;
+    QString backgroundPath;
+    this->exportBackground(background, backgroundPath);
+    TiledImageRenderer renderer(background, completedShapes(true), scale);
+    const QString suffix = QFileInfo(path).suffix().toLower();
+    const qint64 bytes = qint64(renderer.GetSize().width()) * renderer.GetSize().height() * 4;
+
+    if ((suffix == "tif") || (suffix == "tiff"))
+    {
+        this->saveImageBands(renderer, path, EImageFileFormat::EIFF_Tiff);
+    }
+    else if (bytes > InMemoryExportLimit)
+    {
+        if (suffix == "png")
+        {
+            this->saveImageBands(renderer, path, EImageFileFormat::EIFF_Png);
+        }
+        else
+        {
+            QMessageBox::warning(this, "保存图片", "图片过大，请导出为PNG或TIFF格式。");
+        }
+    }
+    else
+    {
+        this->saveImageTiles(renderer, path);
+    }
+}
+
+void PaintImage::saveImageTiles(TiledImageRenderer &renderer, const QString &path)
+{
+    QImage target(renderer.GetSize(), QImage::Format_ARGB32_Premultiplied);
+    if (target.isNull())
+    {
+        QMessageBox::warning(this, "保存图片", "内存不足，无法导出图片。");
+        return;
+    }
+
+    /*
+     * 渲染在线程池中进行，进度为已完成的图块数；取消后等待正在渲染的图块结束。
+     */
+    QProgressDialog dialog("正在渲染图片...", "取消", 0, renderer.GetTileCount(), this);
+    dialog.setWindowModality(Qt::WindowModal);
+    dialog.setMinimumDuration(0);
+
+    QFutureWatcher<void> renderWatcher;
+    connect(&renderWatcher, &QFutureWatcher<void>::progressValueChanged, &dialog, &QProgressDialog::setValue);
+    connect(&renderWatcher, &QFutureWatcher<void>::finished, &dialog, &QProgressDialog::reset);
+    connect(&dialog, &QProgressDialog::canceled, &renderWatcher, &QFutureWatcher<void>::cancel);
+    renderWatcher.setFuture(renderer.Start(target));
+    dialog.exec();
+    renderWatcher.waitForFinished();
+
+    if (renderWatcher.isCanceled())
+    {
+        return;
+    }
+
+    /*
+     * 编码同样放到后台，界面不冻结。
+     */
+    dialog.setLabelText("正在保存图片...");
+    dialog.setCancelButton(nullptr);
+    dialog.setRange(0, 0);
+
+    QFutureWatcher<bool> saveWatcher;
+    connect(&saveWatcher, &QFutureWatcher<bool>::finished, &dialog, &QProgressDialog::reset);
+    saveWatcher.setFuture(QtConcurrent::run([&target, path]()
+    {
+        return target.save(path);
+    }));
+    dialog.exec();
+    saveWatcher.waitForFinished();
+
+    if (!saveWatcher.result())
+    {
+        QMessageBox::warning(this, "保存图片", "写入图片文件失败。");
+    }
+}
+
+void PaintImage::saveImageBands(TiledImageRenderer &renderer, const QString &path, EImageFileFormat format)
+{
+    BandImageExporter exporter(&renderer, path, format);
+
+    /*
+     * 逐行带渲染、写入，进度为已写入的行带数；取消后当前行带写完即停止，并删除不完整的文件。
+     */
+    QProgressDialog dialog("正在导出图片...", "取消", 0, exporter.GetBandCount(), this);
+    dialog.setWindowModality(Qt::WindowModal);
+    dialog.setMinimumDuration(0);
+    dialog.setAutoReset(false);
+
+    bool canceled = false;
+    QFutureWatcher<bool> watcher;
+    connect(&exporter, &BandImageExporter::bandFinished, &dialog, &QProgressDialog::setValue);
+    connect(&watcher, &QFutureWatcher<bool>::finished, &dialog, &QProgressDialog::reset);
+    connect(&dialog, &QProgressDialog::canceled, &exporter, [&exporter, &canceled]()
+    {
+        canceled = true;
+        exporter.Cancel();
+    });
+    watcher.setFuture(QtConcurrent::run([&exporter]()
+    {
+        return exporter.Run();
+    }));
+    dialog.exec();
+    watcher.waitForFinished();
+
+    if (!watcher.result() && !canceled)
+    {
+        QMessageBox::warning(this, "保存图片", "写入图片文件失败。");
+    }
 }
 
 void PaintImage::ClearImage()
@@ -39,82 +241,581 @@ void PaintImage::ClearImage()
 void PaintImage::paintEvent(QPaintEvent *event)
 {
     PaintArea::paintEvent(event);
+}
 
-//    QPainter painter(this->viewport());
-//    QRectF sourceRect(0.0, 0.0, this->width(), this->height());
-//    QRectF targetRect(0.0, 0.0, this->width(), this->height());
-//    painter.drawImage(targetRect, *_image, sourceRect);
+void PaintImage::resizeEvent(QResizeEvent *event)
+{
+    PaintArea::resizeEvent(event);
+    _profilePlot->move(this->viewport()->width() - ProfilePlotWidth - 10, 10);
+}
 
-//    this->paintShapes();
+void PaintImage::mouseMoveEvent(QMouseEvent *e)
+{
+    PaintArea::mouseMoveEvent(e);
+    this->updateImageMeasure();
+}
+
+void PaintImage::updateImageMeasure()
+{
+    this->updateProfile();
+    this->updateRoiStatistics();
+    this->updateCalipers();
+    this->updateCircleFit();
+}
+
+void PaintImage::SetCaliperEnabled(bool enabled)
+{
+    if (_caliperEnabled == enabled)
+    {
+        return;
+    }
+
+    _caliperEnabled = enabled;
+    _caliperLines.clear();
+    _caliperResults.clear();
+    _caliperIndex = -1;
+    _profilePlot->SetEdges(CaliperResult());
+    this->updateCalipers();
+    this->viewport()->update();
 }
 
-void PaintImage::wheelEvent(QWheelEvent *event)
+void PaintImage::updateCalipers()
 {
-    PaintArea::wheelEvent(event);
+    if (!_caliperEnabled || _image.isNull())
+    {
+        return;
+    }
 
     /*
-     * Ctrl + 鼠标滚轮，进行绘图区域的缩放。
+     * 绘制中的直线不在completedShapes()中，单独加入。
      */
-    if (QApplication::keyboardModifiers() == Qt::ControlModifier)
+    GeometryShape *measured = this->GetMeasuredShape();
+    QList<GeometryShape *> shapes = this->completedShapes(true);
+    if ((measured != nullptr) && !measured->GetCompleted())
     {
-        QPoint numDegrees = event->angleDelta();
-        int step = 0;
-        qreal g = 0;
+        shapes.append(measured);
+    }
 
-        if (!numDegrees.isNull())
+    QVector<QLineF> lines;
+    int index = -1;
+    for (GeometryShape *shape : shapes)
+    {
+        QVector<QPoint> geometry = shape->GetLiveGeometry();
+        if ((shape->GetPaintType() != EPaintType::EPT_Line) || (geometry.count() < 2))
+        {
+            continue;
+        }
+        if (shape == measured)
         {
-            step = numDegrees.y();
+            index = lines.count();
         }
+        lines.append(QLineF(geometry.at(0), geometry.at(1)));
+    }
+
+    if ((lines == _caliperLines) && (index == _caliperIndex))
+    {
+        return;
+    }
+
+    if (lines != _caliperLines)
+    {
+        if (_pyramid.IsEmpty())
+        {
+            _pyramid.Build(_image);
+        }
+        _caliperResults = _caliper.MeasureAll(_pyramid.GetLevel(0), lines);
+        _caliperLines = lines;
+        this->viewport()->update();
+    }
+    _caliperIndex = index;
+    _profilePlot->SetEdges((index >= 0) ? _caliperResults.at(index) : CaliperResult());
+}
+
+void PaintImage::SetCircleFitEnabled(bool enabled)
+{
+    _circleFitEnabled = enabled;
+    _fitPendingId = 0;
+    if (!enabled)
+    {
+        _fitQueue.clear();
+    }
+}
+
+void PaintImage::updateCircleFit()
+{
+    if (!_circleFitEnabled || _image.isNull())
+    {
+        return;
+    }
+
+    GeometryShape *measured = this->GetMeasuredShape();
+    if ((measured != nullptr) && !measured->GetCompleted() &&
+            ((measured->GetPaintType() == EPaintType::EPT_Circle) || (measured->GetPaintType() == EPaintType::EPT_Arc)))
+    {
+        _fitPendingId = measured->GetId();
+        return;
+    }
+
+    /*
+     * 绘制中的圆、圆弧不再是测量的图形：已完成或者已取消，取消的在开始拟合时找不到而跳过。
+     */
+    if (_fitPendingId != 0)
+    {
+        _fitQueue.append(_fitPendingId);
+        _fitPendingId = 0;
+        this->startCircleFit();
+    }
+}
+
+void PaintImage::startCircleFit()
+{
+    if (_fitWatcher->isRunning())
+    {
+        return;
+    }
+
+    GeometryShape *shape = nullptr;
+    quint64 id = 0;
+    while ((shape == nullptr) && !_fitQueue.isEmpty())
+    {
+        id = _fitQueue.takeFirst();
+        shape = this->findShape(id);
+    }
+    if (shape == nullptr)
+    {
+        return;
+    }
 
-        event->accept();
+    if (_pyramid.IsEmpty())
+    {
+        _pyramid.Build(_image);
+    }
 
-        int curWidth = this->width();
-        int curHeight = this->height();
-        curWidth += step;
-        curHeight += step;
-        qDebug() << step;
+    CircleFitJob job;
+    job.id = id;
+    job.type = shape->GetPaintType();
+    job.oldGeometry = shape->GetGeometry();
+    job.fitted = false;
+    QImage gray = _pyramid.GetLevel(0);
+    _fitWatcher->setFuture(QtConcurrent::run([job, gray]() mutable
+    {
+        fitCircle(gray, job);
+        return job;
+    }));
+}
+
+void PaintImage::finishCircleFit()
+{
+    const CircleFitJob job = _fitWatcher->result();
+    GeometryShape *shape = this->findShape(job.id);
+
+    /*
+     * 拟合期间图形被删除或修改过时放弃结果。
+     */
+    if (!job.fitted)
+    {
+        qWarning() << "Warn: PaintImage::finishCircleFit(), no circle found near the shape!" << job.id;
+    }
+    else if ((shape != nullptr) && (shape->GetGeometry() == job.oldGeometry) && (job.newGeometry != job.oldGeometry))
+    {
+        this->reshapeShapes(QList<GeometryShape *>() << shape, QVector<QVector<QPoint>>() << job.newGeometry);
+    }
 
-        if (step > 0)
+    this->startCircleFit();
+}
+
+void PaintImage::fitCircle(const QImage &gray, CircleFitJob &job)
+{
+    const QVector<QPoint> &geometry = job.oldGeometry;
+    const int minCount = (job.type == EPaintType::EPT_Arc) ? 3 : 2;
+    if (geometry.count() < minCount)
+    {
+        return;
+    }
+
+    QLineF radiusLine(geometry.at(0), geometry.at(1));
+    qreal startAngle = 0.0;
+    qreal sweepAngle = 360.0;
+    if (job.type == EPaintType::EPT_Arc)
+    {
+        startAngle = radiusLine.angle();
+        sweepAngle = QLineF(geometry.at(0), geometry.at(2)).angle() - startAngle;
+    }
+
+    CircleFit fit;
+    QVector<QPointF> points = CircleFitter::CollectEdges(gray, radiusLine.p1(), radiusLine.length(), startAngle, sweepAngle);
+    if (!CircleFitter::Fit(points, fit))
+    {
+        return;
+    }
+
+    /*
+     * 控制点为整数：圆心取整，其余控制点在原来的方向上、距圆心为拟合的半径。
+     */
+    QPoint center = fit.center.toPoint();
+    job.newGeometry.append(center);
+    for (int i = 1; i < minCount; i++)
+    {
+        QLineF line(geometry.at(0), geometry.at(i));
+        if (line.length() <= 0.0)
         {
-            qDebug() << "Zoom out: " << curWidth << " " << curHeight;
-            g = 2;
+            return;
         }
-        else
+        line.setLength(fit.radius);
+        job.newGeometry.append(center + (line.p2() - line.p1()).toPoint());
+    }
+    job.fitted = true;
+}
+
+GeometryShape *PaintImage::findShape(quint64 id) const
+{
+    for (GeometryShape *shape : this->completedShapes())
+    {
+        if (shape->GetId() == id)
+        {
+            return shape;
+        }
+    }
+    return nullptr;
+}
+
+void PaintImage::MatchSelectedRect()
+{
+    GeometryShape *shape = this->GetMeasuredShape();
+    if (_image.isNull() || (shape == nullptr) || !shape->GetCompleted() ||
+            (shape->GetPaintType() != EPaintType::EPT_Rect))
+    {
+        QMessageBox::information(this, "模板匹配", "请先选中一个矩形。");
+        return;
+    }
+
+    bool ok = false;
+    const double minScore = QInputDialog::getDouble(this, "模板匹配", "最低相似度：", TemplateMatcher::DefaultMinScore,
+                                                    0.5, 1.0, 2, &ok);
+    if (!ok)
+    {
+        return;
+    }
+
+    /*
+     * 矩形的控制点为左上角和右下角，覆盖的像素为[left, right) x [top, bottom)。
+     */
+    const QVector<QPoint> geometry = shape->GetGeometry();
+    const QRect templateRect = QRect(geometry.at(0), geometry.at(1)).normalized().adjusted(0, 0, -1, -1);
+
+    if (_pyramid.IsEmpty())
+    {
+        _pyramid.Build(_image);
+    }
+
+    /*
+     * 取消后等待后台在当前的行块或候选层处停止，不加入任何矩形。
+     */
+    QProgressDialog dialog("正在查找...", "取消", 0, 0, this);
+    dialog.setWindowModality(Qt::WindowModal);
+    dialog.setMinimumDuration(0);
+
+    QAtomicInt canceled(0);
+    QFutureWatcher<QVector<TemplateMatch>> watcher;
+    connect(&watcher, &QFutureWatcher<QVector<TemplateMatch>>::finished, &dialog, &QProgressDialog::reset);
+    connect(&dialog, &QProgressDialog::canceled, this, [&canceled]()
+    {
+        canceled.storeRelease(1);
+    });
+    const ImagePyramid &pyramid = _pyramid;
+    watcher.setFuture(QtConcurrent::run([&pyramid, templateRect, minScore, &canceled]()
+    {
+        return TemplateMatcher::Match(pyramid, templateRect, minScore, &canceled);
+    }));
+    dialog.exec();
+    watcher.waitForFinished();
+    if (canceled.loadAcquire() != 0)
+    {
+        return;
+    }
+
+    /*
+     * 模板本身的位置也会匹配到，与模板重叠超过一半的位置跳过。
+     */
+    const QVector<TemplateMatch> matches = watcher.result();
+    QList<GeometryShape *> shapes;
+    for (const TemplateMatch &match : matches)
+    {
+        const QRect rect = match.rect.intersected(templateRect);
+        if (2 * qint64(rect.width()) * rect.height() > qint64(templateRect.width()) * templateRect.height())
         {
-            qDebug() << "Zoom in: " << curWidth << " " << curHeight;
-            g = 0.5;
+            continue;
         }
 
-        if ((curWidth > this->maximumWidth()) || (curWidth < this->minimumWidth()))
+        GeometryShape *rectShape = GeometryShapeFactory::CreateGeometryShape(EPaintType::EPT_Rect);
+        rectShape->SetGeometry(QVector<QPoint>() << match.rect.topLeft()
+                               << (match.rect.topLeft() + QPoint(match.rect.width(), match.rect.height())));
+        rectShape->SetLayerId(shape->GetLayerId());
+        shapes.append(rectShape);
+    }
+
+    this->insertShapes(shapes);
+    QMessageBox::information(this, "模板匹配", QString("找到%1处。").arg(shapes.count()));
+}
+
+void PaintImage::paintOverlay(QPainter &painter)
+{
+    if (!_caliperEnabled || _caliperResults.isEmpty())
+    {
+        return;
+    }
+
+    /*
+     * 每个边缘画一条垂直于直线、长为卡尺宽度的短线，上升沿、下降沿颜色不同。
+     */
+    const QTransform transform = this->viewportTransform();
+    const qreal halfWidth = qMax(_caliper.GetHalfWidth(), 2.0);
+    painter.save();
+    painter.setRenderHint(QPainter::Antialiasing, true);
+    for (const CaliperResult &result : _caliperResults)
+    {
+        const qreal length = result.line.length();
+        if (length <= 0.0)
         {
-            return;
+            continue;
         }
-        if ((curHeight > this->maximumHeight()) || (curHeight < this->minimumHeight()))
+
+        const QPointF normal = QPointF(result.line.p1().y() - result.line.p2().y(),
+                                       result.line.p2().x() - result.line.p1().x()) / length * halfWidth;
+        for (const CaliperEdge &edge : result.edges)
         {
-            return;
+            painter.setPen(QPen((edge.polarity == EEdgePolarity::EEP_Rising) ? QColor("#00bfff") : QColor("#ff8c00"), 2));
+            painter.drawLine(transform.map(edge.point - normal), transform.map(edge.point + normal));
         }
+    }
+    painter.restore();
+}
 
-        qDebug() << this->matrix().m11();
-        this->scale(g, g);
-        qDebug() << this->matrix().m11();
-        this->viewport()->update();
+void PaintImage::clearImageMeasure()
+{
+    _pyramid.Clear();
+    _roiStatistics.Clear();
+    _profileLine = QLineF();
+    _roiType = EPaintType::EPT_None;
+    _roiGeometry.clear();
+    _caliperLines.clear();
+    _caliperResults.clear();
+    _caliperIndex = -1;
+}
+
+void PaintImage::updateProfile()
+{
+    GeometryShape *shape = this->GetMeasuredShape();
+    QVector<QPoint> geometry;
+    if ((shape != nullptr) && (shape->GetPaintType() == EPaintType::EPT_Line))
+    {
+        geometry = shape->GetLiveGeometry();
+    }
+
+    if (_image.isNull() || (geometry.count() < 2))
+    {
+        _profileLine = QLineF();
+        _profilePlot->hide();
+        return;
+    }
 
-//        *_image = _image->scaled(curWidth, curHeight);
-//        qDebug() << _image->size();
-//        resize(curWidth, curHeight);
+    if (_pyramid.IsEmpty())
+    {
+        _pyramid.Build(_image);
+    }
+
+    QLineF line(geometry.at(0), geometry.at(1));
+    int level = _pyramid.LevelForScale(this->transform().m11());
+    if ((line == _profileLine) && (level == _profileLevel) && _profilePlot->isVisible())
+    {
+        return;
     }
+    _profileLine = line;
+    _profileLevel = level;
+
+    /*
+     * 在所选层上约每个像素一个采样。场景坐标减去半个像素为以原图像素中心为整数点的坐标。
+     */
+    QPointF p1 = ImagePyramid::ToLevel(line.p1() - QPointF(0.5, 0.5), level);
+    QPointF p2 = ImagePyramid::ToLevel(line.p2() - QPointF(0.5, 0.5), level);
+    int maxSamples = ProfileMaxSamples;
+    int count = qBound(2, qCeil(QLineF(p1, p2).length()) + 1, maxSamples);
+    QVector<float> values(count);
+    ImageSampler::SampleLine(_pyramid.GetLevel(level), p1, p2, count, values.data());
+
+    _profilePlot->SetProfile(values, line.length(), level);
+    _profilePlot->show();
+    _profilePlot->raise();
 }
 
-void PaintImage::paintShapes()
+void PaintImage::updateRoiStatistics()
 {
-    if (_saveEnabled)
+    GeometryShape *shape = this->GetMeasuredShape();
+    EPaintType type = (shape == nullptr) ? EPaintType::EPT_None : shape->GetPaintType();
+    if (_image.isNull() || ((type != EPaintType::EPT_Rect) && (type != EPaintType::EPT_Circle) &&
+                            (type != EPaintType::EPT_Ellipse) && (type != EPaintType::EPT_Polygon)))
+    {
+        _roiType = EPaintType::EPT_None;
+        _roiGeometry.clear();
+        _roiLabel->hide();
+        return;
+    }
+
+    QVector<QPoint> geometry = shape->GetLiveGeometry();
+    if ((type == _roiType) && (geometry == _roiGeometry) && _roiLabel->isVisible())
+    {
+        return;
+    }
+    _roiType = type;
+    _roiGeometry = geometry;
+
+    if (_roiStatistics.IsEmpty())
+    {
+        if (_pyramid.IsEmpty())
+        {
+            _pyramid.Build(_image);
+        }
+        _roiStatistics.Build(_pyramid.GetLevel(0));
+    }
+
+    RoiStats stats;
+    bool valid = false;
+    if (geometry.count() >= 2)
+    {
+        switch (type)
+        {
+        case EPaintType::EPT_Rect:
+            valid = _roiStatistics.RectStats(geometry.at(0), geometry.at(1), stats);
+            break;
+        case EPaintType::EPT_Ellipse:
+            valid = _roiStatistics.EllipseStats(QRectF(geometry.at(0), geometry.at(1)), stats);
+            break;
+        case EPaintType::EPT_Circle:
+        {
+            qreal radius = QLineF(geometry.at(0), geometry.at(1)).length();
+            valid = _roiStatistics.EllipseStats(QRectF(geometry.at(0) - QPointF(radius, radius),
+                                                       geometry.at(0) + QPointF(radius, radius)), stats);
+            break;
+        }
+        default:
+            valid = _roiStatistics.PolygonStats(QPolygon(geometry), stats);
+            break;
+        }
+    }
+
+    if (valid)
     {
-        QPainter painter(_image);
-        paintAllShapes(painter);
+        _roiLabel->setText(QString("像素:%0 均值:%1 标准差:%2 最小:%3 最大:%4").arg(stats.count)
+                           .arg(QString::number(stats.mean, 'f', 2)).arg(QString::number(stats.stdDev, 'f', 2))
+                           .arg(stats.min).arg(stats.max));
     }
     else
     {
-        QPainter painter(this->viewport());
-        paintAllShapes(painter);
+        _roiLabel->setText("像素:0");
+    }
+    _roiLabel->adjustSize();
+    _roiLabel->show();
+    _roiLabel->raise();
+}
+
+bool PaintImage::exportBackground(QImage &image, QString &filePath) const
+{
+    if (_image.isNull())
+    {
+        return false;
+    }
+
+    /*
+     * 导出的背景图为原图叠加油漆桶的填充。
+     */
+    image = _fillOverlay.isNull() ? _image : _fillComposite;
+    filePath = _imagePath;
+    return true;
+}
+
+bool PaintImage::exportFillOverlay(QImage &overlay) const
+{
+    if (_fillOverlay.isNull())
+    {
+        return false;
+    }
+
+    overlay = *_fillOverlay;
+    return true;
+}
+
+bool PaintImage::floodFill(const QPoint &scenePos)
+{
+    if (_image.isNull())
+    {
+        return false;
+    }
+    if (!_image.rect().contains(scenePos))
+    {
+        qWarning() << "Warn: PaintImage::floodFill(), position out of image!" << scenePos;
+        return false;
+    }
+
+    /*
+     * 首次填充时建立覆盖层和叠加结果，之后每次点击不再转换、叠加整张图片。
+     */
+    if (_fillOverlay.isNull())
+    {
+        _fillOverlay = QSharedPointer<QImage>::create(_image.size(), QImage::Format_ARGB32);
+        _fillOverlay->fill(Qt::transparent);
+        _fillComposite = _image.convertToFormat(QImage::Format_ARGB32_Premultiplied);
+    }
+
+    /*
+     * 按显示的颜色（含已有的填充）生长，只写入覆盖层，原图不变。
+     */
+    ScanlineFloodFill fill;
+    if (!fill.Grow(_fillComposite, scenePos, FillTolerance))
+    {
+        return false;
+    }
+
+    this->fillBackground(_fillOverlay, fill.GetSpans(), this->GetFillColor());
+    return true;
+}
+
+void PaintImage::BackgroundChanged(const QRect &rect)
+{
+    /*
+     * 重新载入图片后，历史记录中的填充属于旧的覆盖层，不再显示。
+     */
+    const QRect changedRect = rect & _fillComposite.rect();
+    if ((_fillItem == nullptr) || _fillOverlay.isNull() || changedRect.isEmpty())
+    {
+        this->viewport()->update();
+        return;
     }
+
+    QPainter compositePainter(&_fillComposite);
+    compositePainter.setCompositionMode(QPainter::CompositionMode_Source);
+    compositePainter.drawImage(changedRect.topLeft(), _image, changedRect);
+    compositePainter.setCompositionMode(QPainter::CompositionMode_SourceOver);
+    compositePainter.drawImage(changedRect.topLeft(), *_fillOverlay, changedRect);
+    compositePainter.end();
+
+    /*
+     * 先取下图元的位图，使其不被共享，只重绘变化的区域而不复制整张位图。
+     */
+    QRect pixmapRect = changedRect;
+    QPixmap pixmap = _fillItem->pixmap();
+    _fillItem->setPixmap(QPixmap());
+    if (pixmap.size() != _fillOverlay->size())
+    {
+        pixmap = QPixmap(_fillOverlay->size());
+        pixmap.fill(Qt::transparent);
+        pixmapRect = _fillOverlay->rect();
+    }
+
+    QPainter pixmapPainter(&pixmap);
+    pixmapPainter.setCompositionMode(QPainter::CompositionMode_Source);
+    pixmapPainter.drawImage(pixmapRect.topLeft(), *_fillOverlay, pixmapRect);
+    pixmapPainter.end();
+    _fillItem->setPixmap(pixmap);
+
+    this->viewport()->update();
 }
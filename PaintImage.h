@@ -2,27 +2,181 @@
 #define PAINTIMAGE_H
 
 #include "PaintArea.h"
+#include "ImageExport.h"
+#include "FloodFill.h"
+#include "ImagePyramid.h"
+#include "ImageSampler.h"
+#include "ProfilePlot.h"
+#include "RoiStatistics.h"
+#include "EdgeCaliper.h"
+#include "CircleFitter.h"
+#include "TemplateMatcher.h"
 #include <QImage>
+#include <QLabel>
+#include <QFutureWatcher>
+#include <QGraphicsPixmapItem>
+
+/**
+ * @brief The PaintImageItem class 图片图元。
+ * @details 按所在视图的绘制质量选择缩放方式：预览时最近邻，空闲时平滑缩放。
+ * 不通过setTransformationMode()切换，避免切换时整幅图片重绘。
+ */
+class PaintImageItem : public QGraphicsPixmapItem
+{
+public:
+    explicit PaintImageItem(const QPixmap &pixmap, QGraphicsItem *parent = nullptr);
+    void paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget *widget) override;
+};
 
 class PaintImage : public PaintArea
 {
 public:
+    /**
+     * @brief 导出比例的范围；目标图片超过InMemoryExportLimit字节时，按行带流式导出。
+     */
+    constexpr static double MinExportScale = 0.1;
+    constexpr static double MaxExportScale = 16.0;
+    constexpr static qint64 InMemoryExportLimit = 1024LL * 1024 * 1024;
+    /**
+     * @brief 灰度剖面最多ProfileMaxSamples个采样，剖面图的大小（像素）。
+     */
+    constexpr static int ProfileMaxSamples = 8192;
+    constexpr static int ProfilePlotWidth = 360;
+    constexpr static int ProfilePlotHeight = 180;
+
 //    explicit PaintImage(QWidget *parent = nullptr);
     PaintImage(QGraphicsScene *scene, QWidget *parent = nullptr);
     ~PaintImage();
-    void LoadImage();
+    /**
+     * @brief LoadImage 加载背景图，替换场景中原有的图片。
+     */
+    bool LoadImage(const QString &path);
+    /**
+     * @brief SaveImage 将背景图和图形按比例导出为图片，后台渲染，可取消。
+     * @details 图片较小时整幅分块渲染后编码；TIFF或者超过InMemoryExportLimit的PNG按行带流式写入。
+     */
     void SaveImage();
     void ClearImage();
+    /**
+     * @brief SetCaliperEnabled 是否沿所有显示的直线进行边缘卡尺测量（见EdgeCaliper），默认不测量。
+     * @details 开启后直线绘制、移动、改变大小时重新测量，在视图中标出边缘，
+     * 测量的直线的边缘和宽度显示在灰度剖面中。
+     */
+    void SetCaliperEnabled(bool enabled);
+    bool GetCaliperEnabled() const
+    {
+        return _caliperEnabled;
+    }
+    /**
+     * @brief SetCircleFitEnabled 是否将新绘制的圆、圆弧拟合到图片中的边缘（见CircleFitter），默认不拟合。
+     * @details 拟合在后台线程中进行，依次处理；完成时图形没有被修改过才替换控制点，可撤销。
+     */
+    void SetCircleFitEnabled(bool enabled);
+    bool GetCircleFitEnabled() const
+    {
+        return _circleFitEnabled;
+    }
+    /**
+     * @brief MatchSelectedRect 以选中的矩形内的图案为模板，在背景图中查找其它出现位置（见TemplateMatcher），
+     * 每个位置在模板矩形所在的图层加入一个同样大小的矩形，记为一条历史记录。后台查找，界面不冻结，可以取消。
+     */
+    void MatchSelectedRect();
+    /**
+     * @brief BackgroundChanged 填充覆盖层变化后更新显示，背景图本身不变，不影响测量。
+     */
+    void BackgroundChanged(const QRect &rect) override;
 
 protected:
     void paintEvent(QPaintEvent *event) override;
-    void wheelEvent(QWheelEvent *event) override;
+    void resizeEvent(QResizeEvent *event) override;
+    void mouseMoveEvent(QMouseEvent *e) override;
+    bool exportBackground(QImage &image, QString &filePath) const override;
+    bool exportFillOverlay(QImage &overlay) const override;
+    bool floodFill(const QPoint &scenePos) override;
+    void paintOverlay(QPainter &painter) override;
 
 private:
-    QImage *_image;
-    bool _saveEnabled;
+    struct CircleFitJob
+    {
+        quint64 id;
+        EPaintType type;
+        QVector<QPoint> oldGeometry;
+        QVector<QPoint> newGeometry;
+        bool fitted;
+    };
+
+    /**
+     * @brief 原始背景图，剖面、区域统计、卡尺、圆拟合、模板匹配都在它上面测量。
+     * 油漆桶只填充到_fillOverlay（ARGB32，首次填充时建立），显示为_imageItem的子图元，导出时叠加。
+     * _fillComposite为原图叠加覆盖层的结果（ARGB32_Premultiplied），与覆盖层一同建立，
+     * 覆盖层变化时只更新变化的区域；油漆桶在它上面生长，导出时直接使用。
+     */
+    QImage _image;
+    QString _imagePath;
+    PaintImageItem *_imageItem;
+    QSharedPointer<QImage> _fillOverlay;
+    QImage _fillComposite;
+    PaintImageItem *_fillItem;
+    /**
+     * @brief 背景图的灰度金字塔，背景图变化后清空，需要时再生成。
+     */
+    ImagePyramid _pyramid;
+    ProfilePlot *_profilePlot;
+    QLineF _profileLine;
+    int _profileLevel;
+    /**
+     * @brief 背景图的积分图，与_pyramid一同清空、按需生成；_roiType、_roiGeometry为上一次统计的区域。
+     */
+    RoiStatistics _roiStatistics;
+    QLabel *_roiLabel;
+    EPaintType _roiType;
+    QVector<QPoint> _roiGeometry;
+    /**
+     * @brief _caliperLines为上一次测量的直线，_caliperIndex为其中测量的图形的序号，没有时为-1。
+     */
+    EdgeCaliper _caliper;
+    bool _caliperEnabled;
+    QVector<QLineF> _caliperLines;
+    QVector<CaliperResult> _caliperResults;
+    int _caliperIndex;
+    /**
+     * @brief _fitPendingId为绘制中的圆、圆弧，完成后加入_fitQueue，_fitWatcher同时只运行一个拟合。
+     */
+    bool _circleFitEnabled;
+    quint64 _fitPendingId;
+    QList<quint64> _fitQueue;
+    QFutureWatcher<CircleFitJob> *_fitWatcher;
 
-    void paintShapes();
+    /**
+     * @brief updateImageMeasure 测量的图形变化或移动后，更新灰度剖面和区域统计。
+     */
+    void updateImageMeasure();
+    /**
+     * @brief updateProfile 绘制中或唯一选中的图形为直线时，按视图的缩放比例选择金字塔层，
+     * 沿直线双线性采样灰度剖面并显示，直线和层都不变时不重新采样。
+     */
+    void updateProfile();
+    /**
+     * @brief updateRoiStatistics 绘制中或唯一选中的图形为矩形、圆、椭圆、多边形时，统计区域内像素的灰度并显示，
+     * 区域不变时不重新统计。
+     */
+    void updateRoiStatistics();
+    /**
+     * @brief updateCalipers 卡尺测量开启时，显示的直线有变化则全部重新测量。
+     */
+    void updateCalipers();
+    void clearImageMeasure();
+    void updateCircleFit();
+    void startCircleFit();
+    void finishCircleFit();
+    /**
+     * @brief fitCircle 在后台线程中执行：由job.oldGeometry的圆或圆弧收集边缘点并拟合，
+     * 圆心、半径取整后按原来的方向写入job.newGeometry。
+     */
+    static void fitCircle(const QImage &gray, CircleFitJob &job);
+    GeometryShape *findShape(quint64 id) const;
+    void saveImageTiles(TiledImageRenderer &renderer, const QString &path);
+    void saveImageBands(TiledImageRenderer &renderer, const QString &path, EImageFileFormat format);
 };
 
 #endif // PAINTIMAGE_H
@@ -0,0 +1,110 @@
+#include "PaintLayer.h"
+
+PaintLayer::PaintLayer(quint64 id, const QString &name) : _id(id)
+  , _name(name)
+  , _visible(true)
+  , _locked(false)
+  , _opacity(1.0)
+  , _cacheValid(false)
+{
+}
+
+void PaintLayer::SetOpacity(qreal opacity)
+{
+    _opacity = qBound(0.0, opacity, 1.0);
+}
+
+void PaintLayer::AppendShape(GeometryShape *shape)
+{
+    shape->SetZOrder(_shapes.isEmpty() ? 0.0 : _shapes.last()->GetZOrder() + 1.0);
+    _shapes.append(shape);
+    this->InvalidateCache();
+}
+
+bool PaintLayer::InsertShape(GeometryShape *shape, int index)
+{
+    index = qBound(0, index, _shapes.count());
+    if (index == _shapes.count())
+    {
+        this->AppendShape(shape);
+        return false;
+    }
+
+    bool renumbered = false;
+    if (index == 0)
+    {
+        shape->SetZOrder(_shapes.first()->GetZOrder() - 1.0);
+    }
+    else
+    {
+        qreal lower = _shapes.at(index - 1)->GetZOrder();
+        qreal upper = _shapes.at(index)->GetZOrder();
+        qreal zOrder = (lower + upper) / 2.0;
+        shape->SetZOrder(zOrder);
+        renumbered = !((lower < zOrder) && (zOrder < upper));
+    }
+
+    _shapes.insert(index, shape);
+    if (renumbered)
+    {
+        for (int i = 0; i < _shapes.count(); i++)
+        {
+            _shapes.at(i)->SetZOrder(i);
+        }
+    }
+
+    this->InvalidateCache();
+    return renumbered;
+}
+
+bool PaintLayer::RemoveShape(GeometryShape *shape)
+{
+    if (!_shapes.removeOne(shape))
+    {
+        return false;
+    }
+
+    this->InvalidateCache();
+    return true;
+}
+
+bool PaintLayer::BringToFront(GeometryShape *shape)
+{
+    int index = _shapes.indexOf(shape);
+    if ((index < 0) || (index == _shapes.count() - 1))
+    {
+        return false;
+    }
+
+    shape->SetZOrder(_shapes.last()->GetZOrder() + 1.0);
+    _shapes.move(index, _shapes.count() - 1);
+    this->InvalidateCache();
+    return true;
+}
+
+bool PaintLayer::SendToBack(GeometryShape *shape)
+{
+    int index = _shapes.indexOf(shape);
+    if (index <= 0)
+    {
+        return false;
+    }
+
+    shape->SetZOrder(_shapes.first()->GetZOrder() - 1.0);
+    _shapes.move(index, 0);
+    this->InvalidateCache();
+    return true;
+}
+
+bool PaintLayer::IsCacheValid(const QTransform &transform, const QSize &size) const
+{
+    return _cacheValid && (_cacheTransform == transform) &&
+            ((_cache.size() / _cache.devicePixelRatio()) == size);
+}
+
+void PaintLayer::SetCache(const QPixmap &cache, const QTransform &transform)
+{
+    _cache = cache;
+    _cacheTransform = transform;
+    _cacheValid = true;
+}
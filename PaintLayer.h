@@ -0,0 +1,114 @@
+#ifndef PAINTLAYER_H
+#define PAINTLAYER_H
+
+#include <QList>
+#include <QPixmap>
+#include <QString>
+#include <QTransform>
+
+#include "GeometryShape.h"
+
+/**
+ * @brief The PaintLayer class 图层：图形的绘制顺序（列表中靠后的在上层）以及显示、锁定、不透明度。
+ * @details
+ * 图层为其中的图形维护次序键（GeometryShape::GetZOrder()），随列表顺序递增，移除图形不改变其它图形的次序键。
+ * 每个图层缓存一幅视口大小的栅格图，只包含未选中、已完成的图形；视图变换、视口大小变化
+ * 或者图层内的图形变化后缓存失效。显示、隐藏、调整不透明度、调整图层顺序只需重新合成缓存。
+ */
+class PaintLayer
+{
+public:
+    PaintLayer(quint64 id, const QString &name);
+    PaintLayer(const PaintLayer&) = delete;
+    PaintLayer &operator=(const PaintLayer&) = delete;
+
+    quint64 GetId() const
+    {
+        return _id;
+    }
+    QString GetName() const
+    {
+        return _name;
+    }
+    void SetName(const QString &name)
+    {
+        _name = name;
+    }
+    bool GetVisible() const
+    {
+        return _visible;
+    }
+    void SetVisible(bool visible)
+    {
+        _visible = visible;
+    }
+    /**
+     * @brief GetLocked 锁定的图层中的图形不能选中、移动，也不能在其上绘制。
+     */
+    bool GetLocked() const
+    {
+        return _locked;
+    }
+    void SetLocked(bool locked)
+    {
+        _locked = locked;
+    }
+    qreal GetOpacity() const
+    {
+        return _opacity;
+    }
+    void SetOpacity(qreal opacity);
+
+    /**
+     * @brief GetShapes 图层中的图形，从下到上。
+     */
+    const QList<GeometryShape *> &GetShapes() const
+    {
+        return _shapes;
+    }
+    void AppendShape(GeometryShape *shape);
+    /**
+     * @brief InsertShape 将图形插入到第index位（从下往上），用于撤销、重做调整顺序的操作。
+     * @return true - 相邻次序键之间已无法区分，图层内所有图形的次序键重新编号。
+     */
+    bool InsertShape(GeometryShape *shape, int index);
+    bool RemoveShape(GeometryShape *shape);
+    /**
+     * @brief BringToFront 将图形移到图层的最上面。
+     * @return false - 图形不在图层中或者已在最上面。
+     */
+    bool BringToFront(GeometryShape *shape);
+    /**
+     * @brief SendToBack 将图形移到图层的最下面。
+     * @return false - 图形不在图层中或者已在最下面。
+     */
+    bool SendToBack(GeometryShape *shape);
+
+    /**
+     * @brief IsCacheValid 缓存是否按transform绘制、大小为size（设备无关像素）且之后没有失效。
+     */
+    bool IsCacheValid(const QTransform &transform, const QSize &size) const;
+    const QPixmap &GetCache() const
+    {
+        return _cache;
+    }
+    void SetCache(const QPixmap &cache, const QTransform &transform);
+    void InvalidateCache()
+    {
+        _cacheValid = false;
+    }
+
+private:
+    quint64 _id;
+    QString _name;
+    bool _visible;
+    bool _locked;
+    qreal _opacity;
+    QList<GeometryShape *> _shapes;
+
+    QPixmap _cache;
+    QTransform _cacheTransform;
+    bool _cacheValid;
+};
+
+#endif // PAINTLAYER_H
@@ -0,0 +1,130 @@
+#include "PaintLayerPanel.h"
+
+#include <QVBoxLayout>
+#include <QHBoxLayout>
+#include <QLabel>
+#include <QPushButton>
+#include <QSpacerItem>
+#include <QIcon>
+
+PaintLayerPanel::PaintLayerPanel(PaintArea *paintArea, QWidget *parent) : QGroupBox(parent)
+  , _paintArea(paintArea)
+{
+    QVBoxLayout *vLayout = new QVBoxLayout();
+    this->setLayout(vLayout);
+    this->setTitle("图层");
+
+    /*
+     * 列表从上到下为图层从上到下，与绘图区域的编号相反。
+     */
+    _layerComboBox = new QComboBox();
+    vLayout->addWidget(_layerComboBox);
+    connect(_layerComboBox, QOverload<int>::of(&QComboBox::currentIndexChanged), this, [this](int row)
+    {
+        if (row >= 0)
+        {
+            _paintArea->SetCurrentLayer(_paintArea->GetLayerCount() - 1 - row);
+        }
+    });
+
+    _visibleCheckBox = new QCheckBox("显示");
+    vLayout->addWidget(_visibleCheckBox);
+    connect(_visibleCheckBox, &QCheckBox::toggled, this, [this](bool checked)
+    {
+        _paintArea->SetLayerVisible(_paintArea->GetCurrentLayer(), checked);
+    });
+
+    _lockedCheckBox = new QCheckBox("锁定");
+    vLayout->addWidget(_lockedCheckBox);
+    connect(_lockedCheckBox, &QCheckBox::toggled, this, [this](bool checked)
+    {
+        _paintArea->SetLayerLocked(_paintArea->GetCurrentLayer(), checked);
+    });
+
+    vLayout->addWidget(new QLabel("不透明度"));
+    _opacitySlider = new QSlider(Qt::Orientation::Horizontal);
+    _opacitySlider->setRange(0, 100);
+    vLayout->addWidget(_opacitySlider);
+    connect(_opacitySlider, &QSlider::valueChanged, this, [this](int value)
+    {
+        _paintArea->SetLayerOpacity(_paintArea->GetCurrentLayer(), value / 100.0);
+    });
+
+    QPushButton *btn = new QPushButton();
+    btn->setText("新建图层");
+    connect(btn, &QPushButton::clicked, this, [this](){
+        _paintArea->AddLayer();
+    });
+    vLayout->addWidget(btn);
+
+    QHBoxLayout *hLayout = new QHBoxLayout();
+    btn = new QPushButton();
+    btn->setText("上移");
+    connect(btn, &QPushButton::clicked, this, [this](){
+        _paintArea->MoveLayer(_paintArea->GetCurrentLayer(), 1);
+    });
+    hLayout->addWidget(btn);
+    btn = new QPushButton();
+    btn->setText("下移");
+    connect(btn, &QPushButton::clicked, this, [this](){
+        _paintArea->MoveLayer(_paintArea->GetCurrentLayer(), -1);
+    });
+    hLayout->addWidget(btn);
+    vLayout->addLayout(hLayout);
+
+    hLayout = new QHBoxLayout();
+    btn = new QPushButton();
+    btn->setIcon(QIcon(":/images/bringtofront.png"));
+    btn->setToolTip("置于顶层");
+    connect(btn, &QPushButton::clicked, this, [this](){
+        _paintArea->BringSelectedToFront();
+    });
+    hLayout->addWidget(btn);
+    btn = new QPushButton();
+    btn->setIcon(QIcon(":/images/sendtoback.png"));
+    btn->setToolTip("置于底层");
+    connect(btn, &QPushButton::clicked, this, [this](){
+        _paintArea->SendSelectedToBack();
+    });
+    hLayout->addWidget(btn);
+    vLayout->addLayout(hLayout);
+
+    btn = new QPushButton();
+    btn->setText("移到当前图层");
+    btn->setToolTip("将选中的图形移到当前图层的最上面");
+    connect(btn, &QPushButton::clicked, this, [this](){
+        _paintArea->MoveSelectedToLayer(_paintArea->GetCurrentLayer());
+    });
+    vLayout->addWidget(btn);
+
+    QSpacerItem *si = new QSpacerItem(10,10, QSizePolicy::Fixed, QSizePolicy::Expanding);
+    vLayout->addSpacerItem(si);
+
+    connect(_paintArea, &PaintArea::layersChanged, this, &PaintLayerPanel::updateLayers);
+    this->updateLayers();
+}
+
+void PaintLayerPanel::updateLayers()
+{
+    const PaintLayer *current = _paintArea->GetLayer(_paintArea->GetCurrentLayer());
+    if (current == nullptr)
+    {
+        return;
+    }
+
+    const QSignalBlocker comboBoxBlocker(_layerComboBox);
+    const QSignalBlocker visibleBlocker(_visibleCheckBox);
+    const QSignalBlocker lockedBlocker(_lockedCheckBox);
+    const QSignalBlocker opacityBlocker(_opacitySlider);
+
+    _layerComboBox->clear();
+    for (int i = _paintArea->GetLayerCount() - 1; i >= 0; i--)
+    {
+        _layerComboBox->addItem(_paintArea->GetLayer(i)->GetName());
+    }
+    _layerComboBox->setCurrentIndex(_paintArea->GetLayerCount() - 1 - _paintArea->GetCurrentLayer());
+
+    _visibleCheckBox->setChecked(current->GetVisible());
+    _lockedCheckBox->setChecked(current->GetLocked());
+    _opacitySlider->setValue(qRound(current->GetOpacity() * 100));
+}
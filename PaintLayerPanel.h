@@ -0,0 +1,33 @@
+#ifndef PAINTLAYERPANEL_H
+#define PAINTLAYERPANEL_H
+
+#include <QGroupBox>
+#include <QComboBox>
+#include <QCheckBox>
+#include <QSlider>
+
+#include "PaintArea.h"
+
+/**
+ * @brief The PaintLayerPanel class 绘图区域的图层面板：当前图层、显示、锁定、不透明度、图层顺序以及图形的置顶、置底、移到当前图层。
+ */
+class PaintLayerPanel : public QGroupBox
+{
+    Q_OBJECT
+public:
+    explicit PaintLayerPanel(PaintArea *paintArea, QWidget *parent = nullptr);
+
+private:
+    PaintArea *_paintArea;
+    QComboBox *_layerComboBox;
+    QCheckBox *_visibleCheckBox;
+    QCheckBox *_lockedCheckBox;
+    QSlider *_opacitySlider;
+
+    /**
+     * @brief updateLayers 按绘图区域的图层刷新面板，不触发修改。
+     */
+    void updateLayers();
+};
+
+#endif // PAINTLAYERPANEL_H
@@ -7,6 +7,8 @@
 #include <QSizePolicy>
 #include <QScrollArea>
 #include <QGraphicsScene>
+#include <QStandardPaths>
+#include <QTimer>
 
 PaintPanel::PaintPanel(QWidget *parent) : QWidget(parent)
 {
@@ -31,13 +33,44 @@ PaintPanel::PaintPanel(QWidget *parent) : QWidget(parent)
     _paintToolBar->setMinimumWidth(100);
     _paintToolBar->setMaximumWidth(180);
 
+    _paintLayerPanel = new PaintLayerPanel(_paintAreaMain, this);
+    _paintLayerPanel->setMinimumWidth(100);
+    _paintLayerPanel->setMaximumWidth(180);
+
     this->layout()->addWidget(_paintToolBar);
     this->layout()->addWidget(_paintAreaMainWrapper);
+    this->layout()->addWidget(_paintLayerPanel);
 
     connect(_paintToolBar, &PaintToolBar::paintTypeChanged, this, [this](EPaintType type)
     {
         _paintAreaMain->SetPaintType(type);
     });
+    connect(_paintToolBar, &PaintToolBar::toolTypeChanged, this, [this](EToolType type)
+    {
+        _paintAreaMain->SetToolType(type);
+    });
+    connect(_paintToolBar, &PaintToolBar::fillColorChanged, this, [this](const QColor &color)
+    {
+        _paintAreaMain->SetFillColor(color);
+    });
+    connect(_paintToolBar, &PaintToolBar::textStyleChanged, this, [this](int style)
+    {
+        _paintAreaMain->SetTextStyle(style);
+    });
+    _paintAreaMain->SetImportSimplifyTolerance(PaintArea::DefaultSimplifyTolerance);
+    _paintAreaMain->SetCompactStorage(true);
+
     connect(_paintToolBar, &PaintToolBar::imageOptChanged,
             _paintAreaMain, &PaintAreaMain::ImageOptChangedHandler);
+    connect(_paintToolBar, &PaintToolBar::annotationOptChanged,
+            _paintAreaMain, &PaintAreaMain::AnnotationOptChangedHandler);
+
+    /*
+     * 窗口显示后再开启自动保存，恢复提示框以主窗口为父窗口。
+     */
+    QTimer::singleShot(0, this, [this]()
+    {
+        QString dirPath = QStandardPaths::writableLocation(QStandardPaths::AppLocalDataLocation) + "/autosave";
+        _paintAreaMain->EnableAutosave(dirPath, "paintAreaMain");
+    });
 }
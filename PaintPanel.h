@@ -5,6 +5,7 @@
 
 #include "PaintAreaMain.h"
 #include "PaintToolbar.h"
+#include "PaintLayerPanel.h"
 
 class PaintPanel : public QWidget
 {
@@ -16,6 +17,7 @@ private:
     PaintAreaMain *_paintAreaMain;
     PaintAreaMainWrapper *_paintAreaMainWrapper;
     PaintToolBar *_paintToolBar;
+    PaintLayerPanel *_paintLayerPanel;
 };
 
 #endif // PAINTPANEL_H
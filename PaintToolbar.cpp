@@ -1,8 +1,11 @@
 #include "PaintToolbar.h"
 
 #include <QVBoxLayout>
+#include <QHBoxLayout>
 #include <QSpacerItem>
 #include <QPushButton>
+#include <QColorDialog>
+#include <QIcon>
 
 PaintToolBar::PaintToolBar(QWidget *parent) : QGroupBox(parent)
 {
@@ -14,13 +17,69 @@ PaintToolBar::PaintToolBar(QWidget *parent) : QGroupBox(parent)
     addCheckBox(EPaintType::EPT_Line);
     addCheckBox(EPaintType::EPT_Arc);
     addCheckBox(EPaintType::EPT_Polyline);
+    addCheckBox(EPaintType::EPT_Freehand);
 
     addCheckBox(EPaintType::EPT_Circle);
     addCheckBox(EPaintType::EPT_Rect);
     addCheckBox(EPaintType::EPT_Ellipse);
     addCheckBox(EPaintType::EPT_Polygon);
+    addCheckBox(EPaintType::EPT_Text, ":/images/textpointer.png");
+
+    QPushButton *boldBtn = new QPushButton();
+    boldBtn->setIcon(QIcon(":/images/bold.png"));
+    boldBtn->setToolTip("粗体");
+    boldBtn->setCheckable(true);
+    QPushButton *italicBtn = new QPushButton();
+    italicBtn->setIcon(QIcon(":/images/italic.png"));
+    italicBtn->setToolTip("斜体");
+    italicBtn->setCheckable(true);
+    QPushButton *underlineBtn = new QPushButton();
+    underlineBtn->setIcon(QIcon(":/images/underline.png"));
+    underlineBtn->setToolTip("下划线");
+    underlineBtn->setCheckable(true);
+
+    auto textStyleHandler = [this, boldBtn, italicBtn, underlineBtn]()
+    {
+        int style = ETextStyle::ETS_Normal;
+        if (boldBtn->isChecked())
+        {
+            style |= ETextStyle::ETS_Bold;
+        }
+        if (italicBtn->isChecked())
+        {
+            style |= ETextStyle::ETS_Italic;
+        }
+        if (underlineBtn->isChecked())
+        {
+            style |= ETextStyle::ETS_Underline;
+        }
+        emit textStyleChanged(style);
+    };
+    connect(boldBtn, &QPushButton::toggled, this, textStyleHandler);
+    connect(italicBtn, &QPushButton::toggled, this, textStyleHandler);
+    connect(underlineBtn, &QPushButton::toggled, this, textStyleHandler);
+
+    QHBoxLayout *hLayout = new QHBoxLayout();
+    hLayout->addWidget(boldBtn);
+    hLayout->addWidget(italicBtn);
+    hLayout->addWidget(underlineBtn);
+    vLayout->addLayout(hLayout);
+
+    addToolCheckBox(EToolType::ETT_FloodFill, "油漆桶", ":/images/floodfill.png");
+    addToolCheckBox(EToolType::ETT_MagicWand, "魔棒", QString());
 
     QPushButton *btn = new QPushButton();
+    btn->setText("填充颜色");
+    btn->setIcon(QIcon(":/images/linecolor.png"));
+    connect(btn, &QPushButton::clicked, this, [this](){
+        QColor color = QColorDialog::getColor(Qt::red, this, "填充颜色", QColorDialog::ShowAlphaChannel);
+        if (color.isValid())
+        {
+            emit fillColorChanged(color);
+        }
+    });
+    this->layout()->addWidget(btn);
+    btn = new QPushButton();
     btn->setText("加载图片");
     connect(btn, &QPushButton::clicked, this, [this](){
         emit imageOptChanged(1);
@@ -38,19 +97,123 @@ PaintToolBar::PaintToolBar(QWidget *parent) : QGroupBox(parent)
         emit imageOptChanged(3);
     });
     this->layout()->addWidget(btn);
+    btn = new QPushButton();
+    btn->setText("卡尺测量");
+    btn->setCheckable(true);
+    connect(btn, &QPushButton::toggled, this, [this](bool checked){
+        emit imageOptChanged(checked ? 4 : 5);
+    });
+    this->layout()->addWidget(btn);
+    btn = new QPushButton();
+    btn->setText("圆拟合");
+    btn->setCheckable(true);
+    connect(btn, &QPushButton::toggled, this, [this](bool checked){
+        emit imageOptChanged(checked ? 6 : 7);
+    });
+    this->layout()->addWidget(btn);
+    btn = new QPushButton();
+    btn->setText("模板匹配");
+    connect(btn, &QPushButton::clicked, this, [this](){
+        emit imageOptChanged(8);
+    });
+    this->layout()->addWidget(btn);
+    btn = new QPushButton();
+    btn->setText("导入标注");
+    connect(btn, &QPushButton::clicked, this, [this](){
+        emit annotationOptChanged(1);
+    });
+    this->layout()->addWidget(btn);
+    btn = new QPushButton();
+    btn->setText("导出标注");
+    connect(btn, &QPushButton::clicked, this, [this](){
+        emit annotationOptChanged(2);
+    });
+    this->layout()->addWidget(btn);
+    btn = new QPushButton();
+    btn->setText("导出矢量图");
+    connect(btn, &QPushButton::clicked, this, [this](){
+        emit annotationOptChanged(3);
+    });
+    this->layout()->addWidget(btn);
+    btn = new QPushButton();
+    btn->setText("简化图形");
+    connect(btn, &QPushButton::clicked, this, [this](){
+        emit annotationOptChanged(4);
+    });
+    this->layout()->addWidget(btn);
+
+    hLayout = new QHBoxLayout();
+    btn = new QPushButton();
+    btn->setText("并集");
+    connect(btn, &QPushButton::clicked, this, [this](){
+        emit annotationOptChanged(5);
+    });
+    hLayout->addWidget(btn);
+    btn = new QPushButton();
+    btn->setText("交集");
+    connect(btn, &QPushButton::clicked, this, [this](){
+        emit annotationOptChanged(6);
+    });
+    hLayout->addWidget(btn);
+    btn = new QPushButton();
+    btn->setText("差集");
+    connect(btn, &QPushButton::clicked, this, [this](){
+        emit annotationOptChanged(7);
+    });
+    hLayout->addWidget(btn);
+    vLayout->addLayout(hLayout);
+
+    hLayout = new QHBoxLayout();
+    btn = new QPushButton();
+    btn->setText("重叠检查");
+    connect(btn, &QPushButton::clicked, this, [this](){
+        emit annotationOptChanged(8);
+    });
+    hLayout->addWidget(btn);
+    btn = new QPushButton();
+    btn->setText("清除标记");
+    connect(btn, &QPushButton::clicked, this, [this](){
+        emit annotationOptChanged(9);
+    });
+    hLayout->addWidget(btn);
+    vLayout->addLayout(hLayout);
 
     QSpacerItem *si = new QSpacerItem(10,10, QSizePolicy::Fixed, QSizePolicy::Expanding);
     vLayout->addSpacerItem(si);
 }
 
-void PaintToolBar::addCheckBox(EPaintType type)
+void PaintToolBar::addCheckBox(EPaintType type, const QString &iconPath)
 {
     CheckBoxWithPaintType *checkBox = new CheckBoxWithPaintType(type);
     checkBox->setText(PaintTypeStrings::GetStringZh(type));
+    if (!iconPath.isEmpty())
+    {
+        checkBox->setIcon(QIcon(iconPath));
+    }
     checkBox->setAutoExclusive(true);
     checkBox->setCheckable(true);
     checkBox->setChecked(false);
 
     this->layout()->addWidget(checkBox);
     connect(checkBox, SIGNAL(paintTypeChanged(EPaintType)), this, SIGNAL(paintTypeChanged(EPaintType)));
+    connect(checkBox, &CheckBoxWithPaintType::paintTypeChanged, this, [this]()
+    {
+        emit toolTypeChanged(EToolType::ETT_Paint);
+    });
+}
+
+void PaintToolBar::addToolCheckBox(EToolType type, const QString &text, const QString &iconPath)
+{
+    CheckBoxWithToolType *checkBox = new CheckBoxWithToolType(type);
+    checkBox->setText(text);
+    if (!iconPath.isEmpty())
+    {
+        checkBox->setIcon(QIcon(iconPath));
+    }
+    checkBox->setAutoExclusive(true);
+    checkBox->setCheckable(true);
+    checkBox->setChecked(false);
+
+    this->layout()->addWidget(checkBox);
+    connect(checkBox, &CheckBoxWithToolType::toolTypeChanged, this, &PaintToolBar::toolTypeChanged);
 }
@@ -4,6 +4,7 @@
 #include <QWidget>
 #include <QGroupBox>
 #include <QCheckBox>
+#include <QColor>
 
 #include "Types.h"
 
@@ -30,6 +31,29 @@ private:
     EPaintType _paintType;
 };
 
+class CheckBoxWithToolType : public QCheckBox
+{
+    Q_OBJECT
+public:
+    CheckBoxWithToolType(EToolType type, QWidget *parent = nullptr) : QCheckBox(parent)
+      , _toolType(type)
+    {
+        connect(this, &QCheckBox::stateChanged, this, [this](int state)
+        {
+            if (state == Qt::CheckState::Checked)
+            {
+                emit toolTypeChanged(_toolType);
+            }
+        });
+    }
+
+signals:
+    void toolTypeChanged(EToolType type);
+
+private:
+    EToolType _toolType;
+};
+
 class PaintToolBar : public QGroupBox
 {
     Q_OBJECT
@@ -38,10 +62,21 @@ public:
 
 signals:
     void paintTypeChanged(EPaintType type);
+    /**
+     * @brief toolTypeChanged 选中绘制类型时为ETT_Paint。
+     */
+    void toolTypeChanged(EToolType type);
+    void fillColorChanged(const QColor &color);
+    /**
+     * @brief textStyleChanged 文本样式，ETextStyle的组合。
+     */
+    void textStyleChanged(int style);
     void imageOptChanged(int optMode);
+    void annotationOptChanged(int optMode);
 
 private:
-    void addCheckBox(EPaintType type);
+    void addCheckBox(EPaintType type, const QString &iconPath = QString());
+    void addToolCheckBox(EToolType type, const QString &text, const QString &iconPath);
 };
 
 #endif // PAINTTOOLBAR_H
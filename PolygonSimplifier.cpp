@@ -0,0 +1,117 @@
+#include "PolygonSimplifier.h"
+
+#include <QPair>
+
+namespace
+{
+/*
+ * 点p到线段ab的距离的平方。
+ */
+qreal segmentDistance2(const QPoint &p, const QPoint &a, const QPoint &b)
+{
+    const qreal abX = b.x() - a.x();
+    const qreal abY = b.y() - a.y();
+    const qreal apX = p.x() - a.x();
+    const qreal apY = p.y() - a.y();
+    const qreal length2 = abX * abX + abY * abY;
+
+    qreal t = 0.0;
+    if (length2 > 0.0)
+    {
+        t = qBound(0.0, (apX * abX + apY * abY) / length2, 1.0);
+    }
+
+    const qreal dX = apX - t * abX;
+    const qreal dY = apY - t * abY;
+    return dX * dX + dY * dY;
+}
+}
+
+QPolygon PolygonSimplifier::Simplify(const QPolygon &polygon, qreal tolerance, bool closed)
+{
+    if ((polygon.count() < 3) || (tolerance <= 0.0))
+    {
+        return polygon;
+    }
+
+    QPolygon points = polygon;
+    QVector<bool> keep(points.count() + 1, false);
+    int last = points.count() - 1;
+    keep[0] = true;
+
+    if (closed)
+    {
+        /*
+         * 首个顶点重复一次作为终点，两段分别简化。
+         */
+        points << polygon.first();
+        last = points.count() - 1;
+
+        int farthest = 0;
+        qreal farthestDistance = -1.0;
+        for (int i = 1; i < last; i++)
+        {
+            const qreal dX = points.at(i).x() - points.at(0).x();
+            const qreal dY = points.at(i).y() - points.at(0).y();
+            if (dX * dX + dY * dY > farthestDistance)
+            {
+                farthestDistance = dX * dX + dY * dY;
+                farthest = i;
+            }
+        }
+
+        keep[farthest] = true;
+        simplifyRange(points, 0, farthest, tolerance, keep);
+        simplifyRange(points, farthest, last, tolerance, keep);
+    }
+    else
+    {
+        simplifyRange(points, 0, last, tolerance, keep);
+    }
+    keep[last] = true;
+
+    QPolygon result;
+    const int count = closed ? last : (last + 1);
+    for (int i = 0; i < count; i++)
+    {
+        if (keep.at(i))
+        {
+            result << points.at(i);
+        }
+    }
+
+    return result;
+}
+
+void PolygonSimplifier::simplifyRange(const QPolygon &points, int first, int last, qreal tolerance, QVector<bool> &keep)
+{
+    const qreal tolerance2 = tolerance * tolerance;
+    QVector<QPair<int, int>> ranges;
+    ranges.append(qMakePair(first, last));
+
+    while (!ranges.isEmpty())
+    {
+        const QPair<int, int> range = ranges.takeLast();
+        int farthest = -1;
+        qreal farthestDistance = tolerance2;
+
+        for (int i = range.first + 1; i < range.second; i++)
+        {
+            const qreal distance = segmentDistance2(points.at(i), points.at(range.first), points.at(range.second));
+            if (distance > farthestDistance)
+            {
+                farthestDistance = distance;
+                farthest = i;
+            }
+        }
+
+        if (farthest < 0)
+        {
+            continue;
+        }
+
+        keep[farthest] = true;
+        ranges.append(qMakePair(range.first, farthest));
+        ranges.append(qMakePair(farthest, range.second));
+    }
+}
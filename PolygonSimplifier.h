@@ -0,0 +1,28 @@
+#ifndef POLYGONSIMPLIFIER_H
+#define POLYGONSIMPLIFIER_H
+
+#include <QPolygon>
+
+/**
+ * @brief The PolygonSimplifier class 折线、多边形的顶点简化（Ramer-Douglas-Peucker）。
+ * @details 保留的顶点使简化后的折线与原折线的距离不超过容差；用显式栈代替递归，
+ * 顶点数很多时也不会栈溢出。
+ */
+class PolygonSimplifier
+{
+public:
+    /**
+     * @brief Simplify 简化折线或多边形。
+     * @param tolerance 允许的最大距离，不大于0时原样返回。
+     * @param closed 多边形：首尾相连，先在离首个顶点最远的顶点处分为两段再分别简化。
+     */
+    static QPolygon Simplify(const QPolygon &polygon, qreal tolerance, bool closed);
+
+private:
+    /**
+     * @brief simplifyRange 简化points[first, last]，保留的顶点在keep中置为true。
+     */
+    static void simplifyRange(const QPolygon &points, int first, int last, qreal tolerance, QVector<bool> &keep);
+};
+
+#endif // POLYGONSIMPLIFIER_H
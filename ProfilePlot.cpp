@@ -0,0 +1,115 @@
+#include "ProfilePlot.h"
+
+#include <QPainter>
+#include <QPainterPath>
+#include <QtMath>
+#include <QStringList>
+
+ProfilePlot::ProfilePlot(QWidget *parent) : QWidget(parent)
+  , _length(0.0)
+  , _level(0)
+{
+    this->setAttribute(Qt::WA_TransparentForMouseEvents);
+}
+
+void ProfilePlot::SetProfile(const QVector<float> &values, qreal length, int level)
+{
+    _values = values;
+    _length = length;
+    _level = level;
+    this->update();
+}
+
+void ProfilePlot::ClearProfile()
+{
+    _values.clear();
+    _length = 0.0;
+    _caliperResult = CaliperResult();
+    this->update();
+}
+
+void ProfilePlot::SetEdges(const CaliperResult &result)
+{
+    _caliperResult = result;
+    this->update();
+}
+
+void ProfilePlot::paintEvent(QPaintEvent *event)
+{
+    Q_UNUSED(event)
+    QPainter painter(this);
+    painter.fillRect(this->rect(), QColor(0, 0, 0, 160));
+
+    QRectF plotRect = QRectF(this->rect()).adjusted(PlotMargin, PlotMargin / 2, -PlotMargin / 2, -PlotMargin);
+    painter.setPen(QColor(200, 200, 200));
+    painter.drawRect(plotRect);
+
+    if (_values.count() < 2)
+    {
+        painter.drawText(this->rect(), Qt::AlignCenter, "灰度剖面：绘制或选中一条直线");
+        return;
+    }
+
+    /*
+     * 每个采样一个顶点，遇到NaN时开始新的子路径。
+     */
+    QPainterPath path;
+    bool drawing = false;
+    float minValue = 255.0f;
+    float maxValue = 0.0f;
+    qreal stepX = plotRect.width() / (_values.count() - 1);
+    for (int i = 0; i < _values.count(); i++)
+    {
+        float value = _values.at(i);
+        if (qIsNaN(value))
+        {
+            drawing = false;
+            continue;
+        }
+
+        minValue = qMin(minValue, value);
+        maxValue = qMax(maxValue, value);
+        QPointF point(plotRect.left() + stepX * i, plotRect.bottom() - plotRect.height() * value / 255.0);
+        if (drawing)
+        {
+            path.lineTo(point);
+        }
+        else
+        {
+            path.moveTo(point);
+            drawing = true;
+        }
+    }
+
+    painter.setRenderHint(QPainter::Antialiasing, true);
+    painter.setPen(QColor("#7cfc00"));
+    painter.drawPath(path);
+
+    if (_length > 0.0)
+    {
+        QStringList widths;
+        for (const CaliperEdge &edge : _caliperResult.edges)
+        {
+            qreal x = plotRect.left() + plotRect.width() * edge.position / _length;
+            painter.setPen((edge.polarity == EEdgePolarity::EEP_Rising) ? QColor("#00bfff") : QColor("#ff8c00"));
+            painter.drawLine(QPointF(x, plotRect.top()), QPointF(x, plotRect.bottom()));
+        }
+        for (const CaliperPair &pair : _caliperResult.pairs)
+        {
+            widths.append(QString::number(pair.width, 'f', 2));
+        }
+        if (!widths.isEmpty())
+        {
+            painter.setPen(Qt::white);
+            painter.drawText(plotRect.adjusted(4, 2, -4, -2), Qt::AlignLeft | Qt::AlignTop | Qt::TextWordWrap,
+                             QString("宽度:%0").arg(widths.join(", ")));
+        }
+    }
+
+    painter.setPen(Qt::white);
+    painter.drawText(QRectF(0, plotRect.bottom(), this->width(), PlotMargin), Qt::AlignCenter,
+                     QString("长度:%0 层:%1 最小:%2 最大:%3").arg(QString::number(_length, 'f', 1)).arg(_level)
+                     .arg(QString::number(minValue, 'f', 0)).arg(QString::number(maxValue, 'f', 0)));
+    painter.drawText(QRectF(0, plotRect.top() - 6, PlotMargin - 2, 12), Qt::AlignRight | Qt::AlignVCenter, "255");
+    painter.drawText(QRectF(0, plotRect.bottom() - 6, PlotMargin - 2, 12), Qt::AlignRight | Qt::AlignVCenter, "0");
+}
@@ -0,0 +1,43 @@
+#ifndef PROFILEPLOT_H
+#define PROFILEPLOT_H
+
+#include <QWidget>
+#include <QVector>
+
+#include "EdgeCaliper.h"
+
+/**
+ * @brief The ProfilePlot class 灰度剖面曲线：横轴为沿线段的距离（原图像素），纵轴为灰度0～255。
+ * @details 值为NaN的采样（图片外）断开曲线。设置了卡尺结果时，在边缘位置画竖线并显示各对边缘的宽度。
+ */
+class ProfilePlot : public QWidget
+{
+    Q_OBJECT
+public:
+    constexpr static int PlotMargin = 24;
+
+    explicit ProfilePlot(QWidget *parent = nullptr);
+
+    /**
+     * @brief SetProfile 设置剖面并重绘。
+     * @param length 线段的长度（原图像素）。
+     * @param level 采样所在的金字塔层。
+     */
+    void SetProfile(const QVector<float> &values, qreal length, int level);
+    void ClearProfile();
+    /**
+     * @brief SetEdges 同一线段的卡尺结果，result.edges为空时不显示。
+     */
+    void SetEdges(const CaliperResult &result);
+
+protected:
+    void paintEvent(QPaintEvent *event) override;
+
+private:
+    QVector<float> _values;
+    qreal _length;
+    int _level;
+    CaliperResult _caliperResult;
+};
+
+#endif // PROFILEPLOT_H
@@ -0,0 +1,469 @@
+#include "RoiStatistics.h"
+
+#include <algorithm>
+#include <QtMath>
+#include <QtConcurrent>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#define ROISTATISTICS_SSE2
+#include <emmintrin.h>
+#endif
+
+RoiStatistics::RoiStatistics() : _width(0)
+  , _height(0)
+  , _blockColumns(0)
+{
+}
+
+void RoiStatistics::Build(const QImage &gray)
+{
+    this->Clear();
+    if (gray.isNull())
+    {
+        return;
+    }
+
+    _gray = gray;
+    _width = gray.width();
+    _height = gray.height();
+
+    const int stride = _width + 1;
+    _sum.fill(0, qint64(stride) * (_height + 1));
+    _sqSum.fill(0, qint64(stride) * (_height + 1));
+    quint32 *sumBits = _sum.data();
+    quint32 *sqSumBits = _sqSum.data();
+
+    /*
+     * 先并行计算每行的前缀和，再按列分块并行地逐行向下累加。各任务写入不同的行或列。
+     * 无符号数溢出时按2^32回绕，查表时的差值不受影响。
+     */
+    QVector<int> rowTasks;
+    for (int y = 0; y < _height; y += RowsPerTask)
+    {
+        rowTasks.append(y);
+    }
+    QtConcurrent::blockingMap(rowTasks, [this, stride, sumBits, sqSumBits](const int &top)
+    {
+        const int bottom = qMin(top + int(RowsPerTask), _height);
+        for (int y = top; y < bottom; y++)
+        {
+            const uchar *row = _gray.constScanLine(y);
+            quint32 *sumRow = sumBits + qint64(y + 1) * stride;
+            quint32 *sqSumRow = sqSumBits + qint64(y + 1) * stride;
+            quint32 sum = 0;
+            quint32 sqSum = 0;
+
+            for (int x = 0; x < _width; x++)
+            {
+                const quint32 value = row[x];
+                sum += value;
+                sqSum += value * value;
+                sumRow[x + 1] = sum;
+                sqSumRow[x + 1] = sqSum;
+            }
+        }
+    });
+
+    QVector<int> columnTasks;
+    for (int x = 0; x < stride; x += ColumnsPerTask)
+    {
+        columnTasks.append(x);
+    }
+    QtConcurrent::blockingMap(columnTasks, [this, stride, sumBits, sqSumBits](const int &left)
+    {
+        const int right = qMin(left + int(ColumnsPerTask), stride);
+        for (int y = 2; y <= _height; y++)
+        {
+            const qint64 upper = qint64(y - 1) * stride;
+            const qint64 current = qint64(y) * stride;
+            for (int x = left; x < right; x++)
+            {
+                sumBits[current + x] += sumBits[upper + x];
+                sqSumBits[current + x] += sqSumBits[upper + x];
+            }
+        }
+    });
+
+    /*
+     * 块统计只包含完整的块，图片右、下边缘不足一块的部分总是逐像素扫描。
+     */
+    _blockColumns = _width / BlockSize;
+    const int blockRows = _height / BlockSize;
+    _blockMin.fill(0, _blockColumns * blockRows);
+    _blockMax.fill(0, _blockColumns * blockRows);
+    uchar *blockMinBits = _blockMin.data();
+    uchar *blockMaxBits = _blockMax.data();
+
+    QVector<int> blockTasks;
+    for (int by = 0; by < blockRows; by++)
+    {
+        blockTasks.append(by);
+    }
+    QtConcurrent::blockingMap(blockTasks, [this, blockMinBits, blockMaxBits](const int &by)
+    {
+        for (int bx = 0; bx < _blockColumns; bx++)
+        {
+            int min = 255;
+            int max = 0;
+            for (int y = by * BlockSize; y < (by + 1) * BlockSize; y++)
+            {
+                this->scanMinMax(y, bx * BlockSize, (bx + 1) * BlockSize - 1, min, max);
+            }
+            blockMinBits[by * _blockColumns + bx] = uchar(min);
+            blockMaxBits[by * _blockColumns + bx] = uchar(max);
+        }
+    });
+}
+
+void RoiStatistics::Clear()
+{
+    _gray = QImage();
+    _width = 0;
+    _height = 0;
+    _sum.clear();
+    _sqSum.clear();
+    _blockColumns = 0;
+    _blockMin.clear();
+    _blockMax.clear();
+}
+
+bool RoiStatistics::RectStats(const QPoint &p1, const QPoint &p2, RoiStats &stats) const
+{
+    const int left = qMax(0, qMin(p1.x(), p2.x()));
+    const int right = qMin(_width, qMax(p1.x(), p2.x()));
+    const int top = qMax(0, qMin(p1.y(), p2.y()));
+    const int bottom = qMin(_height, qMax(p1.y(), p2.y()));
+    if ((left >= right) || (top >= bottom))
+    {
+        return false;
+    }
+
+    Accumulator accumulator;
+    accumulator.count = qint64(right - left) * (bottom - top);
+    accumulator.sum = this->rectSum(_sum, 255, left, top, right, bottom);
+    accumulator.sqSum = this->rectSum(_sqSum, 255 * 255, left, top, right, bottom);
+    accumulator.min = 255;
+    accumulator.max = 0;
+
+    /*
+     * 完整覆盖的块[bx0, bx1) x [by0, by1)查块统计，其余部分逐像素扫描。
+     */
+    const int bx0 = (left + BlockSize - 1) / BlockSize;
+    const int bx1 = right / BlockSize;
+    const int by0 = (top + BlockSize - 1) / BlockSize;
+    const int by1 = bottom / BlockSize;
+
+    if ((bx0 < bx1) && (by0 < by1))
+    {
+        for (int by = by0; by < by1; by++)
+        {
+            for (int bx = bx0; bx < bx1; bx++)
+            {
+                accumulator.min = qMin(accumulator.min, int(_blockMin.at(by * _blockColumns + bx)));
+                accumulator.max = qMax(accumulator.max, int(_blockMax.at(by * _blockColumns + bx)));
+            }
+        }
+
+        for (int y = top; y < bottom; y++)
+        {
+            if ((y < by0 * BlockSize) || (y >= by1 * BlockSize))
+            {
+                this->scanMinMax(y, left, right - 1, accumulator.min, accumulator.max);
+                continue;
+            }
+            if (left < bx0 * BlockSize)
+            {
+                this->scanMinMax(y, left, bx0 * BlockSize - 1, accumulator.min, accumulator.max);
+            }
+            if (bx1 * BlockSize < right)
+            {
+                this->scanMinMax(y, bx1 * BlockSize, right - 1, accumulator.min, accumulator.max);
+            }
+        }
+    }
+    else
+    {
+        for (int y = top; y < bottom; y++)
+        {
+            this->scanMinMax(y, left, right - 1, accumulator.min, accumulator.max);
+        }
+    }
+
+    return finish(accumulator, stats);
+}
+
+bool RoiStatistics::EllipseStats(const QRectF &rect, RoiStats &stats) const
+{
+    const QRectF ellipse = rect.normalized();
+    const qreal a = ellipse.width() / 2.0;
+    const qreal b = ellipse.height() / 2.0;
+    if ((a <= 0.0) || (b <= 0.0) || _gray.isNull())
+    {
+        return false;
+    }
+
+    const QPointF center = ellipse.center();
+    const int yStart = qMax(0, qCeil(ellipse.top() - 0.5));
+    const int yEnd = qMin(_height, qCeil(ellipse.bottom() - 0.5));
+
+    QVector<FillSpan> spans;
+    for (int y = yStart; y < yEnd; y++)
+    {
+        const qreal dy = (y + 0.5 - center.y()) / b;
+        const qreal t = 1.0 - dy * dy;
+        if (t <= 0.0)
+        {
+            continue;
+        }
+
+        const qreal half = a * std::sqrt(t);
+        this->appendSpan(spans, y, center.x() - half, center.x() + half);
+    }
+
+    return this->accumulateSpans(spans, stats);
+}
+
+bool RoiStatistics::PolygonStats(const QPolygon &polygon, RoiStats &stats) const
+{
+    if ((polygon.count() < 3) || _gray.isNull())
+    {
+        return false;
+    }
+
+    struct Edge
+    {
+        qreal top;
+        qreal bottom;
+        qreal x;
+        qreal dx;
+        qreal dy;
+    };
+
+    /*
+     * 水平边不与任何扫描线相交。x为边在top处的横坐标。交点先乘后除，顶点为整数时交点恰好落在像素中心上也能精确判断。
+     */
+    QVector<Edge> edges;
+    edges.reserve(polygon.count());
+    qreal minY = polygon.first().y();
+    qreal maxY = minY;
+    for (int i = 0; i < polygon.count(); i++)
+    {
+        QPointF p1 = polygon.at(i);
+        QPointF p2 = polygon.at((i + 1) % polygon.count());
+        minY = qMin(minY, p1.y());
+        maxY = qMax(maxY, p1.y());
+        if (p1.y() == p2.y())
+        {
+            continue;
+        }
+        if (p1.y() > p2.y())
+        {
+            std::swap(p1, p2);
+        }
+
+        Edge edge;
+        edge.top = p1.y();
+        edge.bottom = p2.y();
+        edge.x = p1.x();
+        edge.dx = p2.x() - p1.x();
+        edge.dy = p2.y() - p1.y();
+        edges.append(edge);
+    }
+    std::sort(edges.begin(), edges.end(), [](const Edge &e1, const Edge &e2)
+    {
+        return e1.top < e2.top;
+    });
+
+    const int yStart = qMax(0, qCeil(minY - 0.5));
+    const int yEnd = qMin(_height, qCeil(maxY - 0.5));
+
+    QVector<FillSpan> spans;
+    QVector<int> active;
+    QVector<qreal> crossings;
+    int next = 0;
+    for (int y = yStart; y < yEnd; y++)
+    {
+        const qreal yc = y + 0.5;
+
+        /*
+         * 活动边为top <= yc < bottom的边。
+         */
+        while ((next < edges.count()) && (edges.at(next).top <= yc))
+        {
+            active.append(next++);
+        }
+        active.erase(std::remove_if(active.begin(), active.end(), [&edges, yc](int index)
+        {
+            return edges.at(index).bottom <= yc;
+        }), active.end());
+
+        crossings.clear();
+        for (int index : active)
+        {
+            const Edge &edge = edges.at(index);
+            crossings.append(edge.x + (yc - edge.top) * edge.dx / edge.dy);
+        }
+        std::sort(crossings.begin(), crossings.end());
+
+        for (int i = 0; i + 1 < crossings.count(); i += 2)
+        {
+            this->appendSpan(spans, y, crossings.at(i), crossings.at(i + 1));
+        }
+    }
+
+    return this->accumulateSpans(spans, stats);
+}
+
+quint64 RoiStatistics::rectSum(const QVector<quint32> &table, quint32 maxValue, int left, int top, int right,
+                               int bottom) const
+{
+    /*
+     * 每块不超过maxPixels个像素：宽度不超过时按行分条，否则每行再按列分段。
+     */
+    const int maxPixels = int(0xFFFFFFFFu / maxValue);
+    const int columns = qMin(right - left, maxPixels);
+    const int rows = qMax(1, maxPixels / qMax(1, columns));
+
+    quint64 sum = 0;
+    for (int y = top; y < bottom; y += rows)
+    {
+        const int y1 = qMin(y + rows, bottom);
+        for (int x = left; x < right; x += columns)
+        {
+            sum += this->tableSum(table, x, y, qMin(x + columns, right), y1);
+        }
+    }
+
+    return sum;
+}
+
+quint32 RoiStatistics::tableSum(const QVector<quint32> &table, int left, int top, int right, int bottom) const
+{
+    const qint64 stride = _width + 1;
+    return table.at(bottom * stride + right) - table.at(top * stride + right) -
+            table.at(bottom * stride + left) + table.at(top * stride + left);
+}
+
+void RoiStatistics::scanMinMax(int y, int left, int right, int &min, int &max) const
+{
+    const uchar *row = _gray.constScanLine(y);
+    int x = left;
+
+#ifdef ROISTATISTICS_SSE2
+    if (right - x + 1 >= 16)
+    {
+        __m128i vmin = _mm_set1_epi8(char(min));
+        __m128i vmax = _mm_set1_epi8(char(max));
+        for (; x + 16 <= right + 1; x += 16)
+        {
+            const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(row + x));
+            vmin = _mm_min_epu8(vmin, v);
+            vmax = _mm_max_epu8(vmax, v);
+        }
+
+        alignas(16) uchar mins[16];
+        alignas(16) uchar maxs[16];
+        _mm_store_si128(reinterpret_cast<__m128i *>(mins), vmin);
+        _mm_store_si128(reinterpret_cast<__m128i *>(maxs), vmax);
+        for (int i = 0; i < 16; i++)
+        {
+            min = qMin(min, int(mins[i]));
+            max = qMax(max, int(maxs[i]));
+        }
+    }
+#endif
+
+    for (; x <= right; x++)
+    {
+        min = qMin(min, int(row[x]));
+        max = qMax(max, int(row[x]));
+    }
+}
+
+bool RoiStatistics::accumulateSpans(const QVector<FillSpan> &spans, RoiStats &stats) const
+{
+    Accumulator accumulator;
+    accumulator.count = 0;
+    accumulator.sum = 0;
+    accumulator.sqSum = 0;
+    accumulator.min = 255;
+    accumulator.max = 0;
+
+    for (const FillSpan &span : spans)
+    {
+        accumulator.count += span.right - span.left + 1;
+        accumulator.sum += this->rectSum(_sum, 255, span.left, span.y, span.right + 1, span.y + 1);
+        accumulator.sqSum += this->rectSum(_sqSum, 255 * 255, span.left, span.y, span.right + 1, span.y + 1);
+    }
+
+    if (accumulator.count < ParallelMinPixels)
+    {
+        for (const FillSpan &span : spans)
+        {
+            this->scanMinMax(span.y, span.left, span.right, accumulator.min, accumulator.max);
+        }
+        return finish(accumulator, stats);
+    }
+
+    struct MinMaxTask
+    {
+        int begin;
+        int end;
+        int min;
+        int max;
+    };
+
+    QVector<MinMaxTask> tasks;
+    for (int i = 0; i < spans.count(); i += RowsPerTask)
+    {
+        tasks.append({i, qMin(i + int(RowsPerTask), spans.count()), 255, 0});
+    }
+    QtConcurrent::blockingMap(tasks, [this, &spans](MinMaxTask &task)
+    {
+        for (int i = task.begin; i < task.end; i++)
+        {
+            const FillSpan &span = spans.at(i);
+            this->scanMinMax(span.y, span.left, span.right, task.min, task.max);
+        }
+    });
+
+    for (const MinMaxTask &task : tasks)
+    {
+        accumulator.min = qMin(accumulator.min, task.min);
+        accumulator.max = qMax(accumulator.max, task.max);
+    }
+    return finish(accumulator, stats);
+}
+
+void RoiStatistics::appendSpan(QVector<FillSpan> &spans, int y, qreal left, qreal right) const
+{
+    /*
+     * 像素中心x + 0.5在[left, right)内。
+     */
+    const int x0 = qMax(0, qCeil(left - 0.5));
+    const int x1 = qMin(_width, qCeil(right - 0.5));
+    if (x0 < x1)
+    {
+        spans.append({y, x0, x1 - 1});
+    }
+}
+
+bool RoiStatistics::finish(const Accumulator &accumulator, RoiStats &stats)
+{
+    stats.count = accumulator.count;
+    if (accumulator.count <= 0)
+    {
+        stats.mean = 0.0;
+        stats.stdDev = 0.0;
+        stats.min = 0;
+        stats.max = 0;
+        return false;
+    }
+
+    const double count = double(accumulator.count);
+    stats.mean = double(accumulator.sum) / count;
+    stats.stdDev = std::sqrt(qMax(0.0, double(accumulator.sqSum) / count - stats.mean * stats.mean));
+    stats.min = accumulator.min;
+    stats.max = accumulator.max;
+    return true;
+}
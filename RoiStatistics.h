@@ -0,0 +1,109 @@
+#ifndef ROISTATISTICS_H
+#define ROISTATISTICS_H
+
+#include <QImage>
+#include <QVector>
+#include <QRect>
+#include <QPolygon>
+
+#include "FloodFill.h"
+
+/**
+ * @brief The RoiStats struct 区域内像素灰度的统计值，count为0时其它值无意义。
+ */
+struct RoiStats
+{
+    qint64 count;
+    double mean;
+    double stdDev;
+    int min;
+    int max;
+};
+
+/**
+ * @brief The RoiStatistics class 灰度图上矩形、椭圆、多边形区域的像素统计。
+ * @details
+ * - 像素中心在区域内（多边形按奇偶规则）的像素属于区域，区域超出图片的部分忽略。
+ * - 生成时计算灰度与灰度平方的积分图（summed-area table），任意矩形或行段的和、平方和为4次查表。
+ *   积分图为32位、按2^32取回绕，每像素共8字节：区域的和小于2^32时4次查表的差仍然精确，
+ *   即平方和每次查表最多覆盖2^32 / 255^2（约6.6万）个像素，较大的矩形按行分条查表后用64位累加。
+ * - 最小、最大值另按BlockSize x BlockSize的块预先统计，矩形只逐像素扫描未覆盖整块的边缘，
+ *   椭圆、多边形按行段逐像素扫描，支持SSE2时一次比较16个像素。
+ * - 椭圆、多边形按扫描线转换为行段，多边形用按上端排序的活动边表，每行只处理与该行相交的边。
+ *   像素较多时行段分组在线程池中并行扫描最小、最大值。
+ */
+class RoiStatistics
+{
+public:
+    constexpr static int BlockSize = 16;
+    constexpr static int RowsPerTask = 64;
+    constexpr static int ColumnsPerTask = 1024;
+    constexpr static qint64 ParallelMinPixels = 1024 * 1024;
+
+    RoiStatistics();
+
+    /**
+     * @brief Build 由灰度图gray（Grayscale8）重新生成积分图和块统计，gray为空时清空。
+     */
+    void Build(const QImage &gray);
+    void Clear();
+    bool IsEmpty() const
+    {
+        return _gray.isNull();
+    }
+
+    /**
+     * @brief RectStats 矩形[left, right) x [top, bottom)的统计，坐标为场景坐标（与图片像素对齐）。
+     * @return false - 区域内没有像素。
+     */
+    bool RectStats(const QPoint &p1, const QPoint &p2, RoiStats &stats) const;
+    /**
+     * @brief EllipseStats 外接矩形为rect的椭圆的统计。
+     */
+    bool EllipseStats(const QRectF &rect, RoiStats &stats) const;
+    /**
+     * @brief PolygonStats 闭合多边形的统计，少于3个顶点时没有像素。
+     */
+    bool PolygonStats(const QPolygon &polygon, RoiStats &stats) const;
+
+private:
+    struct Accumulator
+    {
+        qint64 count;
+        quint64 sum;
+        quint64 sqSum;
+        int min;
+        int max;
+    };
+
+    QImage _gray;
+    int _width;
+    int _height;
+    /**
+     * @brief 积分图，(_width + 1) x (_height + 1)，(x, y)处为[0, x) x [0, y)的和对2^32取模。
+     */
+    QVector<quint32> _sum;
+    QVector<quint32> _sqSum;
+    int _blockColumns;
+    QVector<uchar> _blockMin;
+    QVector<uchar> _blockMax;
+
+    /**
+     * @brief rectSum 矩形[left, right) x [top, bottom)的和，maxValue为单个像素的最大值（255或255^2）。
+     * 按maxValue分块，使每块的和小于2^32。
+     */
+    quint64 rectSum(const QVector<quint32> &table, quint32 maxValue, int left, int top, int right, int bottom) const;
+    quint32 tableSum(const QVector<quint32> &table, int left, int top, int right, int bottom) const;
+    /**
+     * @brief scanMinMax 第y行[left, right]（包含两端）的最小、最大值合并到min、max。
+     */
+    void scanMinMax(int y, int left, int right, int &min, int &max) const;
+    /**
+     * @brief accumulateSpans 行段已裁剪到图片内。
+     */
+    bool accumulateSpans(const QVector<FillSpan> &spans, RoiStats &stats) const;
+    void appendSpan(QVector<FillSpan> &spans, int y, qreal left, qreal right) const;
+    static bool finish(const Accumulator &accumulator, RoiStats &stats);
+};
+
+#endif // ROISTATISTICS_H
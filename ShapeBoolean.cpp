@@ -0,0 +1,405 @@
+#include "ShapeBoolean.h"
+
+#include <algorithm>
+#include <limits>
+#include <QtMath>
+#include <QtConcurrent>
+
+namespace
+{
+/*
+ * 面积的2倍，带符号。
+ */
+qreal signedArea2(const QPolygonF &polygon)
+{
+    qreal sum = 0.0;
+    for (int i = 0, j = polygon.count() - 1; i < polygon.count(); j = i++)
+    {
+        sum += polygon.at(j).x() * polygon.at(i).y() - polygon.at(i).x() * polygon.at(j).y();
+    }
+    return sum;
+}
+
+qreal cross(const QPointF &o, const QPointF &a, const QPointF &b)
+{
+    return (a.x() - o.x()) * (b.y() - o.y()) - (a.y() - o.y()) * (b.x() - o.x());
+}
+
+/*
+ * 点在三角形内或边上。
+ */
+bool inTriangle(const QPointF &p, const QPointF &a, const QPointF &b, const QPointF &c)
+{
+    const qreal d1 = cross(a, b, p);
+    const qreal d2 = cross(b, c, p);
+    const qreal d3 = cross(c, a, p);
+    const bool hasNegative = (d1 < 0.0) || (d2 < 0.0) || (d3 < 0.0);
+    const bool hasPositive = (d1 > 0.0) || (d2 > 0.0) || (d3 > 0.0);
+    return !(hasNegative && hasPositive);
+}
+
+int rightmostVertex(const QPolygonF &polygon)
+{
+    int index = 0;
+    for (int i = 1; i < polygon.count(); i++)
+    {
+        if (polygon.at(i).x() > polygon.at(index).x())
+        {
+            index = i;
+        }
+    }
+    return index;
+}
+}
+
+bool ShapeBoolean::IsSupported(const GeometryShape *shape)
+{
+    switch (shape->GetPaintType())
+    {
+    case EPaintType::EPT_Polygon:
+    case EPaintType::EPT_Rect:
+    case EPaintType::EPT_Ellipse:
+    case EPaintType::EPT_Circle:
+        return shape->GetCompleted();
+    default:
+        break;
+    }
+
+    return false;
+}
+
+QPainterPath ShapeBoolean::ToPath(const GeometryShape *shape)
+{
+    QPainterPath path;
+
+    switch (shape->GetPaintType())
+    {
+    case EPaintType::EPT_Polygon:
+    case EPaintType::EPT_Rect:
+        path = shape->GetPath();
+        break;
+    case EPaintType::EPT_Ellipse:
+    case EPaintType::EPT_Circle:
+        path.addPolygon(flattenEllipse(shape->GetPath().boundingRect()));
+        path.closeSubpath();
+        break;
+    default:
+        break;
+    }
+
+    return path;
+}
+
+QList<QPolygon> ShapeBoolean::Combine(const QVector<QPainterPath> &paths, EBooleanOp op)
+{
+    QList<QPolygon> polygons;
+    if (paths.isEmpty())
+    {
+        return polygons;
+    }
+
+    QPainterPath result;
+    if (op == EBooleanOp::EBO_Difference)
+    {
+        result = paths.first();
+        if (paths.count() > 1)
+        {
+            result = result.subtracted(reduce(paths.mid(1), EBooleanOp::EBO_Union));
+        }
+    }
+    else
+    {
+        result = reduce(paths, op);
+    }
+
+    /*
+     * 去掉闭合点。被奇数个环包含的环为孔，其余为外轮廓。
+     */
+    QList<QPolygonF> rings;
+    for (QPolygonF ring : result.toSubpathPolygons())
+    {
+        while ((ring.count() > 1) && (ring.last() == ring.first()))
+        {
+            ring.removeLast();
+        }
+        if (ring.count() >= 3)
+        {
+            rings.append(ring);
+        }
+    }
+
+    /*
+     * 包含一个环的环面积一定更大。按面积从大到小排序后，从后往前第一个包含它的环就是直接包含它的环，
+     * 层数比它少一；先比较边界框，只有边界框包含时才判断点是否在环内。
+     */
+    QVector<int> order(rings.count());
+    QVector<qreal> areas(rings.count());
+    QVector<QRectF> bounds(rings.count());
+    for (int i = 0; i < rings.count(); i++)
+    {
+        order[i] = i;
+        areas[i] = qAbs(signedArea2(rings.at(i)));
+        bounds[i] = rings.at(i).boundingRect();
+    }
+    std::sort(order.begin(), order.end(), [&areas](int i1, int i2)
+    {
+        return areas.at(i1) > areas.at(i2);
+    });
+
+    QVector<int> depths(rings.count(), 0);
+    QVector<int> parents(rings.count(), -1);
+    for (int k = 0; k < order.count(); k++)
+    {
+        const int i = order.at(k);
+        for (int l = k - 1; l >= 0; l--)
+        {
+            const int j = order.at(l);
+            if (bounds.at(j).contains(bounds.at(i)) &&
+                    rings.at(j).containsPoint(rings.at(i).first(), Qt::FillRule::OddEvenFill))
+            {
+                depths[i] = depths.at(j) + 1;
+                parents[i] = j;
+                break;
+            }
+        }
+    }
+
+    /*
+     * 孔（层数为奇数）直接所在的环是外轮廓。
+     */
+    QVector<QList<QPolygonF>> holes(rings.count());
+    for (int i = 0; i < rings.count(); i++)
+    {
+        if ((depths.at(i) % 2 != 0) && (parents.at(i) >= 0))
+        {
+            holes[parents.at(i)].append(rings.at(i));
+        }
+    }
+
+    for (int i = 0; i < rings.count(); i++)
+    {
+        if (depths.at(i) % 2 != 0)
+        {
+            continue;
+        }
+
+        QPolygon polygon = roundPolygon(bridgeHoles(rings.at(i), holes.at(i)));
+        if (polygon.count() >= 3)
+        {
+            polygons.append(polygon);
+        }
+    }
+
+    return polygons;
+}
+
+QPainterPath ShapeBoolean::reduce(QVector<QPainterPath> paths, EBooleanOp op)
+{
+    while (paths.count() > 1)
+    {
+        QVector<QPainterPath> next((paths.count() + 1) / 2);
+        QVector<int> indexes(next.count());
+        for (int i = 0; i < indexes.count(); i++)
+        {
+            indexes[i] = i;
+        }
+
+        /*
+         * 每个任务只读取自己的一对路径、写入自己的结果，任务之间不共享路径。
+         */
+        auto combinePair = [&paths, &next, op](int i)
+        {
+            if (2 * i + 1 >= paths.count())
+            {
+                next[i] = paths.at(2 * i);
+            }
+            else if (op == EBooleanOp::EBO_Intersection)
+            {
+                next[i] = paths.at(2 * i).intersected(paths.at(2 * i + 1));
+            }
+            else
+            {
+                next[i] = paths.at(2 * i).united(paths.at(2 * i + 1));
+            }
+        };
+
+        if (paths.count() >= ParallelMinShapes)
+        {
+            QtConcurrent::blockingMap(indexes, combinePair);
+        }
+        else
+        {
+            for (int i : indexes)
+            {
+                combinePair(i);
+            }
+        }
+
+        paths = next;
+    }
+
+    return paths.first();
+}
+
+QPolygonF ShapeBoolean::bridgeHoles(QPolygonF outer, QList<QPolygonF> holes)
+{
+    if (signedArea2(outer) < 0.0)
+    {
+        std::reverse(outer.begin(), outer.end());
+    }
+    for (QPolygonF &hole : holes)
+    {
+        if (signedArea2(hole) > 0.0)
+        {
+            std::reverse(hole.begin(), hole.end());
+        }
+    }
+
+    /*
+     * 先接入最右的孔，之后的孔向右的射线只会遇到已接入的外轮廓。
+     */
+    std::sort(holes.begin(), holes.end(), [](const QPolygonF &h1, const QPolygonF &h2)
+    {
+        return h1.at(rightmostVertex(h1)).x() > h2.at(rightmostVertex(h2)).x();
+    });
+
+    for (const QPolygonF &hole : holes)
+    {
+        const int holeIndex = rightmostVertex(hole);
+        const QPointF m = hole.at(holeIndex);
+        const int count = outer.count();
+
+        /*
+         * 从m向右的射线与外轮廓最近的交点I，所在边上x较大的端点P为候选。
+         */
+        qreal nearestX = 0.0;
+        int edge = -1;
+        for (int i = 0; i < count; i++)
+        {
+            const QPointF &a = outer.at(i);
+            const QPointF &b = outer.at((i + 1) % count);
+            if ((a.y() > m.y()) == (b.y() > m.y()))
+            {
+                continue;
+            }
+
+            const qreal x = a.x() + (m.y() - a.y()) * (b.x() - a.x()) / (b.y() - a.y());
+            if ((x >= m.x()) && ((edge < 0) || (x < nearestX)))
+            {
+                nearestX = x;
+                edge = i;
+            }
+        }
+        if (edge < 0)
+        {
+            continue;
+        }
+
+        const int next = (edge + 1) % count;
+        int outerIndex = (outer.at(edge).x() > outer.at(next).x()) ? edge : next;
+        const QPointF intersection(nearestX, m.y());
+        const QPointF candidate = outer.at(outerIndex);
+
+        /*
+         * 三角形(m, I, P)内的凹顶点会挡住P，此时取与射线夹角最小（相同时最近）的凹顶点。
+         */
+        if (candidate != intersection)
+        {
+            qreal bestSlope = 0.0;
+            qreal bestDistance = 0.0;
+            int best = -1;
+            for (int i = 0; i < count; i++)
+            {
+                const QPointF &point = outer.at(i);
+                if ((i == outerIndex) || (point.x() < m.x()) ||
+                        (cross(outer.at((i + count - 1) % count), point, outer.at((i + 1) % count)) >= 0.0) ||
+                        !inTriangle(point, m, intersection, candidate))
+                {
+                    continue;
+                }
+
+                const qreal dx = point.x() - m.x();
+                const qreal dy = qAbs(point.y() - m.y());
+                const qreal slope = (dx > 0.0) ? dy / dx : std::numeric_limits<qreal>::max();
+                const qreal distance = dx * dx + dy * dy;
+                if ((best < 0) || (slope < bestSlope) || ((slope == bestSlope) && (distance < bestDistance)))
+                {
+                    bestSlope = slope;
+                    bestDistance = distance;
+                    best = i;
+                }
+            }
+            if (best >= 0)
+            {
+                outerIndex = best;
+            }
+        }
+
+        /*
+         * 外轮廓到P，孔从m绕一周回到m，再回到P，继续外轮廓。
+         */
+        QPolygonF merged;
+        merged.reserve(count + hole.count() + 2);
+        for (int i = 0; i <= outerIndex; i++)
+        {
+            merged.append(outer.at(i));
+        }
+        for (int i = 0; i <= hole.count(); i++)
+        {
+            merged.append(hole.at((holeIndex + i) % hole.count()));
+        }
+        for (int i = outerIndex; i < count; i++)
+        {
+            merged.append(outer.at(i));
+        }
+        outer = merged;
+    }
+
+    return outer;
+}
+
+QPolygon ShapeBoolean::roundPolygon(const QPolygonF &ring)
+{
+    QPolygon polygon;
+    polygon.reserve(ring.count());
+    for (const QPointF &point : ring)
+    {
+        QPoint vertex = point.toPoint();
+        if (polygon.isEmpty() || (polygon.last() != vertex))
+        {
+            polygon.append(vertex);
+        }
+    }
+    while ((polygon.count() > 1) && (polygon.last() == polygon.first()))
+    {
+        polygon.removeLast();
+    }
+
+    return polygon;
+}
+
+QPolygonF ShapeBoolean::flattenEllipse(const QRectF &rect)
+{
+    /*
+     * 半径为r、弦高为h时，每段弦对应的圆心角为2 * acos(1 - h / r)。
+     */
+    qreal a = rect.width() / 2.0;
+    qreal b = rect.height() / 2.0;
+    qreal radius = qMax(a, b);
+    int count = 8;
+    if (radius > FlattenTolerance)
+    {
+        count = qMax(count, qCeil(M_PI / qAcos(1.0 - FlattenTolerance / radius)));
+    }
+    count = qMin(count, int(MaxEllipseVertices));
+
+    QPolygonF polygon(count);
+    QPointF center = rect.center();
+    for (int i = 0; i < count; i++)
+    {
+        qreal angle = 2.0 * M_PI * i / count;
+        polygon[i] = QPointF(center.x() + a * qCos(angle), center.y() + b * qSin(angle));
+    }
+
+    return polygon;
+}
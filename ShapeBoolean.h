@@ -0,0 +1,74 @@
+#ifndef SHAPEBOOLEAN_H
+#define SHAPEBOOLEAN_H
+
+#include <QList>
+#include <QVector>
+#include <QPolygon>
+#include <QPainterPath>
+
+#include "GeometryShape.h"
+
+/**
+ * @brief The EBooleanOp enum 图形的布尔运算。
+ * - EBO_Union: 并集。
+ * - EBO_Intersection: 交集。
+ * - EBO_Difference: 差集，第一个图形减去其余图形。
+ */
+enum EBooleanOp
+{
+    EBO_Union = 0,
+    EBO_Intersection,
+    EBO_Difference,
+};
+
+/**
+ * @brief The ShapeBoolean class 多边形、矩形、椭圆、圆的布尔运算，结果为多边形。
+ * @details
+ * - 椭圆、圆按弦高不超过FlattenTolerance展开为多边形，再与其它图形一起作为路径裁剪。
+ * - 两两裁剪使用QPainterPath的布尔运算（QPathClipper），不是扫描线算法；QPathClipper先按边界框筛选再求边的交点，
+ *   不逐对比较所有边。
+ * - 多个图形按二叉树两两合并，每一层的各对在线程池中并行；图形不少于ParallelMinShapes个时才并行。
+ * - 结果的每个外轮廓为一个多边形，被奇数个环包含的环为孔，属于直接包含它的外轮廓。环按面积从大到小排序，
+ *   只在边界框包含时判断点是否在环内，找到直接包含的环即停止。孔用一对重合的连接边
+ *   （keyhole）接入外轮廓，孔与外轮廓方向相反，按奇偶规则填充、包含判断和带符号面积都与带孔的区域一致。
+ *   顶点取整到场景像素。
+ */
+class ShapeBoolean
+{
+public:
+    constexpr static qreal FlattenTolerance = 0.25;
+    constexpr static int MaxEllipseVertices = 4096;
+    constexpr static int ParallelMinShapes = 4;
+
+    /**
+     * @brief IsSupported 图形是否可以参与布尔运算（多边形、矩形、椭圆、圆）。
+     */
+    static bool IsSupported(const GeometryShape *shape);
+    /**
+     * @brief ToPath 将图形展开为由多边形组成的闭合路径，不支持的图形返回空路径。
+     */
+    static QPainterPath ToPath(const GeometryShape *shape);
+    /**
+     * @brief Combine 对paths做布尔运算，差集为第一个路径减去其余路径的并集。
+     * @return 结果的各个外轮廓（孔已接入），少于3个顶点的环已去掉。
+     */
+    static QList<QPolygon> Combine(const QVector<QPainterPath> &paths, EBooleanOp op);
+
+private:
+    /**
+     * @brief reduce 按二叉树两两求并集或交集。
+     */
+    static QPainterPath reduce(QVector<QPainterPath> paths, EBooleanOp op);
+    static QPolygonF flattenEllipse(const QRectF &rect);
+    /**
+     * @brief bridgeHoles 按孔的最右顶点从右到左，依次从该顶点向右找外轮廓上可见的顶点（Eberly），
+     * 用一对重合的边把孔接入外轮廓。
+     */
+    static QPolygonF bridgeHoles(QPolygonF outer, QList<QPolygonF> holes);
+    /**
+     * @brief roundPolygon 顶点取整后去掉相邻的重复顶点（含与首个顶点重合的闭合点）。
+     */
+    static QPolygon roundPolygon(const QPolygonF &ring);
+};
+
+#endif // SHAPEBOOLEAN_H
@@ -0,0 +1,173 @@
+#include "ShapeGrid.h"
+
+#include <algorithm>
+
+namespace
+{
+/*
+ * 包含边界的相交判断，宽或高为0的矩形（水平、垂直线段）也能相交。
+ */
+bool overlaps(const QRect &r1, const QRect &r2)
+{
+    return (r1.left() <= r2.right()) && (r2.left() <= r1.right()) &&
+            (r1.top() <= r2.bottom()) && (r2.top() <= r1.bottom());
+}
+}
+
+void ShapeGrid::InsertShape(GeometryShape *shape)
+{
+    if ((shape == nullptr) || !shape->GetCompleted() || _shapeCells.contains(shape))
+    {
+        return;
+    }
+
+    Entry entry;
+    entry.shape = shape;
+    entry.bounds = shape->BoundingRect().normalized();
+    entry.cells = cellRange(entry.bounds);
+    _shapeCells.insert(shape, entry.cells);
+
+    if (qint64(entry.cells.width()) * entry.cells.height() > MaxCellsPerShape)
+    {
+        _largeShapes.append(entry);
+        return;
+    }
+
+    for (int y = entry.cells.top(); y <= entry.cells.bottom(); y++)
+    {
+        for (int x = entry.cells.left(); x <= entry.cells.right(); x++)
+        {
+            _cells[cellKey(x, y)].append(entry);
+        }
+    }
+}
+
+void ShapeGrid::RemoveShape(GeometryShape *shape)
+{
+    auto it = _shapeCells.find(shape);
+    if (it == _shapeCells.end())
+    {
+        return;
+    }
+
+    QRect cells = it.value();
+    _shapeCells.erase(it);
+
+    auto isShape = [shape](const Entry &entry)
+    {
+        return entry.shape == shape;
+    };
+
+    if (qint64(cells.width()) * cells.height() > MaxCellsPerShape)
+    {
+        _largeShapes.erase(std::remove_if(_largeShapes.begin(), _largeShapes.end(), isShape), _largeShapes.end());
+        return;
+    }
+
+    for (int y = cells.top(); y <= cells.bottom(); y++)
+    {
+        for (int x = cells.left(); x <= cells.right(); x++)
+        {
+            auto cell = _cells.find(cellKey(x, y));
+            if (cell == _cells.end())
+            {
+                continue;
+            }
+
+            cell->erase(std::remove_if(cell->begin(), cell->end(), isShape), cell->end());
+            if (cell->isEmpty())
+            {
+                _cells.erase(cell);
+            }
+        }
+    }
+}
+
+void ShapeGrid::UpdateShape(GeometryShape *shape)
+{
+    this->RemoveShape(shape);
+    this->InsertShape(shape);
+}
+
+void ShapeGrid::Clear()
+{
+    _cells.clear();
+    _shapeCells.clear();
+    _largeShapes.clear();
+}
+
+QVector<GeometryShape *> ShapeGrid::Query(const QRect &rect) const
+{
+    QVector<GeometryShape *> shapes;
+    QRect area = rect.normalized();
+    QRect range = cellRange(area);
+
+    for (const Entry &entry : _largeShapes)
+    {
+        if (overlaps(entry.bounds, area))
+        {
+            shapes.append(entry.shape);
+        }
+    }
+
+    /*
+     * 跨多个网格的图形，只在与查询范围相交的左上角网格中返回。
+     */
+    auto collect = [&shapes, &area, &range](int x, int y, const QVector<Entry> &cell)
+    {
+        for (const Entry &entry : cell)
+        {
+            if ((x == qMax(entry.cells.left(), range.left())) && (y == qMax(entry.cells.top(), range.top())) &&
+                    overlaps(entry.bounds, area))
+            {
+                shapes.append(entry.shape);
+            }
+        }
+    };
+
+    /*
+     * 查询范围的网格数多于已占用的网格时，改为遍历已占用的网格。
+     */
+    if (qint64(range.width()) * range.height() > _cells.count())
+    {
+        for (auto it = _cells.constBegin(); it != _cells.constEnd(); ++it)
+        {
+            int x = qint32(it.key() >> 32);
+            int y = qint32(it.key() & 0xffffffff);
+            if (range.contains(x, y))
+            {
+                collect(x, y, it.value());
+            }
+        }
+        return shapes;
+    }
+
+    for (int y = range.top(); y <= range.bottom(); y++)
+    {
+        for (int x = range.left(); x <= range.right(); x++)
+        {
+            auto cell = _cells.constFind(cellKey(x, y));
+            if (cell != _cells.constEnd())
+            {
+                collect(x, y, cell.value());
+            }
+        }
+    }
+
+    return shapes;
+}
+
+int ShapeGrid::cellIndex(int coordinate)
+{
+    /*
+     * 向下取整，负坐标同样按CellSize划分。
+     */
+    const int cellSize = CellSize;
+    return (coordinate >= 0) ? (coordinate / cellSize) : (-((-coordinate - 1) / cellSize) - 1);
+}
+
+QRect ShapeGrid::cellRange(const QRect &rect)
+{
+    return QRect(QPoint(cellIndex(rect.left()), cellIndex(rect.top())),
+                 QPoint(cellIndex(rect.right()), cellIndex(rect.bottom())));
+}
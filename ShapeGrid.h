@@ -0,0 +1,58 @@
+#ifndef SHAPEGRID_H
+#define SHAPEGRID_H
+
+#include <QHash>
+#include <QRect>
+#include <QVector>
+
+#include "GeometryShape.h"
+
+/**
+ * @brief The ShapeGrid class 按外接矩形将图形登记到均匀网格中，用于区域查询。
+ * @details
+ * - 图形登记到外接矩形覆盖的每个网格，查询只访问与区域相交的网格，与图形总数无关。
+ * - 跨多个网格的图形只在其与查询区域相交的第一个网格中返回，不需要去重。
+ * - 外接矩形覆盖超过MaxCellsPerShape个网格的图形单独存放，每次查询都检查。
+ */
+class ShapeGrid
+{
+public:
+    constexpr static int CellSize = 256;
+    constexpr static int MaxCellsPerShape = 1024;
+
+    /**
+     * @brief InsertShape 登记图形，未完成的图形不登记。
+     */
+    void InsertShape(GeometryShape *shape);
+    void RemoveShape(GeometryShape *shape);
+    /**
+     * @brief UpdateShape 图形的几何变化后重新登记。
+     */
+    void UpdateShape(GeometryShape *shape);
+    void Clear();
+    /**
+     * @brief Query 外接矩形与rect相交的图形（粗筛，需要再做精确判断）。
+     */
+    QVector<GeometryShape *> Query(const QRect &rect) const;
+
+private:
+    struct Entry
+    {
+        GeometryShape *shape;
+        QRect bounds;
+        QRect cells;
+    };
+
+    QHash<quint64, QVector<Entry>> _cells;
+    QHash<GeometryShape *, QRect> _shapeCells;
+    QVector<Entry> _largeShapes;
+
+    static int cellIndex(int coordinate);
+    static QRect cellRange(const QRect &rect);
+    static quint64 cellKey(int x, int y)
+    {
+        return (quint64(quint32(x)) << 32) | quint32(y);
+    }
+};
+
+#endif // SHAPEGRID_H
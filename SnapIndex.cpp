@@ -0,0 +1,253 @@
+#include "SnapIndex.h"
+
+#include <algorithm>
+#include <QtMath>
+#include <QLineF>
+#include <QRect>
+
+SnapIndex::SnapIndex() : _nextVersion(0)
+  , _liveCount(0)
+  , _deadCount(0)
+{
+}
+
+void SnapIndex::InsertShape(const GeometryShape *shape)
+{
+    if ((shape == nullptr) || _shapes.contains(shape))
+    {
+        return;
+    }
+
+    QVector<QPoint> points = SnapPoints(shape);
+    ShapeRecord record;
+    record.version = ++_nextVersion;
+    record.count = points.count();
+    _shapes.insert(shape, record);
+
+    for (const QPoint &point : points)
+    {
+        Entry entry;
+        entry.point = point;
+        entry.shape = shape;
+        entry.version = record.version;
+        _pending.append(entry);
+    }
+    _liveCount += record.count;
+
+    this->rebuildIfNeeded();
+}
+
+void SnapIndex::RemoveShape(const GeometryShape *shape)
+{
+    auto it = _shapes.find(shape);
+    if (it == _shapes.end())
+    {
+        return;
+    }
+
+    _liveCount -= it->count;
+    _deadCount += it->count;
+    _shapes.erase(it);
+
+    this->rebuildIfNeeded();
+}
+
+void SnapIndex::UpdateShape(const GeometryShape *shape)
+{
+    this->RemoveShape(shape);
+    this->InsertShape(shape);
+}
+
+void SnapIndex::Clear()
+{
+    _tree.clear();
+    _pending.clear();
+    _shapes.clear();
+    _liveCount = 0;
+    _deadCount = 0;
+}
+
+bool SnapIndex::Nearest(const QPoint &point, qreal tolerance, QPoint &target) const
+{
+    qreal bestDistance2 = tolerance * tolerance;
+    const Entry *best = nullptr;
+
+    this->nearest(0, _tree.count(), 0, point, bestDistance2, best);
+
+    for (const Entry &entry : _pending)
+    {
+        qreal d2 = distance2(entry.point, point);
+        if ((d2 <= bestDistance2) && this->isLive(entry))
+        {
+            bestDistance2 = d2;
+            best = &entry;
+        }
+    }
+
+    if (best == nullptr)
+    {
+        return false;
+    }
+
+    target = best->point;
+    return true;
+}
+
+QVector<QPoint> SnapIndex::SnapPoints(const GeometryShape *shape)
+{
+    QVector<QPoint> points;
+
+    if ((shape == nullptr) || !shape->GetCompleted())
+    {
+        return points;
+    }
+
+    QVector<QPoint> geometry = shape->GetGeometry();
+
+    switch (shape->GetPaintType())
+    {
+    case EPaintType::EPT_Point:
+    case EPaintType::EPT_Line:
+    case EPaintType::EPT_Polygon:
+    case EPaintType::EPT_Polyline:
+        points = geometry;
+        break;
+    case EPaintType::EPT_Arc:
+        if (geometry.count() >= 3)
+        {
+            /*
+             * 终点为圆心指向第三个控制点的方向与圆的交点。
+             */
+            QLineF endLine(geometry.at(0), geometry.at(2));
+            points << geometry.at(0) << geometry.at(1);
+            if (endLine.length() > 0.0)
+            {
+                endLine.setLength(QLineF(geometry.at(0), geometry.at(1)).length());
+                points << endLine.p2().toPoint();
+            }
+        }
+        break;
+    case EPaintType::EPT_Circle:
+        if (geometry.count() >= 1)
+        {
+            points << geometry.at(0);
+        }
+        break;
+    case EPaintType::EPT_Rect:
+        if (geometry.count() >= 2)
+        {
+            QRect rect = QRect(geometry.at(0), geometry.at(1)).normalized();
+            points << rect.topLeft() << rect.topRight() << rect.bottomLeft() << rect.bottomRight();
+        }
+        break;
+    case EPaintType::EPT_Ellipse:
+        if (geometry.count() >= 2)
+        {
+            points << QRect(geometry.at(0), geometry.at(1)).normalized().center();
+        }
+        break;
+    default:
+        break;
+    }
+
+    return points;
+}
+
+bool SnapIndex::isLive(const Entry &entry) const
+{
+    auto it = _shapes.constFind(entry.shape);
+    return (it != _shapes.constEnd()) && (it->version == entry.version);
+}
+
+void SnapIndex::rebuildIfNeeded()
+{
+    int pendingLimit = qMax(PendingRebuildMin, _tree.count() / PendingRebuildRatio);
+
+    if ((_pending.count() > pendingLimit) ||
+            ((_deadCount > PendingRebuildMin) && (_deadCount > _liveCount)))
+    {
+        this->rebuild();
+    }
+}
+
+void SnapIndex::rebuild()
+{
+    QVector<Entry> entries;
+    entries.reserve(_liveCount);
+
+    for (const Entry &entry : _tree)
+    {
+        if (this->isLive(entry))
+        {
+            entries.append(entry);
+        }
+    }
+    for (const Entry &entry : _pending)
+    {
+        if (this->isLive(entry))
+        {
+            entries.append(entry);
+        }
+    }
+
+    build(entries.data(), entries.data() + entries.count(), 0);
+    _tree.swap(entries);
+    _pending.clear();
+    _deadCount = 0;
+}
+
+void SnapIndex::build(Entry *begin, Entry *end, int axis)
+{
+    if ((end - begin) <= 1)
+    {
+        return;
+    }
+
+    Entry *mid = begin + (end - begin) / 2;
+    std::nth_element(begin, mid, end, [axis](const Entry &e1, const Entry &e2)
+    {
+        return (axis == 0) ? (e1.point.x() < e2.point.x()) : (e1.point.y() < e2.point.y());
+    });
+
+    build(begin, mid, axis ^ 1);
+    build(mid + 1, end, axis ^ 1);
+}
+
+void SnapIndex::nearest(int begin, int end, int axis, const QPoint &point, qreal &bestDistance2, const Entry *&best) const
+{
+    if (begin >= end)
+    {
+        return;
+    }
+
+    int mid = begin + (end - begin) / 2;
+    const Entry &entry = _tree.at(mid);
+
+    /*
+     * 失效的目标仍参与划分，只是不作为结果。
+     */
+    qreal d2 = distance2(entry.point, point);
+    if ((d2 <= bestDistance2) && this->isLive(entry))
+    {
+        bestDistance2 = d2;
+        best = &entry;
+    }
+
+    qreal diff = (axis == 0) ? (point.x() - entry.point.x()) : (point.y() - entry.point.y());
+    if (diff < 0)
+    {
+        this->nearest(begin, mid, axis ^ 1, point, bestDistance2, best);
+        if ((diff * diff) <= bestDistance2)
+        {
+            this->nearest(mid + 1, end, axis ^ 1, point, bestDistance2, best);
+        }
+    }
+    else
+    {
+        this->nearest(mid + 1, end, axis ^ 1, point, bestDistance2, best);
+        if ((diff * diff) <= bestDistance2)
+        {
+            this->nearest(begin, mid, axis ^ 1, point, bestDistance2, best);
+        }
+    }
+}
@@ -0,0 +1,88 @@
+#ifndef SNAPINDEX_H
+#define SNAPINDEX_H
+
+#include <QHash>
+#include <QPoint>
+#include <QVector>
+
+#include "GeometryShape.h"
+
+/**
+ * @brief The SnapIndex class 吸附目标（顶点、端点、圆心、矩形角点）的空间索引。
+ * @details
+ * - 目标按中位数划分建立k-d树，树隐式存储在数组中（不分配节点），最近点查询为O(log n)。
+ * - 新加入的目标先放入待合并缓冲区，查询时线性扫描，缓冲区超过阈值时重建k-d树。
+ * - 删除只作废图形的版本号（惰性删除），失效的目标多于有效的目标时重建。
+ */
+class SnapIndex
+{
+public:
+    /**
+     * @brief 待合并缓冲区的最小重建阈值，树较大时阈值为树大小的1/PendingRebuildRatio。
+     */
+    constexpr static int PendingRebuildMin = 64;
+    constexpr static int PendingRebuildRatio = 16;
+
+    SnapIndex();
+
+    /**
+     * @brief InsertShape 加入图形的吸附目标，未完成的图形没有吸附目标。
+     */
+    void InsertShape(const GeometryShape *shape);
+    void RemoveShape(const GeometryShape *shape);
+    /**
+     * @brief UpdateShape 图形的几何变化后，替换其吸附目标。
+     */
+    void UpdateShape(const GeometryShape *shape);
+    void Clear();
+    /**
+     * @brief Nearest 查找与point的距离不超过tolerance的最近吸附目标。
+     * @param[out] target 找到的吸附目标。
+     * @return false - 范围内没有吸附目标。
+     */
+    bool Nearest(const QPoint &point, qreal tolerance, QPoint &target) const;
+    int GetCount() const
+    {
+        return _liveCount;
+    }
+
+    /**
+     * @brief SnapPoints 图形的吸附目标。
+     * @details 点，线段的端点，圆弧的圆心和端点，圆的圆心，矩形的四个角点，椭圆的中心，多边形/折线的顶点。
+     */
+    static QVector<QPoint> SnapPoints(const GeometryShape *shape);
+
+private:
+    struct Entry
+    {
+        QPoint point;
+        const GeometryShape *shape;
+        quint32 version;
+    };
+    struct ShapeRecord
+    {
+        quint32 version;
+        int count;
+    };
+
+    QVector<Entry> _tree;
+    QVector<Entry> _pending;
+    QHash<const GeometryShape *, ShapeRecord> _shapes;
+    quint32 _nextVersion;
+    int _liveCount;
+    int _deadCount;
+
+    bool isLive(const Entry &entry) const;
+    void rebuildIfNeeded();
+    void rebuild();
+    static void build(Entry *begin, Entry *end, int axis);
+    void nearest(int begin, int end, int axis, const QPoint &point, qreal &bestDistance2, const Entry *&best) const;
+    static qreal distance2(const QPoint &p1, const QPoint &p2)
+    {
+        qreal dx = p1.x() - p2.x();
+        qreal dy = p1.y() - p2.y();
+        return dx * dx + dy * dy;
+    }
+};
+
+#endif // SNAPINDEX_H
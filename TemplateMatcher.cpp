@@ -0,0 +1,318 @@
+#include "TemplateMatcher.h"
+
+#include <algorithm>
+#include <QtMath>
+#include <QtConcurrent>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#define TEMPLATEMATCHER_SSE2
+#include <emmintrin.h>
+#endif
+
+QVector<TemplateMatch> TemplateMatcher::Match(const ImagePyramid &pyramid, const QRect &templateRect, qreal minScore,
+                                              const QAtomicInt *cancel)
+{
+    QVector<TemplateMatch> matches;
+    if (pyramid.IsEmpty())
+    {
+        return matches;
+    }
+
+    const QRect rect = templateRect & pyramid.GetLevel(0).rect();
+    if ((rect.width() < 4) || (rect.height() < 4))
+    {
+        return matches;
+    }
+
+    int coarse = 0;
+    while ((coarse + 1 < pyramid.GetLevelCount()) && ((rect.width() >> (coarse + 1)) >= MinTemplateSize) &&
+           ((rect.height() >> (coarse + 1)) >= MinTemplateSize))
+    {
+        coarse++;
+    }
+
+    QVector<Template> templates(coarse + 1);
+    for (int level = 0; level <= coarse; level++)
+    {
+        const QImage &image = pyramid.GetLevel(level);
+        QRect levelRect(rect.x() >> level, rect.y() >> level, rect.width() >> level, rect.height() >> level);
+        if (!makeTemplate(image, levelRect & image.rect(), templates[level]))
+        {
+            return matches;
+        }
+    }
+
+    /*
+     * 粗搜索层上逐位置计算，各任务写入不同的行。
+     */
+    const QImage &coarseImage = pyramid.GetLevel(coarse);
+    const Template &coarseTemplate = templates.at(coarse);
+    const int columns = coarseImage.width() - coarseTemplate.width + 1;
+    const int rows = coarseImage.height() - coarseTemplate.height + 1;
+    if ((columns <= 0) || (rows <= 0))
+    {
+        return matches;
+    }
+
+    QVector<float> scores(columns * rows);
+    float *scoreBits = scores.data();
+    QVector<int> tasks;
+    for (int y = 0; y < rows; y += RowsPerTask)
+    {
+        tasks.append(y);
+    }
+    QtConcurrent::blockingMap(tasks, [&coarseImage, &coarseTemplate, columns, rows, scoreBits, cancel](const int &top)
+    {
+        if (isCanceled(cancel))
+        {
+            return;
+        }
+
+        const int bottom = qMin(top + int(RowsPerTask), rows);
+        for (int y = top; y < bottom; y++)
+        {
+            for (int x = 0; x < columns; x++)
+            {
+                scoreBits[y * columns + x] = score(coarseImage, coarseTemplate, x, y);
+            }
+        }
+    });
+    if (isCanceled(cancel))
+    {
+        return matches;
+    }
+
+    /*
+     * 不小于8邻域的位置为局部极大值，平台上的重复位置由非极大值抑制去掉。
+     */
+    const float threshold = float(minScore - CoarseScoreMargin);
+    QVector<TemplateMatch> candidates;
+    for (int y = 0; y < rows; y++)
+    {
+        for (int x = 0; x < columns; x++)
+        {
+            const float value = scores.at(y * columns + x);
+            if (value < threshold)
+            {
+                continue;
+            }
+
+            bool isMaximum = true;
+            for (int dy = -1; (dy <= 1) && isMaximum; dy++)
+            {
+                for (int dx = -1; dx <= 1; dx++)
+                {
+                    const int nx = x + dx;
+                    const int ny = y + dy;
+                    if ((nx >= 0) && (ny >= 0) && (nx < columns) && (ny < rows) && (scores.at(ny * columns + nx) > value))
+                    {
+                        isMaximum = false;
+                        break;
+                    }
+                }
+            }
+            if (isMaximum)
+            {
+                candidates.append({QRect(x, y, coarseTemplate.width, coarseTemplate.height), value});
+            }
+        }
+    }
+    candidates = suppress(candidates, coarseTemplate.width, coarseTemplate.height, MaxMatches * 4);
+
+    QtConcurrent::blockingMap(candidates, [&pyramid, &templates, coarse, cancel](TemplateMatch &match)
+    {
+        for (int level = coarse - 1; level >= 0; level--)
+        {
+            if (isCanceled(cancel))
+            {
+                match.score = -1.0;
+                return;
+            }
+
+            const QImage &image = pyramid.GetLevel(level);
+            const Template &pattern = templates.at(level);
+            const int centerX = match.rect.x() * 2;
+            const int centerY = match.rect.y() * 2;
+            float best = -2.0f;
+            QPoint bestPos;
+
+            for (int y = centerY - RefineRadius; y <= centerY + RefineRadius; y++)
+            {
+                for (int x = centerX - RefineRadius; x <= centerX + RefineRadius; x++)
+                {
+                    if ((x < 0) || (y < 0) || (x + pattern.width > image.width()) || (y + pattern.height > image.height()))
+                    {
+                        continue;
+                    }
+
+                    const float value = score(image, pattern, x, y);
+                    if (value > best)
+                    {
+                        best = value;
+                        bestPos = QPoint(x, y);
+                    }
+                }
+            }
+
+            if (best < -1.0f)
+            {
+                match.score = -1.0;
+                return;
+            }
+            match.rect = QRect(bestPos, QSize(pattern.width, pattern.height));
+            match.score = best;
+        }
+    });
+    if (isCanceled(cancel))
+    {
+        return matches;
+    }
+
+    for (const TemplateMatch &match : candidates)
+    {
+        if (match.score >= minScore)
+        {
+            matches.append(match);
+        }
+    }
+
+    return suppress(matches, rect.width(), rect.height(), MaxMatches);
+}
+
+bool TemplateMatcher::makeTemplate(const QImage &image, const QRect &rect, Template &result)
+{
+    if (rect.isEmpty())
+    {
+        return false;
+    }
+
+    result.width = rect.width();
+    result.height = rect.height();
+    result.values.resize(result.width * result.height);
+
+    double sum = 0.0;
+    for (int y = 0; y < result.height; y++)
+    {
+        const uchar *row = image.constScanLine(rect.y() + y) + rect.x();
+        for (int x = 0; x < result.width; x++)
+        {
+            sum += row[x];
+        }
+    }
+
+    const double mean = sum / result.values.count();
+    double squareSum = 0.0;
+    for (int y = 0; y < result.height; y++)
+    {
+        const uchar *row = image.constScanLine(rect.y() + y) + rect.x();
+        for (int x = 0; x < result.width; x++)
+        {
+            const double value = row[x] - mean;
+            result.values[y * result.width + x] = float(value);
+            squareSum += value * value;
+        }
+    }
+
+    result.norm = std::sqrt(squareSum);
+    return result.norm > 1e-3;
+}
+
+float TemplateMatcher::score(const QImage &image, const Template &pattern, int x, int y)
+{
+    double dot = 0.0;
+    quint64 sum = 0;
+    quint64 squareSum = 0;
+
+    for (int j = 0; j < pattern.height; j++)
+    {
+        const uchar *source = image.constScanLine(y + j) + x;
+        const float *values = pattern.values.constData() + j * pattern.width;
+        float rowDot = 0.0f;
+        int i = 0;
+
+#ifdef TEMPLATEMATCHER_SSE2
+        if (pattern.width >= 8)
+        {
+            /*
+             * 每行分别归约：一行的平方和在32位的通道中不会溢出。
+             */
+            const __m128i zero = _mm_setzero_si128();
+            __m128 vdot = _mm_setzero_ps();
+            __m128i vsum = _mm_setzero_si128();
+            __m128i vsquare = _mm_setzero_si128();
+            for (; i + 8 <= pattern.width; i += 8)
+            {
+                const __m128i pixels = _mm_loadl_epi64(reinterpret_cast<const __m128i *>(source + i));
+                vsum = _mm_add_epi64(vsum, _mm_sad_epu8(pixels, zero));
+                const __m128i words = _mm_unpacklo_epi8(pixels, zero);
+                vsquare = _mm_add_epi32(vsquare, _mm_madd_epi16(words, words));
+                const __m128 low = _mm_cvtepi32_ps(_mm_unpacklo_epi16(words, zero));
+                const __m128 high = _mm_cvtepi32_ps(_mm_unpackhi_epi16(words, zero));
+                vdot = _mm_add_ps(vdot, _mm_add_ps(_mm_mul_ps(low, _mm_loadu_ps(values + i)),
+                                                   _mm_mul_ps(high, _mm_loadu_ps(values + i + 4))));
+            }
+
+            alignas(16) float dots[4];
+            alignas(16) quint64 sums[2];
+            alignas(16) quint32 squares[4];
+            _mm_store_ps(dots, vdot);
+            _mm_store_si128(reinterpret_cast<__m128i *>(sums), vsum);
+            _mm_store_si128(reinterpret_cast<__m128i *>(squares), vsquare);
+            rowDot = (dots[0] + dots[1]) + (dots[2] + dots[3]);
+            sum += sums[0] + sums[1];
+            squareSum += quint64(squares[0]) + squares[1] + squares[2] + squares[3];
+        }
+#endif
+
+        for (; i < pattern.width; i++)
+        {
+            const quint32 pixel = source[i];
+            rowDot += pixel * values[i];
+            sum += pixel;
+            squareSum += pixel * pixel;
+        }
+        dot += rowDot;
+    }
+
+    const double count = double(pattern.width) * pattern.height;
+    const double variance = double(squareSum) - double(sum) * double(sum) / count;
+    if (variance <= 1e-6 * count)
+    {
+        return 0.0f;
+    }
+
+    return float(dot / (pattern.norm * std::sqrt(variance)));
+}
+
+QVector<TemplateMatch> TemplateMatcher::suppress(QVector<TemplateMatch> matches, int width, int height, int maxCount)
+{
+    std::sort(matches.begin(), matches.end(), [](const TemplateMatch &m1, const TemplateMatch &m2)
+    {
+        return m1.score > m2.score;
+    });
+
+    QVector<TemplateMatch> kept;
+    for (const TemplateMatch &match : matches)
+    {
+        if (kept.count() >= maxCount)
+        {
+            break;
+        }
+
+        bool overlapped = false;
+        for (const TemplateMatch &other : kept)
+        {
+            if ((qAbs(match.rect.x() - other.rect.x()) * 2 < width) && (qAbs(match.rect.y() - other.rect.y()) * 2 < height))
+            {
+                overlapped = true;
+                break;
+            }
+        }
+        if (!overlapped)
+        {
+            kept.append(match);
+        }
+    }
+
+    return kept;
+}
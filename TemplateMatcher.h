@@ -0,0 +1,80 @@
+#ifndef TEMPLATEMATCHER_H
+#define TEMPLATEMATCHER_H
+
+#include <QImage>
+#include <QVector>
+#include <QRect>
+#include <QAtomicInt>
+
+#include "ImagePyramid.h"
+
+struct TemplateMatch
+{
+    /**
+     * @brief 匹配位置，像素坐标，大小与模板相同。
+     */
+    QRect rect;
+    qreal score;
+};
+
+/**
+ * @brief The TemplateMatcher class 在灰度金字塔上用归一化互相关（NCC）查找模板的所有出现位置。
+ * @details
+ * - 模板为第0层中的矩形区域；选取模板宽、高都不小于MinTemplateSize的最粗的层作为粗搜索层。
+ * - 粗搜索层上逐位置计算NCC，按行分块在线程池中并行；不低于minScore - CoarseScoreMargin的局部极大值
+ *   经非极大值抑制后作为候选。
+ * - 候选逐层向下细化：在下一层的对应位置周围±RefineRadius内取NCC最大的位置，直到第0层，
+ *   各候选在线程池中并行。第0层不低于minScore的结果再做一次非极大值抑制。
+ * - 窗口内积的内层循环支持SSE2时一次处理8个像素：灰度和用SAD、平方和用16位乘加、与模板的内积用单精度。
+ * - 两个位置在x、y方向的距离都小于模板宽、高的一半时视为重叠，只保留得分高的。
+ * - 可以从其他线程取消：粗搜索的各行块之间、各候选之间以及候选细化的各层之间检查取消标志。
+ */
+class TemplateMatcher
+{
+public:
+    constexpr static int MinTemplateSize = 8;
+    constexpr static qreal DefaultMinScore = 0.8;
+    constexpr static qreal CoarseScoreMargin = 0.1;
+    constexpr static int RefineRadius = 2;
+    constexpr static int RowsPerTask = 16;
+    constexpr static int MaxMatches = 1000;
+
+    TemplateMatcher() = delete;
+
+    /**
+     * @brief Match 查找templateRect内的图案在图片中的所有出现位置（含templateRect本身），按得分从高到低排列。
+     * @param templateRect 第0层的像素区域，超出图片的部分裁剪掉。
+     * @param cancel 不为空且非0时尽快停止，可在其他线程中设置。
+     * @return 模板过小（宽、高小于4）、灰度一致或者已取消时返回空。
+     */
+    static QVector<TemplateMatch> Match(const ImagePyramid &pyramid, const QRect &templateRect, qreal minScore,
+                                        const QAtomicInt *cancel = nullptr);
+
+private:
+    struct Template
+    {
+        int width;
+        int height;
+        /**
+         * @brief 减去均值后的模板，以及其平方和的平方根。
+         */
+        QVector<float> values;
+        double norm;
+    };
+
+    static bool isCanceled(const QAtomicInt *cancel)
+    {
+        return (cancel != nullptr) && (cancel->loadAcquire() != 0);
+    }
+    static bool makeTemplate(const QImage &image, const QRect &rect, Template &result);
+    /**
+     * @brief score 模板左上角在(x, y)时的NCC，窗口灰度一致时为0。
+     */
+    static float score(const QImage &image, const Template &pattern, int x, int y);
+    /**
+     * @brief suppress 按得分从高到低，去掉与已保留的位置重叠的位置，最多保留maxCount个。
+     */
+    static QVector<TemplateMatch> suppress(QVector<TemplateMatch> matches, int width, int height, int maxCount);
+};
+
+#endif // TEMPLATEMATCHER_H
@@ -20,6 +20,9 @@ enum EPaintType {
     EPT_Ellipse,
     EPT_Polygon,
 
+    EPT_Text,
+    EPT_Freehand,
+
     EPT_End
 };
 
@@ -37,6 +40,8 @@ public:
             return "Arc";
         case EPaintType::EPT_Polyline:
             return "Polyline";
+        case EPaintType::EPT_Freehand:
+            return "Freehand";
         case EPaintType::EPT_Circle:
             return "Circle";
         case EPaintType::EPT_Rect:
@@ -45,6 +50,8 @@ public:
             return "Ellipse";
         case EPaintType::EPT_Polygon:
             return "Polygon";
+        case EPaintType::EPT_Text:
+            return "Text";
         default:
             break;
         }
@@ -52,6 +59,23 @@ public:
         return "Unkown";
     }
 
+    /**
+     * @brief GetTypeEn GetStringEn()的逆变换，忽略大小写。
+     * @return 无法识别时返回EPT_None。
+     */
+    static EPaintType GetTypeEn(const QString &str)
+    {
+        for (int i = EPaintType::EPT_Point; i < EPaintType::EPT_End; i++)
+        {
+            if (str.compare(GetStringEn(static_cast<EPaintType>(i)), Qt::CaseInsensitive) == 0)
+            {
+                return static_cast<EPaintType>(i);
+            }
+        }
+
+        return EPaintType::EPT_None;
+    }
+
     static QString GetStringZh(EPaintType type)
     {
         switch (type) {
@@ -63,6 +87,8 @@ public:
             return QString("圆弧");
         case EPaintType::EPT_Polyline:
             return QString("多段线");
+        case EPaintType::EPT_Freehand:
+            return QString("手绘");
         case EPaintType::EPT_Circle:
             return QString("圆");
         case EPaintType::EPT_Rect:
@@ -71,6 +97,8 @@ public:
             return QString("椭圆");
         case EPaintType::EPT_Polygon:
             return QString("多边形");
+        case EPaintType::EPT_Text:
+            return QString("文本");
         default:
             break;
         }
@@ -79,4 +107,28 @@ public:
     }
 };
 
+/**
+ * @brief The ETextStyle enum 文本的样式，可按位组合。
+ */
+enum ETextStyle {
+    ETS_Normal = 0,
+    ETS_Bold = 0x1,
+    ETS_Italic = 0x2,
+    ETS_Underline = 0x4,
+};
+
+/**
+ * @brief The EToolType enum
+ * - ETT_Paint: 按绘制类型绘制、选择图形。
+ * - ETT_FloodFill: 油漆桶，按颜色容差填充背景图中的连通区域。
+ * - ETT_MagicWand: 魔棒，按颜色容差选出背景图中的连通区域，生成轮廓多边形。
+ */
+enum EToolType {
+    ETT_Paint = 0,
+    ETT_FloodFill,
+    ETT_MagicWand,
+
+    ETT_End
+};
+
 #endif // TYPES_H
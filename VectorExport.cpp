@@ -0,0 +1,406 @@
+#include "VectorExport.h"
+
+#include <QtMath>
+#include <QBuffer>
+#include <QFileInfo>
+#include <QUrl>
+#include <QLineF>
+#include <QPainter>
+#include <QPdfWriter>
+#include <QPageSize>
+#include <QMarginsF>
+#include <QXmlStreamWriter>
+#include <QDebug>
+
+namespace
+{
+const QString SvgNamespace = "http://www.w3.org/2000/svg";
+const QString XLinkNamespace = "http://www.w3.org/1999/xlink";
+
+QString number(qreal value)
+{
+    return QString::number(value, 'g', 10);
+}
+
+QVector<QRect> backgroundTiles(const QImage &image, int tileSize)
+{
+    QVector<QRect> tiles;
+    for (int y = 0; y < image.height(); y += tileSize)
+    {
+        for (int x = 0; x < image.width(); x += tileSize)
+        {
+            tiles.append(QRect(x, y, qMin(tileSize, image.width() - x), qMin(tileSize, image.height() - y)));
+        }
+    }
+    return tiles;
+}
+
+bool isTransparent(const QImage &image)
+{
+    if (!image.hasAlphaChannel())
+    {
+        return false;
+    }
+
+    const QImage argb = image.convertToFormat(QImage::Format_ARGB32);
+    for (int y = 0; y < argb.height(); y++)
+    {
+        const QRgb *row = reinterpret_cast<const QRgb *>(argb.constScanLine(y));
+        for (int x = 0; x < argb.width(); x++)
+        {
+            if (qAlpha(row[x]) != 0)
+            {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+}
+
+VectorExporter::VectorExporter(const QList<GeometryShape *> &shapes) : _backgroundMode(EVectorBackground::EVB_None)
+{
+    QRect bounds;
+    for (auto item : shapes)
+    {
+        GeometryShape *clone = GeometryShapeFactory::CloneGeometryShape(item);
+        if (clone == nullptr)
+        {
+            continue;
+        }
+        if (!clone->GetCompleted())
+        {
+            delete clone;
+            continue;
+        }
+
+        _shapes.append(clone);
+        bounds |= clone->BoundingRect();
+    }
+
+    const int margin = BoundsMargin;
+    _bounds = bounds.isNull() ? QRectF(0.0, 0.0, 1.0, 1.0) : QRectF(bounds.adjusted(-margin, -margin, margin, margin));
+}
+
+VectorExporter::~VectorExporter()
+{
+    qDeleteAll(_shapes);
+}
+
+void VectorExporter::SetBackground(const QImage &image, const QString &filePath, EVectorBackground mode)
+{
+    _background = image;
+    _backgroundPath = filePath;
+    _backgroundMode = image.isNull() ? EVectorBackground::EVB_None : mode;
+
+    if (!image.isNull())
+    {
+        _bounds = QRectF(image.rect());
+    }
+}
+
+void VectorExporter::SetFillOverlay(const QImage &overlay)
+{
+    _fillOverlay = overlay;
+}
+
+bool VectorExporter::WriteSvg(QIODevice *device) const
+{
+    QXmlStreamWriter xml(device);
+    xml.setAutoFormatting(true);
+    xml.writeStartDocument();
+
+    xml.writeStartElement("svg");
+    xml.writeDefaultNamespace(SvgNamespace);
+    xml.writeNamespace(XLinkNamespace, "xlink");
+    xml.writeAttribute("version", "1.1");
+    xml.writeAttribute("width", number(_bounds.width()));
+    xml.writeAttribute("height", number(_bounds.height()));
+    xml.writeAttribute("viewBox", QString("%1 %2 %3 %4").arg(number(_bounds.x())).arg(number(_bounds.y()))
+                       .arg(number(_bounds.width())).arg(number(_bounds.height())));
+
+    if (_backgroundMode != EVectorBackground::EVB_None)
+    {
+        this->writeSvgBackground(xml);
+    }
+
+    xml.writeStartElement("g");
+    xml.writeAttribute("id", "annotations");
+    xml.writeAttribute("fill", "none");
+    xml.writeAttribute("stroke-width", number(GeometryShape::DefaultLinePenWidth));
+    xml.writeAttribute("stroke-linecap", "round");
+    xml.writeAttribute("stroke-linejoin", "round");
+    for (auto item : _shapes)
+    {
+        writeSvgShape(xml, item);
+    }
+    xml.writeEndElement();
+
+    xml.writeEndElement();
+    xml.writeEndDocument();
+
+    return !xml.hasError();
+}
+
+bool VectorExporter::WritePdf(const QString &path) const
+{
+    /*
+     * 分辨率为72时，1个设备像素为1pt，场景坐标直接作为页面坐标。
+     */
+    QPdfWriter writer(path);
+    writer.setResolution(72);
+    writer.setPageSize(QPageSize(_bounds.size(), QPageSize::Point, QString(), QPageSize::ExactMatch));
+    writer.setPageMargins(QMarginsF(0.0, 0.0, 0.0, 0.0));
+    writer.setCreator("PaintEditor");
+    writer.setTitle(QFileInfo(path).completeBaseName());
+
+    QPainter painter;
+    if (!painter.begin(&writer))
+    {
+        qWarning() << "Warn: VectorExporter::WritePdf(), failed to open!" << path;
+        return false;
+    }
+
+    painter.setRenderHint(QPainter::Antialiasing, true);
+    painter.setRenderHint(QPainter::SmoothPixmapTransform, true);
+    painter.translate(-_bounds.topLeft());
+
+    if (_backgroundMode != EVectorBackground::EVB_None)
+    {
+        for (const QRect &tile : backgroundTiles(_background, BackgroundTileSize))
+        {
+            painter.drawImage(tile.topLeft(), _background.copy(tile));
+        }
+    }
+
+    for (auto item : _shapes)
+    {
+        item->Paint(painter, false);
+    }
+
+    return painter.end();
+}
+
+void VectorExporter::writeSvgBackground(QXmlStreamWriter &xml) const
+{
+    xml.writeStartElement("g");
+    xml.writeAttribute("id", "background");
+
+    const bool linked = (_backgroundMode == EVectorBackground::EVB_Linked) && !_backgroundPath.isEmpty();
+    if (linked)
+    {
+        xml.writeStartElement("image");
+        xml.writeAttribute("x", "0");
+        xml.writeAttribute("y", "0");
+        xml.writeAttribute("width", QString::number(_background.width()));
+        xml.writeAttribute("height", QString::number(_background.height()));
+        xml.writeAttribute("preserveAspectRatio", "none");
+        xml.writeAttribute(XLinkNamespace, "href", QUrl::fromLocalFile(QFileInfo(_backgroundPath).absoluteFilePath()).toString());
+        xml.writeEndElement();
+    }
+    else
+    {
+        writeSvgTiles(xml, _background);
+    }
+
+    xml.writeEndElement();
+
+    /*
+     * 引用的背景图文件不含油漆桶的填充，填充单独嵌入，只写出有填充的图块。
+     */
+    if (linked && !_fillOverlay.isNull())
+    {
+        xml.writeStartElement("g");
+        xml.writeAttribute("id", "fill");
+        writeSvgTiles(xml, _fillOverlay);
+        xml.writeEndElement();
+    }
+}
+
+void VectorExporter::writeSvgTiles(QXmlStreamWriter &xml, const QImage &image)
+{
+    /*
+     * 每次只编码一个图块，编码后立即写出。
+     */
+    for (const QRect &tile : backgroundTiles(image, BackgroundTileSize))
+    {
+        const QImage tileImage = image.copy(tile);
+        if (isTransparent(tileImage))
+        {
+            continue;
+        }
+
+        QByteArray png;
+        QBuffer buffer(&png);
+        buffer.open(QIODevice::WriteOnly);
+        tileImage.save(&buffer, "PNG");
+
+        xml.writeStartElement("image");
+        xml.writeAttribute("x", QString::number(tile.x()));
+        xml.writeAttribute("y", QString::number(tile.y()));
+        xml.writeAttribute("width", QString::number(tile.width()));
+        xml.writeAttribute("height", QString::number(tile.height()));
+        xml.writeAttribute("preserveAspectRatio", "none");
+        xml.writeAttribute(XLinkNamespace, "href", "data:image/png;base64," + QString::fromLatin1(png.toBase64()));
+        xml.writeEndElement();
+    }
+}
+
+void VectorExporter::writeSvgShape(QXmlStreamWriter &xml, const GeometryShape *shape)
+{
+    const QVector<QPoint> points = shape->GetGeometry();
+    const QString stroke = shape->GetLinePen().color().name();
+    QString element;
+    QString content;
+    QXmlStreamAttributes attributes;
+
+    switch (shape->GetPaintType())
+    {
+    case EPaintType::EPT_Point:
+        if (points.count() >= 1)
+        {
+            element = "circle";
+            attributes.append("cx", QString::number(points.at(0).x()));
+            attributes.append("cy", QString::number(points.at(0).y()));
+            attributes.append("r", number(GeometryShape::DefaultPointPenWidth / 2.0));
+            attributes.append("fill", shape->GetPointPen().color().name());
+            attributes.append("stroke", "none");
+        }
+        break;
+    case EPaintType::EPT_Line:
+        if (points.count() >= 2)
+        {
+            element = "line";
+            attributes.append("x1", QString::number(points.at(0).x()));
+            attributes.append("y1", QString::number(points.at(0).y()));
+            attributes.append("x2", QString::number(points.at(1).x()));
+            attributes.append("y2", QString::number(points.at(1).y()));
+            attributes.append("stroke", stroke);
+        }
+        break;
+    case EPaintType::EPT_Arc:
+        if (points.count() >= 3)
+        {
+            /*
+             * 与Arc::Paint()一致：半径为圆心到起点的距离，从起点方向逆时针（角度为负时顺时针）转到终点方向。
+             * SVG的y轴向下，sweep-flag为1表示屏幕上的顺时针。
+             */
+            const QLineF startLine(points.at(0), points.at(1));
+            const QLineF endLine(points.at(0), points.at(2));
+            const qreal radius = startLine.length();
+            const qreal span = endLine.angle() - startLine.angle();
+            const qreal startAngle = qDegreesToRadians(startLine.angle());
+            const qreal endAngle = qDegreesToRadians(endLine.angle());
+            const QPointF start(points.at(0).x() + radius * qCos(startAngle), points.at(0).y() - radius * qSin(startAngle));
+            const QPointF end(points.at(0).x() + radius * qCos(endAngle), points.at(0).y() - radius * qSin(endAngle));
+
+            element = "path";
+            attributes.append("d", QString("M %1 %2 A %3 %3 0 %4 %5 %6 %7")
+                              .arg(number(start.x())).arg(number(start.y())).arg(number(radius))
+                              .arg((qAbs(span) > 180.0) ? 1 : 0).arg((span > 0.0) ? 0 : 1)
+                              .arg(number(end.x())).arg(number(end.y())));
+            attributes.append("stroke", stroke);
+        }
+        break;
+    case EPaintType::EPT_Circle:
+        if (points.count() >= 2)
+        {
+            element = "circle";
+            attributes.append("cx", QString::number(points.at(0).x()));
+            attributes.append("cy", QString::number(points.at(0).y()));
+            attributes.append("r", number(QLineF(points.at(0), points.at(1)).length()));
+            attributes.append("stroke", stroke);
+        }
+        break;
+    case EPaintType::EPT_Rect:
+        if (points.count() >= 2)
+        {
+            const QRect rect = QRect(points.at(0), points.at(1)).normalized();
+            element = "rect";
+            attributes.append("x", QString::number(rect.x()));
+            attributes.append("y", QString::number(rect.y()));
+            attributes.append("width", QString::number(rect.width()));
+            attributes.append("height", QString::number(rect.height()));
+            attributes.append("stroke", stroke);
+        }
+        break;
+    case EPaintType::EPT_Ellipse:
+        if (points.count() >= 2)
+        {
+            const QRectF rect(QRect(points.at(0), points.at(1)).normalized());
+            element = "ellipse";
+            attributes.append("cx", number(rect.center().x()));
+            attributes.append("cy", number(rect.center().y()));
+            attributes.append("rx", number(rect.width() / 2.0));
+            attributes.append("ry", number(rect.height() / 2.0));
+            attributes.append("stroke", stroke);
+        }
+        break;
+    case EPaintType::EPT_Polygon:
+    case EPaintType::EPT_Polyline:
+    case EPaintType::EPT_Freehand:
+        if (points.count() >= 2)
+        {
+            QString value;
+            value.reserve(points.count() * 12);
+            for (int i = 0; i < points.count(); i++)
+            {
+                if (i > 0)
+                {
+                    value.append(' ');
+                }
+                value.append(QString::number(points.at(i).x())).append(',').append(QString::number(points.at(i).y()));
+            }
+
+            element = (shape->GetPaintType() == EPaintType::EPT_Polygon) ? "polygon" : "polyline";
+            attributes.append("points", value);
+            attributes.append("stroke", stroke);
+        }
+        break;
+    case EPaintType::EPT_Text:
+        if (points.count() >= 1)
+        {
+            /*
+             * 与Text::Paint()一致：控制点为文本框的左上角。
+             */
+            const Text *text = static_cast<const Text *>(shape);
+            element = "text";
+            content = text->GetText();
+            attributes.append("x", QString::number(points.at(0).x()));
+            attributes.append("y", QString::number(points.at(0).y()));
+            attributes.append("dominant-baseline", "text-before-edge");
+            attributes.append("font-size", QString::number(Text::DefaultPixelSize));
+            attributes.append("fill", stroke);
+            attributes.append("stroke", "none");
+            if ((text->GetTextStyle() & ETextStyle::ETS_Bold) != 0)
+            {
+                attributes.append("font-weight", "bold");
+            }
+            if ((text->GetTextStyle() & ETextStyle::ETS_Italic) != 0)
+            {
+                attributes.append("font-style", "italic");
+            }
+            if ((text->GetTextStyle() & ETextStyle::ETS_Underline) != 0)
+            {
+                attributes.append("text-decoration", "underline");
+            }
+        }
+        break;
+    default:
+        break;
+    }
+
+    if (element.isEmpty())
+    {
+        return;
+    }
+
+    xml.writeStartElement(element);
+    xml.writeAttribute("id", QString("shape-%1").arg(shape->GetId()));
+    xml.writeAttributes(attributes);
+    if (!content.isEmpty())
+    {
+        xml.writeCharacters(content);
+    }
+    xml.writeEndElement();
+}
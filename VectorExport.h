@@ -0,0 +1,84 @@
+#ifndef VECTOREXPORT_H
+#define VECTOREXPORT_H
+
+#include <QIODevice>
+#include <QImage>
+#include <QList>
+#include <QRectF>
+#include <QString>
+
+#include "GeometryShape.h"
+
+class QXmlStreamWriter;
+
+/**
+ * @brief The EVectorBackground enum 矢量导出时背景图的处理方式。
+ * - EVB_None: 不包含背景图。
+ * - EVB_Linked: 引用背景图文件（仅SVG，PDF按嵌入处理），油漆桶的填充作为单独的图层嵌入。
+ * - EVB_Embedded: 背景图分块编码为PNG嵌入文件。
+ */
+enum EVectorBackground
+{
+    EVB_None = 0,
+    EVB_Linked,
+    EVB_Embedded,
+};
+
+/**
+ * @brief The VectorExporter class 将图形导出为SVG/PDF矢量图。
+ * @details
+ * - SVG通过QXmlStreamWriter边生成边写入，不建立文档树；每个图形对应一个原生元素
+ *   （circle、line、path圆弧、rect、ellipse、polygon、polyline）。
+ * - PDF通过QPdfWriter绘制图形，圆弧、椭圆等输出为矢量路径，1个场景像素对应1pt。
+ * - 嵌入的背景图按BackgroundTileSize分块编码，内存占用与背景图大小无关；全透明的图块不写出。
+ * - 构造时复制图形，导出内容不含选中、拖拽等交互状态。
+ */
+class VectorExporter
+{
+public:
+    constexpr static int BackgroundTileSize = 1024;
+    /**
+     * @brief 没有背景图时，导出范围为所有图形的外接矩形向外扩展BoundsMargin像素。
+     */
+    constexpr static int BoundsMargin = 10;
+
+    explicit VectorExporter(const QList<GeometryShape *> &shapes);
+    ~VectorExporter();
+    VectorExporter(const VectorExporter&) = delete;
+    VectorExporter &operator=(const VectorExporter&) = delete;
+
+    /**
+     * @brief SetBackground 设置背景图，背景图位于场景坐标原点，导出范围变为背景图的范围。
+     * @param filePath 背景图文件，EVB_Linked时引用该文件。
+     */
+    void SetBackground(const QImage &image, const QString &filePath, EVectorBackground mode);
+    /**
+     * @brief SetFillOverlay 设置油漆桶的填充覆盖层，大小与背景图相同。
+     * @details 只在SVG引用背景图文件时使用，写在背景图之上的fill图层中；其它方式的背景图已含填充。
+     */
+    void SetFillOverlay(const QImage &overlay);
+    QRectF GetBounds() const
+    {
+        return _bounds;
+    }
+
+    bool WriteSvg(QIODevice *device) const;
+    bool WritePdf(const QString &path) const;
+
+private:
+    QList<GeometryShape *> _shapes;
+    QRectF _bounds;
+    QImage _background;
+    QString _backgroundPath;
+    EVectorBackground _backgroundMode;
+    QImage _fillOverlay;
+
+    void writeSvgBackground(QXmlStreamWriter &xml) const;
+    /**
+     * @brief writeSvgTiles 将image分块编码为PNG写为image元素，跳过全透明的图块。
+     */
+    static void writeSvgTiles(QXmlStreamWriter &xml, const QImage &image);
+    static void writeSvgShape(QXmlStreamWriter &xml, const GeometryShape *shape);
+};
+
+#endif // VECTOREXPORT_H